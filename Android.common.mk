@@ -140,6 +140,12 @@ LOCAL_CPPFLAGS += \
 LOCAL_C_INCLUDES += \
 	$(LOCAL_PATH)/common/compositor/vk \
 	$(LOCAL_PATH)/../mesa/include
+else ifeq ($(strip $(BOARD_USES_SW_COMPOSITOR)), true)
+LOCAL_CPPFLAGS += \
+	-DUSE_SW
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/common/compositor/sw
 else
 LOCAL_CPPFLAGS += \
 	-DUSE_GL
@@ -53,11 +53,9 @@ LOCAL_CFLAGS += \
 	-DUSE_VNDK
 endif
 
-#LOCAL_CPPFLAGS += \
-#	-DENABLE_DOWNSCALING
-
 LOCAL_SRC_FILES := \
         compositor/compositor.cpp \
+        compositor/compositorservice.cpp \
         compositor/compositorthread.cpp \
         compositor/factory.cpp \
         compositor/nativesurface.cpp \
@@ -70,15 +68,27 @@ LOCAL_SRC_FILES := \
 	core/logicaldisplaymanager.cpp \
 	core/mosaicdisplay.cpp \
         core/overlaylayer.cpp \
+        display/compositioncache.cpp \
         display/displayplanemanager.cpp \
 	display/displayplanestate.cpp \
+        display/idlepolicy.cpp \
+        display/marginestimator.cpp \
+        display/planeallocator.cpp \
+        display/planebroker.cpp \
+        display/planecostmodel.cpp \
+        display/planevalidationcache.cpp \
+        display/planevalidationstrategy.cpp \
+        display/surfacepool.cpp \
+        display/displaycommitthread.cpp \
         display/displayqueue.cpp \
         display/vblankeventhandler.cpp \
         display/virtualdisplay.cpp \
         utils/fdhandler.cpp \
         utils/hwcevent.cpp \
+        utils/synctimeline.cpp \
         utils/hwcthread.cpp \
         utils/hwcutils.cpp \
+        utils/timinghistogram.cpp \
         utils/disjoint_layers.cpp
 
 LOCAL_CPPFLAGS += -DUSE_GRALLOC1
@@ -159,13 +169,40 @@ LOCAL_SRC_FILES += \
         compositor/vk/vksurface.cpp \
         compositor/vk/nativevkresource.cpp \
         compositor/vk/vkshim.cpp
+else ifeq ($(strip $(BOARD_USES_SW_COMPOSITOR)), true)
+LOCAL_CPPFLAGS += \
+        -DUSE_SW
+
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/compositor/sw
+
+LOCAL_SRC_FILES += \
+        compositor/sw/nativeswresource.cpp \
+        compositor/sw/swkernels.cpp \
+        compositor/sw/swrenderer.cpp \
+        compositor/sw/swsurface.cpp \
+        compositor/sw/swthreadpool.cpp
 else
 LOCAL_CPPFLAGS += \
         -DUSE_GL \
         -DPREBUILT_SHADER_FILE_PATH='"/vendor/etc"'
 
+ifneq ($(strip $(HWC_SHADER_CACHE_DIR)),)
+LOCAL_CPPFLAGS += -DSHADER_CACHE_PATH='"$(HWC_SHADER_CACHE_DIR)"'
+endif
+
+ifeq ($(strip $(HWC_PRECOMPILE_GL_PROGRAMS)), true)
+LOCAL_CPPFLAGS += -DPRECOMPILE_GL_PROGRAMS
+endif
+
+ifeq ($(strip $(HWC_SHARED_COMPOSITOR)), true)
+LOCAL_CPPFLAGS += -DENABLE_SHARED_COMPOSITOR
+endif
+
 LOCAL_SRC_FILES += \
+        compositor/gl/glimportcache.cpp \
         compositor/gl/glprogram.cpp \
+        compositor/gl/glprogramcache.cpp \
         compositor/gl/glrenderer.cpp \
         compositor/gl/glsurface.cpp \
         compositor/gl/egloffscreencontext.cpp \
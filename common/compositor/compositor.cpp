@@ -54,17 +54,28 @@ void Compositor::BeginFrame(bool disable_explicit_sync) {
 void Compositor::Reset() {
   if (thread_)
     thread_->ExitThread();
+
+  std::vector<DrawState>().swap(draw_state_);
+  std::vector<DrawState>().swap(media_state_);
 }
 
 bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
-                      std::vector<OverlayLayer> &layers) {
+                      std::vector<OverlayLayer> &layers, bool wait) {
   CTRACE();
   const DisplayPlaneState *comp = NULL;
-  std::vector<size_t> dedicated_layers;
-  std::vector<DrawState> draw_state;
-  std::vector<DrawState> media_state;
-  std::vector<OverlayBuffer *> draw_buffers;
-  std::vector<HwcRect<int>> display_frame;
+  // States handed over to thread_ last frame are swapped back into
+  // draw_state_ and media_state_, release them before reusing storage.
+  frame_arena_.Recycle(dedicated_layers_);
+  frame_arena_.Recycle(draw_state_);
+  frame_arena_.Recycle(media_state_);
+  frame_arena_.Recycle(draw_buffers_);
+  frame_arena_.Recycle(display_frame_);
+  frame_arena_.EndFrame();
+  std::vector<size_t> &dedicated_layers = dedicated_layers_;
+  std::vector<DrawState> &draw_state = draw_state_;
+  std::vector<DrawState> &media_state = media_state_;
+  std::vector<OverlayBuffer *> &draw_buffers = draw_buffers_;
+  std::vector<HwcRect<int>> &display_frame = display_frame_;
   size_t  element_size = 0;
 
   for (auto &layer : layers) {
@@ -148,7 +159,7 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
                        surface->GetSurfaceDamage(), comp_regions);
       }
 
-      std::vector<size_t>().swap(dedicated_layers);
+      dedicated_layers.clear();
       if (comp_regions.empty())
         continue;
 
@@ -175,11 +186,26 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
 
   bool status = true;
   if (!draw_state.empty() || !media_state.empty())
-    status = thread_->Draw(draw_state, media_state, draw_buffers);
+    status = thread_->Draw(draw_state, media_state, draw_buffers, wait);
 
   return status;
 }
 
+bool Compositor::WaitForFrame() {
+  return thread_->WaitForDraw();
+}
+
+void Compositor::GetDrawCallStats(uint64_t *frames,
+                                  uint64_t *draw_calls) const {
+  if (!thread_) {
+    *frames = 0;
+    *draw_calls = 0;
+    return;
+  }
+
+  thread_->GetDrawCallStats(frames, draw_calls);
+}
+
 bool Compositor::DrawOffscreen(std::vector<OverlayLayer> &layers,
                                const std::vector<HwcRect<int>> &display_frame,
                                const std::vector<size_t> &source_layers,
@@ -309,87 +335,87 @@ void Compositor::RestoreVideoDefaultDeinterlace() {
 }
 
 // Below code is taken from drm_hwcomposer adopted to our needs.
+template <typename TIds>
 static std::vector<size_t> SetBitsToVector(
-    uint64_t in, const std::vector<size_t> &index_map) {
+    const TIds &in, size_t offset, const std::vector<size_t> &index_map) {
   std::vector<size_t> out;
-  size_t msb = sizeof(in) * 8 - 1;
-  uint64_t mask = (uint64_t)1 << msb;
-  for (size_t i = msb; mask != (uint64_t)0; i--, mask >>= 1)
-    if (in & mask)
+  for (size_t i = index_map.size(); i-- > 0;)
+    if (in.test(i + offset))
       out.emplace_back(index_map[i]);
   return out;
 }
 
-void Compositor::SeparateLayers(const std::vector<size_t> &dedicated_layers,
-                                const std::vector<size_t> &source_layers,
-                                const std::vector<HwcRect<int>> &display_frame,
-                                const HwcRect<int> &damage_region,
-                                std::vector<CompositionRegion> &comp_regions) {
-  CTRACE();
-  if (source_layers.size() > 64) {
-    ETRACE("Failed to separate layers because there are more than 64");
-    return;
-  }
-
-  size_t num_exclude_rects = 0;
+template <typename TIds>
+static void SeparateRegions(const std::vector<size_t> &dedicated_layers,
+                            const std::vector<size_t> &source_layers,
+                            const std::vector<HwcRect<int>> &layer_rects,
+                            const HwcRect<int> &damage_region,
+                            std::vector<CompositionRegion> &comp_regions) {
+  std::vector<RectSet<int, TIds>> separate_regions;
+  get_draw_regions(layer_rects, damage_region, &separate_regions);
   // Index at which the actual layers begin
   size_t layer_offset = dedicated_layers.size();
-  if (source_layers.size() + layer_offset > 64) {
-    WTRACE(
-        "Exclusion rectangles are being truncated to make the rectangle count "
-        "fit into 64");
-    num_exclude_rects = 64 - source_layers.size() - dedicated_layers.size();
-  }
-
-  // We inject all the exclude rects into the rects list. Any resulting rect
-  // that includes ANY of the first num_exclude_rects is rejected. After the
-  // exclude rects, we add the lower layers. The rects that intersect with
-  // these layers will be inspected and only those which are to be composited
-  // above the layer will be included in the composition regions.
-  std::vector<HwcRect<int>> layer_rects(source_layers.size() + layer_offset);
-  std::transform(
-      dedicated_layers.begin(), dedicated_layers.end(),
-      layer_rects.begin() + num_exclude_rects,
-      [=](size_t layer_index) { return display_frame[layer_index]; });
-  std::transform(source_layers.begin(), source_layers.end(),
-                 layer_rects.begin() + layer_offset, [=](size_t layer_index) {
-                   return display_frame[layer_index];
-                 });
-
-  std::vector<RectSet<int>> separate_regions;
-  get_draw_regions(layer_rects, damage_region, &separate_regions);
-  uint64_t exclude_mask = ((uint64_t)1 << num_exclude_rects) - 1;
-  uint64_t dedicated_mask = (((uint64_t)1 << dedicated_layers.size()) - 1)
-                            << num_exclude_rects;
-
-  for (RectSet<int> &region : separate_regions) {
-    if (region.id_set.getBits() & exclude_mask)
-      continue;
-
+  for (RectSet<int, TIds> &region : separate_regions) {
     // If a rect intersects one of the dedicated layers, we need to remove the
     // layers from the composition region which appear *below* the dedicated
     // layer. This effectively punches a hole through the composition layer such
     // that the dedicated layer can be placed below the composition and not
     // be occluded.
-    uint64_t dedicated_intersect = region.id_set.getBits() & dedicated_mask;
-    for (size_t i = 0; dedicated_intersect && i < dedicated_layers.size();
-         ++i) {
+    for (size_t i = 0; i < dedicated_layers.size(); ++i) {
       // Only exclude layers if they intersect this particular dedicated layer
-      if (!(dedicated_intersect & (1 << (i + num_exclude_rects))))
+      if (!region.id_set.test(i))
         continue;
 
+      region.id_set.subtract(i);
       for (size_t j = 0; j < source_layers.size(); ++j) {
         if (source_layers[j] < dedicated_layers[i])
           region.id_set.subtract(j + layer_offset);
       }
     }
 
-    if (!(region.id_set.getBits() >> layer_offset))
+    if (region.id_set.isEmpty())
       continue;
 
     comp_regions.emplace_back(CompositionRegion{
-        region.rect, SetBitsToVector(region.id_set.getBits() >> layer_offset,
-                                     source_layers)});
+        region.rect,
+        SetBitsToVector(region.id_set, layer_offset, source_layers)});
+  }
+}
+
+void Compositor::SeparateLayers(const std::vector<size_t> &dedicated_layers,
+                                const std::vector<size_t> &source_layers,
+                                const std::vector<HwcRect<int>> &display_frame,
+                                const HwcRect<int> &damage_region,
+                                std::vector<CompositionRegion> &comp_regions) {
+  CTRACE();
+  size_t num_rects = dedicated_layers.size() + source_layers.size();
+  if (num_rects > WideRectIDs::max_elements) {
+    ETRACE("Failed to separate layers because there are more than %d",
+           WideRectIDs::max_elements);
+    return;
+  }
+
+  // We inject the dedicated layers into the rects list, followed by the
+  // layers to be composited. The rects that intersect with the dedicated
+  // layers will be inspected and only those which are to be composited
+  // above the layer will be included in the composition regions.
+  std::vector<HwcRect<int>> layer_rects(num_rects);
+  std::transform(
+      dedicated_layers.begin(), dedicated_layers.end(), layer_rects.begin(),
+      [=](size_t layer_index) { return display_frame[layer_index]; });
+  std::transform(source_layers.begin(), source_layers.end(),
+                 layer_rects.begin() + dedicated_layers.size(),
+                 [=](size_t layer_index) {
+                   return display_frame[layer_index];
+                 });
+
+  // Almost all compositions fit in a single word of rect ids.
+  if (num_rects <= RectIDs::max_elements) {
+    SeparateRegions<RectIDs>(dedicated_layers, source_layers, layer_rects,
+                             damage_region, comp_regions);
+  } else {
+    SeparateRegions<WideRectIDs>(dedicated_layers, source_layers, layer_rects,
+                                 damage_region, comp_regions);
   }
 }
 
@@ -26,6 +26,7 @@
 #include "compositorthread.h"
 #include "displayplanestate.h"
 #include "factory.h"
+#include "framearena.h"
 #include "renderstate.h"
 
 namespace hwcomposer {
@@ -44,7 +45,13 @@ class Compositor {
   void Init(ResourceManager *buffer_manager, uint32_t gpu_fd);
   void Reset();
   void BeginFrame(bool disable_explicit_sync);
-  bool Draw(DisplayPlaneStateList &planes, std::vector<OverlayLayer> &layers);
+  // In case wait is false, rendering is only kicked off and WaitForFrame
+  // needs to be called before the planes can be committed.
+  bool Draw(DisplayPlaneStateList &planes, std::vector<OverlayLayer> &layers,
+            bool wait = true);
+  bool WaitForFrame();
+  // See CompositorThread::GetDrawCallStats.
+  void GetDrawCallStats(uint64_t *frames, uint64_t *draw_calls) const;
   bool DrawOffscreen(std::vector<OverlayLayer> &layers,
                      const std::vector<HwcRect<int>> &display_frame,
                      const std::vector<size_t> &source_layers,
@@ -79,6 +86,13 @@ class Compositor {
   HWCColorMap colors_;
   uint32_t scaling_mode_ = 0;
   HWCDeinterlaceProp deinterlace_;
+  // Storage used by Draw, kept around to avoid allocations every frame.
+  FrameArena frame_arena_;
+  std::vector<size_t> dedicated_layers_;
+  std::vector<DrawState> draw_state_;
+  std::vector<DrawState> media_state_;
+  std::vector<OverlayBuffer *> draw_buffers_;
+  std::vector<HwcRect<int>> display_frame_;
 };
 
 }  // namespace hwcomposer
@@ -75,6 +75,16 @@ typedef struct vk_import {
 } ResourceHandle;
 
 typedef VkDevice GpuDisplay;
+#elif USE_SW
+class NativeBufferHandler;
+typedef struct sw_import {
+  HWCNativeHandle handle_ = 0;
+  uint32_t drm_fd_ = 0;
+  // Used to map handle_ for CPU access.
+  const NativeBufferHandler* handler_ = 0;
+} ResourceHandle;
+typedef const ResourceHandle* GpuResourceHandle;
+typedef void* GpuDisplay;
 #else
 typedef unsigned GpuResourceHandle;
 typedef void* ResourceHandle;
@@ -0,0 +1,201 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "compositorservice.h"
+
+#include "hwctrace.h"
+#include "nativegpuresource.h"
+#include "renderer.h"
+
+namespace hwcomposer {
+
+// Workers shared by all displays. Displays are mostly composited at the
+// same time around vblank, a second worker keeps one of them from waiting
+// for the other.
+static const uint32_t kWorkers = 2;
+
+CompositorService::Worker::Worker(CompositorService *service, uint32_t index)
+    : HWCThread(-8, "CompositorWorker"), service_(service), index_(index) {
+}
+
+CompositorService::Worker::~Worker() {
+  Exit();
+}
+
+bool CompositorService::Worker::Initialize() {
+  if (!InitWorker()) {
+    ETRACE("Failed to initalize CompositorWorker. %s", PRINTERROR());
+    return false;
+  }
+
+  return true;
+}
+
+void CompositorService::Worker::Wake() {
+  Resume();
+}
+
+void CompositorService::Worker::HandleRoutine() {
+  CompositorServiceClient *client = service_->Take(index_);
+  while (client) {
+    client->HandleTasks(renderers_);
+    service_->Done(client);
+    client = service_->Take(index_);
+  }
+}
+
+void CompositorService::Worker::HandleExit() {
+  renderers_.gl_renderer_.reset(nullptr);
+  renderers_.media_renderer_.reset(nullptr);
+  renderers_.gpu_resource_handler_.reset(nullptr);
+}
+
+CompositorService &CompositorService::getInstance() {
+  // Never destroyed, as displays might still be torn down while static
+  // objects are destroyed at exit.
+  static CompositorService *service = new CompositorService();
+  return *service;
+}
+
+bool CompositorService::AddClient(CompositorServiceClient *client) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (workers_.empty()) {
+    for (uint32_t i = 0; i < kWorkers; i++) {
+      std::unique_ptr<Worker> worker(new Worker(this, workers_.size()));
+      if (worker->Initialize())
+        workers_.emplace_back(std::move(worker));
+    }
+
+    queues_.resize(workers_.size());
+    busy_.resize(workers_.size(), false);
+  }
+
+  if (workers_.empty())
+    return false;
+
+  if (GetClient(client))
+    return true;
+
+  ClientInfo info;
+  info.client_ = client;
+  info.home_ = next_home_++ % workers_.size();
+  info.state_ = kIdle;
+  clients_.emplace_back(info);
+  return true;
+}
+
+void CompositorService::RemoveClient(CompositorServiceClient *client) {
+  std::unique_lock<std::mutex> lock(lock_);
+  idle_.wait(lock, [this, client] {
+    ClientInfo *info = GetClient(client);
+    return !info || info->state_ == kIdle;
+  });
+
+  ClientInfo *info = GetClient(client);
+  if (info)
+    clients_.erase(clients_.begin() + (info - clients_.data()));
+}
+
+void CompositorService::Queue(CompositorServiceClient *client) {
+  std::lock_guard<std::mutex> lock(lock_);
+  ClientInfo *info = GetClient(client);
+  if (!info) {
+    ETRACE("CompositorService: Tasks queued by unknown client.");
+    return;
+  }
+
+  switch (info->state_) {
+    case kIdle:
+      Enqueue(info);
+      break;
+    case kRunning:
+      info->state_ = kRunningQueued;
+      break;
+    default:
+      break;
+  }
+}
+
+CompositorService::ClientInfo *CompositorService::GetClient(
+    CompositorServiceClient *client) {
+  for (ClientInfo &info : clients_) {
+    if (info.client_ == client)
+      return &info;
+  }
+
+  return NULL;
+}
+
+void CompositorService::Enqueue(ClientInfo *info) {
+  info->state_ = kQueued;
+  queues_.at(info->home_).emplace_back(info->client_);
+  workers_.at(info->home_)->Wake();
+  if (!busy_.at(info->home_))
+    return;
+
+  // Let an idle worker steal the client.
+  for (uint32_t i = 0; i < workers_.size(); i++) {
+    if (!busy_.at(i)) {
+      workers_.at(i)->Wake();
+      break;
+    }
+  }
+}
+
+CompositorServiceClient *CompositorService::Take(uint32_t worker) {
+  std::lock_guard<std::mutex> lock(lock_);
+  CompositorServiceClient *client = NULL;
+  std::deque<CompositorServiceClient *> &own = queues_.at(worker);
+  if (!own.empty()) {
+    client = own.front();
+    own.pop_front();
+  } else {
+    // Steal the most recently queued client of another worker, the oldest
+    // one is likely to be taken by its home worker next.
+    uint32_t size = queues_.size();
+    for (uint32_t i = 1; i < size && !client; i++) {
+      std::deque<CompositorServiceClient *> &other =
+          queues_.at((worker + i) % size);
+      if (!other.empty()) {
+        client = other.back();
+        other.pop_back();
+      }
+    }
+  }
+
+  busy_.at(worker) = client != NULL;
+  if (client)
+    GetClient(client)->state_ = kRunning;
+
+  return client;
+}
+
+void CompositorService::Done(CompositorServiceClient *client) {
+  std::lock_guard<std::mutex> lock(lock_);
+  ClientInfo *info = GetClient(client);
+  if (!info)
+    return;
+
+  if (info->state_ == kRunningQueued) {
+    Enqueue(info);
+    return;
+  }
+
+  info->state_ = kIdle;
+  idle_.notify_all();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,110 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_COMPOSITORSERVICE_H_
+#define COMMON_COMPOSITOR_COMPOSITORSERVICE_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "compositorthread.h"
+#include "hwcthread.h"
+
+namespace hwcomposer {
+
+// Composites for all displays with a small pool of workers, instead of
+// every CompositorThread running a thread with its own renderers. Each
+// client is queued with its home worker, idle workers steal clients
+// queued with busy ones, so that a display with heavy composition doesn't
+// hold up the others.
+//
+// A client is handled by one worker at a time, in the order its tasks
+// were queued. Renderers belong to the workers, so clients must not rely
+// on any per context state between requests.
+class CompositorService {
+ public:
+  static CompositorService& getInstance();
+
+  // Starts the workers with the first client. Returns false in case
+  // there are no workers, client needs to run its own thread then.
+  bool AddClient(CompositorServiceClient* client);
+
+  // Waits for client's queued tasks to be handled and forgets about it.
+  void RemoveClient(CompositorServiceClient* client);
+
+  // Queues client, its tasks are handled by the next worker available.
+  void Queue(CompositorServiceClient* client);
+
+ private:
+  class Worker : public HWCThread {
+   public:
+    Worker(CompositorService* service, uint32_t index);
+    ~Worker() override;
+
+    bool Initialize();
+    void Wake();
+
+   protected:
+    void HandleRoutine() override;
+    void HandleExit() override;
+
+   private:
+    CompositorService* service_;
+    uint32_t index_;
+    CompositorRenderers renderers_;
+  };
+
+  enum ClientState {
+    kIdle,
+    kQueued,
+    kRunning,
+    kRunningQueued  // Queued again while being handled.
+  };
+
+  struct ClientInfo {
+    CompositorServiceClient* client_;
+    uint32_t home_;
+    ClientState state_;
+  };
+
+  CompositorService() = default;
+  ~CompositorService() = default;
+
+  ClientInfo* GetClient(CompositorServiceClient* client);
+  // Pushes client to the queue of its home worker and wakes workers which
+  // can handle it. Needs lock_ to be held.
+  void Enqueue(ClientInfo* info);
+  // Returns the next client to be handled by worker, NULL in case there
+  // is none.
+  CompositorServiceClient* Take(uint32_t worker);
+  void Done(CompositorServiceClient* client);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::deque<CompositorServiceClient*>> queues_;
+  std::vector<bool> busy_;
+  std::vector<ClientInfo> clients_;
+  uint32_t next_home_ = 0;
+  std::mutex lock_;
+  std::condition_variable idle_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_COMPOSITORSERVICE_H_
@@ -17,6 +17,9 @@
 #include "compositorthread.h"
 
 #include <nativebufferhandler.h>
+#ifdef ENABLE_SHARED_COMPOSITOR
+#include "compositorservice.h"
+#endif
 #include "displayplanemanager.h"
 #include "framebuffermanager.h"
 #include "gpudevice.h"
@@ -38,18 +41,25 @@ CompositorThread::CompositorThread() : HWCThread(-8, "CompositorThread") {
 }
 
 CompositorThread::~CompositorThread() {
+#ifdef ENABLE_SHARED_COMPOSITOR
+  if (shared_)
+    CompositorService::getInstance().RemoveClient(this);
+#endif
 }
 
 void CompositorThread::Initialize(ResourceManager *resource_manager,
                                   uint32_t gpu_fd) {
   fb_manager_ = GpuDevice::getInstance().GetFrameBufferManager();
   tasks_lock_.lock();
-  if (!gpu_resource_handler_)
-    gpu_resource_handler_.reset(CreateNativeGpuResourceHandler());
-
   resource_manager_ = resource_manager;
   gpu_fd_ = gpu_fd;
   tasks_lock_.unlock();
+#ifdef ENABLE_SHARED_COMPOSITOR
+  shared_ = CompositorService::getInstance().AddClient(this);
+  if (shared_)
+    return;
+#endif
+
   if (!InitWorker()) {
     ETRACE("Failed to initalize CompositorThread. %s", PRINTERROR());
   }
@@ -63,6 +73,23 @@ void CompositorThread::FreeResources() {
   tasks_lock_.lock();
   tasks_ |= kReleaseResources;
   tasks_lock_.unlock();
+  Kick();
+}
+
+void CompositorThread::GetDrawCallStats(uint64_t *frames,
+                                        uint64_t *draw_calls) const {
+  *frames = composed_frames_;
+  *draw_calls = draw_calls_;
+}
+
+void CompositorThread::Kick() {
+#ifdef ENABLE_SHARED_COMPOSITOR
+  if (shared_) {
+    CompositorService::getInstance().Queue(this);
+    return;
+  }
+#endif
+
   Resume();
 }
 
@@ -81,7 +108,14 @@ void CompositorThread::Wait() {
 
 bool CompositorThread::Draw(std::vector<DrawState> &states,
                             std::vector<DrawState> &media_states,
-                            const std::vector<OverlayBuffer *> &buffers) {
+                            const std::vector<OverlayBuffer *> &buffers,
+                            bool wait) {
+  // Make sure the thread is done with any previous request before
+  // handing over new states.
+  if (draw_pending_ && !WaitForDraw()) {
+    ETRACE("Previous draw request failed.");
+  }
+
   states_.swap(states);
   tasks_lock_.lock();
 
@@ -106,37 +140,64 @@ bool CompositorThread::Draw(std::vector<DrawState> &states,
     return draw_succeeded_;
   }
 
-  Resume();
+  Kick();
+  if (!wait) {
+    draw_pending_ = true;
+    return true;
+  }
+
+  Wait();
+  return draw_succeeded_;
+}
+
+bool CompositorThread::WaitForDraw() {
+  if (!draw_pending_)
+    return draw_succeeded_;
+
   Wait();
+  draw_pending_ = false;
   return draw_succeeded_;
 }
 
 void CompositorThread::ExitThread() {
+#ifdef ENABLE_SHARED_COMPOSITOR
+  if (shared_) {
+    // Renderers belong to the workers, only resources need to be released.
+    FreeResources();
+    CompositorService::getInstance().RemoveClient(this);
+    shared_ = false;
+  }
+#endif
+
   HWCThread::Exit();
   std::vector<DrawState>().swap(states_);
   std::vector<OverlayBuffer *>().swap(buffers_);
 }
 
 void CompositorThread::HandleExit() {
-  HandleReleaseRequest();
-  gl_renderer_.reset(nullptr);
-  gpu_resource_handler_.reset(nullptr);
+  HandleReleaseRequest(renderers_);
+  renderers_.gl_renderer_.reset(nullptr);
+  renderers_.gpu_resource_handler_.reset(nullptr);
 }
 
 void CompositorThread::HandleRoutine() {
+  HandleTasks(renderers_);
+}
+
+void CompositorThread::HandleTasks(CompositorRenderers &renderers) {
   bool signal = false;
   if (tasks_ & kRender3D) {
-    Handle3DDrawRequest();
+    Handle3DDrawRequest(renderers);
     signal = true;
   }
 
   if (tasks_ & kRenderMedia) {
-    HandleMediaDrawRequest();
+    HandleMediaDrawRequest(renderers);
     signal = true;
   }
 
   if (tasks_ & kReleaseResources) {
-    HandleReleaseRequest();
+    HandleReleaseRequest(renderers);
   }
 
   if (signal) {
@@ -144,7 +205,7 @@ void CompositorThread::HandleRoutine() {
   }
 }
 
-void CompositorThread::HandleReleaseRequest() {
+void CompositorThread::HandleReleaseRequest(CompositorRenderers &renderers) {
   ScopedSpinLock lock(tasks_lock_);
   tasks_ &= ~kReleaseResources;
 
@@ -157,8 +218,8 @@ void CompositorThread::HandleReleaseRequest() {
 
   if (purged_size != 0) {
     if (has_gpu_resource) {
-      Ensure3DRenderer();
-      gpu_resource_handler_->ReleaseGPUResources(purged_gl_resources);
+      Ensure3DRenderer(renderers);
+      renderers.gpu_resource_handler_->ReleaseGPUResources(purged_gl_resources);
     }
 
     const NativeBufferHandler *handler =
@@ -181,8 +242,8 @@ void CompositorThread::HandleReleaseRequest() {
   purged_size = purged_media_resources.size();
 
   if (purged_size != 0) {
-    EnsureMediaRenderer();
-    media_renderer_->DestroyMediaResources(purged_media_resources);
+    EnsureMediaRenderer(renderers);
+    renderers.media_renderer_->DestroyMediaResources(purged_media_resources);
 
     const NativeBufferHandler *handler =
         resource_manager_->GetNativeBufferHandler();
@@ -201,20 +262,23 @@ void CompositorThread::HandleReleaseRequest() {
   }
 }
 
-void CompositorThread::Handle3DDrawRequest() {
+void CompositorThread::Handle3DDrawRequest(CompositorRenderers &renderers) {
   tasks_lock_.lock();
   tasks_ &= ~kRender3D;
   tasks_lock_.unlock();
 
-  Ensure3DRenderer();
-  if (!gl_renderer_) {
+  Ensure3DRenderer(renderers);
+  if (!renderers.gl_renderer_) {
     draw_succeeded_ = false;
     return;
   }
 
-  gl_renderer_->SetDisableExplicitSync(disable_explicit_sync_);
+  Renderer *gl_renderer = renderers.gl_renderer_.get();
+  NativeGpuResource *gpu_resource_handler =
+      renderers.gpu_resource_handler_.get();
+  gl_renderer->SetDisableExplicitSync(disable_explicit_sync_);
 
-  if (!gpu_resource_handler_->PrepareResources(buffers_)) {
+  if (!gpu_resource_handler->PrepareResources(buffers_)) {
     ETRACE(
         "Failed to prepare GPU resources for compositing the frame, "
         "error: %s",
@@ -223,6 +287,7 @@ void CompositorThread::Handle3DDrawRequest() {
     return;
   }
 
+  uint64_t draw_calls = 0;
   size_t size = states_.size();
   for (size_t i = 0; i < size; i++) {
     DrawState &draw_state = states_.at(i);
@@ -232,18 +297,18 @@ void CompositorThread::Handle3DDrawRequest() {
 
       for (RenderState::LayerState &temp : layer_state) {
         temp.handle_ =
-            gpu_resource_handler_->GetResourceHandle(temp.layer_index_);
+            gpu_resource_handler->GetResourceHandle(temp.layer_index_);
       }
     }
 
     const std::vector<int32_t> &fences = draw_state.acquire_fences_;
     for (int32_t fence : fences) {
-      gl_renderer_->InsertFence(fence);
+      gl_renderer->InsertFence(fence);
     }
 
     std::vector<int32_t>().swap(draw_state.acquire_fences_);
 
-    if (!gl_renderer_->Draw(draw_state.states_, draw_state.surface_)) {
+    if (!gl_renderer->Draw(draw_state.states_, draw_state.surface_)) {
       ETRACE(
           "Failed to Draw: "
           "error: %s",
@@ -252,6 +317,7 @@ void CompositorThread::Handle3DDrawRequest() {
       break;
     }
 
+    draw_calls += gl_renderer->GetDrawCallCount();
     if (draw_state.destroy_surface_) {
       if (draw_succeeded_) {
         draw_state.retire_fence_ =
@@ -263,16 +329,20 @@ void CompositorThread::Handle3DDrawRequest() {
   }
 
   if (disable_explicit_sync_)
-    gl_renderer_->InsertFence(-1);
+    gl_renderer->InsertFence(-1);
+
+  composed_frames_++;
+  draw_calls_ += draw_calls;
 }
 
-void CompositorThread::HandleMediaDrawRequest() {
+void CompositorThread::HandleMediaDrawRequest(
+    CompositorRenderers &renderers) {
   tasks_lock_.lock();
   tasks_ &= ~kRenderMedia;
   tasks_lock_.unlock();
 
-  EnsureMediaRenderer();
-  if (!media_renderer_) {
+  EnsureMediaRenderer(renderers);
+  if (!renderers.media_renderer_) {
     draw_succeeded_ = false;
     return;
   }
@@ -280,7 +350,8 @@ void CompositorThread::HandleMediaDrawRequest() {
   size_t size = media_states_.size();
   for (size_t i = 0; i < size; i++) {
     DrawState &draw_state = media_states_[i];
-    if (!media_renderer_->Draw(draw_state.media_state_, draw_state.surface_)) {
+    if (!renderers.media_renderer_->Draw(draw_state.media_state_,
+                                         draw_state.surface_)) {
       ETRACE(
           "Failed to render the frame by VA, "
           "error: %s\n",
@@ -291,22 +362,25 @@ void CompositorThread::HandleMediaDrawRequest() {
   }
 }
 
-void CompositorThread::Ensure3DRenderer() {
-  if (!gl_renderer_) {
-    gl_renderer_.reset(Create3DRenderer());
-    if (!gl_renderer_->Init()) {
+void CompositorThread::Ensure3DRenderer(CompositorRenderers &renderers) {
+  if (!renderers.gpu_resource_handler_)
+    renderers.gpu_resource_handler_.reset(CreateNativeGpuResourceHandler());
+
+  if (!renderers.gl_renderer_) {
+    renderers.gl_renderer_.reset(Create3DRenderer());
+    if (!renderers.gl_renderer_->Init()) {
       ETRACE("Failed to initialize OpenGL compositor %s", PRINTERROR());
-      gl_renderer_.reset(nullptr);
+      renderers.gl_renderer_.reset(nullptr);
     }
   }
 }
 
-void CompositorThread::EnsureMediaRenderer() {
-  if (!media_renderer_) {
-    media_renderer_.reset(CreateMediaRenderer());
-    if (!media_renderer_->Init(gpu_fd_)) {
+void CompositorThread::EnsureMediaRenderer(CompositorRenderers &renderers) {
+  if (!renderers.media_renderer_) {
+    renderers.media_renderer_.reset(CreateMediaRenderer());
+    if (!renderers.media_renderer_->Init(gpu_fd_)) {
       ETRACE("Failed to initialize Media Renderer %s", PRINTERROR());
-      media_renderer_.reset(nullptr);
+      renderers.media_renderer_.reset(nullptr);
     }
   }
 }
@@ -20,6 +20,7 @@
 #include <platformdefines.h>
 #include <spinlock.h>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -38,20 +39,54 @@ class ResourceManager;
 class NativeBufferHandler;
 class FrameBufferManager;
 
-class CompositorThread : public HWCThread {
+// Renderers and GPU resources used to handle requests. Owned by the
+// thread, or by a CompositorService worker in case the thread is shared.
+struct CompositorRenderers {
+  std::unique_ptr<Renderer> gl_renderer_;
+  std::unique_ptr<Renderer> media_renderer_;
+  std::unique_ptr<NativeGpuResource> gpu_resource_handler_;
+};
+
+// Requests of a display, which can be handled by a CompositorService
+// worker.
+class CompositorServiceClient {
+ public:
+  virtual ~CompositorServiceClient() {
+  }
+
+  // Handles the queued tasks with renderers of the worker.
+  virtual void HandleTasks(CompositorRenderers& renderers) = 0;
+};
+
+class CompositorThread : public HWCThread, public CompositorServiceClient {
  public:
   CompositorThread();
   ~CompositorThread() override;
 
   void Initialize(ResourceManager* resource_manager, uint32_t gpu_fd);
 
+  // Queues states to be rendered. In case wait is false, returns as soon
+  // as the work has been handed over to the thread and WaitForDraw needs
+  // to be called before the rendered surfaces are used.
   bool Draw(std::vector<DrawState>& states,
             std::vector<DrawState>& media_states,
-            const std::vector<OverlayBuffer*>& buffers);
+            const std::vector<OverlayBuffer*>& buffers, bool wait = true);
+
+  // Waits for any Draw request which is still being handled. Returns
+  // false in case it failed.
+  bool WaitForDraw();
 
   void SetDisableExplicitSync(bool disable_explicit_sync);
   void FreeResources();
 
+  // Returns the number of frames composed with the 3D renderer and the
+  // draw calls issued for them. Can be called from any thread.
+  void GetDrawCallStats(uint64_t* frames, uint64_t* draw_calls) const;
+
+  // Handles the queued tasks with renderers. Called on the thread or by
+  // the CompositorService worker handling this thread's requests.
+  void HandleTasks(CompositorRenderers& renderers) override;
+
   void HandleRoutine() override;
   void HandleExit() override;
   void ExitThread();
@@ -64,29 +99,36 @@ class CompositorThread : public HWCThread {
     kReleaseResources = 1 << 3  // Release surfaces from plane manager.
   };
 
-  void Handle3DDrawRequest();
-  void HandleMediaDrawRequest();
-  void HandleReleaseRequest();
+  void Handle3DDrawRequest(CompositorRenderers& renderers);
+  void HandleMediaDrawRequest(CompositorRenderers& renderers);
+  void HandleReleaseRequest(CompositorRenderers& renderers);
   void Wait();
-  void Ensure3DRenderer();
-  void EnsureMediaRenderer();
+  // Hands queued tasks over to the thread or the CompositorService.
+  void Kick();
+  void Ensure3DRenderer(CompositorRenderers& renderers);
+  void EnsureMediaRenderer(CompositorRenderers& renderers);
 
   SpinLock tasks_lock_;
-  std::unique_ptr<Renderer> gl_renderer_;
-  std::unique_ptr<Renderer> media_renderer_;
-  std::unique_ptr<NativeGpuResource> gpu_resource_handler_;
+  CompositorRenderers renderers_;
   std::vector<OverlayBuffer*> buffers_;
   std::vector<DrawState> states_;
   std::vector<DrawState> media_states_;
   std::vector<ResourceHandle> purged_resources_;
   bool disable_explicit_sync_ = false;
   bool draw_succeeded_ = false;
+  bool draw_pending_ = false;
   ResourceManager* resource_manager_ = NULL;
   uint32_t tasks_ = kNone;
   uint32_t gpu_fd_ = 0;
   FDHandler fd_chandler_;
   HWCEvent cevent_;
   FrameBufferManager* fb_manager_ = NULL;
+  std::atomic<uint64_t> composed_frames_{0};
+  std::atomic<uint64_t> draw_calls_{0};
+#ifdef ENABLE_SHARED_COMPOSITOR
+  // Requests are handled by CompositorService.
+  bool shared_ = false;
+#endif
 };
 
 }  // namespace hwcomposer
@@ -17,9 +17,32 @@
 #include "egloffscreencontext.h"
 
 #include "hwctrace.h"
+#ifdef ENABLE_SHARED_COMPOSITOR
+#include "spinlock.h"
+#endif
 
 namespace hwcomposer {
 
+#ifdef ENABLE_SHARED_COMPOSITOR
+// Compositor workers draw for any display, so all contexts share textures
+// with a context which is never made current and lives as long as the
+// process.
+static EGLContext GetShareContext(EGLDisplay egl_display, EGLConfig config,
+                                  const EGLint* context_attribs) {
+  static SpinLock share_lock;
+  static EGLContext share_context = EGL_NO_CONTEXT;
+  ScopedSpinLock lock(share_lock);
+  if (share_context == EGL_NO_CONTEXT) {
+    share_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT,
+                                     context_attribs);
+    if (share_context == EGL_NO_CONTEXT)
+      ETRACE("Failed to create shared EGL Context.");
+  }
+
+  return share_context;
+}
+#endif
+
 EGLOffScreenContext::EGLOffScreenContext()
     : egl_display_(EGL_NO_DISPLAY), egl_ctx_(EGL_NO_CONTEXT) {
 }
@@ -57,7 +80,11 @@ bool EGLOffScreenContext::Init() {
     return false;
   }
 
-  egl_ctx_ = eglCreateContext(egl_display_, egl_config, EGL_NO_CONTEXT,
+  EGLContext share_context = EGL_NO_CONTEXT;
+#ifdef ENABLE_SHARED_COMPOSITOR
+  share_context = GetShareContext(egl_display_, egl_config, context_attribs);
+#endif
+  egl_ctx_ = eglCreateContext(egl_display_, egl_config, share_context,
                               context_attribs);
 
   if (egl_ctx_ == EGL_NO_CONTEXT) {
@@ -17,7 +17,8 @@ TARGET_PCI_ID=$1
 OUT_DIR=$SHADER_PRE_BUILT_PATH/shader_prog_arrays
 OUT_HEADER=$SHADER_PRE_BUILT_PATH/glprebuiltshaderarray.h
 
-SHADER_TEST_FILE_PREFIX=hwc_shader_prog_
+# Versioned by generate_shader_test.sh.
+SHADER_TEST_FILE_PREFIX=hwc_shader_prog_v2_
 SHADER_TEST_FOLDER=$SHADER_PRE_BUILT_PATH/shader-test
 BIN_TO_ARRAY=$SHADER_PRE_BUILT_PATH/bin_to_c_array
 SHADER_DB_DIR=$SHADER_PRE_BUILT_PATH/shader-db
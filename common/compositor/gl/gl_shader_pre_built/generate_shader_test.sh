@@ -25,22 +25,27 @@ shader_test+="#version 300 es\n"
 shader_test+="#define LAYER_COUNT "
 shader_test+="$layer_cnt\n"
 
-shader_test+="precision mediump int;\n"
-shader_test+="uniform vec4 uViewport;\n"
-shader_test+="uniform vec4 uLayerCrop[LAYER_COUNT];\n"
+# Has to match GLProgram::GetBatchSize.
+batch_size=$(( 192 / $layer_cnt ))
+shader_test+="#define BATCH_SIZE "
+shader_test+="$batch_size\n"
+
+shader_test+="precision highp int;\n"
+shader_test+="uniform int uFirstRegion;\n"
+shader_test+="uniform vec4 uLayerCrop[LAYER_COUNT * BATCH_SIZE];\n"
 shader_test+="uniform mat2 uTexMatrix[LAYER_COUNT];\n"
 shader_test+="in vec2 vPosition;\n"
 shader_test+="in vec2 vTexCoords;\n"
 shader_test+="out vec2 fTexCoords[LAYER_COUNT];\n"
 shader_test+="void main() {\n"
+shader_test+="  int crop = (gl_VertexID / 6 - uFirstRegion) * LAYER_COUNT;\n"
 shader_test+="  for (int i = 0; i < LAYER_COUNT; i++) {\n"
 shader_test+="    vec2 tempCoords = vTexCoords * uTexMatrix[i];\n"
-shader_test+="    fTexCoords[i] =\n"
-shader_test+="        uLayerCrop[i].xy + tempCoords * uLayerCrop[i].zw;\n"
+shader_test+="    fTexCoords[i] = uLayerCrop[crop + i].xy +\n"
+shader_test+="                    tempCoords * uLayerCrop[crop + i].zw;\n"
 shader_test+="  }\n"
-shader_test+="  vec2 scaledPosition = uViewport.xy + vPosition * uViewport.zw;\n"
 shader_test+="  gl_Position =\n"
-shader_test+="      vec4(scaledPosition * vec2(2.0) - vec2(1.0), 0.0, 1.0);\n"
+shader_test+="      vec4(vPosition * vec2(2.0) - vec2(1.0), 0.0, 1.0);\n"
 shader_test+="}\n"
 
 # fragment shader creation
@@ -100,8 +105,11 @@ done
 shader_test+="  oFragColor = vec4(color, 1.0 - alphaCover);\n"
 shader_test+="}\n"
 
-outfile_name=hwc_shader_prog_$layer_cnt.shader_test
+# Has to match PREBUILT_SHADER_VERSION in glprogram.cpp, binaries of
+# older versions aren't loaded.
+shader_version=2
+outfile_name=hwc_shader_prog_v${shader_version}_$layer_cnt.shader_test
 
-echo -e "$shader_test" > hwc_shader_prog_$layer_cnt.shader_test
+echo -e "$shader_test" > $outfile_name
 
 echo "$outfile_name is generated successfully"
@@ -0,0 +1,146 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "glimportcache.h"
+
+#include <sys/stat.h>
+
+#include <array>
+#include <map>
+#include <tuple>
+
+#include "spinlock.h"
+
+namespace hwcomposer {
+
+struct ImportKey {
+  uint32_t format_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t num_planes_;
+  // Device and inode of the dma-buf of every plane.
+  std::array<uint64_t, 4> devices_;
+  std::array<uint64_t, 4> inodes_;
+  std::array<uint32_t, 4> pitches_;
+  std::array<uint32_t, 4> offsets_;
+  std::array<uint32_t, 2> modifiers_;
+
+  bool operator<(const ImportKey& rhs) const {
+    return std::tie(format_, width_, height_, num_planes_, devices_, inodes_,
+                    pitches_, offsets_, modifiers_) <
+           std::tie(rhs.format_, rhs.width_, rhs.height_, rhs.num_planes_,
+                    rhs.devices_, rhs.inodes_, rhs.pitches_, rhs.offsets_,
+                    rhs.modifiers_);
+  }
+};
+
+struct Import {
+  ImportKey key_;
+  GLuint texture_;
+  uint32_t refs_;
+};
+
+static SpinLock imports_lock;
+static std::map<ImportKey, EGLImageKHR> images;
+static std::map<EGLImageKHR, Import> imports;
+
+// Returns false in case the dma-buf of a plane can't be identified.
+static bool GetKey(const HwcMeta& meta, uint32_t format, ImportKey* key) {
+  if (meta.num_planes_ > 4)
+    return false;
+
+  key->format_ = format;
+  key->width_ = meta.width_;
+  key->height_ = meta.height_;
+  key->num_planes_ = meta.num_planes_;
+  for (uint32_t i = 0; i < 4; i++) {
+    // Fields of unused planes aren't initialized.
+    key->devices_[i] = 0;
+    key->inodes_[i] = 0;
+    key->pitches_[i] = 0;
+    key->offsets_[i] = 0;
+    if (i >= meta.num_planes_)
+      continue;
+
+    // GEM handle numbers can be reused by another buffer once a display
+    // purging this one has closed its handles, while the dma-buf and so
+    // its inode are kept alive by the EGLImage of the import.
+    struct stat buffer;
+    if (fstat(meta.prime_fds_[i], &buffer) != 0)
+      return false;
+
+    key->devices_[i] = buffer.st_dev;
+    key->inodes_[i] = buffer.st_ino;
+    key->pitches_[i] = meta.pitches_[i];
+    key->offsets_[i] = meta.offsets_[i];
+  }
+
+  key->modifiers_[0] = meta.fb_modifiers_[0];
+  key->modifiers_[1] = meta.fb_modifiers_[1];
+  return true;
+}
+
+bool GLImportCache::Acquire(const HwcMeta& meta, uint32_t format,
+                            EGLImageKHR* image, GLuint* texture) {
+  ImportKey key;
+  if (!GetKey(meta, format, &key))
+    return false;
+
+  ScopedSpinLock lock(imports_lock);
+  auto it = images.find(key);
+  if (it == images.end())
+    return false;
+
+  Import& import = imports[it->second];
+  import.refs_++;
+  *image = it->second;
+  *texture = import.texture_;
+  return true;
+}
+
+bool GLImportCache::Add(const HwcMeta& meta, uint32_t format,
+                        EGLImageKHR image, GLuint texture) {
+  ImportKey key;
+  if (!GetKey(meta, format, &key))
+    return false;
+
+  ScopedSpinLock lock(imports_lock);
+  if (images.find(key) != images.end())
+    return false;
+
+  images[key] = image;
+  Import& import = imports[image];
+  import.key_ = key;
+  import.texture_ = texture;
+  import.refs_ = 1;
+  return true;
+}
+
+bool GLImportCache::Release(EGLImageKHR image) {
+  ScopedSpinLock lock(imports_lock);
+  auto it = imports.find(image);
+  if (it == imports.end())
+    return true;
+
+  if (--it->second.refs_ > 0)
+    return false;
+
+  images.erase(it->second.key_);
+  imports.erase(it);
+  return true;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,57 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_GL_GLIMPORTCACHE_H_
+#define COMMON_COMPOSITOR_GL_GLIMPORTCACHE_H_
+
+#include <stdint.h>
+
+#include <hwcmeta.h>
+
+#include "shim.h"
+
+namespace hwcomposer {
+
+// Shares the EGLImage and texture of a buffer imported for sampling
+// between all OverlayBuffers wrapping it, e.g. a client buffer shown on
+// cloned displays, which would otherwise be imported once per display.
+// Buffers are identified by the dma-bufs of their planes, as GEM handle
+// numbers can be reused by other buffers while an import is still alive.
+//
+// Imports are reference counted and destroyed with the last buffer using
+// them. Textures are only usable by all compositors in case their
+// contexts are in the same share group, see EGLOffScreenContext.
+class GLImportCache {
+ public:
+  // Returns true and the import of the buffer described by meta and
+  // format in image and texture if there is one, taking a reference.
+  static bool Acquire(const HwcMeta& meta, uint32_t format,
+                      EGLImageKHR* image, GLuint* texture);
+
+  // Adds the import of the buffer described by meta and format, holding
+  // one reference. Returns false in case the buffer has been imported by
+  // another compositor meanwhile or its dma-bufs can't be identified,
+  // image and texture aren't shared then.
+  static bool Add(const HwcMeta& meta, uint32_t format, EGLImageKHR image,
+                  GLuint texture);
+
+  // Drops a reference to image. Returns true in case image and its
+  // texture aren't used anymore and need to be destroyed.
+  static bool Release(EGLImageKHR image);
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_GL_GLIMPORTCACHE_H_
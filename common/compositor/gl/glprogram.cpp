@@ -19,6 +19,7 @@
 #include <string>
 #include <sstream>
 
+#include "glprogramcache.h"
 #include "hwctrace.h"
 #include "renderstate.h"
 
@@ -59,31 +60,81 @@ static GLint CompileAndCheckShader(GLenum type, unsigned source_count,
 }
 
 static std::string GenerateVertexShader(int layer_count) {
+  // Vertices of region i are 6 * i to 6 * i + 5, crops of its layers are
+  // stored after the ones of the regions drawn before it in this batch.
   std::ostringstream vertex_shader_stream;
   vertex_shader_stream
       << "#version 300 es\n"
       << "#define LAYER_COUNT " << layer_count << "\n"
-      << "precision mediump int;\n"
-      << "uniform vec4 uViewport;\n"
-      << "uniform vec4 uLayerCrop[LAYER_COUNT];\n"
+      << "#define BATCH_SIZE " << GLProgram::GetBatchSize(layer_count) << "\n"
+      << "precision highp int;\n"
+      << "uniform int uFirstRegion;\n"
+      << "uniform vec4 uLayerCrop[LAYER_COUNT * BATCH_SIZE];\n"
       << "uniform mat2 uTexMatrix[LAYER_COUNT];\n"
       << "in vec2 vPosition;\n"
       << "in vec2 vTexCoords;\n"
       << "out vec2 fTexCoords[LAYER_COUNT];\n"
       << "void main() {\n"
+      << "  int crop = (gl_VertexID / 6 - uFirstRegion) * LAYER_COUNT;\n"
       << "  for (int i = 0; i < LAYER_COUNT; i++) {\n"
       << "    vec2 tempCoords = vTexCoords * uTexMatrix[i];\n"
-      << "    fTexCoords[i] =\n"
-      << "        uLayerCrop[i].xy + tempCoords * uLayerCrop[i].zw;\n"
+      << "    fTexCoords[i] = uLayerCrop[crop + i].xy +\n"
+      << "                    tempCoords * uLayerCrop[crop + i].zw;\n"
       << "  }\n"
-      << "  vec2 scaledPosition = uViewport.xy + vPosition * uViewport.zw;\n"
       << "  gl_Position =\n"
-      << "      vec4(scaledPosition * vec2(2.0) - vec2(1.0), 0.0, 1.0);\n"
+      << "      vec4(vPosition * vec2(2.0) - vec2(1.0), 0.0, 1.0);\n"
       << "}\n";
   return vertex_shader_stream.str();
 }
 
-static std::string GenerateFragmentShader(int layer_count) {
+// Copies a layer which doesn't need to be blended, see
+// RenderState::kOpaqueCopy.
+static std::string GenerateCopyFragmentShader() {
+  std::ostringstream fragment_shader_stream;
+  fragment_shader_stream
+      << "#version 300 es\n"
+      << "#define LAYER_COUNT 1\n"
+      << "#extension GL_OES_EGL_image_external : require\n"
+      << "precision mediump float;\n"
+      << "uniform samplerExternalOES uLayerTexture0;\n"
+      << "in vec2 fTexCoords[LAYER_COUNT];\n"
+      << "out vec4 oFragColor;\n"
+      << "void main() {\n"
+      << "  oFragColor = texture2D(uLayerTexture0, fTexCoords[0]);\n"
+      << "}\n";
+  return fragment_shader_stream.str();
+}
+
+// Blends two premultiplied layers, see RenderState::kPremultBlend.
+static std::string GeneratePremultBlendFragmentShader() {
+  std::ostringstream fragment_shader_stream;
+  fragment_shader_stream
+      << "#version 300 es\n"
+      << "#define LAYER_COUNT 2\n"
+      << "#extension GL_OES_EGL_image_external : require\n"
+      << "precision mediump float;\n"
+      << "uniform samplerExternalOES uLayerTexture0;\n"
+      << "uniform samplerExternalOES uLayerTexture1;\n"
+      << "uniform float uLayerAlpha[LAYER_COUNT];\n"
+      << "in vec2 fTexCoords[LAYER_COUNT];\n"
+      << "out vec4 oFragColor;\n"
+      << "void main() {\n"
+      << "  vec4 top = texture2D(uLayerTexture0, fTexCoords[0]) *\n"
+      << "             uLayerAlpha[0];\n"
+      << "  vec4 bottom = texture2D(uLayerTexture1, fTexCoords[1]) *\n"
+      << "                uLayerAlpha[1];\n"
+      << "  oFragColor = top + bottom * (1.0 - top.a);\n"
+      << "}\n";
+  return fragment_shader_stream.str();
+}
+
+static std::string GenerateFragmentShader(int layer_count, uint32_t flags) {
+  if (flags & RenderState::kOpaqueCopy)
+    return GenerateCopyFragmentShader();
+
+  if (flags & RenderState::kPremultBlend)
+    return GeneratePremultBlendFragmentShader();
+
   std::ostringstream fragment_shader_stream;
   fragment_shader_stream << "#version 300 es\n"
                          << "#define LAYER_COUNT " << layer_count << "\n"
@@ -147,10 +198,15 @@ static GLint LoadPreBuiltBinary(GLint gl_program, void *binary, long size) {
   glProgramBinaryOES(gl_program, GL_PROGRAM_BINARY_FORMAT_MESA, binary, size);
 
   glGetProgramiv(gl_program, GL_LINK_STATUS, &status);
-  if (status)
-    return gl_program;
+  if (!status)
+    return 0;
+
+  // Binaries built for the per draw uViewport interface still link, but
+  // can't be used with batched draws.
+  if (glGetUniformLocation(gl_program, "uFirstRegion") < 0)
+    return 0;
 
-  return 0;
+  return gl_program;
 }
 #endif
 
@@ -158,7 +214,20 @@ static GLint LoadPreBuiltBinary(GLint gl_program, void *binary, long size) {
 #include "glprebuiltshaderarray.h"
 #endif
 
-static GLint GenerateProgram(unsigned num_textures,
+// Returns name of the program in GLProgramCache.
+static std::string GetProgramName(unsigned num_textures, uint32_t flags) {
+  if (flags & RenderState::kOpaqueCopy)
+    return "copy";
+
+  if (flags & RenderState::kPremultBlend)
+    return "premult_blend";
+
+  std::ostringstream name;
+  name << num_textures;
+  return name.str();
+}
+
+static GLint GenerateProgram(unsigned num_textures, uint32_t flags,
                              std::ostringstream *shader_log) {
   GLint status;
   GLint program = glCreateProgram();
@@ -174,11 +243,19 @@ static GLint GenerateProgram(unsigned num_textures,
     return 0;
   }
 
+  std::string vertex_shader_string = GenerateVertexShader(num_textures);
+  std::string fragment_shader_string =
+      GenerateFragmentShader(num_textures, flags);
+  std::string sources = vertex_shader_string + fragment_shader_string;
+  std::string name = GetProgramName(num_textures, flags);
+  if (GLProgramCache::LoadProgram(program, name, sources))
+    return program;
+
 #ifdef USE_PREBUILT_SHADER_BIN_ARRAY
   /* try to retrieve shader binary program from built-in arrays */
 
-  /* support only up to 16 layers */
-  if (num_textures > 0 && num_textures < 17) {
+  /* support only up to 16 layers, for the generic programs */
+  if (num_textures > 0 && num_textures < 17 && !flags) {
     /* first long is the size of binary */
     binary_sz = *(long *)shader_prog_arrays[num_textures - 1];
     binary_prog =
@@ -200,14 +277,24 @@ static GLint GenerateProgram(unsigned num_textures,
 /* 10MB limit on shader binary file size */
 #define FILE_SIZE_LIMIT 10485760
 
+/* Bumped whenever the interface of the generic programs changes, has to
+ * match generate_shader_test.sh.
+ */
+#define PREBUILT_SHADER_VERSION 2
+
   /* try to load prebuilt shader program from files */
   std::ostringstream shader_program_fname;
-  shader_program_fname << PREBUILT_SHADER_FILE_PATH "/hwc_shader_prog_"
-                       << num_textures << ".shader_test.bin";
+  shader_program_fname << PREBUILT_SHADER_FILE_PATH "/hwc_shader_prog_v"
+                       << PREBUILT_SHADER_VERSION << "_" << num_textures
+                       << ".shader_test.bin";
 
   FILE *shader_prog_fp;
 
-  shader_prog_fp = fopen(shader_program_fname.str().c_str(), "rb");
+  /* pre-built shaders only exist for the generic programs */
+  if (flags)
+    shader_prog_fp = NULL;
+  else
+    shader_prog_fp = fopen(shader_program_fname.str().c_str(), "rb");
 
   if (!shader_prog_fp)
     goto fail_file_open;
@@ -252,14 +339,12 @@ fail_file_open:
                 << "now trying run-time build\n";
 #endif
 
-  std::string vertex_shader_string = GenerateVertexShader(num_textures);
   const GLchar *vertex_shader_source = vertex_shader_string.c_str();
   GLint vertex_shader = CompileAndCheckShader(
       GL_VERTEX_SHADER, 1, &vertex_shader_source, shader_log);
   if (!vertex_shader)
     return 0;
 
-  std::string fragment_shader_string = GenerateFragmentShader(num_textures);
   const GLchar *fragment_shader_source = fragment_shader_string.c_str();
   GLint fragment_shader = CompileAndCheckShader(
       GL_FRAGMENT_SHADER, 1, &fragment_shader_source, shader_log);
@@ -291,17 +376,19 @@ fail_file_open:
     return 0;
   }
 
+  GLProgramCache::StoreProgram(program, name, sources);
   return program;
 }
 
 GLProgram::GLProgram()
     : program_(0),
-      viewport_loc_(0),
+      first_region_loc_(0),
       crop_loc_(0),
       alpha_loc_(0),
       premult_loc_(0),
       tex_matrix_loc_(0),
       solid_color_loc_(0),
+      texture_count_(0),
       initialized_(false) {
 }
 
@@ -310,23 +397,31 @@ GLProgram::~GLProgram() {
     glDeleteProgram(program_);
 }
 
-bool GLProgram::Init(unsigned texture_count) {
+bool GLProgram::Init(unsigned texture_count, uint32_t flags) {
   std::ostringstream shader_log;
-  program_ = GenerateProgram(texture_count, &shader_log);
+  program_ = GenerateProgram(texture_count, flags, &shader_log);
   if (!program_) {
     ETRACE("%s", shader_log.str().c_str());
     return false;
   }
 
+  texture_count_ = texture_count;
   return true;
 }
 
-void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
-                           GLuint viewport_height) {
+unsigned GLProgram::GetBatchSize(unsigned texture_count) {
+  if (texture_count == 0 || texture_count >= kMaxCropUniforms)
+    return 1;
+
+  return kMaxCropUniforms / texture_count;
+}
+
+void GLProgram::UseProgram(const RenderState *const *states, unsigned count,
+                           unsigned first_region) {
   glUseProgram(program_);
-  unsigned size = state.layer_state_.size();
+  unsigned size = texture_count_;
   if (!initialized_) {
-    viewport_loc_ = glGetUniformLocation(program_, "uViewport");
+    first_region_loc_ = glGetUniformLocation(program_, "uFirstRegion");
     crop_loc_ = glGetUniformLocation(program_, "uLayerCrop");
     alpha_loc_ = glGetUniformLocation(program_, "uLayerAlpha");
     premult_loc_ = glGetUniformLocation(program_, "uLayerPremult");
@@ -343,27 +438,41 @@ void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
     initialized_ = true;
   }
 
-  glUniform4f(viewport_loc_, state.x_ / (float)viewport_width,
-              state.y_ / (float)viewport_height,
-              (state.width_) / (float)viewport_width,
-              (state.height_) / (float)viewport_height);
-
+  // All states source the same layers, only their crops differ.
+  const RenderState &state = *states[0];
   for (unsigned src_index = 0; src_index < size; src_index++) {
     const RenderState::LayerState &src = state.layer_state_[src_index];
-    glUniform1f(alpha_loc_ + src_index, src.alpha_);
-    glUniform1f(premult_loc_ + src_index, src.premult_);
-    glUniform4f(crop_loc_ + src_index, src.crop_bounds_[0], src.crop_bounds_[1],
-                src.crop_bounds_[2] - src.crop_bounds_[0],
-                src.crop_bounds_[3] - src.crop_bounds_[1]);
+    // Specialized programs don't use all of the uniforms.
+    if (alpha_loc_ >= 0)
+      glUniform1f(alpha_loc_ + src_index, src.alpha_);
+
+    if (premult_loc_ >= 0)
+      glUniform1f(premult_loc_ + src_index, src.premult_);
+
     glUniformMatrix2fv(tex_matrix_loc_ + src_index, 1, GL_FALSE,
                        src.texture_matrix_);
-    glActiveTexture(GL_TEXTURE0 + src_index);
-    glBindTexture(GL_TEXTURE_EXTERNAL_OES, src.handle_);
-    glUniform4f(solid_color_loc_ + src_index, (float)src.solid_color_array_[3],
-                (float)src.solid_color_array_[2],
-                (float)src.solid_color_array_[1],
-                (float)src.solid_color_array_[0]);
+    // The shader adds uLayerColor to sampled colors in [0, 1], so the
+    // 0-255 channels need to be normalized, like the other renderers do.
+    if (solid_color_loc_ >= 0)
+      glUniform4f(solid_color_loc_ + src_index,
+                  src.solid_color_array_[3] / 255.0f,
+                  src.solid_color_array_[2] / 255.0f,
+                  src.solid_color_array_[1] / 255.0f,
+                  src.solid_color_array_[0] / 255.0f);
   }
+
+  crops_.clear();
+  for (unsigned region = 0; region < count; region++) {
+    for (const RenderState::LayerState &src : states[region]->layer_state_) {
+      crops_.emplace_back(src.crop_bounds_[0]);
+      crops_.emplace_back(src.crop_bounds_[1]);
+      crops_.emplace_back(src.crop_bounds_[2] - src.crop_bounds_[0]);
+      crops_.emplace_back(src.crop_bounds_[3] - src.crop_bounds_[1]);
+    }
+  }
+
+  glUniform1i(first_region_loc_, first_region);
+  glUniform4fv(crop_loc_, count * size, crops_.data());
 }
 
 }  // namespace hwcomposer
@@ -17,6 +17,8 @@
 #ifndef COMMON_COMPOSITOR_GL_GLPROGRAM_H_
 #define COMMON_COMPOSITOR_GL_GLPROGRAM_H_
 
+#include <stdint.h>
+
 #include <vector>
 
 #include "shim.h"
@@ -33,18 +35,36 @@ class GLProgram {
 
   ~GLProgram();
 
-  bool Init(unsigned texture_count);
-  void UseProgram(const RenderState& cmd, GLuint viewport_width,
-                  GLuint viewport_height);
+  // flags select a specialized program for regions with one of the
+  // RenderState flags set, 0 the generic one blending texture_count
+  // layers.
+  bool Init(unsigned texture_count, uint32_t flags = 0);
+
+  // Returns the maximum number of regions sourcing texture_count layers
+  // which can be drawn with one draw call.
+  static unsigned GetBatchSize(unsigned texture_count);
+
+  // Sets up the program to draw count regions, which all source the same
+  // layers. first_region is the index of the first one of them in the
+  // vertex buffer, i.e. its vertices start at 6 * first_region.
+  void UseProgram(const RenderState* const* states, unsigned count,
+                  unsigned first_region);
 
  private:
+  // Crops of all regions of a batch are passed as one uniform array. This
+  // leaves enough of the 256 vertex uniform vectors every GLES 3.0
+  // implementation supports for the texture matrices.
+  static const unsigned kMaxCropUniforms = 192;
+
   GLint program_;
-  GLint viewport_loc_;
+  GLint first_region_loc_;
   GLint crop_loc_;
   GLint alpha_loc_;
   GLint premult_loc_;
   GLint tex_matrix_loc_;
   GLint solid_color_loc_;
+  unsigned texture_count_;
+  std::vector<GLfloat> crops_;
   bool initialized_;
 };
 
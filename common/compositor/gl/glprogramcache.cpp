@@ -0,0 +1,264 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "glprogramcache.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "egloffscreencontext.h"
+#include "glprogram.h"
+#include "hwctrace.h"
+#include "spinlock.h"
+
+namespace hwcomposer {
+
+struct ProgramBinary {
+  uint64_t key_;
+  GLenum format_;
+  std::vector<uint8_t> data_;
+};
+
+#ifdef SHADER_CACHE_PATH
+// Header of binaries stored in files.
+struct FileHeader {
+  uint32_t magic_;
+  uint32_t format_;
+  uint64_t key_;
+  uint64_t size_;
+};
+
+static const uint32_t kFileMagic = 0x48574350;  // HWCP
+// Same limit as for pre-built shader files.
+static const uint64_t kMaxFileSize = 10485760;
+#endif
+
+static SpinLock binaries_lock;
+static std::map<std::string, ProgramBinary> binaries;
+
+static void HashString(const char* str, uint64_t* hash) {
+  // FNV-1a
+  for (; str && *str; str++) {
+    *hash ^= static_cast<uint8_t>(*str);
+    *hash *= 0x100000001b3ULL;
+  }
+
+  *hash ^= 0xff;
+  *hash *= 0x100000001b3ULL;
+}
+
+static uint64_t GetKey(const std::string& sources) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), &hash);
+  HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), &hash);
+  HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), &hash);
+  HashString(sources.c_str(), &hash);
+  return hash;
+}
+
+#ifdef SHADER_CACHE_PATH
+static std::string GetFileName(const std::string& name) {
+  std::ostringstream file_name;
+  file_name << SHADER_CACHE_PATH "/hwc_program_" << name << ".bin";
+  return file_name.str();
+}
+
+static bool ReadFile(const std::string& name, uint64_t key,
+                     ProgramBinary* binary) {
+  FILE* file = fopen(GetFileName(name).c_str(), "rb");
+  if (!file)
+    return false;
+
+  FileHeader header;
+  bool success = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic_ == kFileMagic && header.key_ == key &&
+                 header.size_ > 0 && header.size_ <= kMaxFileSize;
+  if (success) {
+    binary->key_ = key;
+    binary->format_ = header.format_;
+    binary->data_.resize(header.size_);
+    success =
+        fread(binary->data_.data(), 1, header.size_, file) == header.size_;
+  }
+
+  fclose(file);
+  return success;
+}
+
+static void WriteFile(const std::string& name, const ProgramBinary& binary) {
+  // Write to a temporary file first, so that other processes never see a
+  // partial binary. Its name is unique, as renderers of this and other
+  // processes might store the same program at once.
+  std::string file_name = GetFileName(name);
+  std::vector<char> temp_name(file_name.begin(), file_name.end());
+  static const char kSuffix[] = ".XXXXXX";
+  temp_name.insert(temp_name.end(), kSuffix, kSuffix + sizeof(kSuffix));
+  int fd = mkstemp(temp_name.data());
+  if (fd < 0) {
+    ETRACE("Failed to create shader cache file %s", temp_name.data());
+    return;
+  }
+
+  // mkstemp only allows the owner to read the file.
+  fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  FILE* file = fdopen(fd, "wb");
+  if (!file) {
+    ETRACE("Failed to open shader cache file %s", temp_name.data());
+    close(fd);
+    remove(temp_name.data());
+    return;
+  }
+
+  FileHeader header;
+  header.magic_ = kFileMagic;
+  header.format_ = binary.format_;
+  header.key_ = binary.key_;
+  header.size_ = binary.data_.size();
+  bool success =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(binary.data_.data(), 1, binary.data_.size(), file) ==
+          binary.data_.size();
+  if (fclose(file) != 0)
+    success = false;
+
+  if (!success || rename(temp_name.data(), file_name.c_str()) != 0) {
+    ETRACE("Failed to write shader cache file %s", file_name.c_str());
+    remove(temp_name.data());
+  }
+}
+#endif
+
+bool GLProgramCache::LoadProgram(GLint program, const std::string& name,
+                                 const std::string& sources) {
+  if (!glProgramBinaryOES)
+    return false;
+
+  uint64_t key = GetKey(sources);
+  ProgramBinary binary;
+  bool found = false;
+  binaries_lock.lock();
+  auto it = binaries.find(name);
+  if (it != binaries.end() && it->second.key_ == key) {
+    binary = it->second;
+    found = true;
+  }
+  binaries_lock.unlock();
+
+#ifdef SHADER_CACHE_PATH
+  if (!found && ReadFile(name, key, &binary)) {
+    found = true;
+    ScopedSpinLock lock(binaries_lock);
+    binaries[name] = binary;
+  }
+#endif
+
+  if (!found)
+    return false;
+
+  glProgramBinaryOES(program, binary.format_, binary.data_.data(),
+                     binary.data_.size());
+  GLint status = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  return status != 0;
+}
+
+void GLProgramCache::StoreProgram(GLint program, const std::string& name,
+                                  const std::string& sources) {
+  if (!glGetProgramBinaryOES)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if (length <= 0)
+    return;
+
+  ProgramBinary binary;
+  binary.key_ = GetKey(sources);
+  binary.data_.resize(length);
+  GLsizei written = 0;
+  glGetProgramBinaryOES(program, length, &written, &binary.format_,
+                        binary.data_.data());
+  if (written <= 0)
+    return;
+
+  binary.data_.resize(written);
+#ifdef SHADER_CACHE_PATH
+  WriteFile(name, binary);
+#endif
+  ScopedSpinLock lock(binaries_lock);
+  binaries[name] = std::move(binary);
+}
+
+GLProgramPrecompiler &GLProgramPrecompiler::getInstance() {
+  // Never destroyed, like the cache it fills, so that renderers going away
+  // don't stop it for renderers created later on.
+  static GLProgramPrecompiler *precompiler = new GLProgramPrecompiler();
+  return *precompiler;
+}
+
+GLProgramPrecompiler::GLProgramPrecompiler()
+    : HWCThread(10, "GLProgramPrecompiler") {
+}
+
+GLProgramPrecompiler::~GLProgramPrecompiler() {
+}
+
+bool GLProgramPrecompiler::Start(unsigned first, unsigned last) {
+  ScopedSpinLock lock(lock_);
+  if (started_)
+    return true;
+
+  started_ = true;
+  first_ = first;
+  last_ = last;
+  if (!InitWorker()) {
+    ETRACE("Failed to initialize GLProgramPrecompiler. %s", PRINTERROR());
+    return false;
+  }
+
+  Resume();
+  return true;
+}
+
+void GLProgramPrecompiler::HandleRoutine() {
+  if (done_)
+    return;
+
+  done_ = true;
+  EGLOffScreenContext context;
+  if (!context.Init() || !context.MakeCurrent()) {
+    ETRACE("Failed to initialize context of GLProgramPrecompiler.");
+    return;
+  }
+
+  for (unsigned count = first_; count <= last_; count++) {
+    // Programs found in the cache are loaded and dropped right away.
+    GLProgram program;
+    program.Init(count);
+  }
+
+  eglMakeCurrent(context.GetDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,77 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_GL_GLPROGRAMCACHE_H_
+#define COMMON_COMPOSITOR_GL_GLPROGRAMCACHE_H_
+
+#include <string>
+
+#include "hwcthread.h"
+#include "shim.h"
+#include "spinlock.h"
+
+namespace hwcomposer {
+
+// Keeps binaries of linked programs, so that a program doesn't need to be
+// compiled again once it has been built by any GL renderer of the process.
+// In case SHADER_CACHE_PATH is defined, binaries are stored in files in
+// this directory as well and reused after a restart.
+//
+// Binaries are keyed by program name and a hash of the driver strings and
+// shader sources, so that binaries of another driver or of older shaders
+// are never loaded.
+class GLProgramCache {
+ public:
+  // Loads the binary of the program called name and built from sources
+  // into program. Returns false in case there is none or the driver
+  // rejected it. Needs a current context.
+  static bool LoadProgram(GLint program, const std::string& name,
+                          const std::string& sources);
+
+  // Stores the binary of the linked program. Needs a current context.
+  static void StoreProgram(GLint program, const std::string& name,
+                           const std::string& sources);
+};
+
+// Builds programs for layer counts not compiled at start up on a
+// background thread with its own context, so that renderers find them
+// in GLProgramCache instead of compiling them mid frame. Shared by all
+// renderers of the process, like GLProgramCache.
+class GLProgramPrecompiler : public HWCThread {
+ public:
+  static GLProgramPrecompiler& getInstance();
+
+  // Builds programs for first to last layers. Only the first call starts
+  // building, later ones return right away.
+  bool Start(unsigned first, unsigned last);
+
+ protected:
+  void HandleRoutine() override;
+
+ private:
+  GLProgramPrecompiler();
+  ~GLProgramPrecompiler() override;
+
+  SpinLock lock_;
+  unsigned first_ = 0;
+  unsigned last_ = 0;
+  bool started_ = false;
+  // Only accessed on the thread.
+  bool done_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_GL_GLPROGRAMCACHE_H_
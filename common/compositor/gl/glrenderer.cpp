@@ -16,7 +16,10 @@
 
 #include "glrenderer.h"
 
+#include <algorithm>
+
 #include "glprogram.h"
+#include "glprogramcache.h"
 #include "hwctrace.h"
 #include "nativesurface.h"
 #include "renderstate.h"
@@ -27,21 +30,87 @@
 
 namespace hwcomposer {
 
+// Position and texture coordinates of the two triangles covering a region.
+static const unsigned kVerticesPerRegion = 6;
+static const unsigned kFloatsPerVertex = 4;
+
+// Programs for up to this many layers are built at start up.
+static const unsigned kEagerPrograms = 4;
+#ifdef PRECOMPILE_GL_PROGRAMS
+// Programs for more layers are built in the background up to this many
+// layers, the same limit as for pre-built shaders.
+static const unsigned kPrecompiledPrograms = 16;
+#endif
+
+// Regions sourcing the same layers can be drawn with one call, as they
+// only differ in position and crops.
+static bool SourcesSameLayers(const RenderState &lhs, const RenderState &rhs) {
+  size_t size = lhs.layer_state_.size();
+  if (size != rhs.layer_state_.size())
+    return false;
+
+  for (size_t i = 0; i < size; i++) {
+    const RenderState::LayerState &lhs_src = lhs.layer_state_[i];
+    const RenderState::LayerState &rhs_src = rhs.layer_state_[i];
+    if (lhs_src.layer_index_ != rhs_src.layer_index_ ||
+        lhs_src.handle_ != rhs_src.handle_)
+      return false;
+  }
+
+  return true;
+}
+
+// Orders regions by layer count and layers, so that regions which can be
+// batched are next to each other and program changes are minimized.
+static bool CompareLayers(const RenderState *lhs, const RenderState *rhs) {
+  size_t lhs_size = lhs->layer_state_.size();
+  size_t rhs_size = rhs->layer_state_.size();
+  if (lhs_size != rhs_size)
+    return lhs_size < rhs_size;
+
+  for (size_t i = 0; i < lhs_size; i++) {
+    uint32_t lhs_index = lhs->layer_state_[i].layer_index_;
+    uint32_t rhs_index = rhs->layer_state_[i].layer_index_;
+    if (lhs_index != rhs_index)
+      return lhs_index < rhs_index;
+  }
+
+  return false;
+}
+
+// Fills a region holding a solid color layer with a scissored clear,
+// instead of sampling and blending. The color is the one the generic
+// program computes, see GenerateFragmentShader.
+static void FillSolidColor(const RenderState &state) {
+  const RenderState::LayerState &src = state.layer_state_.front();
+  const uint8_t *color = src.solid_color_array_;
+  float scale = std::max(color[0] / 255.0f, src.premult_) * src.alpha_;
+  glScissor(state.scissor_x_, state.scissor_y_, state.scissor_width_,
+            state.scissor_height_);
+  glClearColor(color[3] / 255.0f * scale, color[2] / 255.0f * scale,
+               color[1] / 255.0f * scale, src.alpha_);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
 GLRenderer::~GLRenderer() {
   if (!context_.MakeCurrent()) {
     ETRACE("Failed make current context.");
     return;
   }
 
+  if (vertex_buffer_)
+    glDeleteBuffers(1, &vertex_buffer_);
+
   if (vertex_array_)
     glDeleteVertexArraysOES(1, &vertex_array_);
+
+#ifdef ENABLE_SHARED_COMPOSITOR
+  if (framebuffer_)
+    glDeleteFramebuffers(1, &framebuffer_);
+#endif
 }
 
 bool GLRenderer::Init() {
-  // clang-format off
-  const GLfloat verts[] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f,
-                           0.0f, 2.0f, 2.0f, 0.0f, 2.0f, 0.0f};
-  // clang-format on
   if (!context_.Init()) {
     ETRACE("Failed to initialize EGLContext.");
     return false;
@@ -59,28 +128,50 @@ bool GLRenderer::Init() {
   glGenVertexArraysOES(1, &vertex_array);
   glBindVertexArrayOES(vertex_array);
 
+  // Vertices are uploaded with every frame, see Draw.
   GLuint vertex_buffer;
   glGenBuffers(1, &vertex_buffer);
   glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
-  for (int i = 1; i < 5; i++) {
+  for (unsigned i = 1; i <= kEagerPrograms; i++) {
     std::unique_ptr<GLProgram> program(new GLProgram());
     if (program->Init(i)) {
       programs_.emplace_back(std::move(program));
     }
   }
 
+  copy_program_.reset(new GLProgram());
+  if (!copy_program_->Init(1, RenderState::kOpaqueCopy))
+    copy_program_.reset();
+
+  premult_blend_program_.reset(new GLProgram());
+  if (!premult_blend_program_->Init(2, RenderState::kPremultBlend))
+    premult_blend_program_.reset();
+
+#ifdef PRECOMPILE_GL_PROGRAMS
+  // Programs are shared by all renderers through GLProgramCache, so they
+  // only need to be built once per process.
+  GLProgramPrecompiler::getInstance().Start(kEagerPrograms + 1,
+                                            kPrecompiledPrograms);
+#endif
+
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
 
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, NULL);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4,
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(float) * kFloatsPerVertex, NULL);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(float) * kFloatsPerVertex,
                         (void *)(sizeof(float) * 2));
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   vertex_array_ = vertex_array;
+  vertex_buffer_ = vertex_buffer;
+
+#ifdef ENABLE_SHARED_COMPOSITOR
+  glGenFramebuffers(1, &framebuffer_);
+#endif
 
   return true;
 }
@@ -95,6 +186,9 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
   // GL rendere should not support protected
   surface->GetLayer()->SetProtected(false);
 
+#ifdef ENABLE_SHARED_COMPOSITOR
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+#endif
   if (!surface->MakeCurrent())
     return false;
 #ifdef COMPOSITOR_TRACING
@@ -109,7 +203,7 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
   glViewport(left, top, frame_width, frame_height);
 
   if (clear_surface || partial_clear) {
-    const HwcRect<int> &damage = surface->GetSurfaceDamage();
+    HwcRect<int> damage = surface->GetRenderDamage();
     GLuint clear_width = damage.right - damage.left;
     GLuint clear_height = damage.bottom - damage.top;
     if (surface->IsOnScreen() &&
@@ -117,12 +211,10 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
       glEnable(GL_SCISSOR_TEST);
       glScissor(damage.left, damage.top, clear_width, clear_height);
       glClear(GL_COLOR_BUFFER_BIT);
+      glDisable(GL_SCISSOR_TEST);
     } else {
       glClear(GL_COLOR_BUFFER_BIT);
-      glEnable(GL_SCISSOR_TEST);
     }
-  } else {
-    glEnable(GL_SCISSOR_TEST);
   }
 
 #ifdef COMPOSITOR_TRACING
@@ -137,42 +229,127 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
       damage.left, damage.top, damage.right - damage.left,
       damage.bottom - damage.top);
 #endif
+  // Regions don't overlap, so they can be drawn in any order.
+  uint32_t fills = 0;
+  states_.clear();
   for (const RenderState &state : render_states) {
-    unsigned size = state.layer_state_.size();
-    GLProgram *program = GetProgram(size);
-    if (!program)
+    if (state.layer_state_.empty())
+      continue;
+
+    if (!(state.flags_ & RenderState::kSolidColor)) {
+      states_.emplace_back(&state);
       continue;
+    }
+
+    if (!fills)
+      glEnable(GL_SCISSOR_TEST);
 
-    program->UseProgram(state, frame_width, frame_height);
+    FillSolidColor(state);
+    fills++;
+  }
+
+  if (fills) {
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  }
+
+  std::stable_sort(states_.begin(), states_.end(), CompareLayers);
+
+  // Every region is drawn as a quad covering exactly its pixels, instead
+  // of a scissored triangle covering the whole viewport, so that regions
+  // can share a draw call.
+  vertices_.clear();
+  for (const RenderState *state : states_) {
 #ifdef COMPOSITOR_TRACING
     ICOMPOSITORTRACE(
         "scissor_x_: %d state.scissor_y_: %d scissor_width_: %d "
         "scissor_height_: %d \n",
-        state.scissor_x_, state.scissor_y_, state.scissor_width_,
-        state.scissor_height_);
-    total_width += std::max(total_width, state.scissor_width_);
-    total_height += state.scissor_height_;
+        state->scissor_x_, state->scissor_y_, state->scissor_width_,
+        state->scissor_height_);
+    total_width += std::max(total_width, state->scissor_width_);
+    total_height += state->scissor_height_;
     const HwcRect<int> &damage = surface->GetSurfaceDamage();
     if (AnalyseOverlap(
-            damage, HwcRect<int>(state.scissor_x_, state.scissor_y_,
-                                 state.scissor_x_ + state.scissor_width_,
-                                 state.scissor_y_ + state.scissor_height_)) ==
+            damage, HwcRect<int>(state->scissor_x_, state->scissor_y_,
+                                 state->scissor_x_ + state->scissor_width_,
+                                 state->scissor_y_ + state->scissor_height_)) ==
         kOutside) {
       ICOMPOSITORTRACE("ALERT: Rendering Layer outside Damaged Region. \n");
     }
 #endif
-    glScissor(state.scissor_x_, state.scissor_y_, state.scissor_width_,
-              state.scissor_height_);
+    GLfloat x1 = state->x_ / (float)frame_width;
+    GLfloat y1 = state->y_ / (float)frame_height;
+    GLfloat x2 = (state->x_ + state->width_) / (float)frame_width;
+    GLfloat y2 = (state->y_ + state->height_) / (float)frame_height;
+    // clang-format off
+    const GLfloat verts[kVerticesPerRegion * kFloatsPerVertex] = {
+        x1, y1, 0.0f, 0.0f,  x1, y2, 0.0f, 1.0f,  x2, y1, 1.0f, 0.0f,
+        x2, y1, 1.0f, 0.0f,  x1, y2, 0.0f, 1.0f,  x2, y2, 1.0f, 1.0f};
+    // clang-format on
+    vertices_.insert(vertices_.end(), verts,
+                     verts + kVerticesPerRegion * kFloatsPerVertex);
+  }
 
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(GLfloat),
+               vertices_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Texture units are only rebound when the layers of the next batch
+  // differ and are unbound once all regions have been drawn.
+  bound_textures_.clear();
+  uint32_t draw_calls = 0;
+  size_t count = states_.size();
+  size_t first = 0;
+  while (first < count) {
+    const RenderState &state = *states_[first];
+    unsigned size = state.layer_state_.size();
+    GLProgram *program = GetProgram(size, state.flags_);
+    size_t last = first + 1;
+    size_t batch_size = program ? GLProgram::GetBatchSize(size) : count;
+    while (last < count && last - first < batch_size &&
+           SourcesSameLayers(state, *states_[last]))
+      last++;
+
+    if (!program) {
+      first = last;
+      continue;
+    }
+
+    if (bound_textures_.size() < size)
+      bound_textures_.resize(size, 0);
 
     for (unsigned src_index = 0; src_index < size; src_index++) {
+      GLuint handle = state.layer_state_[src_index].handle_;
+      if (bound_textures_[src_index] == handle)
+        continue;
+
       glActiveTexture(GL_TEXTURE0 + src_index);
-      glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, handle);
+      bound_textures_[src_index] = handle;
     }
+
+    program->UseProgram(&states_[first], last - first, first);
+    glDrawArrays(GL_TRIANGLES, first * kVerticesPerRegion,
+                 (last - first) * kVerticesPerRegion);
+    draw_calls++;
+    first = last;
+  }
+
+  for (unsigned src_index = 0; src_index < bound_textures_.size();
+       src_index++) {
+    if (!bound_textures_[src_index])
+      continue;
+
+    glActiveTexture(GL_TEXTURE0 + src_index);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
   }
 
-  glDisable(GL_SCISSOR_TEST);
+  draw_calls_ = draw_calls;
+#ifdef COMPOSITOR_TRACING
+  ICOMPOSITORTRACE("Draw calls: %u solid color fills: %d regions: %zu \n",
+                   draw_calls, fills, count);
+#endif
 
   if (!disable_explicit_sync_)
     surface->SetNativeFence(context_.GetSyncFD(surface->IsOnScreen()));
@@ -213,7 +390,14 @@ void GLRenderer::SetDisableExplicitSync(bool disable_explicit_sync) {
   disable_explicit_sync_ = disable_explicit_sync;
 }
 
-GLProgram *GLRenderer::GetProgram(unsigned texture_count) {
+GLProgram *GLRenderer::GetProgram(unsigned texture_count, uint32_t flags) {
+  // Generic programs are used in case a specialized one failed to build.
+  if ((flags & RenderState::kOpaqueCopy) && copy_program_)
+    return copy_program_.get();
+
+  if ((flags & RenderState::kPremultBlend) && premult_blend_program_)
+    return premult_blend_program_.get();
+
   if (programs_.size() >= texture_count) {
     GLProgram *program = programs_[texture_count - 1].get();
     if (program != 0)
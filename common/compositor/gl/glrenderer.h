@@ -40,13 +40,28 @@ class GLRenderer : public Renderer {
 
   void SetDisableExplicitSync(bool disable_explicit_sync) override;
 
+  uint32_t GetDrawCallCount() const override {
+    return draw_calls_;
+  }
+
  private:
-  GLProgram *GetProgram(unsigned texture_count);
+  GLProgram *GetProgram(unsigned texture_count, uint32_t flags);
 
   EGLOffScreenContext context_;
 
   std::vector<std::unique_ptr<GLProgram>> programs_;
+  std::unique_ptr<GLProgram> copy_program_;
+  std::unique_ptr<GLProgram> premult_blend_program_;
+  std::vector<const RenderState *> states_;
+  std::vector<GLfloat> vertices_;
+  std::vector<GLuint> bound_textures_;
   GLuint vertex_array_ = 0;
+  GLuint vertex_buffer_ = 0;
+#ifdef ENABLE_SHARED_COMPOSITOR
+  // Surfaces are attached to this framebuffer when drawn, see GLSurface.
+  GLuint framebuffer_ = 0;
+#endif
+  uint32_t draw_calls_ = 0;
   bool disable_explicit_sync_ = false;
 };
 
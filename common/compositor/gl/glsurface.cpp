@@ -46,9 +46,11 @@ bool GLSurface::InitializeGPUResources() {
     return false;
   }
 
+#ifndef ENABLE_SHARED_COMPOSITOR
   // Bind Fb.
   fb_ = import.fb_;
   glBindFramebuffer(GL_FRAMEBUFFER, fb_);
+#endif
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                          import.texture_, 0);
 
@@ -77,6 +79,17 @@ bool GLSurface::InitializeGPUResources() {
 }
 
 bool GLSurface::MakeCurrent() {
+#ifdef ENABLE_SHARED_COMPOSITOR
+  // Framebuffers aren't shared between contexts and any compositor worker
+  // might draw the surface, so it is attached to the framebuffer bound by
+  // the renderer every time.
+  if (!InitializeGPUResources()) {
+    ETRACE("Failed to initialize gpu resources.");
+    return false;
+  }
+
+  return true;
+#else
   if (!fb_ && !InitializeGPUResources()) {
     ETRACE("Failed to initialize gpu resources.");
     return false;
@@ -84,6 +97,7 @@ bool GLSurface::MakeCurrent() {
 
   glBindFramebuffer(GL_FRAMEBUFFER, fb_);
   return true;
+#endif
 }
 
 }  // namespace hwcomposer
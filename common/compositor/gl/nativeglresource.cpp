@@ -19,6 +19,9 @@
 #include "hwctrace.h"
 #include "overlaylayer.h"
 #include "shim.h"
+#ifdef ENABLE_SHARED_COMPOSITOR
+#include "glimportcache.h"
+#endif
 
 namespace hwcomposer {
 
@@ -60,6 +63,12 @@ void NativeGLResource::ReleaseGPUResources(
 
   for (size_t i = 0; i < purged_size; i++) {
     const ResourceHandle& handle = handles.at(i);
+#ifdef ENABLE_SHARED_COMPOSITOR
+    // Imports shared with other buffers are destroyed with the last one.
+    if (handle.image_ && !GLImportCache::Release(handle.image_))
+      continue;
+#endif
+
     if (handle.image_) {
       eglDestroyImageKHR(egl_display, handle.image_);
     }
@@ -16,6 +16,8 @@
 
 #include "nativesurface.h"
 
+#include <algorithm>
+
 #include "displayplane.h"
 #include "displayplanestate.h"
 #include "gpudevice.h"
@@ -128,6 +130,30 @@ void NativeSurface::SetTransform(uint32_t transform) {
   layer_.SetTransform(transform);
 }
 
+void NativeSurface::SetDownScalingFactor(uint32_t factor) {
+  if (down_scaling_factor_ != factor) {
+    down_scaling_factor_ = factor;
+    clear_surface_ = kFullClear;
+    damage_changed_ = true;
+  }
+}
+
+HwcRect<int> NativeSurface::GetRenderDamage() const {
+  const HwcRect<int> &damage = layer_.GetSurfaceDamage();
+  if (down_scaling_factor_ <= 1)
+    return damage;
+
+  // Round outwards, so that all pixels touched by the damage are covered.
+  int factor = static_cast<int>(down_scaling_factor_);
+  HwcRect<int> render_damage;
+  render_damage.left = damage.left / factor;
+  render_damage.top = damage.top / factor;
+  render_damage.right = std::min((damage.right + factor - 1) / factor, width_);
+  render_damage.bottom =
+      std::min((damage.bottom + factor - 1) / factor, height_);
+  return render_damage;
+}
+
 void NativeSurface::SetSurfaceAge(int value) {
   surface_age_ = value;
   if (surface_age_ >= 0) {
@@ -167,13 +193,16 @@ void NativeSurface::ResetSourceCrop(const HwcRect<float> &source_crop) {
 
 void NativeSurface::UpdateSurfaceDamage(
     const HwcRect<int> &currentsurface_damage, bool force) {
+  // Damage is tracked at display resolution.
+  int max_width = width_ * static_cast<int>(down_scaling_factor_);
+  int max_height = height_ * static_cast<int>(down_scaling_factor_);
   HwcRect<int> current_damage = currentsurface_damage;
-  if (current_damage.right > width_) {
-    current_damage.right = width_;
+  if (current_damage.right > max_width) {
+    current_damage.right = max_width;
   }
 
-  if (current_damage.bottom > height_) {
-    current_damage.bottom = height_;
+  if (current_damage.bottom > max_height) {
+    current_damage.bottom = max_height;
   }
 
   HwcRect<int> &surface_damage = layer_.GetSurfaceDamage();
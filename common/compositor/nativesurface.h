@@ -120,6 +120,17 @@ class NativeSurface {
   // Applies rotation transform to this surface.
   void SetTransform(uint32_t transform);
 
+  // Content is rendered at 1/factor of the display resolution in both
+  // directions and upscaled by the display plane.
+  void SetDownScalingFactor(uint32_t factor);
+
+  uint32_t GetDownScalingFactor() const {
+    return down_scaling_factor_;
+  }
+
+  // Returns damage of this surface in the resolution it's rendered at.
+  HwcRect<int> GetRenderDamage() const;
+
   // Returns true in case damage of this surface has changed
   // compared to previous frame.
   bool IsSurfaceDamageChanged() const;
@@ -148,6 +159,7 @@ class NativeSurface {
   bool damage_changed_ = true;
   bool reset_damage_ = true;
   uint64_t modifier_ = 0;
+  uint32_t down_scaling_factor_ = 1;
   bool on_screen_ = false;
   HwcRect<int> previous_damage_;
   HwcRect<int> previous_nc_damage_;
@@ -64,6 +64,11 @@ class Renderer {
   virtual void InsertFence(int32_t kms_fence) = 0;
 
   virtual void SetDisableExplicitSync(bool disable_explicit_sync) = 0;
+
+  // Returns the number of draw calls issued by the last Draw.
+  virtual uint32_t GetDrawCallCount() const {
+    return 0;
+  }
 };
 
 }  // namespace hwcomposer
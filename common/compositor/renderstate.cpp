@@ -17,6 +17,7 @@
 #include "renderstate.h"
 
 #include <hwcutils.h>
+#include <math.h>
 #include <algorithm>
 
 #include "compositionregion.h"
@@ -33,21 +34,46 @@ void RenderState::ConstructState(std::vector<OverlayLayer> &layers,
                                  bool use_plane_transform) {
   float bounds[4];
   std::copy_n(region.frame.bounds, 4, bounds);
-  x_ = bounds[0];
-  y_ = bounds[1];
-  width_ = bounds[2] - bounds[0];
-  height_ = bounds[3] - bounds[1];
+  if (downscaling_factor > 1 && !uses_display_up_scaling) {
+    // Surface holds the region at reduced resolution. Snap it to whole
+    // pixels of the surface, so that neighbouring regions neither overlap
+    // nor leave gaps, and sample the layers for the snapped region.
+    float factor = static_cast<float>(downscaling_factor);
+    for (int i = 0; i < 4; i++) {
+      bounds[i] = roundf(bounds[i] / factor);
+    }
+
+    x_ = bounds[0];
+    y_ = bounds[1];
+    width_ = bounds[2] - bounds[0];
+    height_ = bounds[3] - bounds[1];
+    // Region is too small to cover any pixel of the surface.
+    if (width_ == 0 || height_ == 0)
+      return;
+
+    for (int i = 0; i < 4; i++) {
+      bounds[i] *= factor;
+    }
+  } else {
+    x_ = bounds[0];
+    y_ = bounds[1];
+    width_ = bounds[2] - bounds[0];
+    height_ = bounds[3] - bounds[1];
+  }
+
   scissor_x_ = x_;
   scissor_y_ = y_;
   scissor_width_ = width_;
   scissor_height_ = height_;
   const std::vector<size_t> &source = region.source_layers;
+  bool has_solid_color = false;
   for (size_t texture_index : source) {
     OverlayLayer &layer = layers.at(texture_index);
     layer_state_.emplace_back();
     RenderState::LayerState &src = layer_state_.back();
     src.layer_index_ = texture_index;
     src.solid_color_array_ = layer.GetSolidColorArray();
+    has_solid_color |= layer.IsSolidColor();
     bool swap_xy = false;
     bool flip_xy[2] = {false, false};
     uint32_t transform = layer.GetTransform();
@@ -112,17 +138,8 @@ void RenderState::ConstructState(std::vector<OverlayLayer> &layers,
       display_rect.right = static_cast<float>(display_Rect.right);
       display_rect.top = static_cast<float>(display_Rect.top);
       display_rect.bottom = static_cast<float>(display_Rect.bottom);
-      if (downscaling_factor > 1) {
-        display_rect.right =
-            display_rect.right -
-            ((display_rect.right - display_rect.left) / downscaling_factor);
-
-        display_size[0] = display_rect.right - display_rect.left;
-        display_size[1] = display_rect.bottom - display_rect.top;
-      } else {
-        display_size[0] = static_cast<float>(layer.GetDisplayFrameWidth());
-        display_size[1] = static_cast<float>(layer.GetDisplayFrameHeight());
-      }
+      display_size[0] = static_cast<float>(layer.GetDisplayFrameWidth());
+      display_size[1] = static_cast<float>(layer.GetDisplayFrameHeight());
     }
 
     float tex_width = 0;
@@ -167,6 +184,21 @@ void RenderState::ConstructState(std::vector<OverlayLayer> &layers,
     src.premult_ =
         (layer.GetBlending() == HWCBlending::kBlendingPremult) ? 1.0f : 0.0f;
   }
+
+  flags_ = 0;
+  size_t size = layer_state_.size();
+  if (size == 1) {
+    const LayerState &src = layer_state_.front();
+    if (has_solid_color) {
+      flags_ |= kSolidColor;
+    } else if (src.alpha_ == 1.0f && src.premult_ == 1.0f) {
+      flags_ |= kOpaqueCopy;
+    }
+  } else if (size == 2 && !has_solid_color &&
+             layer_state_[0].premult_ == 1.0f &&
+             layer_state_[1].premult_ == 1.0f) {
+    flags_ |= kPremultBlend;
+  }
 }
 
 }  // namespace hwcomposer
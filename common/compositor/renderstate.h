@@ -34,6 +34,19 @@ class NativeSurface;
 class OverlayBuffer;
 
 struct RenderState {
+  // Regions renderers can draw in a cheaper way than blending all of
+  // their layers, set by ConstructState.
+  enum Flags {
+    // Region only holds a solid color layer, it can be filled without
+    // sampling.
+    kSolidColor = 1 << 0,
+    // Region only holds a layer which doesn't need to be blended, it
+    // can be copied.
+    kOpaqueCopy = 1 << 1,
+    // Region holds two premultiplied layers and no solid color ones.
+    kPremultBlend = 1 << 2
+  };
+
   struct LayerState {
     float crop_bounds_[4];
     float alpha_;
@@ -57,6 +70,7 @@ struct RenderState {
   uint32_t scissor_y_;
   uint32_t scissor_width_;
   uint32_t scissor_height_;
+  uint32_t flags_ = 0;
   std::vector<LayerState> layer_state_;
 };
 
@@ -0,0 +1,60 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nativeswresource.h"
+
+#include "hwctrace.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+NativeSWResource::~NativeSWResource() {
+}
+
+bool NativeSWResource::PrepareResources(
+    const std::vector<OverlayBuffer*>& buffers) {
+  std::vector<GpuResourceHandle>().swap(layer_images_);
+  layer_images_.reserve(buffers.size());
+  for (auto& buffer : buffers) {
+    if (buffer) {
+      const ResourceHandle& import_image = buffer->GetGpuResource(NULL, true);
+      if (!import_image.handle_ || !import_image.handler_) {
+        ETRACE("Failed to import buffer for CPU access.");
+        return false;
+      }
+
+      layer_images_.emplace_back(&import_image);
+    } else
+      layer_images_.emplace_back(nullptr);
+  }
+
+  return true;
+}
+
+void NativeSWResource::ReleaseGPUResources(
+    const std::vector<ResourceHandle>& /*handles*/) {
+  // Buffers are only mapped while drawing, nothing to release.
+}
+
+GpuResourceHandle NativeSWResource::GetResourceHandle(
+    uint32_t layer_index) const {
+  if (layer_images_.size() <= layer_index)
+    return nullptr;
+
+  return layer_images_.at(layer_index);
+}
+
+}  // namespace hwcomposer
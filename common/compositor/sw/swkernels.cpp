@@ -0,0 +1,431 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "swkernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <drm_fourcc.h>
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace hwcomposer {
+
+// Pixel is one r, g, b, a quad in a vector register, if there is one.
+#if defined(__SSE4_1__)
+typedef __m128 Pixel;
+
+static inline Pixel PixelSet(float r, float g, float b, float a) {
+  return _mm_setr_ps(r, g, b, a);
+}
+
+static inline Pixel PixelSplat(float value) {
+  return _mm_set1_ps(value);
+}
+
+static inline Pixel PixelLoad(const float* pixel) {
+  return _mm_loadu_ps(pixel);
+}
+
+static inline void PixelStore(float* pixel, Pixel value) {
+  _mm_storeu_ps(pixel, value);
+}
+
+static inline Pixel PixelAdd(Pixel lhs, Pixel rhs) {
+  return _mm_add_ps(lhs, rhs);
+}
+
+static inline Pixel PixelSub(Pixel lhs, Pixel rhs) {
+  return _mm_sub_ps(lhs, rhs);
+}
+
+static inline Pixel PixelMul(Pixel lhs, Pixel rhs) {
+  return _mm_mul_ps(lhs, rhs);
+}
+
+static inline Pixel PixelSplatAlpha(Pixel pixel) {
+  return _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Returns r, g, b of pixel and a of alpha.
+static inline Pixel PixelWithAlpha(Pixel pixel, Pixel alpha) {
+  return _mm_blend_ps(pixel, alpha, 0x8);
+}
+
+static inline Pixel PixelSwapRB(Pixel pixel) {
+  return _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+// Converts four bytes, in memory order, to normalized floats.
+static inline Pixel PixelFromBytes(uint32_t bytes) {
+  __m128i value = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+  return _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(1.0f / 255.0f));
+}
+
+static inline uint32_t PixelToBytes(Pixel pixel) {
+  __m128i value = _mm_cvtps_epi32(_mm_mul_ps(pixel, _mm_set1_ps(255.0f)));
+  value = _mm_packus_epi32(value, value);
+  value = _mm_packus_epi16(value, value);
+  return _mm_cvtsi128_si32(value);
+}
+#elif defined(__ARM_NEON)
+typedef float32x4_t Pixel;
+
+static inline Pixel PixelSet(float r, float g, float b, float a) {
+  const float value[4] = {r, g, b, a};
+  return vld1q_f32(value);
+}
+
+static inline Pixel PixelSplat(float value) {
+  return vdupq_n_f32(value);
+}
+
+static inline Pixel PixelLoad(const float* pixel) {
+  return vld1q_f32(pixel);
+}
+
+static inline void PixelStore(float* pixel, Pixel value) {
+  vst1q_f32(pixel, value);
+}
+
+static inline Pixel PixelAdd(Pixel lhs, Pixel rhs) {
+  return vaddq_f32(lhs, rhs);
+}
+
+static inline Pixel PixelSub(Pixel lhs, Pixel rhs) {
+  return vsubq_f32(lhs, rhs);
+}
+
+static inline Pixel PixelMul(Pixel lhs, Pixel rhs) {
+  return vmulq_f32(lhs, rhs);
+}
+
+static inline Pixel PixelSplatAlpha(Pixel pixel) {
+  return vdupq_lane_f32(vget_high_f32(pixel), 1);
+}
+
+static inline Pixel PixelWithAlpha(Pixel pixel, Pixel alpha) {
+  return vsetq_lane_f32(vgetq_lane_f32(alpha, 3), pixel, 3);
+}
+
+static inline Pixel PixelSwapRB(Pixel pixel) {
+  float32x2_t rg = vget_low_f32(pixel);
+  float32x2_t ba = vget_high_f32(pixel);
+  float32x2_t bg = vset_lane_f32(vget_lane_f32(ba, 0), rg, 0);
+  float32x2_t ra = vset_lane_f32(vget_lane_f32(rg, 0), ba, 0);
+  return vcombine_f32(bg, ra);
+}
+
+static inline Pixel PixelFromBytes(uint32_t bytes) {
+  uint8x8_t value = vreinterpret_u8_u32(vdup_n_u32(bytes));
+  uint32x4_t wide = vmovl_u16(vget_low_u16(vmovl_u8(value)));
+  return vmulq_n_f32(vcvtq_f32_u32(wide), 1.0f / 255.0f);
+}
+
+static inline uint32_t PixelToBytes(Pixel pixel) {
+  pixel = vminq_f32(vmaxq_f32(pixel, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+  uint32x4_t value =
+      vcvtq_u32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), pixel, 255.0f));
+  uint16x4_t half = vmovn_u32(value);
+  uint8x8_t bytes = vmovn_u16(vcombine_u16(half, half));
+  return vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+}
+#else
+struct Pixel {
+  float v[4];
+};
+
+static inline Pixel PixelSet(float r, float g, float b, float a) {
+  Pixel pixel = {{r, g, b, a}};
+  return pixel;
+}
+
+static inline Pixel PixelSplat(float value) {
+  return PixelSet(value, value, value, value);
+}
+
+static inline Pixel PixelLoad(const float* pixel) {
+  return PixelSet(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
+static inline void PixelStore(float* pixel, Pixel value) {
+  memcpy(pixel, value.v, sizeof(value.v));
+}
+
+static inline Pixel PixelAdd(Pixel lhs, Pixel rhs) {
+  for (int i = 0; i < 4; i++)
+    lhs.v[i] += rhs.v[i];
+  return lhs;
+}
+
+static inline Pixel PixelSub(Pixel lhs, Pixel rhs) {
+  for (int i = 0; i < 4; i++)
+    lhs.v[i] -= rhs.v[i];
+  return lhs;
+}
+
+static inline Pixel PixelMul(Pixel lhs, Pixel rhs) {
+  for (int i = 0; i < 4; i++)
+    lhs.v[i] *= rhs.v[i];
+  return lhs;
+}
+
+static inline Pixel PixelSplatAlpha(Pixel pixel) {
+  return PixelSplat(pixel.v[3]);
+}
+
+static inline Pixel PixelWithAlpha(Pixel pixel, Pixel alpha) {
+  pixel.v[3] = alpha.v[3];
+  return pixel;
+}
+
+static inline Pixel PixelSwapRB(Pixel pixel) {
+  std::swap(pixel.v[0], pixel.v[2]);
+  return pixel;
+}
+
+static inline Pixel PixelFromBytes(uint32_t bytes) {
+  uint8_t value[4];
+  memcpy(value, &bytes, sizeof(value));
+  return PixelSet(value[0] / 255.0f, value[1] / 255.0f, value[2] / 255.0f,
+                  value[3] / 255.0f);
+}
+
+static inline uint32_t PixelToBytes(Pixel pixel) {
+  uint8_t value[4];
+  for (int i = 0; i < 4; i++) {
+    float channel = std::min(std::max(pixel.v[i], 0.0f), 1.0f);
+    value[i] = static_cast<uint8_t>(channel * 255.0f + 0.5f);
+  }
+
+  uint32_t bytes;
+  memcpy(&bytes, value, sizeof(bytes));
+  return bytes;
+}
+#endif
+
+static inline Pixel PixelLerp(Pixel from, Pixel to, Pixel weight) {
+  return PixelAdd(from, PixelMul(PixelSub(to, from), weight));
+}
+
+// Layout of the 32 bit formats in memory, relative to r, g, b, a.
+struct FormatInfo {
+  bool swap_rb_;
+  bool opaque_;
+};
+
+static bool GetFormatInfo(uint32_t format, FormatInfo* info) {
+  switch (format) {
+    case DRM_FORMAT_ABGR8888:
+      *info = FormatInfo{false, false};
+      return true;
+    case DRM_FORMAT_XBGR8888:
+      *info = FormatInfo{false, true};
+      return true;
+    case DRM_FORMAT_ARGB8888:
+      *info = FormatInfo{true, false};
+      return true;
+    case DRM_FORMAT_XRGB8888:
+      *info = FormatInfo{true, true};
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool SWIsFormatSupported(uint32_t format) {
+  FormatInfo info;
+  return GetFormatInfo(format, &info);
+}
+
+template <bool kSwapRB, bool kOpaque, bool kPremult>
+static inline Pixel LoadTexel(const uint8_t* texel) {
+  const Pixel one = PixelSplat(1.0f);
+  uint32_t bytes;
+  memcpy(&bytes, texel, sizeof(bytes));
+  Pixel pixel = PixelFromBytes(bytes);
+  if (kSwapRB)
+    pixel = PixelSwapRB(pixel);
+
+  if (kOpaque)
+    return PixelWithAlpha(pixel, one);
+
+  if (!kPremult)
+    pixel = PixelMul(pixel, PixelWithAlpha(PixelSplatAlpha(pixel), one));
+
+  return pixel;
+}
+
+template <bool kSwapRB, bool kOpaque, bool kPremult>
+static void FetchRow(const SWSource& source, const SWSpan& span,
+                     uint32_t count, float* out) {
+  const uint8_t* pixels = source.pixels_;
+  uint32_t stride = source.stride_;
+  int max_x = static_cast<int>(source.width_) - 1;
+  int max_y = static_cast<int>(source.height_) - 1;
+
+  // Unscaled layers, rotated or not, map pixels to texel centers. Copy
+  // them without filtering.
+  bool unit_step = (fabsf(span.dx_) == 1.0f && span.dy_ == 0.0f) ||
+                   (span.dx_ == 0.0f && fabsf(span.dy_) == 1.0f);
+  if (unit_step && fabsf(span.x_ - roundf(span.x_)) < 1.0f / 256.0f &&
+      fabsf(span.y_ - roundf(span.y_)) < 1.0f / 256.0f) {
+    int x = static_cast<int>(roundf(span.x_));
+    int y = static_cast<int>(roundf(span.y_));
+    int dx = static_cast<int>(span.dx_);
+    int dy = static_cast<int>(span.dy_);
+    for (uint32_t i = 0; i < count; i++, x += dx, y += dy) {
+      int texel_x = std::min(std::max(x, 0), max_x);
+      int texel_y = std::min(std::max(y, 0), max_y);
+      Pixel pixel = LoadTexel<kSwapRB, kOpaque, kPremult>(
+          pixels + texel_y * stride + texel_x * 4);
+      PixelStore(out + i * 4, pixel);
+    }
+
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    float x = span.x_ + i * span.dx_;
+    float y = span.y_ + i * span.dy_;
+    float floor_x = floorf(x);
+    float floor_y = floorf(y);
+    int x0 = static_cast<int>(floor_x);
+    int y0 = static_cast<int>(floor_y);
+    int x1 = std::min(std::max(x0 + 1, 0), max_x);
+    int y1 = std::min(std::max(y0 + 1, 0), max_y);
+    x0 = std::min(std::max(x0, 0), max_x);
+    y0 = std::min(std::max(y0, 0), max_y);
+    const uint8_t* row0 = pixels + y0 * stride;
+    const uint8_t* row1 = pixels + y1 * stride;
+    Pixel top = PixelLerp(LoadTexel<kSwapRB, kOpaque, kPremult>(row0 + x0 * 4),
+                          LoadTexel<kSwapRB, kOpaque, kPremult>(row0 + x1 * 4),
+                          PixelSplat(x - floor_x));
+    Pixel bottom =
+        PixelLerp(LoadTexel<kSwapRB, kOpaque, kPremult>(row1 + x0 * 4),
+                  LoadTexel<kSwapRB, kOpaque, kPremult>(row1 + x1 * 4),
+                  PixelSplat(x - floor_x));
+    PixelStore(out + i * 4, PixelLerp(top, bottom, PixelSplat(y - floor_y)));
+  }
+}
+
+template <bool kSwapRB, bool kOpaque>
+static void FetchRow(const SWSource& source, const SWSpan& span,
+                     uint32_t count, float* out) {
+  if (source.premult_)
+    FetchRow<kSwapRB, kOpaque, true>(source, span, count, out);
+  else
+    FetchRow<kSwapRB, kOpaque, false>(source, span, count, out);
+}
+
+void SWInitRow(float* row, uint32_t count) {
+  const Pixel clear = PixelSet(0.0f, 0.0f, 0.0f, 1.0f);
+  for (uint32_t i = 0; i < count; i++)
+    PixelStore(row + i * 4, clear);
+}
+
+void SWFetchRow(const SWSource& source, const SWSpan& span, uint32_t count,
+                float* out) {
+  FormatInfo info;
+  if (!source.pixels_ || !GetFormatInfo(source.format_, &info)) {
+    const float* color = source.color_;
+    Pixel pixel = PixelSet(color[0], color[1], color[2], color[3]);
+    if (!source.premult_)
+      pixel = PixelMul(pixel, PixelSet(color[3], color[3], color[3], 1.0f));
+
+    for (uint32_t i = 0; i < count; i++)
+      PixelStore(out + i * 4, pixel);
+    return;
+  }
+
+  if (info.swap_rb_) {
+    if (info.opaque_)
+      FetchRow<true, true>(source, span, count, out);
+    else
+      FetchRow<true, false>(source, span, count, out);
+  } else {
+    if (info.opaque_)
+      FetchRow<false, true>(source, span, count, out);
+    else
+      FetchRow<false, false>(source, span, count, out);
+  }
+}
+
+void SWBlendRow(float* row, const float* source, uint32_t count,
+                float alpha) {
+  // row.rgb += source.rgb * alpha * row.a
+  // row.a -= source.a * alpha * row.a
+  uint32_t i = 0;
+#if defined(__AVX2__)
+  const __m256 scale2 = _mm256_setr_ps(alpha, alpha, alpha, -alpha, alpha,
+                                       alpha, alpha, -alpha);
+  for (; i + 2 <= count; i += 2) {
+    __m256 dst = _mm256_loadu_ps(row + i * 4);
+    __m256 src = _mm256_mul_ps(_mm256_loadu_ps(source + i * 4), scale2);
+    __m256 cover = _mm256_permute_ps(dst, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm256_storeu_ps(row + i * 4,
+                     _mm256_add_ps(dst, _mm256_mul_ps(src, cover)));
+  }
+#endif
+
+  const Pixel scale = PixelSet(alpha, alpha, alpha, -alpha);
+  for (; i < count; i++) {
+    Pixel dst = PixelLoad(row + i * 4);
+    Pixel src = PixelMul(PixelLoad(source + i * 4), scale);
+    PixelStore(row + i * 4,
+               PixelAdd(dst, PixelMul(src, PixelSplatAlpha(dst))));
+  }
+}
+
+bool SWIsRowCovered(const float* row, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (row[i * 4 + 3] > 0.5f / 255.0f)
+      return false;
+  }
+
+  return true;
+}
+
+void SWStoreRow(const float* row, uint32_t count, uint32_t format,
+                uint8_t* dst) {
+  FormatInfo info;
+  if (!GetFormatInfo(format, &info))
+    return;
+
+  const Pixel one = PixelSplat(1.0f);
+  for (uint32_t i = 0; i < count; i++) {
+    Pixel pixel = PixelLoad(row + i * 4);
+    // Output alpha is the coverage of all layers.
+    pixel = PixelWithAlpha(pixel, PixelSub(one, pixel));
+    if (info.swap_rb_)
+      pixel = PixelSwapRB(pixel);
+
+    uint32_t bytes = PixelToBytes(pixel);
+    memcpy(dst + i * 4, &bytes, sizeof(bytes));
+  }
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,75 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_SW_SWKERNELS_H_
+#define COMMON_COMPOSITOR_SW_SWKERNELS_H_
+
+#include <stdint.h>
+
+namespace hwcomposer {
+
+// Row kernels of the software compositor. Rows are kept as one float
+// r, g, b, a quad per pixel, with premultiplied colors. The alpha channel
+// of the row being composed holds the coverage left for layers below,
+// layers are blended front to back like in the GL shaders.
+//
+// Kernels use AVX2, SSE4.1 or NEON depending on the instruction set the
+// library is built for and fall back to plain C++ otherwise.
+
+struct SWSource {
+  // NULL for solid color layers.
+  const uint8_t* pixels_;
+  uint32_t stride_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t format_;
+  // Color of solid color layers, not premultiplied.
+  float color_[4];
+  // Colors of the source are premultiplied already.
+  bool premult_;
+};
+
+// Position of the first pixel of a row in source texels, with texel
+// centers at integer positions, and the step to the next pixel.
+struct SWSpan {
+  float x_;
+  float y_;
+  float dx_;
+  float dy_;
+};
+
+bool SWIsFormatSupported(uint32_t format);
+
+// Clears count pixels of a row being composed.
+void SWInitRow(float* row, uint32_t count);
+
+// Samples count pixels of source along span. Sources are clamped at
+// their edges, samples between texels are filtered bilinearly.
+void SWFetchRow(const SWSource& source, const SWSpan& span, uint32_t count,
+                float* out);
+
+// Blends count pixels of source, scaled by alpha, below row.
+void SWBlendRow(float* row, const float* source, uint32_t count, float alpha);
+
+// Returns true in case layers below can't contribute to row anymore.
+bool SWIsRowCovered(const float* row, uint32_t count);
+
+// Writes count pixels of row to dst, which is in format.
+void SWStoreRow(const float* row, uint32_t count, uint32_t format,
+                uint8_t* dst);
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_SW_SWKERNELS_H_
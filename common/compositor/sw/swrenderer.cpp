@@ -0,0 +1,291 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "swrenderer.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <nativebufferhandler.h>
+
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "nativesurface.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+// Rows composed by one task of the thread pool.
+static const uint32_t kBandRows = 32;
+// Threads composing a frame, including the compositor thread.
+static const uint32_t kMaxThreads = 4;
+
+SWRenderer::~SWRenderer() {
+  UnMapImages();
+}
+
+bool SWRenderer::Init() {
+  uint32_t threads = std::thread::hardware_concurrency();
+  threads = std::min(std::max(threads, 1u), kMaxThreads);
+  if (!pool_.Init(threads - 1)) {
+    ETRACE("Failed to initialize SW compositor thread pool.");
+    return false;
+  }
+
+  return true;
+}
+
+bool SWRenderer::Draw(const std::vector<RenderState> &render_states,
+                      NativeSurface *surface) {
+  // SW renderer can't write to protected buffers.
+  surface->GetLayer()->SetProtected(false);
+
+  if (!surface->MakeCurrent())
+    return false;
+
+  const ResourceHandle &target =
+      surface->GetLayer()->GetBuffer()->GetGpuResource(NULL, false);
+  target_format_ = target.handle_->meta_data_.format_;
+  if (!SWIsFormatSupported(target_format_)) {
+    ETRACE("Format %x is not supported by SW renderer.", target_format_);
+    return false;
+  }
+
+  if (!MapImage(&target, &target_)) {
+    UnMapImages();
+    return false;
+  }
+
+  uint32_t frame_width = surface->GetWidth();
+  uint32_t frame_height = surface->GetHeight();
+  bool clear_surface = surface->ClearSurface();
+  bool partial_clear = surface->IsPartialClear();
+
+  surface->SetClearSurface(NativeSurface::kNone);
+
+  if (clear_surface || partial_clear) {
+    HwcRect<int> damage(0, 0, frame_width, frame_height);
+    if (surface->IsOnScreen())
+      damage = surface->GetRenderDamage();
+
+    uint32_t left = std::max(damage.left, 0);
+    uint32_t top = std::max(damage.top, 0);
+    uint32_t right = std::min(std::max(damage.right, 0),
+                              static_cast<int>(frame_width));
+    uint32_t bottom = std::min(std::max(damage.bottom, 0),
+                               static_cast<int>(frame_height));
+    for (uint32_t y = top; left < right && y < bottom; y++) {
+      memset(target_.pixels_ + y * target_.stride_ + left * 4, 0,
+             (right - left) * 4);
+    }
+  }
+
+  bool status = true;
+  layers_.clear();
+  bands_.clear();
+  for (const RenderState &state : render_states) {
+    size_t first_layer = layers_.size();
+    if (!PrepareLayers(state)) {
+      status = false;
+      break;
+    }
+
+    // GL renderer clips regions with the scissor, do the same here.
+    uint32_t right = std::min(state.x_ + state.width_, frame_width);
+    uint32_t bottom = std::min(state.y_ + state.height_, frame_height);
+    if (state.x_ >= right || layers_.size() == first_layer)
+      continue;
+
+    for (uint32_t top = state.y_; top < bottom; top += kBandRows) {
+      Band band;
+      band.state_ = &state;
+      band.first_layer_ = first_layer;
+      band.layer_count_ = layers_.size() - first_layer;
+      band.top_ = top;
+      band.bottom_ = std::min(top + kBandRows, bottom);
+      band.width_ = right - state.x_;
+      bands_.emplace_back(band);
+    }
+  }
+
+  if (status) {
+    size_t scratch_size = 0;
+    for (const Band &band : bands_)
+      scratch_size = std::max<size_t>(scratch_size, band.width_ * 8);
+
+    // Storage only grows, regions of later frames usually fit.
+    scratch_.resize(pool_.GetThreadCount());
+    for (std::vector<float> &scratch : scratch_) {
+      if (scratch.size() < scratch_size)
+        scratch.resize(scratch_size);
+    }
+
+    pool_.Run(
+        [this](size_t index, size_t thread) {
+          DrawBand(bands_.at(index), scratch_.at(thread).data());
+        },
+        bands_.size());
+  }
+
+  UnMapImages();
+
+  if (!status)
+    return false;
+
+  // Frame is done once Draw returns, there is nothing to wait for.
+  if (!disable_explicit_sync_)
+    surface->SetNativeFence(-1);
+
+  surface->ResetDamage();
+  return true;
+}
+
+void SWRenderer::InsertFence(int32_t kms_fence) {
+  // Layers are read by the CPU, wait till they are ready.
+  if (kms_fence > 0) {
+    HWCPoll(kms_fence, -1);
+    close(kms_fence);
+  }
+}
+
+void SWRenderer::SetDisableExplicitSync(bool disable_explicit_sync) {
+  disable_explicit_sync_ = disable_explicit_sync;
+}
+
+bool SWRenderer::MapImage(const ResourceHandle *resource, Image *image) {
+  for (const Image &mapped : images_) {
+    if (mapped.resource_ == resource) {
+      *image = mapped;
+      return true;
+    }
+  }
+
+  const HwcMeta &meta = resource->handle_->meta_data_;
+  image->resource_ = resource;
+  image->stride_ = 0;
+  image->map_data_ = NULL;
+  image->pixels_ = static_cast<uint8_t *>(resource->handler_->Map(
+      resource->handle_, 0, 0, meta.width_, meta.height_, &image->stride_,
+      &image->map_data_, 0));
+  if (!image->pixels_) {
+    ETRACE("Failed to map buffer for SW rendering.");
+    return false;
+  }
+
+  images_.emplace_back(*image);
+  return true;
+}
+
+void SWRenderer::UnMapImages() {
+  for (const Image &image : images_) {
+    image.resource_->handler_->UnMap(image.resource_->handle_,
+                                     image.map_data_);
+  }
+
+  images_.clear();
+}
+
+bool SWRenderer::PrepareLayers(const RenderState &state) {
+  for (const RenderState::LayerState &layer_state : state.layer_state_) {
+    layers_.emplace_back();
+    Layer &layer = layers_.back();
+    layer.state_ = &layer_state;
+    // Matrix swaps x and y of texture coordinates, see TransformMatrices.
+    layer.swap_xy_ = layer_state.texture_matrix_[1] != 0.0f;
+
+    SWSource &source = layer.source_;
+    source.premult_ = layer_state.premult_ != 0.0f;
+    const uint8_t *color = layer_state.solid_color_array_;
+    source.color_[0] = color[3] / 255.0f;
+    source.color_[1] = color[2] / 255.0f;
+    source.color_[2] = color[1] / 255.0f;
+    source.color_[3] = color[0] / 255.0f;
+    source.pixels_ = NULL;
+    source.stride_ = 0;
+    source.width_ = 1;
+    source.height_ = 1;
+    source.format_ = 0;
+    const ResourceHandle *resource = layer_state.handle_;
+    if (!resource)
+      continue;
+
+    const HwcMeta &meta = resource->handle_->meta_data_;
+    if (!SWIsFormatSupported(meta.format_)) {
+      ETRACE("Format %x is not supported by SW renderer.", meta.format_);
+      return false;
+    }
+
+    Image image;
+    if (!MapImage(resource, &image))
+      return false;
+
+    source.pixels_ = image.pixels_;
+    source.stride_ = image.stride_;
+    source.width_ = meta.width_;
+    source.height_ = meta.height_;
+    source.format_ = meta.format_;
+  }
+
+  return true;
+}
+
+void SWRenderer::DrawBand(const Band &band, float *scratch) {
+  const RenderState &state = *band.state_;
+  uint32_t width = band.width_;
+  float *row = scratch;
+  float *source_row = scratch + width * 4;
+  const Layer *layers = &layers_.at(band.first_layer_);
+  for (uint32_t y = band.top_; y < band.bottom_; y++) {
+    SWInitRow(row, width);
+    // Position of pixel centers in the region, in [0, 1].
+    float region_x = 0.5f / state.width_;
+    float region_y = (y - state.y_ + 0.5f) / state.height_;
+    float region_dx = 1.0f / state.width_;
+    for (size_t i = 0; i < band.layer_count_; i++) {
+      const Layer &layer = layers[i];
+      const float *crop = layer.state_->crop_bounds_;
+      float texture_width = layer.source_.width_;
+      float texture_height = layer.source_.height_;
+      float crop_width = (crop[2] - crop[0]) * texture_width;
+      float crop_height = (crop[3] - crop[1]) * texture_height;
+      SWSpan span;
+      if (layer.swap_xy_) {
+        span.x_ = crop[0] * texture_width + region_y * crop_width - 0.5f;
+        span.y_ = crop[1] * texture_height + region_x * crop_height - 0.5f;
+        span.dx_ = 0.0f;
+        span.dy_ = region_dx * crop_height;
+      } else {
+        span.x_ = crop[0] * texture_width + region_x * crop_width - 0.5f;
+        span.y_ = crop[1] * texture_height + region_y * crop_height - 0.5f;
+        span.dx_ = region_dx * crop_width;
+        span.dy_ = 0.0f;
+      }
+
+      SWFetchRow(layer.source_, span, width, source_row);
+      SWBlendRow(row, source_row, width, layer.state_->alpha_);
+      if (SWIsRowCovered(row, width))
+        break;
+    }
+
+    SWStoreRow(row, width, target_format_,
+               target_.pixels_ + y * target_.stride_ + state.x_ * 4);
+  }
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,89 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_SW_SWRENDERER_H_
+#define COMMON_COMPOSITOR_SW_SWRENDERER_H_
+
+#include <vector>
+
+#include "compositordefs.h"
+#include "renderer.h"
+#include "renderstate.h"
+#include "swkernels.h"
+#include "swthreadpool.h"
+
+namespace hwcomposer {
+
+// Composes render states on the CPU, for systems without a usable GPU.
+// Regions are split in bands of rows, which are composed in parallel by
+// a pool of worker threads.
+class SWRenderer : public Renderer {
+ public:
+  SWRenderer() = default;
+  ~SWRenderer() override;
+
+  bool Init() override;
+  bool Draw(const std::vector<RenderState> &commands,
+            NativeSurface *surface) override;
+
+  void InsertFence(int32_t kms_fence) override;
+
+  void SetDisableExplicitSync(bool disable_explicit_sync) override;
+
+ private:
+  struct Image {
+    const ResourceHandle *resource_;
+    uint8_t *pixels_;
+    uint32_t stride_;
+    void *map_data_;
+  };
+
+  struct Layer {
+    SWSource source_;
+    const RenderState::LayerState *state_;
+    bool swap_xy_;
+  };
+
+  struct Band {
+    const RenderState *state_;
+    // Layers of the region in layers_.
+    size_t first_layer_;
+    size_t layer_count_;
+    uint32_t top_;
+    uint32_t bottom_;
+    uint32_t width_;
+  };
+
+  // Maps resource for CPU access, once per Draw call.
+  bool MapImage(const ResourceHandle *resource, Image *image);
+  void UnMapImages();
+  bool PrepareLayers(const RenderState &state);
+  // Composes band using scratch, which holds two rows of the band.
+  void DrawBand(const Band &band, float *scratch);
+
+  std::vector<Image> images_;
+  std::vector<Layer> layers_;
+  std::vector<Band> bands_;
+  // Scratch rows of every thread of pool_, kept across frames.
+  std::vector<std::vector<float>> scratch_;
+  Image target_;
+  uint32_t target_format_ = 0;
+  SWThreadPool pool_;
+  bool disable_explicit_sync_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_SW_SWRENDERER_H_
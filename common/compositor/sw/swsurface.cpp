@@ -0,0 +1,47 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "swsurface.h"
+
+#include "hwctrace.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+SWSurface::SWSurface(uint32_t width, uint32_t height)
+    : NativeSurface(width, height) {
+}
+
+SWSurface::~SWSurface() {
+}
+
+bool SWSurface::MakeCurrent() {
+  OverlayBuffer* layer_buffer = layer_.GetBuffer();
+  if (!layer_buffer) {
+    ETRACE("Failed to get layer buffer for SW rendering.");
+    return false;
+  }
+
+  const ResourceHandle& import = layer_buffer->GetGpuResource(NULL, false);
+  if (!import.handle_ || !import.handler_) {
+    ETRACE("Failed to import surface buffer for CPU access.");
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace hwcomposer
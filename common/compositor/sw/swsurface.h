@@ -0,0 +1,36 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_SW_SWSURFACE_H_
+#define COMMON_COMPOSITOR_SW_SWSURFACE_H_
+
+#include "nativesurface.h"
+
+namespace hwcomposer {
+
+class SWSurface : public NativeSurface {
+ public:
+  SWSurface() = default;
+  ~SWSurface() override;
+  SWSurface(uint32_t width, uint32_t height);
+
+  // Returns true in case the surface has a buffer which can be mapped
+  // for CPU access.
+  bool MakeCurrent() override;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_SW_SWSURFACE_H_
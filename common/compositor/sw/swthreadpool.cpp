@@ -0,0 +1,102 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "swthreadpool.h"
+
+#include <algorithm>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+SWThreadPool::Worker::Worker(SWThreadPool* pool, size_t thread)
+    : HWCThread(-8, "SWCompositorWorker"), pool_(pool), thread_(thread) {
+}
+
+SWThreadPool::Worker::~Worker() {
+  Stop();
+}
+
+bool SWThreadPool::Worker::Start() {
+  return InitWorker();
+}
+
+void SWThreadPool::Worker::Wake() {
+  Resume();
+}
+
+void SWThreadPool::Worker::Stop() {
+  Exit();
+}
+
+void SWThreadPool::Worker::HandleRoutine() {
+  pool_->RunTasks(thread_);
+  pool_->done_.Signal();
+}
+
+SWThreadPool::~SWThreadPool() {
+  for (auto& worker : workers_) {
+    worker->Stop();
+  }
+}
+
+bool SWThreadPool::Init(uint32_t num_workers) {
+  if (!done_.Initialize())
+    return false;
+
+  for (uint32_t i = 0; i < num_workers; i++) {
+    std::unique_ptr<Worker> worker(new Worker(this, i + 1));
+    if (!worker->Start()) {
+      ETRACE("Failed to start SW compositor worker %s", PRINTERROR());
+      break;
+    }
+
+    workers_.emplace_back(std::move(worker));
+  }
+
+  return true;
+}
+
+void SWThreadPool::Run(const std::function<void(size_t, size_t)>& task,
+                       size_t count) {
+  if (count == 0)
+    return;
+
+  task_ = &task;
+  count_ = count;
+  next_.store(0);
+  // Small jobs aren't worth waking up the workers.
+  size_t num_workers = std::min(workers_.size(), count - 1);
+  for (size_t i = 0; i < num_workers; i++) {
+    workers_.at(i)->Wake();
+  }
+
+  RunTasks(0);
+  for (size_t i = 0; i < num_workers; i++) {
+    done_.Wait();
+  }
+
+  task_ = NULL;
+}
+
+void SWThreadPool::RunTasks(size_t thread) {
+  size_t index;
+  while ((index = next_.fetch_add(1)) < count_) {
+    (*task_)(index, thread);
+  }
+}
+
+}  // namespace hwcomposer
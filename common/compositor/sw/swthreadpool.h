@@ -0,0 +1,86 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_SW_SWTHREADPOOL_H_
+#define COMMON_COMPOSITOR_SW_SWTHREADPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "hwcevent.h"
+#include "hwcthread.h"
+
+namespace hwcomposer {
+
+// Worker threads of the software compositor. Run() hands out task
+// indices to the workers and the calling thread, till all of them are
+// done. Threads are numbered, so that tasks can keep scratch memory per
+// thread.
+class SWThreadPool {
+ public:
+  SWThreadPool() = default;
+  ~SWThreadPool();
+  SWThreadPool(const SWThreadPool& rhs) = delete;
+  SWThreadPool& operator=(const SWThreadPool& rhs) = delete;
+
+  // Starts num_workers threads besides the calling one.
+  bool Init(uint32_t num_workers);
+
+  // Returns the number of threads running tasks, including the calling
+  // one.
+  size_t GetThreadCount() const {
+    return workers_.size() + 1;
+  }
+
+  // Calls task(index, thread) for every index < count and returns once
+  // all calls are done. Thread is the number of the thread making the
+  // call, the calling thread is 0.
+  void Run(const std::function<void(size_t, size_t)>& task, size_t count);
+
+ private:
+  class Worker : public HWCThread {
+   public:
+    Worker(SWThreadPool* pool, size_t thread);
+    ~Worker() override;
+
+    bool Start();
+    void Wake();
+    void Stop();
+
+   protected:
+    void HandleRoutine() override;
+
+   private:
+    SWThreadPool* pool_;
+    size_t thread_;
+  };
+
+  void RunTasks(size_t thread);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  const std::function<void(size_t, size_t)>* task_ = NULL;
+  size_t count_ = 0;
+  std::atomic<size_t> next_{0};
+  HWCEvent done_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_SW_SWTHREADPOOL_H_
@@ -629,6 +629,30 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
         .width = (uint32_t)state.width_, .height = (uint32_t)state.height_,
     };
 
+    // Solid color regions are cleared instead of sampling the layer.
+    if (state.flags_ & RenderState::kSolidColor) {
+      const RenderState::LayerState &src = state.layer_state_.front();
+      const uint8_t *color = src.solid_color_array_;
+      float scale = std::max(color[0] / 255.0f, src.premult_) * src.alpha_;
+      VkClearAttachment attachment = {};
+      attachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      attachment.colorAttachment = 0;
+      attachment.clearValue.color.float32[0] = color[3] / 255.0f * scale;
+      attachment.clearValue.color.float32[1] = color[2] / 255.0f * scale;
+      attachment.clearValue.color.float32[2] = color[1] / 255.0f * scale;
+      attachment.clearValue.color.float32[3] = src.alpha_;
+
+      VkClearRect clear_rect = {};
+      clear_rect.rect = scissor;
+      clear_rect.layerCount = 1;
+      vkCmdClearAttachments(cmd_buffer, 1, &attachment, 1, &clear_rect);
+      continue;
+    }
+
+    // Copy and premultiplied blend regions use the generic pipeline.
+    // vkcomp.frag is specialized to the layer count and, unlike the GL
+    // program, has no solid color terms. For one or two layers it fetches
+    // and writes the same texels a dedicated variant would.
     VKProgram *program = GetProgram(layer_count);
     VkPipeline pipeline = program->getPipeline();
     VkPipelineLayout pipeline_layout = program->getPipeLayout();
@@ -282,7 +282,19 @@ void HwcLayer::SufaceDamageTransfrom() {
   }
 }
 
+uint32_t HwcLayer::GetUpdateCount() const {
+  uint32_t history = update_history_ << 1;
+  if (state_ & kLayerContentChanged)
+    history |= 1;
+
+  return __builtin_popcount(history);
+}
+
 void HwcLayer::Validate() {
+  update_history_ <<= 1;
+  if (state_ & kLayerContentChanged)
+    update_history_ |= 1;
+
   state_ &= ~kVisibleRegionChanged;
   state_ |= kLayerValidated;
   state_ &= ~kLayerContentChanged;
@@ -91,10 +91,22 @@ bool LogicalDisplay::Present(std::vector<HwcLayer *> &source_layers,
   if (power_mode_ != kOn)
     return true;
 
-  return logical_display_manager_->Present(source_layers, retire_fence,
+  return logical_display_manager_->Present(source_layers, retire_fence, -1,
                                            call_back, handle_constraints);
 }
 
+bool LogicalDisplay::PresentAt(std::vector<HwcLayer *> &source_layers,
+                               int32_t *retire_fence, int64_t target_timestamp,
+                               PixelUploaderCallback *call_back,
+                               bool handle_constraints) {
+  if (power_mode_ != kOn)
+    return true;
+
+  return logical_display_manager_->Present(source_layers, retire_fence,
+                                           target_timestamp, call_back,
+                                           handle_constraints);
+}
+
 bool LogicalDisplay::PresentClone(NativeDisplay * /*display*/) {
   return false;
 }
@@ -163,6 +175,57 @@ void LogicalDisplay::SetDisableExplicitSync(bool disable_explicit_sync) {
   physical_display_->SetDisableExplicitSync(disable_explicit_sync);
 }
 
+void LogicalDisplay::SetPipelineDepth(uint32_t depth) {
+  physical_display_->SetPipelineDepth(depth);
+}
+
+void LogicalDisplay::SetMailboxMode(bool enable) {
+  physical_display_->SetMailboxMode(enable);
+}
+
+bool LogicalDisplay::GetFrameCoalescingStats(uint32_t *presented,
+                                             uint32_t *coalesced) {
+  return physical_display_->GetFrameCoalescingStats(presented, coalesced);
+}
+
+bool LogicalDisplay::GetFrameStageTiming(HWCFrameStage stage,
+                                         HWCStageTiming *timing) {
+  return physical_display_->GetFrameStageTiming(stage, timing);
+}
+
+bool LogicalDisplay::GetDrawCallStats(uint64_t *frames, uint64_t *draw_calls) {
+  return physical_display_->GetDrawCallStats(frames, draw_calls);
+}
+
+void LogicalDisplay::SetCompositionCacheBudget(uint64_t budget) {
+  physical_display_->SetCompositionCacheBudget(budget);
+}
+
+bool LogicalDisplay::GetCompositionCacheStats(uint32_t *hits,
+                                              uint32_t *misses) {
+  return physical_display_->GetCompositionCacheStats(hits, misses);
+}
+
+void LogicalDisplay::SetOffScreenSurfaceBudget(uint64_t budget) {
+  physical_display_->SetOffScreenSurfaceBudget(budget);
+}
+
+bool LogicalDisplay::GetNextVblankTime(int64_t *timestamp) {
+  return physical_display_->GetNextVblankTime(timestamp);
+}
+
+void LogicalDisplay::SetPresentMarginTuning(uint32_t deviation_factor,
+                                            uint32_t slack_us) {
+  physical_display_->SetPresentMarginTuning(deviation_factor, slack_us);
+}
+
+void LogicalDisplay::SetIdleHysteresis(uint32_t min_idle_frames,
+                                       uint32_t max_idle_frames,
+                                       uint32_t exit_frames) {
+  physical_display_->SetIdleHysteresis(min_idle_frames, max_idle_frames,
+                                       exit_frames);
+}
+
 void LogicalDisplay::SetVideoScalingMode(uint32_t mode) {
   physical_display_->SetVideoScalingMode(mode);
 }
@@ -134,6 +134,7 @@ void LogicalDisplayManager::RegisterHotPlugNotification() {
 
 bool LogicalDisplayManager::Present(std::vector<HwcLayer*>& source_layers,
                                     int32_t* retire_fence,
+                                    int64_t target_timestamp,
                                     PixelUploaderCallback* call_back,
                                     bool handle_constraints) {
   uint32_t total_size = displays_.size();
@@ -188,8 +189,9 @@ bool LogicalDisplayManager::Present(std::vector<HwcLayer*>& source_layers,
     return true;
   }
 
-  bool success = physical_display_->Present(layers_, retire_fence, call_back,
-                                            handle_constraints);
+  bool success =
+      physical_display_->PresentAt(layers_, retire_fence, target_timestamp,
+                                   call_back, handle_constraints);
   std::vector<HwcLayer*>().swap(cursor_layers_);
   std::vector<HwcLayer*>().swap(layers_);
   queued_displays_ = 0;
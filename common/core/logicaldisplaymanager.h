@@ -56,8 +56,15 @@ class LogicalDisplayManager {
    */
   void RegisterHotPlugNotification();
 
+  /**
+   * Presents layers of all logical displays together once each of them
+   * has been presented. target_timestamp of the last one is passed to
+   * the physical display, see NativeDisplay::PresentAt. -1 if there is
+   * none.
+   */
   bool Present(std::vector<HwcLayer*>& source_layers, int32_t* retire_fence,
-               PixelUploaderCallback* call_back, bool handle_constraints);
+               int64_t target_timestamp, PixelUploaderCallback* call_back,
+               bool handle_constraints);
 
   /**
    * Run all display's VSyncUpdate and pass timestamp to each call.
@@ -216,7 +216,15 @@ bool MosaicDisplay::SetPowerMode(uint32_t power_mode) {
 bool MosaicDisplay::Present(std::vector<HwcLayer *> &source_layers,
                             int32_t *retire_fence,
                             PixelUploaderCallback *call_back,
-                            bool /*handle_constraints*/) {
+                            bool handle_constraints) {
+  return PresentAt(source_layers, retire_fence, -1, call_back,
+                   handle_constraints);
+}
+
+bool MosaicDisplay::PresentAt(std::vector<HwcLayer *> &source_layers,
+                              int32_t *retire_fence, int64_t target_timestamp,
+                              PixelUploaderCallback *call_back,
+                              bool /*handle_constraints*/) {
   if (power_mode_ != kOn) {
 #ifdef ENALBE_PANORAMA
     if (skip_update_) {
@@ -297,7 +305,7 @@ bool MosaicDisplay::Present(std::vector<HwcLayer *> &source_layers,
       continue;
     }
 
-    display->Present(layers, &fence, call_back, true);
+    display->PresentAt(layers, &fence, target_timestamp, call_back, true);
     IMOSAICDISPLAYTRACE("Present called for Display index %d \n", i);
     if (fence > 0) {
       if (*retire_fence < 0) {
@@ -546,6 +554,133 @@ void MosaicDisplay::SetDisableExplicitSync(bool disable_explicit_sync) {
   }
 }
 
+void MosaicDisplay::SetPipelineDepth(uint32_t depth) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetPipelineDepth(depth);
+  }
+}
+
+void MosaicDisplay::SetMailboxMode(bool enable) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetMailboxMode(enable);
+  }
+}
+
+bool MosaicDisplay::GetFrameCoalescingStats(uint32_t *presented,
+                                            uint32_t *coalesced) {
+  // All displays get the same frames, use the first one.
+  if (physical_displays_.empty())
+    return false;
+
+  return physical_displays_.at(0)->GetFrameCoalescingStats(presented,
+                                                           coalesced);
+}
+
+bool MosaicDisplay::GetFrameStageTiming(HWCFrameStage stage,
+                                        HWCStageTiming *timing) {
+  // Report the slowest display of the mosaic.
+  bool supported = false;
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    HWCStageTiming display_timing;
+    if (!physical_displays_.at(i)->GetFrameStageTiming(stage, &display_timing))
+      continue;
+
+    if (!supported || display_timing.p99_us_ > timing->p99_us_)
+      *timing = display_timing;
+
+    supported = true;
+  }
+
+  return supported;
+}
+
+bool MosaicDisplay::GetDrawCallStats(uint64_t *frames, uint64_t *draw_calls) {
+  // Every display is composed on its own, report the total.
+  bool supported = false;
+  *frames = 0;
+  *draw_calls = 0;
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    uint64_t display_frames = 0;
+    uint64_t display_draw_calls = 0;
+    if (!physical_displays_.at(i)->GetDrawCallStats(&display_frames,
+                                                    &display_draw_calls))
+      continue;
+
+    *frames += display_frames;
+    *draw_calls += display_draw_calls;
+    supported = true;
+  }
+
+  return supported;
+}
+
+void MosaicDisplay::SetCompositionCacheBudget(uint64_t budget) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetCompositionCacheBudget(budget);
+  }
+}
+
+bool MosaicDisplay::GetCompositionCacheStats(uint32_t *hits,
+                                             uint32_t *misses) {
+  // Every display has a cache of its own, report the total.
+  bool supported = false;
+  *hits = 0;
+  *misses = 0;
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    uint32_t display_hits = 0;
+    uint32_t display_misses = 0;
+    if (!physical_displays_.at(i)->GetCompositionCacheStats(&display_hits,
+                                                            &display_misses))
+      continue;
+
+    *hits += display_hits;
+    *misses += display_misses;
+    supported = true;
+  }
+
+  return supported;
+}
+
+void MosaicDisplay::SetOffScreenSurfaceBudget(uint64_t budget) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetOffScreenSurfaceBudget(budget);
+  }
+}
+
+bool MosaicDisplay::GetNextVblankTime(int64_t *timestamp) {
+  // All displays are expected to be in sync, use the first one.
+  if (physical_displays_.empty())
+    return false;
+
+  return physical_displays_.at(0)->GetNextVblankTime(timestamp);
+}
+
+void MosaicDisplay::SetPresentMarginTuning(uint32_t deviation_factor,
+                                           uint32_t slack_us) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetPresentMarginTuning(deviation_factor,
+                                                     slack_us);
+  }
+}
+
+void MosaicDisplay::SetIdleHysteresis(uint32_t min_idle_frames,
+                                      uint32_t max_idle_frames,
+                                      uint32_t exit_frames) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetIdleHysteresis(min_idle_frames,
+                                                max_idle_frames, exit_frames);
+  }
+}
+
 void MosaicDisplay::SetVideoScalingMode(uint32_t mode) {
   uint32_t size = physical_displays_.size();
   for (uint32_t i = 0; i < size; i++) {
@@ -76,6 +76,25 @@ class MosaicDisplay : public NativeDisplay {
   void SetContrast(uint32_t red, uint32_t green, uint32_t blue) override;
   void SetBrightness(uint32_t red, uint32_t green, uint32_t blue) override;
   void SetDisableExplicitSync(bool disable_explicit_sync) override;
+  void SetPipelineDepth(uint32_t depth) override;
+  void SetMailboxMode(bool enable) override;
+  bool GetFrameCoalescingStats(uint32_t *presented,
+                               uint32_t *coalesced) override;
+  bool GetFrameStageTiming(HWCFrameStage stage,
+                           HWCStageTiming *timing) override;
+  bool GetDrawCallStats(uint64_t *frames, uint64_t *draw_calls) override;
+  void SetCompositionCacheBudget(uint64_t budget) override;
+  bool GetCompositionCacheStats(uint32_t *hits, uint32_t *misses) override;
+  void SetOffScreenSurfaceBudget(uint64_t budget) override;
+  bool PresentAt(std::vector<HwcLayer *> &source_layers, int32_t *retire_fence,
+                 int64_t target_timestamp,
+                 PixelUploaderCallback *call_back = NULL,
+                 bool handle_constraints = false) override;
+  bool GetNextVblankTime(int64_t *timestamp) override;
+  void SetPresentMarginTuning(uint32_t deviation_factor,
+                              uint32_t slack_us) override;
+  void SetIdleHysteresis(uint32_t min_idle_frames, uint32_t max_idle_frames,
+                         uint32_t exit_frames) override;
   void SetVideoScalingMode(uint32_t mode) override;
   void SetVideoColor(HWCColorControl color, float value) override;
   void GetVideoColor(HWCColorControl color, float *value, float *start,
@@ -30,6 +30,11 @@
 
 namespace hwcomposer {
 
+// Layers changing in at least 24 of the last 32 frames are considered
+// to be updated frequently, till they drop below 16.
+static const uint32_t kFrequentUpdateCount = 24;
+static const uint32_t kInfrequentUpdateCount = 16;
+
 OverlayLayer::ImportedBuffer::~ImportedBuffer() {
   if (acquire_fence_ > 0) {
     close(acquire_fence_);
@@ -37,7 +42,7 @@ OverlayLayer::ImportedBuffer::~ImportedBuffer() {
 }
 
 OverlayLayer::ImportedBuffer::ImportedBuffer(
-    std::shared_ptr<OverlayBuffer>& buffer, int32_t acquire_fence)
+    const std::shared_ptr<OverlayBuffer>& buffer, int32_t acquire_fence)
     : acquire_fence_(acquire_fence) {
   buffer_ = buffer;
 }
@@ -114,7 +119,11 @@ void OverlayLayer::SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
   }
 
   buffer->SetDataSpace(dataspace_);
+  SetBuffer(buffer, acquire_fence);
+}
 
+void OverlayLayer::SetBuffer(const std::shared_ptr<OverlayBuffer>& buffer,
+                             int32_t acquire_fence) {
   imported_buffer_.reset(new ImportedBuffer(buffer, acquire_fence));
   ValidateForOverlayUsage();
 }
@@ -289,8 +298,40 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
   dataspace_ = layer->GetDataSpace();
   blending_ = layer->GetBlending();
   solid_color_ = layer->GetSolidColor();
+  switch (layer->GetCompositionQuality()) {
+    case HWCCompositionQuality::kHalf:
+      max_down_scaling_factor_ = 2;
+      break;
+    case HWCCompositionQuality::kQuarter:
+      max_down_scaling_factor_ = 4;
+      break;
+    default:
+      max_down_scaling_factor_ = 1;
+      break;
+  }
+
+  update_count_ = layer->GetUpdateCount();
+  // Use a lower threshold for leaving the frequently updated
+  // state than for entering it, so that layers updated at a
+  // rate close to the threshold don't switch state every
+  // frame.
+  bool frequently_updated =
+      previous_layer && previous_layer->IsFrequentlyUpdated();
+  if (update_count_ >= kFrequentUpdateCount ||
+      (frequently_updated && update_count_ >= kInfrequentUpdateCount)) {
+    state_ |= kFrequentlyUpdated;
+  } else {
+    state_ &= ~kFrequentlyUpdated;
+  }
+
   TransformDamage(layer, max_height, max_width);
 
+  if (previous_layer) {
+    dirty_ = 0;
+    if (layer->HasZorderChanged())
+      dirty_ |= kDirtyZorder;
+  }
+
   if (previous_layer && layer->HasZorderChanged()) {
     if (previous_layer->actual_composition_ == kGpu) {
       CalculateRect(previous_layer->display_frame_, surface_damage_);
@@ -492,12 +533,42 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
   supported_composition_ = rhs->supported_composition_;
   actual_composition_ = rhs->actual_composition_;
 
+  // Re-plan the planes in case layer started or stopped being
+  // updated frequently, so that it gets a plane of its own or
+  // is blended together with static layers. Layers becoming static or
+  // not don't change the plan, PlaneAllocator treats update counts below
+  // kMinGroupUpdateCount alike.
+  if (IsFrequentlyUpdated() != rhs->IsFrequentlyUpdated())
+    state_ |= kNeedsReValidation;
+
+  // Resolution planes showing this layer are composed at might change.
+  if (max_down_scaling_factor_ != rhs->max_down_scaling_factor_)
+    state_ |= kNeedsReValidation;
+
   bool content_changed = false;
   bool rect_changed = layer->HasDisplayRectChanged();
   bool source_rect_changed = layer->HasSourceRectChanged();
   if (source_rect_changed)
     state_ |= kSourceRectChanged;
 
+  OverlayBuffer* rhs_buffer = NULL;
+  if (rhs->imported_buffer_.get())
+    rhs_buffer = rhs->imported_buffer_->buffer_.get();
+
+  if ((!buffer != !rhs_buffer) ||
+      (buffer && rhs_buffer && buffer->GetFormat() != rhs_buffer->GetFormat()))
+    dirty_ |= kDirtyBuffer;
+
+  if (rect_changed || (source_crop_width_ != rhs->source_crop_width_) ||
+      (source_crop_height_ != rhs->source_crop_height_))
+    dirty_ |= kDirtyGeometry;
+
+  if ((alpha_ != rhs->alpha_) || (blending_ != rhs->blending_))
+    dirty_ |= kDirtyAlpha;
+
+  if ((transform_ != rhs->transform_) || layer->HasLayerAttributesChanged())
+    dirty_ |= kDirtyTransform;
+
   // We expect cursor plane to support alpha always.
   if ((actual_composition_ & kGpu) || (type_ == kLayerCursor) ||
       (type_ == kLayerSolidColor)) {
@@ -540,17 +611,17 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
     // transparent planes. We assume plane supporting
     // ARGB will support XRGB.
     if ((rhs->alpha_ == 0xff) && (alpha_ != rhs->alpha_)) {
-      state_ |= kNeedsReValidation;
+      state_ |= kPlaneLocalReValidation;
       return;
     }
 
     if (blending_ != rhs->blending_) {
-      state_ |= kNeedsReValidation;
+      state_ |= kPlaneLocalReValidation;
       return;
     }
 
     if (rect_changed || layer->HasLayerAttributesChanged()) {
-      state_ |= kNeedsReValidation;
+      state_ |= kPlaneLocalReValidation;
       return;
     }
 
@@ -559,7 +630,7 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
       // shouldn't impact the plane composition results.
       if ((source_crop_width_ != rhs->source_crop_width_) ||
           (source_crop_height_ != rhs->source_crop_height_)) {
-        state_ |= kNeedsReValidation;
+        state_ |= kPlaneLocalReValidation;
         return;
       }
     }
@@ -571,7 +642,7 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
 
   if (!layer->HasVisibleRegionChanged() && !content_changed &&
       surface_damage_.empty() && !layer->HasLayerContentChanged() &&
-      !(state_ & kNeedsReValidation) && !layer->GetUseForMosaic()) {
+      !NeedsRevalidation() && !layer->GetUseForMosaic()) {
     state_ &= ~kLayerContentChanged;
   }
 }
@@ -607,6 +678,7 @@ void OverlayLayer::CloneLayer(const OverlayLayer* layer,
   z_order_ = z_order;
   blending_ = layer->blending_;
   solid_color_ = layer->solid_color_;
+  max_down_scaling_factor_ = layer->max_down_scaling_factor_;
 }
 
 void OverlayLayer::Dump() {
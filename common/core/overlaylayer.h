@@ -32,6 +32,22 @@ class OverlayBuffer;
 class ResourceManager;
 
 struct OverlayLayer {
+  // Properties which changed compared to the layer at the same z order in
+  // the previous frame.
+  enum LayerDirtyFlags {
+    kDirtyBuffer = 1 << 0,     // Buffer format changed or buffer was added
+                               // or removed.
+    kDirtyGeometry = 1 << 1,   // Display frame or source crop size changed.
+    kDirtyAlpha = 1 << 2,      // Alpha or blending changed.
+    kDirtyTransform = 1 << 3,  // Transform changed.
+    kDirtyZorder = 1 << 4,     // Layer moved in the stack.
+    kDirtyAll = kDirtyBuffer | kDirtyGeometry | kDirtyAlpha | kDirtyTransform |
+                kDirtyZorder,
+    // Changes which don't affect planes used by other layers. It's enough
+    // to re-test the plane this layer is scanned out by.
+    kDirtyPlaneLocal = kDirtyGeometry | kDirtyAlpha | kDirtyTransform
+  };
+
   enum LayerComposition {
     kGpu = 1 << 0,      // Needs GPU Composition.
     kDisplay = 1 << 1,  // Display Can scanout the layer directly.
@@ -110,6 +126,10 @@ struct OverlayLayer {
   void SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
                  ResourceManager* buffer_manager, bool register_buffer);
 
+  // Uses buffer, which has already been imported, for this layer.
+  void SetBuffer(const std::shared_ptr<OverlayBuffer>& buffer,
+                 int32_t acquire_fence);
+
   std::shared_ptr<OverlayBuffer>& GetSharedBuffer() const;
 
   void SetSourceCrop(const HwcRect<float>& source_crop);
@@ -152,6 +172,26 @@ struct OverlayLayer {
     return state_ & kLayerContentChanged;
   }
 
+  // Returns in how many of the last 32 frames content
+  // of this layer has changed.
+  uint32_t GetUpdateCount() const {
+    return update_count_;
+  }
+
+  // Returns true if this layer is updated (nearly) every
+  // frame, i.e. video or games. Such layers should get a
+  // plane of their own.
+  bool IsFrequentlyUpdated() const {
+    return state_ & kFrequentlyUpdated;
+  }
+
+  // Returns by how much content of this layer may be scaled
+  // down in both directions when composed by the GPU, 1, 2
+  // or 4. See HWCCompositionQuality.
+  uint32_t GetMaxDownScalingFactor() const {
+    return max_down_scaling_factor_;
+  }
+
   // Returns true if this layer is visible.
   bool IsVisible() const {
     return !(state_ & kInvisible);
@@ -194,6 +234,16 @@ struct OverlayLayer {
     return type_ == kLayerSolidColor;
   }
 
+  // Video layer has been picked by DisplayPlaneManager to be scanned out
+  // directly, instead of going through the media pipeline.
+  void SetVideoScanout(bool video_scanout) {
+    video_scanout_ = video_scanout;
+  }
+
+  bool IsVideoScanout() const {
+    return video_scanout_;
+  }
+
   bool IsProtected() const {
     return type_ == kLayerProtected;
   }
@@ -234,14 +284,28 @@ struct OverlayLayer {
   // we are able to show the layer on screen
   // correctly.
   bool NeedsRevalidation() const {
-    return state_ & kNeedsReValidation;
+    return state_ & (kNeedsReValidation | kPlaneLocalReValidation);
   }
 
   bool NeedsPartialClear() const {
     return state_ & kForcePartialClear;
   }
 
-  uint32_t GetSolidColor() {
+  // Returns LayerDirtyFlags for this frame. kDirtyAll is returned in
+  // case there is no previous frame state to compare with.
+  uint32_t GetDirtyFlags() const {
+    return dirty_;
+  }
+
+  // Returns true if the layer needs to be re-validated but only has
+  // changes which can be checked by re-testing the plane it's on. Any
+  // other reason for re-validation needs all planes to be validated.
+  bool NeedsPlaneLocalRevalidation() const {
+    return (state_ & kPlaneLocalReValidation) &&
+           !(state_ & kNeedsReValidation) && !(dirty_ & ~kDirtyPlaneLocal);
+  }
+
+  uint32_t GetSolidColor() const {
     return solid_color_;
   }
 
@@ -261,12 +325,15 @@ struct OverlayLayer {
     kInvisible = 1 << 2,
     kSourceRectChanged = 1 << 3,
     kNeedsReValidation = 1 << 4,
-    kForcePartialClear = 1 << 5
+    kForcePartialClear = 1 << 5,
+    kFrequentlyUpdated = 1 << 6,
+    // Re-validation is needed only for changes in kDirtyPlaneLocal.
+    kPlaneLocalReValidation = 1 << 7
   };
 
   struct ImportedBuffer {
    public:
-    ImportedBuffer(std::shared_ptr<OverlayBuffer>& buffer,
+    ImportedBuffer(const std::shared_ptr<OverlayBuffer>& buffer,
                    int32_t acquire_fence);
     ~ImportedBuffer();
 
@@ -306,16 +373,20 @@ struct OverlayLayer {
   uint32_t dataspace_ = 0;
 
   uint32_t solid_color_ = 0;
+  uint32_t update_count_ = 0;
+  uint32_t max_down_scaling_factor_ = 1;
 
   HwcRect<float> source_crop_;
   HwcRect<int> display_frame_;
   HwcRect<int> surface_damage_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
   uint32_t state_ = kLayerContentChanged | kDimensionsChanged;
+  uint32_t dirty_ = kDirtyAll;
   std::unique_ptr<ImportedBuffer> imported_buffer_;
   LayerComposition supported_composition_ = kAll;
   LayerComposition actual_composition_ = kAll;
   HWCLayerType type_ = kLayerNormal;
+  bool video_scanout_ = false;
 };
 
 }  // namespace hwcomposer
@@ -0,0 +1,297 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "compositioncache.h"
+
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "nativesurface.h"
+#include "overlaybuffer.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+static inline void HashCombine(uint64_t &hash, uint64_t value) {
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  hash *= 0x100000001b3ULL;
+}
+
+template <typename T>
+static inline void HashRect(uint64_t &hash, const HwcRect<T> &rect) {
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.left)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.top)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.right)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.bottom)));
+}
+
+CompositionCache::CompositionCache(uint64_t budget) : budget_(budget) {
+}
+
+void CompositionCache::SetBudget(uint64_t budget,
+                                 std::vector<NativeSurface *> &evicted) {
+  budget_ = budget;
+  Trim(budget_, evicted);
+}
+
+bool CompositionCache::Insert(const DisplayPlaneState &plane,
+                              const std::vector<OverlayLayer> &layers,
+                              std::vector<NativeSurface *> &evicted) {
+  if (budget_ == 0 || !plane.NeedsOffScreenComposition() ||
+      plane.IsVideoPlane() || plane.ApplyEffects())
+    return false;
+
+  const std::vector<NativeSurface *> &surfaces = plane.GetSurfaces();
+  if (surfaces.empty())
+    return false;
+
+  // Planes are retired once more in case layers are validated again
+  // within the same frame.
+  for (const Entry &entry : entries_) {
+    if (entry.surfaces_.front() == surfaces.front())
+      return true;
+  }
+
+  uint64_t size = 0;
+  for (NativeSurface *surface : surfaces) {
+    // Surfaces not shown yet don't hold a complete composition.
+    if (!surface->IsOnScreen())
+      return false;
+
+    size += GetSurfaceSize(surface);
+  }
+
+  if (size > budget_)
+    return false;
+
+  const std::vector<size_t> &source_layers = plane.GetSourceLayers();
+  for (size_t index : source_layers) {
+    if (index >= layers.size())
+      return false;
+  }
+
+  entries_.emplace_front();
+  Entry &entry = entries_.front();
+  entry.signature_ = GetSignature(plane, layers);
+  entry.display_frame_ = plane.GetDisplayFrame();
+  entry.down_scaling_factor_ = plane.GetDownScalingFactor();
+  entry.surfaces_ = surfaces;
+  entry.size_ = size;
+  entry.layers_.reserve(source_layers.size());
+  for (size_t index : source_layers) {
+    const OverlayLayer &layer = layers.at(index);
+    entry.layers_.emplace_back();
+    LayerKey &key = entry.layers_.back();
+    key.has_buffer_ = layer.GetBuffer() != NULL;
+    if (key.has_buffer_)
+      key.buffer_ = layer.GetSharedBuffer();
+
+    key.source_crop_ = layer.GetSourceCrop();
+    key.display_frame_ = layer.GetDisplayFrame();
+    key.transform_ = layer.GetMergedTransform();
+    key.solid_color_ = layer.GetSolidColor();
+    key.blending_ = layer.GetBlending();
+    key.alpha_ = layer.GetAlpha();
+  }
+
+  size_ += size;
+  // New entry fits in the budget, so it's never evicted here.
+  Trim(budget_, evicted);
+  IPLANECACHETRACE("CompositionCache insert %llx, %zu entries using %llu bytes",
+                   (unsigned long long)entry.signature_, entries_.size(),
+                   (unsigned long long)size_);
+  return true;
+}
+
+bool CompositionCache::Lookup(const DisplayPlaneState &plane,
+                              const std::vector<OverlayLayer> &layers,
+                              std::vector<NativeSurface *> &surfaces) {
+  NativeSurface *target = plane.GetOffScreenTarget();
+  if (!target)
+    return false;
+
+  uint64_t signature = GetSignature(plane, layers);
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->signature_ != signature || !Matches(*it, plane, layers) ||
+        !HasCompatibleSurfaces(*it, plane, target))
+      continue;
+
+    surfaces.swap(it->surfaces_);
+    size_ -= it->size_;
+    entries_.erase(it);
+    hits_++;
+    IPLANECACHETRACE("CompositionCache hit %llx hits: %u misses: %u",
+                     (unsigned long long)signature, hits_, misses_);
+    return true;
+  }
+
+  misses_++;
+  IPLANECACHETRACE("CompositionCache miss %llx hits: %u misses: %u",
+                   (unsigned long long)signature, hits_, misses_);
+  return false;
+}
+
+void CompositionCache::Invalidate(const std::vector<OverlayLayer> &layers,
+                                  std::vector<NativeSurface *> &evicted) {
+  auto it = entries_.begin();
+  while (it != entries_.end()) {
+    bool stale = false;
+    for (const LayerKey &key : it->layers_) {
+      if (!key.has_buffer_)
+        continue;
+
+      // A released buffer might be replaced by one at the same address.
+      std::shared_ptr<OverlayBuffer> buffer = key.buffer_.lock();
+      if (!buffer) {
+        stale = true;
+        break;
+      }
+
+      for (const OverlayLayer &layer : layers) {
+        if (layer.GetBuffer() == buffer.get() &&
+            layer.HasLayerContentChanged()) {
+          stale = true;
+          break;
+        }
+      }
+
+      if (stale)
+        break;
+    }
+
+    auto current = it++;
+    if (stale)
+      Evict(current, evicted);
+  }
+}
+
+void CompositionCache::Reset(std::vector<NativeSurface *> &evicted) {
+  Trim(0, evicted);
+}
+
+void CompositionCache::Clear() {
+  EntryList().swap(entries_);
+  size_ = 0;
+}
+
+uint64_t CompositionCache::GetSignature(
+    const DisplayPlaneState &plane, const std::vector<OverlayLayer> &layers) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  HashRect(hash, plane.GetDisplayFrame());
+  HashCombine(hash, plane.GetDownScalingFactor());
+  const std::vector<size_t> &source_layers = plane.GetSourceLayers();
+  HashCombine(hash, source_layers.size());
+  for (size_t index : source_layers) {
+    if (index >= layers.size())
+      break;
+
+    const OverlayLayer &layer = layers.at(index);
+    HashCombine(hash, reinterpret_cast<uintptr_t>(layer.GetBuffer()));
+    HashCombine(hash, layer.GetAlpha());
+    HashCombine(hash, layer.GetMergedTransform());
+    HashRect(hash, layer.GetSourceCrop());
+    HashRect(hash, layer.GetDisplayFrame());
+  }
+
+  return hash;
+}
+
+bool CompositionCache::Matches(const Entry &entry,
+                               const DisplayPlaneState &plane,
+                               const std::vector<OverlayLayer> &layers) {
+  const std::vector<size_t> &source_layers = plane.GetSourceLayers();
+  if (entry.layers_.size() != source_layers.size() ||
+      entry.down_scaling_factor_ != plane.GetDownScalingFactor() ||
+      !(entry.display_frame_ == plane.GetDisplayFrame()))
+    return false;
+
+  size_t size = source_layers.size();
+  for (size_t i = 0; i < size; i++) {
+    size_t index = source_layers.at(i);
+    if (index >= layers.size())
+      return false;
+
+    const OverlayLayer &layer = layers.at(index);
+    const LayerKey &key = entry.layers_.at(i);
+    std::shared_ptr<OverlayBuffer> buffer = key.buffer_.lock();
+    if (key.has_buffer_ != (layer.GetBuffer() != NULL) ||
+        buffer.get() != layer.GetBuffer() ||
+        !(key.source_crop_ == layer.GetSourceCrop()) ||
+        !(key.display_frame_ == layer.GetDisplayFrame()) ||
+        key.transform_ != layer.GetMergedTransform() ||
+        key.blending_ != layer.GetBlending() || key.alpha_ != layer.GetAlpha())
+      return false;
+
+    if (!key.has_buffer_ && key.solid_color_ != layer.GetSolidColor())
+      return false;
+  }
+
+  return true;
+}
+
+bool CompositionCache::HasCompatibleSurfaces(const Entry &entry,
+                                             const DisplayPlaneState &plane,
+                                             NativeSurface *target) {
+  NativeSurface *surface = entry.surfaces_.front();
+  OverlayBuffer *buffer = surface->GetLayer()->GetBuffer();
+  OverlayBuffer *target_buffer = target->GetLayer()->GetBuffer();
+  if (!buffer || !target_buffer)
+    return false;
+
+  // Surfaces are sized to the plane they have been allocated for, see
+  // SurfacePool.
+  uint32_t width = 0;
+  uint32_t height = 0;
+  plane.GetOffScreenTargetSize(&width, &height);
+  for (NativeSurface *cached : entry.surfaces_) {
+    if (static_cast<uint32_t>(cached->GetWidth()) < width ||
+        static_cast<uint32_t>(cached->GetHeight()) < height)
+      return false;
+  }
+
+  return buffer->GetFormat() == target_buffer->GetFormat() &&
+         surface->GetModifier() == target->GetModifier() &&
+         surface->GetLayer()->GetTransform() ==
+             target->GetLayer()->GetTransform();
+}
+
+uint64_t CompositionCache::GetSurfaceSize(NativeSurface *surface) {
+  uint32_t bpp = 32;
+  OverlayBuffer *buffer = surface->GetLayer()->GetBuffer();
+  if (buffer)
+    bpp = GetBitsPerPixelForFormat(buffer->GetFormat());
+
+  return static_cast<uint64_t>(surface->GetWidth()) * surface->GetHeight() *
+         bpp / 8;
+}
+
+void CompositionCache::Trim(uint64_t budget,
+                            std::vector<NativeSurface *> &evicted) {
+  while (size_ > budget && !entries_.empty()) {
+    Evict(--entries_.end(), evicted);
+  }
+}
+
+void CompositionCache::Evict(EntryList::iterator entry,
+                             std::vector<NativeSurface *> &evicted) {
+  IPLANECACHETRACE("CompositionCache evict %llx",
+                   (unsigned long long)entry->signature_);
+  evicted.insert(evicted.end(), entry->surfaces_.begin(),
+                 entry->surfaces_.end());
+  size_ -= entry->size_;
+  entries_.erase(entry);
+}
+
+}  // namespace hwcomposer
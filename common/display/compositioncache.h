@@ -0,0 +1,145 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_COMPOSITIONCACHE_H_
+#define COMMON_DISPLAY_COMPOSITIONCACHE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "displayplanestate.h"
+
+namespace hwcomposer {
+
+class NativeSurface;
+class OverlayBuffer;
+struct OverlayLayer;
+
+// Keeps the offscreen surfaces of planes which are not used anymore,
+// together with a description of the composition they hold. A plane
+// blending the same layers later on takes the surfaces over instead of
+// blending the layers again, i.e. when layers on top of a static group
+// move around and all planes above them are validated again.
+//
+// Entries are keyed on the buffers of the blended layers, their rects,
+// alpha, blending and transform. An entry is dropped as soon as the
+// content of one of its buffers changes. Cached surfaces keep their
+// age, so they are neither recycled nor released by DisplayPlaneManager
+// while cached. Evicted surfaces are handed back to the caller, which
+// needs to recycle them once they are offscreen.
+class CompositionCache {
+ public:
+  explicit CompositionCache(uint64_t budget = kDefaultBudget);
+  CompositionCache(const CompositionCache& rhs) = delete;
+  CompositionCache& operator=(const CompositionCache& rhs) = delete;
+
+  // Sets memory, in bytes, the cached surfaces may use at most. 0
+  // disables the cache. Surfaces not fitting anymore are added to
+  // evicted.
+  void SetBudget(uint64_t budget, std::vector<NativeSurface*>& evicted);
+
+  // Takes over the surfaces of plane, which is being retired. layers
+  // are the layers of the frame plane has last been shown with. Returns
+  // false in case plane can't be cached, the caller needs to recycle its
+  // surfaces in that case. Least recently used entries not fitting in
+  // the budget anymore are added to evicted.
+  bool Insert(const DisplayPlaneState& plane,
+              const std::vector<OverlayLayer>& layers,
+              std::vector<NativeSurface*>& evicted);
+
+  // Returns true in case the composition of plane, showing layers, has
+  // been cached with surfaces compatible with the current offscreen
+  // target of plane. In that case the entry is dropped and its surfaces,
+  // current composition first, are moved to surfaces.
+  bool Lookup(const DisplayPlaneState& plane,
+              const std::vector<OverlayLayer>& layers,
+              std::vector<NativeSurface*>& surfaces);
+
+  // Drops entries using a buffer of a layer whose content has changed
+  // with this frame.
+  void Invalidate(const std::vector<OverlayLayer>& layers,
+                  std::vector<NativeSurface*>& evicted);
+
+  // Drops all entries, adding their surfaces to evicted.
+  void Reset(std::vector<NativeSurface*>& evicted);
+
+  // Forgets all entries. To be used once the surfaces have been
+  // destroyed.
+  void Clear();
+
+  uint32_t GetHits() const {
+    return hits_;
+  }
+
+  uint32_t GetMisses() const {
+    return misses_;
+  }
+
+  uint64_t GetSize() const {
+    return size_;
+  }
+
+ private:
+  // Enough for three full sets of 1080p ARGB surfaces.
+  static const uint64_t kDefaultBudget = 3 * 3 * 1920 * 1080 * 4;
+
+  struct LayerKey {
+    std::weak_ptr<OverlayBuffer> buffer_;
+    HwcRect<float> source_crop_;
+    HwcRect<int> display_frame_;
+    uint32_t transform_;
+    uint32_t solid_color_;
+    HWCBlending blending_;
+    uint8_t alpha_;
+    bool has_buffer_;
+  };
+
+  struct Entry {
+    uint64_t signature_;
+    HwcRect<int> display_frame_;
+    uint32_t down_scaling_factor_;
+    std::vector<LayerKey> layers_;
+    std::vector<NativeSurface*> surfaces_;
+    uint64_t size_;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  static uint64_t GetSignature(const DisplayPlaneState& plane,
+                               const std::vector<OverlayLayer>& layers);
+  static bool Matches(const Entry& entry, const DisplayPlaneState& plane,
+                      const std::vector<OverlayLayer>& layers);
+  static bool HasCompatibleSurfaces(const Entry& entry,
+                                    const DisplayPlaneState& plane,
+                                    NativeSurface* target);
+  static uint64_t GetSurfaceSize(NativeSurface* surface);
+
+  // Drops least recently used entries till size_ is at most budget.
+  void Trim(uint64_t budget, std::vector<NativeSurface*>& evicted);
+  void Evict(EntryList::iterator entry, std::vector<NativeSurface*>& evicted);
+
+  EntryList entries_;
+  uint64_t budget_;
+  uint64_t size_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_COMPOSITIONCACHE_H_
@@ -0,0 +1,152 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "displaycommitthread.h"
+
+#include "displayqueue.h"
+#include "hwctrace.h"
+#include "hwcutils.h"
+
+namespace hwcomposer {
+
+static const int64_t kOneMillisecondNs = 1000 * 1000;
+
+DisplayCommitThread::DisplayCommitThread(DisplayQueue* queue)
+    : HWCThread(-8, "DisplayCommitThread"), queue_(queue) {
+}
+
+DisplayCommitThread::~DisplayCommitThread() {
+  HWCThread::Exit();
+}
+
+bool DisplayCommitThread::Initialize() {
+  if (!slot_event_.Initialize() || !done_event_.Initialize())
+    return false;
+
+  slot_handler_.AddFd(slot_event_.get_fd());
+  if (!InitWorker()) {
+    ETRACE("Failed to initalize DisplayCommitThread. %s", PRINTERROR());
+    return false;
+  }
+
+  return true;
+}
+
+void DisplayCommitThread::QueueFrame() {
+  state_lock_.lock();
+  state_ = kQueued;
+  state_lock_.unlock();
+  Resume();
+}
+
+bool DisplayCommitThread::Flush(bool drop) {
+  state_lock_.lock();
+  if (state_ == kIdle) {
+    state_lock_.unlock();
+    return false;
+  }
+
+  if (drop && state_ == kWaitingForSlot) {
+    state_ = kIdle;
+    state_lock_.unlock();
+    slot_event_.Signal();
+    return true;
+  }
+
+  waiting_ = true;
+  state_lock_.unlock();
+  done_event_.Wait();
+  return false;
+}
+
+void DisplayCommitThread::HandleRoutine() {
+  state_lock_.lock();
+  if (state_ != kQueued) {
+    state_lock_.unlock();
+    return;
+  }
+
+  state_ = kPreparing;
+  state_lock_.unlock();
+
+  bool rendered = queue_->WaitForQueuedFrame();
+
+  // Clear any wake up meant for a frame dropped earlier.
+  while (slot_handler_.Poll(0) > 0 &&
+         slot_handler_.IsReady(slot_event_.get_fd()) > 0) {
+    slot_event_.Wait();
+  }
+
+  state_lock_.lock();
+  state_ = kWaitingForSlot;
+  state_lock_.unlock();
+
+  WaitForCommitSlot();
+
+  state_lock_.lock();
+  if (state_ != kWaitingForSlot) {
+    // Frame has been dropped, DisplayQueue takes care of it.
+    state_lock_.unlock();
+    IPAGEFLIPEVENTTRACE("DisplayCommitThread: Queued frame dropped.");
+    return;
+  }
+
+  state_ = kCommitting;
+  state_lock_.unlock();
+
+  queue_->CommitQueuedFrame(rendered);
+
+  state_lock_.lock();
+  state_ = kIdle;
+  if (waiting_) {
+    waiting_ = false;
+    done_event_.Signal();
+  }
+  state_lock_.unlock();
+
+  // The next frame can't be committed before this one has been flipped
+  // anyway, wait for it here so that its release fences get signalled.
+  queue_->SignalQueuedFrameRelease();
+}
+
+void DisplayCommitThread::WaitForCommitSlot() {
+  int timeout = GetCommitTimeout();
+  if (timeout <= 0)
+    return;
+
+  IPAGEFLIPEVENTTRACE("DisplayCommitThread: Waiting %d ms for commit slot.",
+                      timeout);
+  if (slot_handler_.Poll(timeout) <= 0)
+    return;
+
+  if (slot_handler_.IsReady(slot_event_.get_fd()) > 0)
+    slot_event_.Wait();
+}
+
+int DisplayCommitThread::GetCommitTimeout() const {
+  // Commit right away if we don't know when the next vblank is.
+  int64_t commit_time = queue_->GetQueuedFrameCommitTime();
+  if (commit_time < 0)
+    return 0;
+
+  int64_t timeout = commit_time - GetMonotonicTime();
+  if (timeout <= 0)
+    return 0;
+
+  return static_cast<int>(timeout / kOneMillisecondNs);
+}
+
+}  // namespace hwcomposer
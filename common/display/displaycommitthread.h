@@ -0,0 +1,81 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_DISPLAYCOMMITTHREAD_H_
+#define COMMON_DISPLAY_DISPLAYCOMMITTHREAD_H_
+
+#include <stdint.h>
+
+#include <spinlock.h>
+
+#include "fdhandler.h"
+#include "hwcevent.h"
+#include "hwcthread.h"
+
+namespace hwcomposer {
+
+class DisplayQueue;
+
+// Commits frames prepared by DisplayQueue off the client thread. The thread
+// waits for the frame to be rendered and for the previous one to be
+// flipped and than commits it as late as possible before the vblank it
+// should be shown at. This allows a frame queued in the meantime to
+// replace it.
+class DisplayCommitThread : public HWCThread {
+ public:
+  explicit DisplayCommitThread(DisplayQueue* queue);
+  ~DisplayCommitThread() override;
+
+  bool Initialize();
+
+  // Hands over the frame prepared by DisplayQueue.
+  void QueueFrame();
+
+  // Waits till the queued frame, if any, has been handled. In case drop is
+  // true and the frame is still waiting for its vblank slot, it is dropped
+  // instead. Returns true if the frame has been dropped.
+  bool Flush(bool drop);
+
+  void HandleRoutine() override;
+
+ private:
+  enum State {
+    kIdle = 0,            // No frame queued.
+    kQueued = 1,          // Frame queued, not handled yet.
+    kPreparing = 2,       // Waiting for rendering and previous flip.
+    kWaitingForSlot = 3,  // Waiting for the vblank slot, can be dropped.
+    kCommitting = 4       // Frame is being committed.
+  };
+
+  // Waits till it's time to commit the frame or it has been dropped.
+  void WaitForCommitSlot();
+
+  // Returns time in milliseconds till the queued frame should be committed.
+  int GetCommitTimeout() const;
+
+  SpinLock state_lock_;
+  DisplayQueue* queue_;
+  FDHandler slot_handler_;
+  // Signalled to stop waiting for the vblank slot.
+  HWCEvent slot_event_;
+  // Signalled once the queued frame has been handled.
+  HWCEvent done_event_;
+  uint32_t state_ = kIdle;
+  bool waiting_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_DISPLAYCOMMITTHREAD_H_
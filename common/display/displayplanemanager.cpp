@@ -24,6 +24,7 @@
 #include "hwctrace.h"
 #include "nativesurface.h"
 #include "overlaylayer.h"
+#include "planevalidationstrategy.h"
 
 #include "hwcutils.h"
 
@@ -34,11 +35,18 @@ DisplayPlaneManager::DisplayPlaneManager(DisplayPlaneHandler *plane_handler,
     : plane_handler_(plane_handler),
       resource_manager_(resource_manager),
       cursor_plane_(nullptr),
+      plane_broker_(plane_handler->GetPlaneBroker()),
+      plane_allocator_(&cost_model_),
+      pipe_(0),
       width_(0),
       height_(0),
       total_overlays_(0),
+      broker_generation_(0),
       display_transform_(kIdentity),
-      release_surfaces_(false) {
+      release_surfaces_(false),
+      video_scanout_(true) {
+  validation_strategy_.reset(
+      new BatchedPlaneValidationStrategy(plane_handler_, &validation_cache_));
 }
 
 DisplayPlaneManager::~DisplayPlaneManager() {
@@ -66,14 +74,115 @@ void DisplayPlaneManager::ResizeOverlays() {
       overlay_planes_.size(), total_overlays_, cursor_plane_ == NULL);
 }
 
-bool DisplayPlaneManager::Initialize(uint32_t width, uint32_t height) {
+bool DisplayPlaneManager::Initialize(uint32_t pipe, uint32_t width,
+                                     uint32_t height) {
+  pipe_ = pipe;
   width_ = width;
   height_ = height;
+  surface_pool_.SetDisplaySize(width, height);
   bool status = plane_handler_->PopulatePlanes(overlay_planes_);
   ResizeOverlays();
+  if (status && plane_broker_) {
+    RegisterSharedPlanes();
+    broker_generation_ = plane_broker_->GetGeneration(pipe_);
+    UpdateSharedPlanes();
+  }
+
+  validation_cache_.Reset();
   return status;
 }
 
+bool DisplayPlaneManager::SyncSharedPlanes(
+    const DisplayPlaneStateList &composition, bool disable_overlay) {
+  if (!plane_broker_)
+    return false;
+
+  uint32_t demand = 0;
+  if (!disable_overlay)
+    demand = GetSharedPlaneDemand(composition);
+
+  plane_broker_->BeginFrame(pipe_, demand);
+  uint32_t generation = plane_broker_->GetGeneration(pipe_);
+  if (generation == broker_generation_)
+    return false;
+
+  broker_generation_ = generation;
+  UpdateSharedPlanes();
+  return true;
+}
+
+uint32_t DisplayPlaneManager::GetSharedPlaneDemand(
+    const DisplayPlaneStateList &composition) const {
+  uint32_t planes = 0;
+  uint32_t blended = 0;
+  for (const DisplayPlaneState &plane : composition) {
+    if (cursor_plane_ && plane.GetDisplayPlane() == cursor_plane_)
+      continue;
+
+    planes++;
+    size_t layers = plane.GetSourceLayers().size();
+    if (plane.NeedsOffScreenComposition() && layers > 1)
+      blended += layers - 1;
+  }
+
+  if (planes == 0)
+    return 0;
+
+  // Layers only needed to be blended together if all planes were taken,
+  // otherwise they didn't fit on a plane anyway.
+  uint32_t demand = planes - 1;
+  if (planes >= total_overlays_)
+    demand += blended;
+
+  return demand;
+}
+
+void DisplayPlaneManager::RegisterSharedPlanes() {
+  for (uint32_t i = 0; i < total_overlays_; i++) {
+    plane_broker_->AddPlane(pipe_, overlay_planes_.at(i)->id(), i == 0);
+  }
+}
+
+void DisplayPlaneManager::UpdateSharedPlanes() {
+  std::vector<std::unique_ptr<DisplayPlane>> planes;
+  planes.swap(overlay_planes_);
+  std::unique_ptr<DisplayPlane> cursor_plane;
+  if (cursor_plane_) {
+    cursor_plane.reset(planes.back().release());
+    planes.pop_back();
+  }
+
+  for (std::unique_ptr<DisplayPlane> &plane : lent_planes_) {
+    planes.emplace_back(plane.release());
+  }
+
+  lent_planes_.clear();
+  std::sort(
+      planes.begin(), planes.end(),
+      [](const std::unique_ptr<DisplayPlane> &l,
+         const std::unique_ptr<DisplayPlane> &r) { return l->id() < r->id(); });
+
+  size_t size = planes.size();
+  for (size_t i = 0; i < size; i++) {
+    std::unique_ptr<DisplayPlane> &plane = planes.at(i);
+    if (i == 0 || plane_broker_->IsOwner(pipe_, plane->id())) {
+      overlay_planes_.emplace_back(plane.release());
+    } else {
+      IPLANERESERVEDTRACE("Plane[%d] is used by another display.",
+                          plane->id());
+      // Makes sure the next commit disables it.
+      plane->SetInUse(false);
+      lent_planes_.emplace_back(plane.release());
+    }
+  }
+
+  if (cursor_plane)
+    overlay_planes_.emplace_back(cursor_plane.release());
+
+  ResizeOverlays();
+  validation_cache_.Reset();
+}
+
 void DisplayPlaneManager::ResetPlanes(drmModeAtomicReqPtr pset) {
   for (auto j = overlay_planes_.begin(); j < overlay_planes_.end(); j++) {
     if (!j->get()->InUse()) {
@@ -124,6 +233,9 @@ bool DisplayPlaneManager::ValidateLayers(
     overlay_begin = overlay_planes_.begin() + composition.size();
   }
 
+  // Planes reused from the previous frame have already been validated.
+  size_t validated_planes = composition.size();
+
   // Let's mark all planes as free to be used.
   for (auto j = overlay_begin; j < overlay_planes_.end(); ++j) {
     j->get()->SetInUse(false);
@@ -134,13 +246,11 @@ bool DisplayPlaneManager::ValidateLayers(
     avail_planes--;
   // If video layers is more than available planes
   // We are going to force all the layers bo be composited by VA path
-  // cursor layer should not be handle by VPP
-  if ((video_layers >= avail_planes ||
-       (middle_video && video_layers > avail_planes - 2)) &&
-      video_layers > 0) {
-    ForceVppForAllLayers(composition, layers, add_index, mark_later, false);
-    return true;
-  }
+  // cursor layer should not be handle by VPP, unless the planner below
+  // finds a way to keep UI layers and streams apart.
+  bool force_vpp = (video_layers >= avail_planes ||
+                    (middle_video && video_layers > avail_planes - 2)) &&
+                   video_layers > 0;
 
   std::vector<OverlayLayer *> cursor_layers;
   auto layer_begin = layers.begin();
@@ -159,14 +269,34 @@ bool DisplayPlaneManager::ValidateLayers(
       overlay_end = overlay_planes_.end() - 1;
     }
 
+    size_t begin = layer_begin - layers.begin();
+    size_t first_plane = overlay_begin - overlay_planes_.begin();
+    size_t num_planes = overlay_end - overlay_begin;
+    if (video_layers > 0)
+      PlanVideoLayers(layers, begin, first_plane, num_planes);
+
+    // Decide up front which layers share a plane, instead of piling
+    // layers onto the last plane once we run out of them.
+    bool has_plan = PlanLayerGroups(layers, begin, first_plane, num_planes);
+    if (force_vpp && !has_plan) {
+      ForceVppForAllLayers(composition, layers, add_index, mark_later, false);
+      return true;
+    }
+
     // Handle layers for overlays.
     auto j = overlay_begin;
 
     while (j <= overlay_end) {
-      if (previous_layer && !composition.empty()) {
+      // Scaling checks test commit all planes, which only tells something
+      // about the plane checked in case the others have been validated.
+      // With deferred validation they are done by
+      // ResolveDeferredValidation.
+      if (previous_layer && !composition.empty() &&
+          !validation_strategy_->DefersValidation()) {
         DisplayPlaneState &last_plane = composition.back();
         if (last_plane.NeedsOffScreenComposition()) {
           ValidateForDisplayScaling(composition.back(), composition);
+          ValidateForDownScaling(composition.back(), composition);
         }
       }
 
@@ -178,6 +308,8 @@ bool DisplayPlaneManager::ValidateLayers(
       // Handle remaining overlay planes.
       for (auto i = layer_begin; i != layer_end; ++i) {
         OverlayLayer *layer = &(*(i));
+        size_t group_size =
+            has_plan ? layer_group_sizes_.at(i - layers.begin()) : 1;
         ++layer_begin;
         DisplayPlane *plane = NULL;
         bool plane_index_moved = false;
@@ -209,7 +341,7 @@ bool DisplayPlaneManager::ValidateLayers(
 
         // No planes, need to Squash non video planes
         // No need to do squash, if only 1 overlay is available.
-        if (j == overlay_end && total_overlays_ > 1) {
+        if (!has_plan && j == overlay_end && total_overlays_ > 1) {
           bool needsquash =
               composition.back().IsVideoPlane() && (layer_begin != layer_end);
           if (!needsquash) {
@@ -233,7 +365,33 @@ bool DisplayPlaneManager::ValidateLayers(
           }
         }
 
-        if (j < overlay_end || plane_index_moved) {
+        // Blending a small layer into the offscreen surface of the plane
+        // below can be cheaper than giving it a plane of its own.
+        bool merge_with_last = false;
+        if (has_plan) {
+          merge_with_last = plane_index_moved && group_size == 0;
+          if (merge_with_last)
+            j--;
+        } else if (plane_index_moved && !prefer_seperate_plane &&
+                   composition.size() > validated_planes) {
+          const DisplayPlaneState &last_plane = composition.back();
+          merge_with_last =
+              last_plane.NeedsOffScreenComposition() &&
+              !ForceSeparatePlane(last_plane, layer) &&
+              cost_model_.PreferGpuComposition(last_plane.GetDisplayFrame(),
+                                               *layer);
+          if (merge_with_last) {
+            ISURFACETRACE(
+                "Layer[%d] blended into plane[%d], gpu cost: %llu scanout "
+                "cost: %llu \n",
+                layer->GetZorder(), last_plane.GetDisplayPlane()->id(),
+                (unsigned long long)cost_model_.GetGpuCompositionCost(*layer),
+                (unsigned long long)cost_model_.GetScanoutCost(*layer));
+            j--;
+          }
+        }
+
+        if (!merge_with_last && (j < overlay_end || plane_index_moved)) {
           // Separate plane added
           composition.emplace_back(plane, layer, this);
           DisplayPlaneState &last_plane = composition.back();
@@ -245,9 +403,10 @@ bool DisplayPlaneManager::ValidateLayers(
 
           // If we are able to composite buffer with the given plane, lets use
           // it.
-          bool fall_back = false;
-          if (plane)
-            fall_back = FallbacktoGPU(plane, layer, composition);
+          // Planes which get more layers are composed by the GPU anyway.
+          bool fall_back = group_size > 1;
+          if (plane && !fall_back)
+            fall_back = !ValidateScanout(plane, layer, composition);
           test_commit_done = true;
           if (fall_back) {
             ISURFACETRACE(
@@ -256,6 +415,9 @@ bool DisplayPlaneManager::ValidateLayers(
                 last_plane.GetDisplayPlane()->id(), layer->GetZorder(),
                 layer->IsVideoLayer(), layer->IsSolidColor(),
                 layer->GetAlpha());
+            // Don't keep what the previous frame found out about the
+            // layer, it's blended by the GPU now.
+            layer->SupportedDisplayComposition(OverlayLayer::kGpu);
             last_plane.ForceGPURendering();
           }
         } else {
@@ -265,10 +427,11 @@ bool DisplayPlaneManager::ValidateLayers(
               "Added Layer into last plane(InUse): %d %d "
               "validate_final_layers: %d  \n",
               layer->GetZorder(), composition.size(), validate_final_layers);
+          layer->SupportedDisplayComposition(OverlayLayer::kGpu);
           last_plane.AddLayer(layer);
         }
 
-        if (j == overlay_end) {
+        if (!has_plan && j == overlay_end) {
           bool needsquash =
               composition.back().IsVideoPlane() && (layer_begin != layer_end);
           if (needsquash) {
@@ -281,6 +444,26 @@ bool DisplayPlaneManager::ValidateLayers(
       }
     }
 
+    // Check planes whose validation has been deferred by the validation
+    // strategy, before adding the cursor plane on top. In case that can't
+    // be fixed plane by plane, compose all layers on a single plane.
+    if (!ResolveDeferredValidation(composition, layers, validated_planes)) {
+      if (!video_layers) {
+        ForceGpuForAllLayers(composition, layers, mark_later, false);
+      } else {
+        for (DisplayPlaneState &plane : composition)
+          MarkSurfacesForRecycling(&plane, mark_later, false);
+
+        DisplayPlaneStateList().swap(composition);
+        for (auto &plane : overlay_planes_)
+          plane->SetInUse(false);
+
+        ForceVppForAllLayers(composition, layers, 0, mark_later, false);
+      }
+
+      return true;
+    }
+
     if ((cursor_layers.size() > 0) && cursor_plane_) {
       if (cursor_layers.size() > 1) {
         ETRACE("More than 1 cursor layers found, we don't support it");
@@ -300,6 +483,134 @@ bool DisplayPlaneManager::ValidateLayers(
   return true;
 }
 
+bool DisplayPlaneManager::PlanLayerGroups(std::vector<OverlayLayer> &layers,
+                                          size_t begin, size_t first_plane,
+                                          size_t num_planes) {
+  allocator_layers_.clear();
+  allocator_indices_.clear();
+  for (size_t i = begin; i < layers.size(); i++) {
+    OverlayLayer &layer = layers.at(i);
+    // Cursor layers are handled separately.
+    if (layer.IsCursorLayer() && cursor_plane_)
+      continue;
+
+    PlaneAllocator::LayerInfo info;
+    info.display_frame_ = layer.GetDisplayFrame();
+    info.scanout_cost_ = cost_model_.GetScanoutCost(layer);
+    info.gpu_cost_ = cost_model_.GetGpuCompositionCost(layer);
+    info.update_count_ = layer.GetUpdateCount();
+    // Streams picked by PlanVideoLayers get a plane of their own.
+    info.separate_ = layer.IsProtected() || layer.IsVideoScanout();
+    info.video_ = layer.IsVideoLayer();
+    for (size_t plane = 0; plane < num_planes && plane < 64; plane++) {
+      if (CanScanoutLayer(overlay_planes_.at(first_plane + plane).get(),
+                          &layer)) {
+        info.plane_mask_ |= 1ULL << plane;
+      }
+    }
+
+    allocator_layers_.emplace_back(info);
+    allocator_indices_.emplace_back(i);
+  }
+
+  if (!plane_allocator_.Allocate(allocator_layers_, num_planes,
+                                 group_sizes_)) {
+    IPLANERESERVEDTRACE("No plane allocation found for %zu layers.",
+                        allocator_layers_.size());
+    return false;
+  }
+
+  layer_group_sizes_.assign(layers.size(), 0);
+  size_t index = 0;
+  for (size_t group_size : group_sizes_) {
+    layer_group_sizes_.at(allocator_indices_.at(index)) = group_size;
+    index += group_size;
+  }
+
+  return true;
+}
+
+void DisplayPlaneManager::PlanVideoLayers(std::vector<OverlayLayer> &layers,
+                                          size_t begin, size_t first_plane,
+                                          size_t num_planes) {
+  video_candidates_.clear();
+  size_t size = layers.size();
+  for (size_t i = begin; i < size; i++) {
+    OverlayLayer &layer = layers.at(i);
+    layer.SetVideoScanout(false);
+    // Protected content is always handled by the media pipeline.
+    if (!video_scanout_ || !layer.IsVideoLayer() || layer.IsProtected())
+      continue;
+
+    // Check if any of the planes supports the stream, i.e. NV12.
+    layer.SetVideoScanout(true);
+    bool supported = false;
+    for (size_t plane = 0; plane < num_planes; plane++) {
+      if (CanScanoutLayer(overlay_planes_.at(first_plane + plane).get(),
+                          &layer)) {
+        supported = true;
+        break;
+      }
+    }
+
+    layer.SetVideoScanout(false);
+    if (!supported) {
+      IVIDEOPLANETRACE("Video layer[%d] can't be scanned out directly.",
+                       layer.GetZorder());
+      continue;
+    }
+
+    const HwcRect<float> &crop = layer.GetSourceCrop();
+    uint64_t area = static_cast<uint64_t>(crop.right - crop.left) *
+                    static_cast<uint64_t>(crop.bottom - crop.top);
+    uint64_t score = area * std::max(layer.GetUpdateCount(), 1u);
+    video_candidates_.emplace_back(score, i);
+  }
+
+  std::sort(video_candidates_.begin(), video_candidates_.end(),
+            [](const std::pair<uint64_t, size_t> &lhs,
+               const std::pair<uint64_t, size_t> &rhs) {
+              return lhs.first > rhs.first;
+            });
+
+  for (const auto &candidate : video_candidates_) {
+    OverlayLayer &layer = layers.at(candidate.second);
+    layer.SetVideoScanout(true);
+    if (GetVideoPlanesNeeded(layers, begin) > num_planes) {
+      layer.SetVideoScanout(false);
+      IVIDEOPLANETRACE(
+          "Video layer[%d] score: %llu blended by the media pipeline, out of "
+          "planes.",
+          layer.GetZorder(), (unsigned long long)candidate.first);
+      continue;
+    }
+
+    IVIDEOPLANETRACE("Video layer[%d] score: %llu gets a plane of its own.",
+                     layer.GetZorder(), (unsigned long long)candidate.first);
+  }
+}
+
+size_t DisplayPlaneManager::GetVideoPlanesNeeded(
+    const std::vector<OverlayLayer> &layers, size_t begin) const {
+  size_t planes = 0;
+  const OverlayLayer *previous = NULL;
+  size_t size = layers.size();
+  for (size_t i = begin; i < size; i++) {
+    const OverlayLayer &layer = layers.at(i);
+    if (layer.IsCursorLayer() && cursor_plane_)
+      continue;
+
+    if (!previous || layer.IsVideoScanout() || previous->IsVideoScanout() ||
+        layer.IsProtected() || previous->IsProtected() ||
+        layer.IsVideoLayer() != previous->IsVideoLayer())
+      planes++;
+
+    previous = &layer;
+  }
+
+  return planes;
+}
+
 DisplayPlaneState *DisplayPlaneManager::GetLastUsedOverlay(
     DisplayPlaneStateList &composition) {
   CTRACE();
@@ -350,16 +661,19 @@ void DisplayPlaneManager::ValidateForDisplayTransform(
 
 void DisplayPlaneManager::ValidateForDownScaling(
     DisplayPlaneState &last_plane, const DisplayPlaneStateList &composition) {
-#ifdef ENABLE_DOWNSCALING
   uint32_t original_downscaling_factor = last_plane.GetDownScalingFactor();
   if (last_plane.RevalidationType() &
       DisplayPlaneState::ReValidationType::kDownScaling) {
-    last_plane.SetDisplayDownScalingFactor(1, false);
-    if (!last_plane.IsUsingPlaneScalar() && last_plane.CanUseGPUDownScaling()) {
-      last_plane.SetDisplayDownScalingFactor(4, false);
-      if (!plane_handler_->TestCommit(composition)) {
-        last_plane.SetDisplayDownScalingFactor(1, false);
-      }
+    uint32_t factor = 1;
+    if (!last_plane.IsUsingPlaneScalar() && last_plane.CanUseGPUDownScaling())
+      factor = last_plane.GetMaxDownScalingFactor();
+
+    // Scalers are limited in HW, try lower scaling ratios in case the
+    // plane can't upscale the composition as much as layers would allow.
+    last_plane.SetDisplayDownScalingFactor(factor, false);
+    while (factor > 1 && !TestCommit(composition)) {
+      factor /= 2;
+      last_plane.SetDisplayDownScalingFactor(factor, false);
     }
 
     uint32_t validation_done =
@@ -370,10 +684,6 @@ void DisplayPlaneManager::ValidateForDownScaling(
   if (original_downscaling_factor != last_plane.GetDownScalingFactor()) {
     last_plane.RefreshSurfaces(NativeSurface::kFullClear, true);
   }
-#else
-  HWC_UNUSED(composition);
-  HWC_UNUSED(last_plane);
-#endif
 }
 
 void DisplayPlaneManager::ValidateForDisplayScaling(
@@ -425,6 +735,29 @@ void DisplayPlaneManager::ValidateForDisplayScaling(
 
 void DisplayPlaneManager::ReleaseUnreservedPlanes(
     std::vector<uint32_t> &reserved_planes) {
+  // Reserved planes are indexed on all planes of the display, including
+  // the ones lent to other displays.
+  if (!lent_planes_.empty()) {
+    std::unique_ptr<DisplayPlane> cursor_plane;
+    if (cursor_plane_) {
+      cursor_plane.reset(overlay_planes_.back().release());
+      overlay_planes_.pop_back();
+    }
+
+    for (std::unique_ptr<DisplayPlane> &plane : lent_planes_) {
+      overlay_planes_.emplace_back(plane.release());
+    }
+
+    lent_planes_.clear();
+    std::sort(overlay_planes_.begin(), overlay_planes_.end(),
+              [](const std::unique_ptr<DisplayPlane> &l,
+                 const std::unique_ptr<DisplayPlane> &r) {
+                return l->id() < r->id();
+              });
+    if (cursor_plane)
+      overlay_planes_.emplace_back(cursor_plane.release());
+  }
+
   uint32_t plane_index = 0;
   for (std::vector<std::unique_ptr<DisplayPlane>>::iterator iter =
            overlay_planes_.begin();
@@ -435,16 +768,23 @@ void DisplayPlaneManager::ReleaseUnreservedPlanes(
       iter++;
     } else {
       IPLANERESERVEDTRACE("Erasing Plane[%d]", plane_index);
+      if (plane_broker_)
+        plane_broker_->RemovePlane(pipe_, iter->get()->id());
       iter = overlay_planes_.erase(iter);
     }
     plane_index++;
   }
   ResizeOverlays();
+  if (plane_broker_)
+    UpdateSharedPlanes();
+
+  validation_cache_.Reset();
 }
 
 void DisplayPlaneManager::ReleaseAllOffScreenTargets() {
   CTRACE();
-  std::vector<std::unique_ptr<NativeSurface>>().swap(surfaces_);
+  composition_cache_.Clear();
+  surface_pool_.Clear();
 }
 
 void DisplayPlaneManager::ReleaseFreeOffScreenTargets(bool forced) {
@@ -453,25 +793,61 @@ void DisplayPlaneManager::ReleaseFreeOffScreenTargets(bool forced) {
 #ifdef SURFACE_RECYCLE_TRACING
   ISURFACERECYCLETRACE(
       "invoking ReleaseFreeOffScreenTargets --forced:%d, "
-      "--release_surfaces_:%d, surfaces_.size() = %d",
-      forced, release_surfaces_, surfaces_.size());
+      "--release_surfaces_:%d, surfaces: %zu",
+      forced, release_surfaces_, surface_pool_.GetSurfaceCount());
 #endif
-  std::vector<std::unique_ptr<NativeSurface>> surfaces;
-  for (auto &fb : surfaces_) {
-    if (fb->IsOnScreen()) {
-      surfaces.emplace_back(fb.release());
-    }
-  }
-
-  surfaces.swap(surfaces_);
+  surface_pool_.ReleaseFreeSurfaces(forced);
 #ifdef SURFACE_RECYCLE_TRACING
-  ISURFACERECYCLETRACE(
-      "After ReleaseFreeOffScreenTargets surfaces_.size() = %d",
-      surfaces_.size());
+  ISURFACERECYCLETRACE("After ReleaseFreeOffScreenTargets surfaces: %zu",
+                       surface_pool_.GetSurfaceCount());
 #endif
   release_surfaces_ = false;
 }
 
+void DisplayPlaneManager::SetOffScreenSurfaceBudget(uint64_t budget) {
+  surface_pool_.SetBudget(budget);
+  release_surfaces_ = true;
+}
+
+void DisplayPlaneManager::ResizeOffScreenTargets(
+    DisplayPlaneStateList &composition,
+    std::vector<NativeSurface *> &mark_later) {
+  for (DisplayPlaneState &plane : composition) {
+    if (!plane.NeedsOffScreenComposition() || plane.IsVideoPlane() ||
+        plane.GetSurfaces().empty())
+      continue;
+
+    if (plane.OffScreenTargetsFit() && !HasOversizedOffScreenTargets(plane))
+      continue;
+
+#ifdef SURFACE_RECYCLE_TRACING
+    ISURFACERECYCLETRACE("Surfaces of plane[%d] don't fit, replacing them.",
+                         plane.GetDisplayPlane()->id());
+#endif
+    MarkSurfacesForRecycling(&plane, mark_later, true);
+    EnsureOffScreenTarget(plane);
+  }
+}
+
+bool DisplayPlaneManager::HasOversizedOffScreenTargets(
+    const DisplayPlaneState &plane) const {
+  // Surfaces allocated before the plane got downscaled only need a
+  // fraction of their size.
+  if (plane.GetDownScalingFactor() <= 1 || display_transform_ != kIdentity)
+    return false;
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  plane.GetOffScreenTargetSize(&width, &height);
+  for (NativeSurface *surface : plane.GetSurfaces()) {
+    if (surface_pool_.IsOversized(surface->GetWidth(), surface->GetHeight(),
+                                  width, height))
+      return true;
+  }
+
+  return false;
+}
+
 void DisplayPlaneManager::SetDisplayTransform(uint32_t transform) {
   display_transform_ = transform;
 }
@@ -497,48 +873,46 @@ void DisplayPlaneManager::EnsureOffScreenTarget(DisplayPlaneState &plane,
       plane.GetDisplayPlane()->GetPreferredFormatModifier();
   if (plane.IsVideoPlane())
     preferred_modifier = 0;
-  size_t surface_index = 0;
-  for (auto &srf : surfaces_) {
-    if (srf->GetSurfaceAge() == -1) {
-      OverlayBuffer *layer_buffer = srf->GetLayer()->GetBuffer();
-      if (!layer_buffer) {
-#ifdef SURFACE_RECYCLE_TRACING
-        ISURFACERECYCLETRACE(
-            "Layer buffer is null, skip surface[%d] for plane[%d]/layer",
-            surface_index, plane.GetDisplayPlane()->id());
-#endif
-        surface_index++;
-        continue;
-      }
-      uint32_t surface_format = layer_buffer->GetFormat();
-      if ((preferred_format == surface_format) &&
-          (preferred_modifier == srf->GetModifier())) {
+
+  // Compositions are rendered at display coordinates, so surfaces only
+  // need to reach the bottom right corner of the plane. Video surfaces
+  // and surfaces rotated by the display are always full screen.
+  bool video_surface = video_separate && !force_normal_surface;
+  uint32_t width = width_;
+  uint32_t height = height_;
+  if (!plane.IsVideoPlane() && display_transform_ == kIdentity)
+    plane.GetOffScreenTargetSize(&width, &height);
+
+  surface = surface_pool_.GetFreeSurface(preferred_format, preferred_modifier,
+                                         video_surface, width, height);
 #ifdef SURFACE_RECYCLE_TRACING
-        ISURFACERECYCLETRACE("Reuse surface[%d] for the plane[%d].",
-                             surface_index, plane.GetDisplayPlane()->id());
+  if (surface)
+    ISURFACERECYCLETRACE("Reuse %dx%d surface for the plane[%d].",
+                         surface->GetWidth(), surface->GetHeight(),
+                         plane.GetDisplayPlane()->id());
 #endif
-        surface = srf.get();
-        break;
-      }
-    }
-    surface_index++;
-  }
 
   if (!surface) {
+    uint32_t alloc_width = width_;
+    uint32_t alloc_height = height_;
+    if (width != width_ || height != height_)
+      surface_pool_.GetAllocationSize(width, height, &alloc_width,
+                                      &alloc_height);
+
     NativeSurface *new_surface = NULL;
-    if (video_separate && !force_normal_surface) {
+    if (video_surface) {
 #ifdef SURFACE_RECYCLE_TRACING
       ISURFACERECYCLETRACE("CreateVideoSurface for plane[%d]",
                            plane.GetDisplayPlane()->id());
 #endif
-      new_surface = CreateVideoSurface(width_, height_);
+      new_surface = CreateVideoSurface(alloc_width, alloc_height);
       usage = hwcomposer::kLayerVideo;
     } else {
 #ifdef SURFACE_RECYCLE_TRACING
-      ISURFACERECYCLETRACE("Create3DSurface for plane[%d]",
-                           plane.GetDisplayPlane()->id());
+      ISURFACERECYCLETRACE("Create3DSurface %dx%d for plane[%d]", alloc_width,
+                           alloc_height, plane.GetDisplayPlane()->id());
 #endif
-      new_surface = Create3DSurface(width_, height_);
+      new_surface = Create3DSurface(alloc_width, alloc_height);
     }
 
     bool modifer_succeeded = false;
@@ -553,52 +927,126 @@ void DisplayPlaneManager::EnsureOffScreenTarget(DisplayPlaneState &plane,
       plane.GetDisplayPlane()->BlackListPreferredFormatModifier();
     }
 
-    surfaces_.emplace_back(std::move(new_surface));
-#ifdef SURFACE_RECYCLE_TRACING
-    ISURFACERECYCLETRACE("Add new surface into surfaces_[%d]",
-                         surfaces_.size());
-#endif
-    surface = surfaces_.back().get();
+    surface_pool_.AddSurface(new_surface, preferred_format, video_surface);
+    surface = new_surface;
   }
 
   surface->SetPlaneTarget(plane);
   plane.SetOffScreenTarget(surface);
 }
 
-bool DisplayPlaneManager::FallbacktoGPU(
-    DisplayPlane *target_plane, OverlayLayer *layer,
-    const DisplayPlaneStateList &composition) const {
+bool DisplayPlaneManager::CanScanoutLayer(DisplayPlane *target_plane,
+                                          OverlayLayer *layer) const {
   // SolidColor can't be scanout directly
 
   layer->SupportedDisplayComposition(OverlayLayer::kGpu);
   if (layer->IsSolidColor())
-    return true;
+    return false;
   // We need video process to apply effects
-  // Such as deinterlace, so always fallback to GPU
-  if (layer->IsVideoLayer())
-    return true;
+  // Such as deinterlace, so always fallback to GPU unless the stream has
+  // been picked to be scanned out directly, see PlanVideoLayers.
+  if (layer->IsVideoLayer() && !layer->IsVideoScanout())
+    return false;
 
   if (!target_plane->ValidateLayer(layer)) {
-    return true;
+    return false;
   }
 
   OverlayBuffer *layer_buffer = layer->GetBuffer();
   if (!layer_buffer)
-    return true;
+    return false;
 
   if (layer_buffer->GetFb() == 0) {
-    return true;
+    return false;
   }
 
-  // TODO(kalyank): Take relevant factors into consideration to determine if
-  // Plane Composition makes sense. i.e. layer size etc
-  if (!plane_handler_->TestCommit(composition)) {
+  return true;
+}
+
+bool DisplayPlaneManager::FallbacktoGPU(
+    DisplayPlane *target_plane, OverlayLayer *layer,
+    const DisplayPlaneStateList &composition) const {
+  if (!CanScanoutLayer(target_plane, layer))
+    return true;
+
+  // Whether plane composition makes sense for the layer has been decided
+  // by ValidateLayers using cost_model_, here we only check if it works.
+  if (!TestCommit(composition)) {
     return true;
   }
   layer->SupportedDisplayComposition(OverlayLayer::kAll);
   return false;
 }
 
+bool DisplayPlaneManager::ValidateScanout(
+    DisplayPlane *target_plane, OverlayLayer *layer,
+    const DisplayPlaneStateList &composition) {
+  if (!CanScanoutLayer(target_plane, layer))
+    return false;
+
+  if (!validation_strategy_->ValidatePlane(composition))
+    return false;
+
+  layer->SupportedDisplayComposition(OverlayLayer::kAll);
+  return true;
+}
+
+bool DisplayPlaneManager::ResolveDeferredValidation(
+    DisplayPlaneStateList &composition, std::vector<OverlayLayer> &layers,
+    size_t begin) {
+  int index = validation_strategy_->FindFailingPlane(composition, begin);
+  while (index >= 0) {
+    DisplayPlaneState &plane = composition.at(index);
+    // Only scanout planes can be fixed by composing them offscreen.
+    if (!plane.Scanout() || plane.IsCursorPlane()) {
+      ISURFACETRACE(
+          "Plane[%d] fails batched validation and can't fall back to GPU",
+          plane.GetDisplayPlane()->id());
+      return false;
+    }
+
+    const std::vector<size_t> &source_layers = plane.GetSourceLayers();
+    OverlayLayer *layer = &(layers.at(source_layers.at(0)));
+    ISURFACETRACE(
+        "Force GPU rander the plane[%d], for the layer[%d] after batched "
+        "validation",
+        plane.GetDisplayPlane()->id(), layer->GetZorder());
+    layer->SupportedDisplayComposition(OverlayLayer::kGpu);
+    plane.ForceGPURendering();
+    // Check the plane again, it may still fail as an offscreen plane.
+    index = validation_strategy_->FindFailingPlane(composition, index);
+  }
+
+  if (!validation_strategy_->DefersValidation())
+    return true;
+
+  // All planes pass now, check if offscreen planes can use scalers.
+  size_t size = composition.size();
+  for (size_t i = begin; i < size; i++) {
+    DisplayPlaneState &plane = composition.at(i);
+    if (plane.NeedsOffScreenComposition()) {
+      ValidateForDisplayScaling(plane, composition);
+      ValidateForDownScaling(plane, composition);
+    }
+  }
+
+  return true;
+}
+
+bool DisplayPlaneManager::TestCommit(
+    const DisplayPlaneStateList &composition) const {
+  return validation_strategy_->TestCommit(composition);
+}
+
+void DisplayPlaneManager::SetValidationStrategy(
+    std::unique_ptr<PlaneValidationStrategy> strategy) {
+  validation_strategy_ = std::move(strategy);
+}
+
+void DisplayPlaneManager::ResetValidationCache() {
+  validation_cache_.Reset();
+}
+
 bool DisplayPlaneManager::CheckPlaneFormat(uint32_t format) {
   return overlay_planes_.at(0)->IsSupportedFormat(format);
 }
@@ -701,6 +1149,77 @@ void DisplayPlaneManager::ReleasedSurfaces() {
   release_surfaces_ = true;
 }
 
+bool DisplayPlaneManager::CacheComposition(
+    const DisplayPlaneState &plane, const std::vector<OverlayLayer> &layers,
+    std::vector<NativeSurface *> &mark_later) {
+  size_t marked = mark_later.size();
+  bool cached = composition_cache_.Insert(plane, layers, mark_later);
+  if (mark_later.size() != marked)
+    release_surfaces_ = true;
+
+  return cached;
+}
+
+void DisplayPlaneManager::ReuseCachedCompositions(
+    DisplayPlaneStateList &composition, const std::vector<OverlayLayer> &layers,
+    std::vector<NativeSurface *> &mark_later) {
+  std::vector<NativeSurface *> cached_surfaces;
+  for (DisplayPlaneState &plane : composition) {
+    if (!plane.NeedsOffScreenComposition() || plane.IsVideoPlane())
+      continue;
+
+    // Only planes whose surfaces have all been allocated this frame are
+    // rendered from scratch.
+    const std::vector<NativeSurface *> &surfaces = plane.GetSurfaces();
+    if (surfaces.empty())
+      continue;
+
+    bool new_surfaces = true;
+    for (NativeSurface *surface : surfaces) {
+      if (surface->IsOnScreen()) {
+        new_surfaces = false;
+        break;
+      }
+    }
+
+    if (!new_surfaces ||
+        !composition_cache_.Lookup(plane, layers, cached_surfaces))
+      continue;
+
+    ISURFACETRACE("Reusing cached composition of %zu layers for plane[%d]\n",
+                  plane.GetSourceLayers().size(),
+                  plane.GetDisplayPlane()->id());
+    MarkSurfacesForRecycling(&plane, mark_later, true);
+    plane.ReuseOffScreenTargets(cached_surfaces);
+    cached_surfaces.clear();
+  }
+}
+
+void DisplayPlaneManager::InvalidateCachedCompositions(
+    const std::vector<OverlayLayer> &layers,
+    std::vector<NativeSurface *> &mark_later) {
+  size_t marked = mark_later.size();
+  composition_cache_.Invalidate(layers, mark_later);
+  if (mark_later.size() != marked)
+    release_surfaces_ = true;
+}
+
+void DisplayPlaneManager::ResetCompositionCache(
+    std::vector<NativeSurface *> &mark_later) {
+  size_t marked = mark_later.size();
+  composition_cache_.Reset(mark_later);
+  if (mark_later.size() != marked)
+    release_surfaces_ = true;
+}
+
+void DisplayPlaneManager::SetCompositionCacheBudget(
+    uint64_t budget, std::vector<NativeSurface *> &mark_later) {
+  size_t marked = mark_later.size();
+  composition_cache_.SetBudget(budget, mark_later);
+  if (mark_later.size() != marked)
+    release_surfaces_ = true;
+}
+
 void DisplayPlaneManager::MarkSurfacesForRecycling(
     DisplayPlaneState *plane, std::vector<NativeSurface *> &mark_later,
     bool recycle_resources, bool reset_plane_surfaces) {
@@ -747,6 +1266,37 @@ void DisplayPlaneManager::MarkSurfacesForRecycling(
   }
 }
 
+bool DisplayPlaneManager::ValidateDirtyPlanes(
+    DisplayPlaneStateList &composition, std::vector<OverlayLayer> &layers) {
+  bool dirty = false;
+  for (DisplayPlaneState &plane : composition) {
+    if (!plane.Scanout() || plane.IsCursorPlane())
+      continue;
+
+    OverlayLayer *layer = &(layers.at(plane.GetSourceLayers().at(0)));
+    if (!layer->NeedsRevalidation())
+      continue;
+
+    // Streams on planes scanned out have been picked by PlanVideoLayers.
+    layer->SetVideoScanout(layer->IsVideoLayer() && video_scanout_);
+    if (!layer->NeedsPlaneLocalRevalidation() ||
+        !CanScanoutLayer(plane.GetDisplayPlane(), layer)) {
+      return false;
+    }
+
+    IPLANECACHETRACE("Re-testing plane[%d] for layer[%d] dirty flags %x",
+                     plane.GetDisplayPlane()->id(), layer->GetZorder(),
+                     layer->GetDirtyFlags());
+    layer->SupportedDisplayComposition(OverlayLayer::kAll);
+    dirty = true;
+  }
+
+  if (!dirty)
+    return true;
+
+  return TestCommit(composition);
+}
+
 bool DisplayPlaneManager::ReValidatePlanes(
     DisplayPlaneStateList &composition, std::vector<OverlayLayer> &layers,
     std::vector<NativeSurface *> &mark_later, bool *request_full_validation,
@@ -768,7 +1318,7 @@ bool DisplayPlaneManager::ReValidatePlanes(
 
   if (re_validate_commit) {
     // If this combination fails just fall back to full validation.
-    if (!plane_handler_->TestCommit(composition)) {
+    if (!TestCommit(composition)) {
       ISURFACETRACE(
           "ReValidatePlanes Test commit failed. Forcing full validation. \n");
       *request_full_validation = true;
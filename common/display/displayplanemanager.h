@@ -22,8 +22,15 @@
 #include <tuple>
 #include <vector>
 
+#include "compositioncache.h"
 #include "displayplanehandler.h"
 #include "displayplanestate.h"
+#include "planeallocator.h"
+#include "planebroker.h"
+#include "planecostmodel.h"
+#include "planevalidationcache.h"
+#include "planevalidationstrategy.h"
+#include "surfacepool.h"
 
 namespace hwcomposer {
 
@@ -41,7 +48,14 @@ class DisplayPlaneManager {
 
   virtual ~DisplayPlaneManager();
 
-  bool Initialize(uint32_t width, uint32_t height);
+  bool Initialize(uint32_t pipe, uint32_t width, uint32_t height);
+
+  // Picks up planes handed to or taken from this display by the plane
+  // broker, see PlaneBroker. composition is the last composition shown,
+  // planes are only claimed in case it ran out of planes. Returns true in
+  // case planes changed and all layers need to be validated again.
+  bool SyncSharedPlanes(const DisplayPlaneStateList &composition,
+                        bool disable_overlay);
 
   bool ValidateLayers(std::vector<OverlayLayer> &layers, int add_index,
                       bool disable_overlay, DisplayPlaneStateList &composition,
@@ -57,6 +71,43 @@ class DisplayPlaneManager {
   // ReleaseFreeOffScreenTargets is called.
   void ReleasedSurfaces();
 
+  // Keeps surfaces of plane, which is being retired, in the composition
+  // cache. layers are the layers plane has last been shown with. Returns
+  // false in case plane can't be cached, its surfaces need to be
+  // recycled in that case. Surfaces evicted from the cache are added to
+  // mark_later.
+  bool CacheComposition(const DisplayPlaneState &plane,
+                        const std::vector<OverlayLayer> &layers,
+                        std::vector<NativeSurface *> &mark_later);
+
+  // Lets planes of composition which would be rendered from scratch take
+  // over surfaces already holding their composition, see
+  // CompositionCache. Surfaces allocated for them are recycled.
+  void ReuseCachedCompositions(DisplayPlaneStateList &composition,
+                               const std::vector<OverlayLayer> &layers,
+                               std::vector<NativeSurface *> &mark_later);
+
+  // Drops cached compositions showing buffers whose content has changed
+  // with this frame.
+  void InvalidateCachedCompositions(const std::vector<OverlayLayer> &layers,
+                                    std::vector<NativeSurface *> &mark_later);
+
+  // Drops all cached compositions.
+  void ResetCompositionCache(std::vector<NativeSurface *> &mark_later);
+
+  // Sets memory, in bytes, surfaces kept by the composition cache may
+  // use. 0 disables the cache.
+  void SetCompositionCacheBudget(uint64_t budget,
+                                 std::vector<NativeSurface *> &mark_later);
+
+  uint32_t GetCompositionCacheHits() const {
+    return composition_cache_.GetHits();
+  }
+
+  uint32_t GetCompositionCacheMisses() const {
+    return composition_cache_.GetMisses();
+  }
+
   // This can be used to quickly check if the new DisplayPlaneStateList
   // can be succefully commited before doing a full re-validation.
   bool ReValidatePlanes(DisplayPlaneStateList &list,
@@ -66,14 +117,40 @@ class DisplayPlaneManager {
                         bool needs_revalidation_checks,
                         bool re_validate_commit);
 
+  // Re-tests planes of composition scanning out layers which need to be
+  // re-validated but only have changes local to their plane, see
+  // OverlayLayer::NeedsPlaneLocalRevalidation. Returns false in case a
+  // plane can't show its layer anymore and layers need to be assigned
+  // to planes again.
+  bool ValidateDirtyPlanes(DisplayPlaneStateList &composition,
+                           std::vector<OverlayLayer> &layers);
+
   bool CheckPlaneFormat(uint32_t format);
 
   void ReleaseFreeOffScreenTargets(bool forced = false);
 
   void ReleaseAllOffScreenTargets();
 
+  // Sets memory, in bytes, offscreen surfaces of this display may use
+  // before surfaces which aren't on screen anymore are released, see
+  // SurfacePool.
+  void SetOffScreenSurfaceBudget(uint64_t budget);
+
+  // Offscreen targets are sized to the display frame of their plane.
+  // Replaces surfaces of planes in composition which have grown beyond
+  // them. Surfaces still on screen are added to mark_later.
+  void ResizeOffScreenTargets(DisplayPlaneStateList &composition,
+                              std::vector<NativeSurface *> &mark_later);
+
+  // Video layers may only be scanned out directly while no media
+  // effects have been requested, as these are applied by the media
+  // pipeline.
+  void EnableVideoScanout(bool enable) {
+    video_scanout_ = enable;
+  }
+
   bool HasSurfaces() const {
-    return !surfaces_.empty();
+    return !surface_pool_.IsEmpty();
   }
 
   uint32_t GetHeight() const {
@@ -128,11 +205,70 @@ class DisplayPlaneManager {
   void EnsureOffScreenTarget(DisplayPlaneState &plane,
                              bool force_normal_surface = false);
 
+  // Replaces the strategy used by ValidateLayers to decide when layer to
+  // plane mapping is test committed. BatchedPlaneValidationStrategy is
+  // used by default.
+  void SetValidationStrategy(std::unique_ptr<PlaneValidationStrategy> strategy);
+
+  // Drops all cached test commit results. Should be called in case
+  // a commit fails, as cached results cannot be trusted anymore.
+  void ResetValidationCache();
+
+  uint32_t GetValidationCacheHits() const {
+    return validation_cache_.GetHits();
+  }
+
+  uint32_t GetValidationCacheMisses() const {
+    return validation_cache_.GetMisses();
+  }
+
  private:
   DisplayPlaneState *GetLastUsedOverlay(DisplayPlaneStateList &composition);
+
+  // Plans which of the layers from begin on share a plane, using up to
+  // num_planes planes from first_plane on, see PlaneAllocator. On success
+  // layer_group_sizes_ holds for every layer starting a plane the number
+  // of layers on it and 0 for layers added to the plane below.
+  bool PlanLayerGroups(std::vector<OverlayLayer> &layers, size_t begin,
+                       size_t first_plane, size_t num_planes);
+
+  // Picks the video layers from begin on which are scanned out on a
+  // plane of their own, highest resolution and most frequently updated
+  // streams first, as long as the remaining layers still fit in
+  // num_planes planes. Other streams are blended together by the media
+  // pipeline, UI layers are kept apart from them.
+  void PlanVideoLayers(std::vector<OverlayLayer> &layers, size_t begin,
+                       size_t first_plane, size_t num_planes);
+
+  // Returns the number of planes needed for the layers from begin on,
+  // with video layers only sharing planes with other video layers.
+  size_t GetVideoPlanesNeeded(const std::vector<OverlayLayer> &layers,
+                              size_t begin) const;
   bool FallbacktoGPU(DisplayPlane *target_plane, OverlayLayer *layer,
                      const DisplayPlaneStateList &composition) const;
 
+  // Returns false if layer can't be scanned out by target_plane
+  // irrespective of the other planes in use.
+  bool CanScanoutLayer(DisplayPlane *target_plane, OverlayLayer *layer) const;
+
+  // Returns true if layer can be scanned out by target_plane as far as
+  // the validation strategy can tell at this point.
+  bool ValidateScanout(DisplayPlane *target_plane, OverlayLayer *layer,
+                       const DisplayPlaneStateList &composition);
+
+  // Moves planes which fail the deferred validation to GPU composition
+  // and runs the scaling checks of offscreen planes, once all other
+  // planes are known to work. Planes before begin are known to work.
+  // Returns false in case a failing plane can't be moved to GPU
+  // composition, i.e. composition needs to be planned again.
+  bool ResolveDeferredValidation(DisplayPlaneStateList &composition,
+                                 std::vector<OverlayLayer> &layers,
+                                 size_t begin);
+
+  // Test commits composition, using a previously cached result for
+  // the same layer to plane mapping if available.
+  bool TestCommit(const DisplayPlaneStateList &composition) const;
+
   void ValidateForDisplayScaling(DisplayPlaneState &last_plane,
                                  const DisplayPlaneStateList &composition);
 
@@ -156,19 +292,53 @@ class DisplayPlaneManager {
 
   bool CheckForDownScaling(DisplayPlaneStateList &composition);
 
+  // Returns true in case plane has been downscaled and its surfaces are
+  // much larger than needed.
+  bool HasOversizedOffScreenTargets(const DisplayPlaneState &plane) const;
+
   void ResizeOverlays();
 
+  // Registers planes with plane_broker_, the primary plane is pinned to
+  // this display.
+  void RegisterSharedPlanes();
+
+  // Moves planes this display doesn't own anymore to lent_planes_ and
+  // takes back the ones it got.
+  void UpdateSharedPlanes();
+
+  // Returns the number of planes, besides the primary one, composition
+  // uses plus the number of layers it had to blend for lack of planes.
+  uint32_t GetSharedPlaneDemand(const DisplayPlaneStateList &composition) const;
+
   DisplayPlaneHandler *plane_handler_;
   ResourceManager *resource_manager_;
   DisplayPlane *cursor_plane_;
-  std::vector<std::unique_ptr<NativeSurface>> surfaces_;
+  SurfacePool surface_pool_;
   std::vector<std::unique_ptr<DisplayPlane>> overlay_planes_;
-
+  // Planes currently used by other displays.
+  std::vector<std::unique_ptr<DisplayPlane>> lent_planes_;
+  PlaneBroker *plane_broker_;
+  PlaneValidationCache validation_cache_;
+  CompositionCache composition_cache_;
+  std::unique_ptr<PlaneValidationStrategy> validation_strategy_;
+  PlaneCostModel cost_model_;
+  PlaneAllocator plane_allocator_;
+  // Storage used by PlanLayerGroups, kept around to avoid allocations.
+  std::vector<PlaneAllocator::LayerInfo> allocator_layers_;
+  std::vector<size_t> allocator_indices_;
+  std::vector<size_t> group_sizes_;
+  std::vector<size_t> layer_group_sizes_;
+  // Storage used by PlanVideoLayers, score and index of video layers.
+  std::vector<std::pair<uint64_t, size_t>> video_candidates_;
+
+  uint32_t pipe_;
   uint32_t width_;
   uint32_t height_;
   uint32_t total_overlays_;
+  uint32_t broker_generation_;
   uint32_t display_transform_;
   bool release_surfaces_;
+  bool video_scanout_;
 };
 
 }  // namespace hwcomposer
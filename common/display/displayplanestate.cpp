@@ -21,6 +21,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 namespace hwcomposer {
 
 DisplayPlaneState::DisplayPlanePrivateState::~DisplayPlanePrivateState() {
@@ -45,6 +47,7 @@ DisplayPlaneState::DisplayPlaneState(DisplayPlane *plane, OverlayLayer *layer,
   private_data_->display_frame_ = layer->GetDisplayFrame();
   private_data_->rect_updated_ = true;
   private_data_->source_crop_ = layer->GetSourceCrop();
+  private_data_->max_down_scaling_factor_ = layer->GetMaxDownScalingFactor();
   if (layer->IsCursorLayer()) {
     private_data_->type_ = DisplayPlanePrivateState::PlaneType::kCursor;
     private_data_->has_cursor_layer_ = true;
@@ -68,7 +71,8 @@ DisplayPlaneState::DisplayPlaneState(DisplayPlane *plane, OverlayLayer *layer,
 
   if (layer->IsVideoLayer()) {
     SetVideoPlane(true);
-    ForceGPURendering(force_normal_surface);
+    if (!layer->IsVideoScanout())
+      ForceGPURendering(force_normal_surface);
   }
 
   recycled_surface_ = false;
@@ -145,6 +149,12 @@ void DisplayPlaneState::AddLayer(const OverlayLayer *layer,
   if (!private_data_->has_cursor_layer_)
     private_data_->has_cursor_layer_ = layer->IsCursorLayer();
 
+  if (layer->GetMaxDownScalingFactor() <
+      private_data_->max_down_scaling_factor_) {
+    private_data_->max_down_scaling_factor_ = layer->GetMaxDownScalingFactor();
+    private_data_->rect_updated_ = true;
+  }
+
   // TODO: Add checks for Video type once our
   // Media backend can support compositing more
   // than one layer together.
@@ -175,6 +185,7 @@ void DisplayPlaneState::ResetLayers(const std::vector<OverlayLayer> &layers,
   HwcRect<int> target_display_frame;
   HwcRect<float> target_source_crop;
   bool has_video = false;
+  uint32_t max_down_scaling_factor = 4;
   size_t size = layers.size();
 
   for (const size_t &index : current_layers) {
@@ -192,6 +203,8 @@ void DisplayPlaneState::ResetLayers(const std::vector<OverlayLayer> &layers,
       has_video = layer.IsVideoLayer();
     }
 
+    max_down_scaling_factor =
+        std::min(max_down_scaling_factor, layer.GetMaxDownScalingFactor());
     const HwcRect<int> &df = layer.GetDisplayFrame();
     const HwcRect<float> &source_crop = layer.GetSourceCrop();
     CalculateRect(df, target_display_frame);
@@ -227,6 +240,11 @@ void DisplayPlaneState::ResetLayers(const std::vector<OverlayLayer> &layers,
     }
   }
 
+  if (private_data_->max_down_scaling_factor_ != max_down_scaling_factor) {
+    private_data_->max_down_scaling_factor_ = max_down_scaling_factor;
+    private_data_->rect_updated_ = true;
+  }
+
   if (!private_data_->rect_updated_)
     private_data_->rect_updated_ = rect_updated;
 
@@ -362,6 +380,20 @@ void DisplayPlaneState::SetOffScreenTarget(NativeSurface *target) {
   needs_surface_allocation_ = false;
 }
 
+void DisplayPlaneState::ReuseOffScreenTargets(
+    const std::vector<NativeSurface *> &surfaces) {
+  private_data_->surfaces_ = surfaces;
+  private_data_->layer_ = surfaces.front()->GetLayer();
+  private_data_->refresh_surface_ = false;
+#ifdef SURFACE_RECYCLE_TRACING
+  ISURFACERECYCLETRACE("Reuse %zu cached surfaces for plane[%d].",
+                       surfaces.size(), GetDisplayPlane()->id());
+#endif
+  recycled_surface_ = true;
+  surface_swapped_ = true;
+  needs_surface_allocation_ = surfaces.size() < 3;
+}
+
 NativeSurface *DisplayPlaneState::GetOffScreenTarget() const {
   if (private_data_->surfaces_.size() == 0) {
     return NULL;
@@ -373,6 +405,36 @@ NativeSurface *DisplayPlaneState::GetOffScreenTarget() const {
   return private_data_->surfaces_.at(0);
 }
 
+void DisplayPlaneState::GetOffScreenTargetSize(uint32_t *width,
+                                               uint32_t *height) const {
+  HwcRect<float> scaled_rect;
+  CalculateSourceCrop(scaled_rect);
+  int right = static_cast<int>(ceilf(scaled_rect.right));
+  int bottom = static_cast<int>(ceilf(scaled_rect.bottom));
+  // Composition is rendered at display coordinates unless it's downscaled.
+  if (private_data_->use_plane_scalar_ ||
+      private_data_->down_scaling_factor_ <= 1) {
+    const HwcRect<int> &display_frame = private_data_->display_frame_;
+    right = std::max(display_frame.right, right);
+    bottom = std::max(display_frame.bottom, bottom);
+  }
+  *width = std::max(right, 0);
+  *height = std::max(bottom, 0);
+}
+
+bool DisplayPlaneState::OffScreenTargetsFit() const {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  GetOffScreenTargetSize(&width, &height);
+  for (NativeSurface *surface : private_data_->surfaces_) {
+    if (static_cast<uint32_t>(surface->GetWidth()) < width ||
+        static_cast<uint32_t>(surface->GetHeight()) < height)
+      return false;
+  }
+
+  return true;
+}
+
 void DisplayPlaneState::SwapSurfaceIfNeeded() {
   if (surface_swapped_) {
     return;
@@ -461,9 +523,14 @@ void DisplayPlaneState::RefreshSurfaces(NativeSurface::ClearType clear_surface,
   HwcRect<float> scaled_rect;
   CalculateSourceCrop(scaled_rect);
 
+  uint32_t factor = 1;
+  if (!private_data_->use_plane_scalar_)
+    factor = private_data_->down_scaling_factor_;
+
   for (NativeSurface *surface : private_data_->surfaces_) {
     surface->ResetDisplayFrame(target_display_frame);
     surface->ResetSourceCrop(scaled_rect);
+    surface->SetDownScalingFactor(factor);
 
     bool clear = surface->ClearSurface();
     bool partial_clear = surface->IsPartialClear();
@@ -552,9 +619,11 @@ void DisplayPlaneState::UsePlaneScalar(bool enable, bool force_refresh) {
       const HwcRect<int> &target_display_frame = private_data_->display_frame_;
       HwcRect<float> scaled_rect;
       CalculateSourceCrop(scaled_rect);
+      uint32_t factor = enable ? 1 : private_data_->down_scaling_factor_;
       for (NativeSurface *surface : private_data_->surfaces_) {
         surface->ResetDisplayFrame(target_display_frame);
         surface->ResetSourceCrop(scaled_rect);
+        surface->SetDownScalingFactor(factor);
         if (surface->ClearSurface()) {
           surface->UpdateSurfaceDamage(scaled_rect, true);
         }
@@ -666,13 +735,14 @@ void DisplayPlaneState::ValidateReValidation() {
     bool use_scalar = CanUseDisplayUpScaling();
     if (private_data_->use_plane_scalar_ != use_scalar) {
       re_validate_layer_ |= ReValidationType::kUpScalar;
-#ifdef ENABLE_DOWNSCALING
     } else {
-      bool down_scale = CanUseGPUDownScaling();
-      if ((private_data_->down_scaling_factor_ > 0) != down_scale) {
-        re_validate_layer_ = ReValidationType::kDownScaling;
+      uint32_t factor = 1;
+      if (CanUseGPUDownScaling())
+        factor = private_data_->max_down_scaling_factor_;
+
+      if (private_data_->down_scaling_factor_ != factor) {
+        re_validate_layer_ |= ReValidationType::kDownScaling;
       }
-#endif
     }
   }
 
@@ -749,53 +819,15 @@ bool DisplayPlaneState::CanUseDisplayUpScaling() const {
 }
 
 bool DisplayPlaneState::CanUseGPUDownScaling() const {
-#ifndef ENABLE_DOWNSCALING
-  private_data_->can_use_downscaling_ = false;
-  return false;
-#endif
-  if (!private_data_->rect_updated_) {
-    return private_data_->can_use_downscaling_;
-  }
-
-  bool value = false;
-  private_data_->can_use_downscaling_ = false;
-  if (!NeedsOffScreenComposition()) {
-    value = false;
-  } else if (private_data_->use_plane_scalar_ &&
-             private_data_->can_use_display_scalar_) {
-    value = false;
-  } else {
-    const HwcRect<int> &target_display_frame = private_data_->display_frame_;
-    const HwcRect<float> &target_src_rect = private_data_->source_crop_;
-
-    uint32_t display_frame_width =
-        target_display_frame.right - target_display_frame.left;
-    uint32_t display_frame_height =
-        target_display_frame.bottom - target_display_frame.top;
-    uint32_t source_crop_width = static_cast<uint32_t>(
-        ceilf(target_src_rect.right - target_src_rect.left));
-    uint32_t source_crop_height = static_cast<uint32_t>(
-        ceilf(target_src_rect.bottom - target_src_rect.top));
-    if (display_frame_width < 500) {
-      // Ignore < 500 pixels.
-      value = false;
-    } else if ((display_frame_width == source_crop_width) &&
-               (display_frame_height == source_crop_height)) {
-      value = true;
-    } else {
-      // If we are already downscaling content by less than 25%, no need
-      // for any further downscaling.
-      if (display_frame_width >
-          (source_crop_width -
-           (source_crop_width / private_data_->down_scaling_factor_))) {
-        value = true;
-      }
-    }
+  if (private_data_->max_down_scaling_factor_ <= 1 ||
+      !NeedsOffScreenComposition() || IsVideoPlane() || IsCursorPlane() ||
+      private_data_->use_plane_scalar_) {
+    return false;
   }
 
-  private_data_->can_use_downscaling_ = value;
-
-  return private_data_->can_use_display_scalar_;
+  // Ignore < 500 pixels, there is not much fill rate to save.
+  const HwcRect<int> &target_display_frame = private_data_->display_frame_;
+  return (target_display_frame.right - target_display_frame.left) >= 500;
 }
 
 void DisplayPlaneState::SetRotationType(RotationType type, bool refresh) {
@@ -823,11 +855,6 @@ DisplayPlaneState::RotationType DisplayPlaneState::GetRotationType() const {
 
 void DisplayPlaneState::SetDisplayDownScalingFactor(uint32_t factor,
                                                     bool clear_surfaces) {
-#ifndef ENABLE_DOWNSCALING
-  HWC_UNUSED(factor);
-  HWC_UNUSED(clear_surfaces);
-  return;
-#endif
   if (private_data_->down_scaling_factor_ == factor)
     return;
 
@@ -850,13 +877,14 @@ void DisplayPlaneState::CalculateSourceCrop(HwcRect<float> &scaled_rect) const {
     scaled_rect = private_data_->source_crop_;
   } else {
     scaled_rect = private_data_->display_frame_;
-#ifdef ENABLE_DOWNSCALING
     if (private_data_->down_scaling_factor_ > 1) {
-      scaled_rect.right =
-          scaled_rect.right -
-          (scaled_rect.right / private_data_->down_scaling_factor_);
+      // Snap the crop the same way RenderState snaps the regions.
+      float factor = static_cast<float>(private_data_->down_scaling_factor_);
+      scaled_rect.left = roundf(scaled_rect.left / factor);
+      scaled_rect.top = roundf(scaled_rect.top / factor);
+      scaled_rect.right = roundf(scaled_rect.right / factor);
+      scaled_rect.bottom = roundf(scaled_rect.bottom / factor);
     }
-#endif
   }
 }
 
@@ -84,6 +84,11 @@ class DisplayPlaneState {
   // SetOffcreen Surface for this plane.
   void SetOffScreenTarget(NativeSurface *target);
 
+  // Takes over surfaces, current composition first, which already hold
+  // the composition of this plane. Plane is scanned out without being
+  // rendered to.
+  void ReuseOffScreenTargets(const std::vector<NativeSurface *> &surfaces);
+
   // Get display frame not counted in display rotation
   const HwcRect<int> &GetDisplayFrame() const;
 
@@ -96,6 +101,14 @@ class DisplayPlaneState {
 
   NativeSurface *GetOffScreenTarget() const;
 
+  // Returns the size an offscreen target needs to have at least to hold
+  // the composition of this plane.
+  void GetOffScreenTargetSize(uint32_t *width, uint32_t *height) const;
+
+  // Returns true in case all surfaces of this plane are big enough to
+  // hold its composition.
+  bool OffScreenTargetsFit() const;
+
   // Returns all NativeSurfaces associated with this plane.
   // These can be empty if the plane doesn't need to go
   // through any composition pass before being scanned out.
@@ -194,11 +207,18 @@ class DisplayPlaneState {
   // This should be used only as a hint.
   bool CanUseDisplayUpScaling() const;
 
-  // Returns true if we can benefit by using gpu for
-  // downscaling content of this plane.
+  // Returns true if content of this plane may be composed
+  // at reduced resolution and upscaled by the display plane,
+  // see HWCCompositionQuality.
   // This should be used only as a hint.
   bool CanUseGPUDownScaling() const;
 
+  // Returns by how much content of all layers of this plane
+  // may be scaled down, see OverlayLayer::GetMaxDownScalingFactor.
+  uint32_t GetMaxDownScalingFactor() const {
+    return private_data_->max_down_scaling_factor_;
+  }
+
   // Set if Plane rotation needs to be handled
   // using GPU or Display.
   void SetRotationType(RotationType type, bool refresh);
@@ -208,6 +228,8 @@ class DisplayPlaneState {
   // plane is not rotated.
   RotationType GetRotationType() const;
 
+  // Composes content of this plane at 1/factor of the display
+  // resolution in both directions. factor is 1, 2 or 4.
   void SetDisplayDownScalingFactor(uint32_t factor, bool clear_surfaces);
 
   uint32_t GetDownScalingFactor() const;
@@ -278,8 +300,6 @@ class DisplayPlaneState {
     bool has_cursor_layer_ = false;
     // Can benefit using display scalar.
     bool can_use_display_scalar_ = false;
-    // Using GPU for downscaling.
-    bool use_down_scaling_ = false;
     // Can benefit by downscaling using
     // GPU.
     bool can_use_downscaling_ = false;
@@ -294,6 +314,8 @@ class DisplayPlaneState {
     // Display cannot support the required rotation.
     bool unsupported_display_rotation_ = false;
     uint32_t down_scaling_factor_ = 1;
+    // Lowest GetMaxDownScalingFactor of the layers.
+    uint32_t max_down_scaling_factor_ = 1;
     // Any offscreen surfaces used by this
     // plane.
     std::vector<NativeSurface *> surfaces_;
@@ -20,6 +20,7 @@
 #include <hwclayer.h>
 #include <math.h>
 #include <sys/time.h>
+#include <time.h>
 #include <vector>
 
 #include "displayplanemanager.h"
@@ -35,10 +36,17 @@
 
 namespace hwcomposer {
 
+// Margins used till we have measured the actual durations.
+static const int64_t kInitialFrameMargin = 8 * 1000 * 1000;
+static const int64_t kInitialCommitMargin = 3 * 1000 * 1000;
+
 DisplayQueue::DisplayQueue(uint32_t gpu_fd, bool disable_explictsync,
                            NativeBufferHandler* buffer_handler,
                            PhysicalDisplay* display)
-    : gpu_fd_(gpu_fd), display_(display) {
+    : gpu_fd_(gpu_fd),
+      display_(display),
+      frame_margin_(kInitialFrameMargin),
+      commit_margin_(kInitialCommitMargin) {
   if (disable_explictsync) {
     state_ |= kDisableExplictSync;
   } else {
@@ -69,6 +77,8 @@ DisplayQueue::DisplayQueue(uint32_t gpu_fd, bool disable_explictsync,
 }
 
 DisplayQueue::~DisplayQueue() {
+  if (commit_thread_)
+    RetireQueuedFrame(false);
 }
 
 bool DisplayQueue::Initialize(uint32_t pipe, uint32_t width, uint32_t height,
@@ -80,7 +90,7 @@ bool DisplayQueue::Initialize(uint32_t pipe, uint32_t width, uint32_t height,
 
   display_plane_manager_.reset(
       new DisplayPlaneManager(plane_handler, resource_manager_.get()));
-  if (!display_plane_manager_->Initialize(width, height)) {
+  if (!display_plane_manager_->Initialize(pipe, width, height)) {
     ETRACE("Failed to initialize DisplayPlane Manager.");
     return false;
   }
@@ -160,6 +170,7 @@ bool DisplayQueue::ForcePlaneValidation(int add_index, int remove_index,
 
 void DisplayQueue::ReleaseUnreservedPlanes(
     std::vector<uint32_t>& reserved_planes) {
+  RetireQueuedFrame(false);
   display_plane_manager_->ReleaseUnreservedPlanes(reserved_planes);
 }
 
@@ -170,13 +181,21 @@ void DisplayQueue::GetCachedLayers(const std::vector<OverlayLayer>& layers,
   size_t previous_size = 0;
   int new_re_validate = 0;
   bool rects_updated = false;
+  // Surfaces of a frame which never reached the display have been put
+  // back in the order before it, so they don't match in_flight_layers_.
+  bool cache_compositions =
+      !queued_frame_.replaces_dropped_ && !last_commit_failed_update_;
 
   for (DisplayPlaneState& previous_plane : previous_plane_state_) {
     previous_size += previous_plane.GetSourceLayers().size();
     if ((int)previous_size > re_validate_begin) {
       // Mark surfaces of all planes to be released once they are
-      // offline.
-      if (previous_plane.NeedsOffScreenComposition()) {
+      // offline, unless they are kept to be reused by a plane showing
+      // the same layers.
+      if (previous_plane.NeedsOffScreenComposition() &&
+          !(cache_compositions &&
+            display_plane_manager_->CacheComposition(
+                previous_plane, in_flight_layers_, surfaces_not_inuse_))) {
         display_plane_manager_->MarkSurfacesForRecycling(
             &previous_plane, surfaces_not_inuse_, true);
       }
@@ -208,11 +227,13 @@ void DisplayQueue::GetCachedLayers(const std::vector<OverlayLayer>& layers,
 void DisplayQueue::InitializeOverlayLayers(
     std::vector<HwcLayer*>& source_layers, bool handle_constraints,
     std::vector<OverlayLayer>& layers, bool& has_video_layer,
-    bool& has_cursor_layer, int& re_validate_begin, bool& idle_frame) {
+    bool& has_cursor_layer, int& re_validate_begin, int& dirty_begin,
+    bool& idle_frame) {
   size_t size = source_layers.size();
   size_t previous_size = in_flight_layers_.size();
   uint32_t z_order = 0;
   re_validate_begin = size;
+  dirty_begin = size;
 
   for (size_t layer_index = 0; layer_index < size; layer_index++) {
     HwcLayer* layer = source_layers.at(layer_index);
@@ -276,20 +297,30 @@ void DisplayQueue::InitializeOverlayLayers(
       if (re_validate_begin == size) {
         bool need_revalidate =
             overlay_layer->IsSolidColor() != previous_layer->IsSolidColor();
+        bool plane_local = false;
         if (!need_revalidate) {
           if (!(overlay_layer->IsCursorLayer() &&
                 previous_layer->IsCursorLayer())) {
             if (IsLayerAlphaBlendingCommitted(overlay_layer) ^
-                IsLayerAlphaBlendingCommitted(previous_layer))
+                IsLayerAlphaBlendingCommitted(previous_layer)) {
+              need_revalidate = true;
+            } else if (overlay_layer->NeedsRevalidation()) {
               need_revalidate = true;
-            if (!need_revalidate) {
-              if (overlay_layer->NeedsRevalidation())
-                need_revalidate = true;
+              plane_local = overlay_layer->NeedsPlaneLocalRevalidation();
             }
           }
         }
-        if (need_revalidate)
-          re_validate_begin = layer_index;
+        if (need_revalidate) {
+          // Changes which only affect the plane this layer is on don't
+          // need the upper stack to be re-validated, these planes are
+          // re-tested in AssignAndCommitPlanes.
+          if (plane_local) {
+            if (dirty_begin == size)
+              dirty_begin = layer_index;
+          } else {
+            re_validate_begin = layer_index;
+          }
+        }
       }
     } else if (overlay_layer->IsVideoLayer()) {
       re_validate_begin = 0;
@@ -320,21 +351,60 @@ void DisplayQueue::DumpCurrentDisplayPlaneList(
 
 bool DisplayQueue::AssignAndCommitPlanes(
     std::vector<OverlayLayer>& layers, std::vector<HwcLayer*>* source_layers,
-    bool validate_layers, int re_validate_begin, bool setMediaEffect,
-    int32_t* retire_fence, ScopedStateTracker* tracker) {
-  DisplayPlaneStateList current_composition_planes;
+    bool validate_layers, int re_validate_begin, int dirty_begin,
+    bool setMediaEffect, int32_t* retire_fence, ScopedStateTracker* tracker) {
+  DisplayPlaneStateList& current_composition_planes = frame_planes_;
   bool render_layers = false;
   bool composition_passed = true;
   bool disable_overlays = state_ & kDisableOverlay;
   bool disable_explictsync = state_ & kDisableExplictSync;
+  bool pipelined = pipeline_depth_ > 1;
+  bool queue_commit = pipelined && commit_thread_ && !clone_mode_ &&
+                      !IsIgnoreUpdates();
+  int64_t frame_start = GetMonotonicTime();
+  int64_t fence_wait_start = fence_wait_;
+
+  // Queued frame can be replaced by this one if it's still waiting for
+  // its vblank. Release fences handed out for it are signalled with the
+  // ones of this frame.
+  RetireQueuedFrame(!IsIgnoreUpdates());
+  // Surfaces have already been aged for the dropped frame, which never
+  // reached the display.
+  bool replaces_dropped = queued_frame_.replaces_dropped_;
+
+  // Planes might have been handed to or taken back by other displays.
+  if (display_plane_manager_->SyncSharedPlanes(previous_plane_state_,
+                                                disable_overlays)) {
+    re_validate_begin = 0;
+    validate_layers = true;
+  }
 
+  int64_t stage_start = GetMonotonicTime();
+  display_plane_manager_->InvalidateCachedCompositions(layers,
+                                                       surfaces_not_inuse_);
   GetCachedLayers(layers, re_validate_begin, current_composition_planes);
   // We need to verify the rest layers and planes
   if (re_validate_begin < (int)layers.size()) {
     validate_layers = true;
+  } else if (!validate_layers && dirty_begin < (int)layers.size() &&
+             !display_plane_manager_->ValidateDirtyPlanes(
+                 current_composition_planes, layers)) {
+    // Planes can't show the changed layers anymore, assign all layers
+    // from the first changed one again.
+    IPLANECACHETRACE("Re-testing dirty planes failed, validating from %d",
+                     dirty_begin);
+    for (DisplayPlaneState& plane : current_composition_planes) {
+      plane.GetDisplayPlane()->SetInUse(false);
+    }
+
+    current_composition_planes.clear();
+    re_validate_begin = dirty_begin;
+    GetCachedLayers(layers, re_validate_begin, current_composition_planes);
+    validate_layers = true;
   }
 
   if (validate_layers) {
+    display_plane_manager_->EnableVideoScanout(!setMediaEffect);
     display_plane_manager_->ValidateLayers(
         layers, re_validate_begin, disable_overlays, current_composition_planes,
         previous_plane_state_, surfaces_not_inuse_);
@@ -343,9 +413,18 @@ bool DisplayQueue::AssignAndCommitPlanes(
       SetMediaEffectsState(requested_video_effect_, layers,
                            current_composition_planes);
     }
+
+    display_plane_manager_->ReuseCachedCompositions(
+        current_composition_planes, layers, surfaces_not_inuse_);
     needs_clone_validation_ = true;
   }
 
+  // Layers of a plane might have moved beyond its surfaces.
+  display_plane_manager_->ResizeOffScreenTargets(current_composition_planes,
+                                                 surfaces_not_inuse_);
+
+  AddStageTiming(HWCFrameStage::kValidateLayers, stage_start);
+
   for (auto& composition : current_composition_planes) {
     if (composition.NeedsOffScreenComposition()) {
       render_layers = true;
@@ -363,18 +442,30 @@ bool DisplayQueue::AssignAndCommitPlanes(
   // Ensure all pixel buffer uploads are done.
   bool compsition_passed = false;
 
-  // Handle any 3D Composition.
+  // Handle any 3D Composition. In pipelined mode we only kick off the
+  // rendering here and wait for it in the commit stage below.
   if (render_layers) {
+    stage_start = GetMonotonicTime();
     compositor_.BeginFrame(disable_explictsync);
     // Prepare for final composition.
-    if (!compositor_.Draw(current_composition_planes, layers)) {
+    if (!compositor_.Draw(current_composition_planes, layers, !pipelined)) {
       ETRACE("Failed to prepare for the frame composition. ");
       composition_passed = false;
     }
+
+    AddStageTiming(HWCFrameStage::kCompositorDraw, stage_start);
+  }
+
+  if (composition_passed && pipelined && !queue_commit) {
+    if (!WaitForPipelinedCommit(render_layers)) {
+      ETRACE("Failed to render the frame. ");
+      composition_passed = false;
+    }
   }
 
   if (!composition_passed) {
     HandleCommitFailure(current_composition_planes);
+    SignalDroppedFrameRelease();
     last_commit_failed_update_ = true;
     return false;
   }
@@ -394,10 +485,24 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   int32_t fence = 0;
   bool fence_released = false;
-  if (!IsIgnoreUpdates()) {
+  if (!IsIgnoreUpdates() && !queue_commit) {
+    // In case the last queued frame was dropped, planes of the frame
+    // before are still on screen.
+    const DisplayPlaneStateList& on_screen_planes =
+        queued_frame_.on_screen_planes_.empty()
+            ? previous_plane_state_
+            : queued_frame_.on_screen_planes_;
     composition_passed = display_->Commit(
-        current_composition_planes, previous_plane_state_, disable_explictsync,
+        current_composition_planes, on_screen_planes, disable_explictsync,
         kms_fence_, &fence, &fence_released);
+    if (composition_passed) {
+      queued_frame_.on_screen_planes_.clear();
+      // DrmDisplay waits for the previous flip, which isn't needed to
+      // make the next vblank.
+      if (!pipelined)
+        frame_margin_.AddSample(GetMonotonicTime() - frame_start -
+                                (fence_wait_ - fence_wait_start));
+    }
   }
 
   if (fence_released) {
@@ -407,7 +512,11 @@ bool DisplayQueue::AssignAndCommitPlanes(
   if (!composition_passed) {
     DumpCurrentDisplayPlaneList(current_composition_planes);
     last_commit_failed_update_ = true;
+    // Cached validation results led to a failing commit, don't trust
+    // them anymore.
+    display_plane_manager_->ResetValidationCache();
     HandleCommitFailure(current_composition_planes);
+    SignalDroppedFrameRelease();
     return false;
   }
 
@@ -416,13 +525,13 @@ bool DisplayQueue::AssignAndCommitPlanes(
   // Doing it here also ensures that if this surface
   // is still in use than it will be marked in use
   // below.
-  if (!mark_not_inuse_.empty()) {
+  if (!mark_not_inuse_.empty() && !replaces_dropped) {
     size_t size = mark_not_inuse_.size();
     for (uint32_t i = 0; i < size; i++) {
       mark_not_inuse_.at(i)->SetSurfaceAge(-1);
     }
 
-    std::vector<NativeSurface*>().swap(mark_not_inuse_);
+    mark_not_inuse_.clear();
     if (tracker)
       tracker->ForceSurfaceRelease();
   }
@@ -437,9 +546,9 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   // Swap any surfaces which are to be marked as not in
   // use next frame.
-  if (!surfaces_not_inuse_.empty()) {
+  if (!surfaces_not_inuse_.empty() && !replaces_dropped) {
     size_t size = surfaces_not_inuse_.size();
-    std::vector<NativeSurface*> temp;
+    std::vector<NativeSurface*>& temp = frame_surfaces_;
     for (uint32_t i = 0; i < size; i++) {
       NativeSurface* surface = surfaces_not_inuse_.at(i);
       uint32_t age = surface->GetSurfaceAge();
@@ -454,14 +563,60 @@ bool DisplayQueue::AssignAndCommitPlanes(
     surfaces_not_inuse_.swap(temp);
   }
 
+  if (queue_commit) {
+    // Planes of the previous frame stay on screen till the queued one has
+    // been committed.
+    if (queued_frame_.on_screen_planes_.empty())
+      queued_frame_.on_screen_planes_.swap(current_composition_planes);
+
+    queued_frame_.render_layers_ = render_layers;
+    queued_frame_.target_time_ = target_present_time_;
+    queued_frame_.committed_ = false;
+    queued_frame_.queued_ = true;
+    // Commit fence is only known once the frame has been committed. Hand
+    // out a fence of release_timeline_ instead, which commit_thread_
+    // signals once the frame has been flipped.
+    queued_frame_.release_point_ = 0;
+    int32_t release_fence = -1;
+    if (!disable_explictsync)
+      release_fence =
+          release_timeline_.CreateFence(&queued_frame_.release_point_);
+
+    // Frame dropped before is released along with this one.
+    if (queued_frame_.release_point_)
+      dropped_release_point_ = 0;
+
+    commit_thread_->QueueFrame();
+    presented_frames_++;
+
+    if (release_fence > 0) {
+      if (retire_fence)
+        *retire_fence = dup(release_fence);
+      if (source_layers)
+        SetReleaseFenceToLayers(release_fence, *source_layers, true);
+      close(release_fence);
+    } else if (!disable_explictsync) {
+      // No sw_sync, wait for the commit fence.
+      if (!RetireQueuedFrame(false)) {
+        SignalDroppedFrameRelease();
+        return false;
+      }
+
+      if (kms_fence_ > 0)
+        fence = kms_fence_;
+    }
+  }
+
   if (fence > 0) {
     if (retire_fence)
       *retire_fence = dup(fence);
     kms_fence_ = fence;
     if (source_layers)
-      SetReleaseFenceToLayers(fence, *source_layers);
+      SetReleaseFenceToLayers(fence, *source_layers, false);
   }
 
+  SignalDroppedFrameRelease();
+
   // Let Display handle any lazy initalizations.
   if (handle_display_initializations_) {
     handle_display_initializations_ = false;
@@ -484,10 +639,12 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
   ScopedIdleStateTracker tracker(idle_tracker_, compositor_,
                                  resource_manager_.get(), this);
   if (tracker.IgnoreUpdate()) {
+    // Content changes can't be tracked while updates are ignored.
+    display_plane_manager_->ResetCompositionCache(surfaces_not_inuse_);
     return true;
   }
   source_layers_ = &source_layers;
-  std::vector<OverlayLayer> layers;
+  std::vector<OverlayLayer>& layers = frame_layers_;
   int re_validate_begin = -1;
   bool idle_frame = true;
   // If last commit failed, lets force full validation as
@@ -498,16 +655,26 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
 
   bool has_video_layer = false;
   bool has_cursor_layer = false;
+  int dirty_begin = -1;
   needs_clone_validation_ = false;
 
+  int64_t stage_start = GetMonotonicTime();
   InitializeOverlayLayers(source_layers, handle_constraints, layers,
                           has_video_layer, has_cursor_layer, re_validate_begin,
-                          idle_frame);
+                          dirty_begin, idle_frame);
+  AddStageTiming(HWCFrameStage::kInitializeLayers, stage_start);
 
-  if (validate_layers || re_validate_begin != source_layers.size()) {
+  if (validate_layers || re_validate_begin != source_layers.size() ||
+      dirty_begin != source_layers.size()) {
     needs_clone_validation_ = true;
   }
 
+  // In case layers need to be assigned to planes again anyway, do so
+  // from the first changed layer.
+  if (re_validate_begin != source_layers.size() &&
+      dirty_begin < re_validate_begin)
+    re_validate_begin = dirty_begin;
+
   if (has_cursor_layer)
     tracker.FrameHasCursor();
 
@@ -551,9 +718,11 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
       for (size_t i = 0; i < size; i++) {
         mark_not_inuse_[i]->SetSurfaceAge(-1);
       }
-      std::vector<NativeSurface*>().swap(mark_not_inuse_);
+      mark_not_inuse_.clear();
       tracker.ForceSurfaceRelease();
     }
+
+    RecycleFrameStorage();
     return true;
   }
 
@@ -561,14 +730,23 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     call_back->Synchronize();
   }
 
-  return AssignAndCommitPlanes(
-      layers, &source_layers, validate_layers, re_validate_begin,
+  // Frames committed from this thread are held here, DisplayCommitThread
+  // takes care of it otherwise.
+  if (target_present_time_ > 0 && !(pipeline_depth_ > 1 && commit_thread_))
+    WaitForLatchTime(target_present_time_);
+
+  bool committed = AssignAndCommitPlanes(
+      layers, &source_layers, validate_layers, re_validate_begin, dirty_begin,
       force_media_composition && requested_video_effect, retire_fence,
       &tracker);
+  RecycleFrameStorage();
+  return committed;
 }
 
 void DisplayQueue::PresentClonedCommit(DisplayQueue* queue) {
   ScopedCloneStateTracker tracker(compositor_, resource_manager_.get(), this);
+  // Make sure source queue is done committing the planes we clone.
+  queue->RetireQueuedFrame(false);
   const DisplayPlaneStateList& source_planes =
       queue->GetCurrentCompositionPlanes();
   if (source_planes.empty()) {
@@ -583,14 +761,14 @@ void DisplayQueue::PresentClonedCommit(DisplayQueue* queue) {
         mark_not_inuse_.at(i)->SetSurfaceAge(-1);
       }
 
-      std::vector<NativeSurface*>().swap(mark_not_inuse_);
+      mark_not_inuse_.clear();
       tracker.ForceSurfaceRelease();
     }
 
     return;
   }
 
-  std::vector<OverlayLayer> layers;
+  std::vector<OverlayLayer>& layers = frame_layers_;
   size_t layers_size = layers.size();
   int add_index = layers_size;
   size_t z_order = 0;
@@ -655,13 +833,25 @@ void DisplayQueue::PresentClonedCommit(DisplayQueue* queue) {
     validate_layers = true;
 
   AssignAndCommitPlanes(layers, queue->GetSourceLayers(), validate_layers,
-                        add_index, false, NULL, &tracker);
+                        add_index, layers.size(), false, NULL, &tracker);
+  RecycleFrameStorage();
+}
+
+void DisplayQueue::RecycleFrameStorage() {
+  // Storage holds whatever is left of the previous frame at this point,
+  // make sure it's released now and not only with the next frame.
+  frame_arena_.Recycle(frame_layers_);
+  frame_arena_.Recycle(frame_planes_);
+  frame_arena_.Recycle(frame_surfaces_);
+  frame_arena_.EndFrame();
 }
 
 void DisplayQueue::SetCloneMode(bool cloned) {
   if (clone_mode_ == cloned)
     return;
 
+  RetireQueuedFrame(false);
+
   if (vblank_handler_) {
     if (cloned) {
       vblank_handler_->SetPowerMode(kOff);
@@ -679,6 +869,8 @@ void DisplayQueue::SetCloneMode(bool cloned) {
           &previous_plane, surfaces_not_inuse_, true);
     }
 
+    // Frames of the cloned display are not tracked.
+    display_plane_manager_->ResetCompositionCache(surfaces_not_inuse_);
     DisplayPlaneStateList().swap(previous_plane_state_);
   }
 
@@ -693,7 +885,6 @@ void DisplayQueue::ResetPlanes(drmModeAtomicReqPtr pset) {
 void DisplayQueue::IgnoreUpdates() {
   idle_tracker_.idle_frames_ = 0;
   idle_tracker_.state_ = FrameStateTracker::kIgnoreUpdates;
-  idle_tracker_.revalidate_frames_counter_ = 0;
 }
 
 bool DisplayQueue::IsIgnoreUpdates() {
@@ -711,6 +902,9 @@ void DisplayQueue::HandleCommitFailure(
         &plane, surfaces_not_inuse_, false, false);
   }
 
+  // Planes retired for this frame are back in use.
+  display_plane_manager_->ResetCompositionCache(surfaces_not_inuse_);
+
   // Let's mark all previous planes as in use.
   for (DisplayPlaneState& previous_plane : previous_plane_state_) {
     previous_plane.GetDisplayPlane()->SetInUse(true);
@@ -718,6 +912,163 @@ void DisplayQueue::HandleCommitFailure(
   }
 }
 
+bool DisplayQueue::WaitForQueuedFrame() {
+  return WaitForPipelinedCommit(queued_frame_.render_layers_);
+}
+
+void DisplayQueue::CommitQueuedFrame(bool rendered) {
+  queued_frame_.committed_ = false;
+  // Release fences of a frame which doesn't reach the display are
+  // signalled right away.
+  release_flip_point_ = queued_frame_.release_point_;
+  if (!rendered) {
+    ETRACE("Failed to render the queued frame. ");
+    return;
+  }
+
+  // Always ask for a commit fence, we need it to know when the next frame
+  // can be committed even if explicit sync is disabled.
+  int32_t fence = 0;
+  bool fence_released = false;
+  int64_t commit_start = GetMonotonicTime();
+  if (!display_->Commit(previous_plane_state_, queued_frame_.on_screen_planes_,
+                        false, 0, &fence, &fence_released)) {
+    DumpCurrentDisplayPlaneList(previous_plane_state_);
+    return;
+  }
+
+  commit_margin_.AddSample(GetMonotonicTime() - commit_start);
+
+  // There is no commit fence in case of a modeset, which is a blocking
+  // commit.
+  queued_frame_.committed_ = true;
+  if (fence > 0) {
+    kms_fence_ = fence;
+    if (release_flip_point_)
+      release_flip_fence_ = dup(fence);
+  }
+}
+
+void DisplayQueue::SignalQueuedFrameRelease() {
+  if (!release_flip_point_)
+    return;
+
+  if (release_flip_fence_ > 0) {
+    HWCPoll(release_flip_fence_, -1);
+    close(release_flip_fence_);
+    release_flip_fence_ = -1;
+  }
+
+  release_timeline_.Signal(release_flip_point_);
+  release_flip_point_ = 0;
+}
+
+void DisplayQueue::SignalDroppedFrameRelease() {
+  // No frame with a release point is queued at this point, so
+  // commit_thread_ doesn't advance release_timeline_ at the same time.
+  if (!dropped_release_point_)
+    return;
+
+  release_timeline_.Signal(dropped_release_point_);
+  dropped_release_point_ = 0;
+}
+
+int64_t DisplayQueue::GetQueuedFrameCommitTime() {
+  return GetLatchTime(queued_frame_.target_time_, commit_margin_);
+}
+
+int64_t DisplayQueue::GetLatchTime(int64_t target, MarginEstimator& margin) {
+  int64_t now = GetMonotonicTime();
+  int64_t duration = margin.GetMargin();
+  int64_t vblank = -1;
+  if (target > 0)
+    vblank = vblank_handler_->GetClosestVblankTime(target);
+
+  // Aim for the first vblank we can still make in case target is too
+  // early.
+  if (vblank - duration < now)
+    vblank = vblank_handler_->GetNextVblankTime(now + duration);
+
+  if (vblank < 0)
+    return -1;
+
+  return vblank - duration;
+}
+
+void DisplayQueue::WaitForLatchTime(int64_t target) {
+  int64_t latch_time = GetLatchTime(target, frame_margin_);
+  if (latch_time <= GetMonotonicTime())
+    return;
+
+  IPAGEFLIPEVENTTRACE("Holding frame till %lld for target %lld",
+                      (long long)latch_time, (long long)target);
+  struct timespec ts;
+  ts.tv_sec = latch_time / 1000000000LL;
+  ts.tv_nsec = latch_time % 1000000000LL;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+bool DisplayQueue::RetireQueuedFrame(bool drop) {
+  if (!queued_frame_.queued_)
+    return true;
+
+  queued_frame_.queued_ = false;
+  bool dropped =
+      commit_thread_->Flush(drop &&
+                            (mailbox_ || !queued_frame_.replaces_dropped_));
+  if (dropped) {
+    coalesced_frames_++;
+    if (queued_frame_.release_point_)
+      dropped_release_point_ = queued_frame_.release_point_;
+
+    IPAGEFLIPEVENTTRACE("Queued frame replaced, %d of %d frames coalesced.",
+                        coalesced_frames_, presented_frames_);
+  }
+
+  if (!dropped && queued_frame_.committed_) {
+    // Previous frame has been replaced on screen.
+    queued_frame_.on_screen_planes_.clear();
+    queued_frame_.replaces_dropped_ = false;
+    return true;
+  }
+
+  // Frame never reached the display. Restore order of the surfaces
+  // rendered for it, so that ones still on screen are not rendered to.
+  for (DisplayPlaneState& plane : previous_plane_state_) {
+    plane.HandleCommitFailure();
+  }
+
+  queued_frame_.replaces_dropped_ = dropped;
+  if (!dropped) {
+    ETRACE("Failed to commit the queued frame. ");
+    // Cached validation results led to a failing commit, don't trust
+    // them anymore.
+    display_plane_manager_->ResetValidationCache();
+    display_plane_manager_->ResetCompositionCache(surfaces_not_inuse_);
+    last_commit_failed_update_ = true;
+  }
+
+  return false;
+}
+
+bool DisplayQueue::WaitForPipelinedCommit(bool render_layers) {
+  int64_t wait_start = GetMonotonicTime();
+  // Previous frame needs to be flipped before we can queue the next
+  // commit. Wait for it while the compositor thread is rendering.
+  if (kms_fence_ > 0) {
+    HWCPoll(kms_fence_, -1);
+    close(kms_fence_);
+    kms_fence_ = 0;
+  }
+
+  bool rendered = true;
+  if (render_layers)
+    rendered = compositor_.WaitForFrame();
+
+  AddStageTiming(HWCFrameStage::kFenceWait, wait_start);
+  return rendered;
+}
+
 void DisplayQueue::SetMediaEffectsState(
     bool apply_effects, const std::vector<OverlayLayer>& layers,
     DisplayPlaneStateList& current_composition_planes) {
@@ -780,7 +1131,8 @@ void DisplayQueue::UpdateOnScreenSurfaces() {
 }
 
 void DisplayQueue::SetReleaseFenceToLayers(
-    int32_t fence, std::vector<HwcLayer*>& source_layers) {
+    int32_t fence, std::vector<HwcLayer*>& source_layers,
+    bool rendering_queued) {
   for (const DisplayPlaneState& plane : previous_plane_state_) {
     if (plane.IsSurfaceRecycled())
       continue;
@@ -797,14 +1149,20 @@ void DisplayQueue::SetReleaseFenceToLayers(
         overlay_layer.SetLayerComposition(OverlayLayer::kDisplay);
       }
     } else {
-      release_fence = plane.GetOverlayLayer()->GetAcquireFence();
+      // While the frame is being rendered, the compositor thread replaces
+      // the fence of the plane's surface. Layers are released once the
+      // frame has been flipped then, which is after rendering anyway.
+      if (!rendering_queued)
+        release_fence = plane.GetOverlayLayer()->GetAcquireFence();
 
       for (size_t layer_index = 0; layer_index < size; layer_index++) {
         OverlayLayer& overlay_layer =
             in_flight_layers_.at(layers.at(layer_index));
         overlay_layer.SetLayerComposition(OverlayLayer::kGpu);
         HwcLayer* layer = source_layers.at(overlay_layer.GetLayerIndex());
-        if (release_fence > 0) {
+        if (rendering_queued) {
+          layer->SetReleaseFence(dup(fence));
+        } else if (release_fence > 0) {
           layer->SetReleaseFence(dup(release_fence));
         } else {
           int32_t temp = overlay_layer.GetAcquireFence();
@@ -827,6 +1185,7 @@ void DisplayQueue::HandleExit() {
   power_mode_lock_.lock();
   state_ |= kIgnoreIdleRefresh;
   power_mode_lock_.unlock();
+  RetireQueuedFrame(false);
   vblank_handler_->SetPowerMode(kOff);
   if (!previous_plane_state_.empty()) {
     display_->Disable(previous_plane_state_);
@@ -888,6 +1247,64 @@ void DisplayQueue::SetBrightness(uint32_t red, uint32_t green, uint32_t blue) {
   state_ |= kNeedsColorCorrection;
 }
 
+void DisplayQueue::SetPipelineDepth(uint32_t depth) {
+  RetireQueuedFrame(false);
+  if (depth > 1 && !commit_thread_) {
+    release_timeline_.Initialize();
+    commit_thread_.reset(new DisplayCommitThread(this));
+    if (!commit_thread_->Initialize())
+      commit_thread_.reset(nullptr);
+  }
+
+  pipeline_depth_ = depth;
+}
+
+void DisplayQueue::SetMailboxMode(bool enable) {
+  RetireQueuedFrame(false);
+  mailbox_ = enable;
+}
+
+void DisplayQueue::GetFrameCoalescingStats(uint32_t* presented,
+                                           uint32_t* coalesced) {
+  *presented = presented_frames_;
+  *coalesced = coalesced_frames_;
+}
+
+void DisplayQueue::SetCompositionCacheBudget(uint64_t budget) {
+  RetireQueuedFrame(false);
+  display_plane_manager_->SetCompositionCacheBudget(budget,
+                                                    surfaces_not_inuse_);
+}
+
+void DisplayQueue::SetOffScreenSurfaceBudget(uint64_t budget) {
+  display_plane_manager_->SetOffScreenSurfaceBudget(budget);
+}
+
+void DisplayQueue::GetCompositionCacheStats(uint32_t* hits, uint32_t* misses) {
+  *hits = display_plane_manager_->GetCompositionCacheHits();
+  *misses = display_plane_manager_->GetCompositionCacheMisses();
+}
+
+void DisplayQueue::AddStageTiming(HWCFrameStage stage, int64_t start) {
+  int64_t duration = GetMonotonicTime() - start;
+  stage_timings_[static_cast<uint32_t>(stage)].AddSample(duration);
+  if (stage == HWCFrameStage::kFenceWait)
+    fence_wait_ += duration;
+}
+
+bool DisplayQueue::GetFrameStageTiming(HWCFrameStage stage,
+                                       HWCStageTiming* timing) {
+  if (stage >= HWCFrameStage::kNumFrameStages)
+    return false;
+
+  stage_timings_[static_cast<uint32_t>(stage)].GetTiming(timing);
+  return true;
+}
+
+void DisplayQueue::GetDrawCallStats(uint64_t* frames, uint64_t* draw_calls) {
+  compositor_.GetDrawCallStats(frames, draw_calls);
+}
+
 void DisplayQueue::SetDisableExplicitSync(bool disable_explicit_sync) {
   if (disable_explicit_sync) {
     state_ |= kDisableExplictSync;
@@ -974,6 +1391,33 @@ void DisplayQueue::VSyncControl(bool enabled) {
   vblank_handler_->VSyncControl(enabled);
 }
 
+bool DisplayQueue::GetNextVblankTime(int64_t* timestamp) {
+  int64_t vblank = vblank_handler_->GetNextVblankTime(GetMonotonicTime());
+  if (vblank < 0)
+    return false;
+
+  *timestamp = vblank;
+  return true;
+}
+
+void DisplayQueue::SetTargetPresentTime(int64_t timestamp) {
+  target_present_time_ = timestamp;
+}
+
+void DisplayQueue::SetPresentMarginTuning(uint32_t deviation_factor,
+                                          uint32_t slack_us) {
+  frame_margin_.SetTuning(deviation_factor, (int64_t)slack_us * 1000);
+  commit_margin_.SetTuning(deviation_factor, (int64_t)slack_us * 1000);
+}
+
+void DisplayQueue::SetIdleHysteresis(uint32_t min_idle_frames,
+                                     uint32_t max_idle_frames,
+                                     uint32_t exit_frames) {
+  idle_tracker_.idle_lock_.lock();
+  idle_policy_.SetHysteresis(min_idle_frames, max_idle_frames, exit_frames);
+  idle_tracker_.idle_lock_.unlock();
+}
+
 void DisplayQueue::HandleIdleCase() {
   idle_tracker_.idle_lock_.lock();
   if (idle_tracker_.state_ & FrameStateTracker::kPrepareComposition) {
@@ -981,26 +1425,27 @@ void DisplayQueue::HandleIdleCase() {
     return;
   }
 
-  if (idle_tracker_.total_planes_ <= 1 ||
-      (idle_tracker_.state_ & FrameStateTracker::kTrackingFrames) ||
-      (idle_tracker_.state_ & FrameStateTracker::kRevalidateLayers) ||
-      idle_tracker_.has_cursor_layer_) {
-    idle_tracker_.idle_lock_.unlock();
-    return;
-  }
+  if (idle_tracker_.state_ & FrameStateTracker::kTrackingFrames)
+    idle_policy_.AddIdleModeVblank();
 
-  if (idle_tracker_.idle_frames_ > kidleframes) {
+  // Keep counting vblanks till the threshold is crossed, the count is
+  // also used by idle_policy_ to learn the update cadence.
+  uint32_t threshold = idle_policy_.GetIdleThreshold();
+  if (idle_tracker_.idle_frames_ > threshold) {
     idle_tracker_.idle_lock_.unlock();
     return;
   }
 
-  if (idle_tracker_.idle_frames_ < kidleframes) {
-    idle_tracker_.idle_frames_++;
+  idle_tracker_.idle_frames_++;
+  if (idle_tracker_.idle_frames_ <= threshold ||
+      idle_tracker_.total_planes_ <= 1 ||
+      (idle_tracker_.state_ & FrameStateTracker::kTrackingFrames) ||
+      (idle_tracker_.state_ & FrameStateTracker::kRevalidateLayers) ||
+      idle_tracker_.has_cursor_layer_) {
     idle_tracker_.idle_lock_.unlock();
     return;
   }
 
-  idle_tracker_.idle_frames_++;
   power_mode_lock_.lock();
   if (!(state_ & kIgnoreIdleRefresh) && refresh_callback_ &&
       (state_ & kPoweredOn)) {
@@ -1063,6 +1508,8 @@ void DisplayQueue::ResetQueue() {
   last_commit_failed_update_ = false;
   std::vector<OverlayLayer>().swap(in_flight_layers_);
   DisplayPlaneStateList().swap(previous_plane_state_);
+  DisplayPlaneStateList().swap(queued_frame_.on_screen_planes_);
+  queued_frame_.replaces_dropped_ = false;
   std::vector<NativeSurface*>().swap(mark_not_inuse_);
   std::vector<NativeSurface*>().swap(surfaces_not_inuse_);
   if (display_plane_manager_.get() && display_plane_manager_->HasSurfaces())
@@ -1076,6 +1523,7 @@ void DisplayQueue::ResetQueue() {
 
   idle_tracker_.state_ = 0;
   idle_tracker_.idle_frames_ = 0;
+  idle_policy_.Reset();
   if (ignore_updates) {
     idle_tracker_.state_ |= FrameStateTracker::kIgnoreUpdates;
   }
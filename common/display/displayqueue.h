@@ -22,15 +22,22 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <atomic>
 #include <memory>
 #include <queue>
 #include <vector>
 
 #include "compositor.h"
+#include "displaycommitthread.h"
 #include "displayplanemanager.h"
+#include "framearena.h"
 #include "hwcthread.h"
+#include "idlepolicy.h"
+#include "marginestimator.h"
 #include "platformdefines.h"
 #include "resourcemanager.h"
+#include "synctimeline.h"
+#include "timinghistogram.h"
 #include "vblankeventhandler.h"
 
 namespace hwcomposer {
@@ -54,7 +61,8 @@ class DisplayPlaneHandler;
 struct HwcLayer;
 class NativeBufferHandler;
 
-static uint32_t kidleframes = 250;
+// Maximum number of frames which can be in flight in pipelined mode.
+static const uint32_t kMaxPipelineDepth = 2;
 class DisplayQueue {
  public:
   DisplayQueue(uint32_t gpu_fd, bool disable_explictsync,
@@ -74,6 +82,32 @@ class DisplayQueue {
   void SetContrast(uint32_t red, uint32_t green, uint32_t blue);
   void SetBrightness(uint32_t red, uint32_t green, uint32_t blue);
   void SetDisableExplicitSync(bool disable_explicit_sync);
+  // Sets the number of frames which can be in flight. 1 means every
+  // frame is rendered and flipped before QueueUpdate returns. With 2,
+  // frames are committed by DisplayCommitThread. depth has been checked
+  // by PhysicalDisplay to be in 1..kMaxPipelineDepth.
+  // In case DisplayCommitThread can't be started, and in clone mode,
+  // frames are still committed by QueueUpdate after waiting for their
+  // rendering, so validation of the next frame doesn't overlap with
+  // rendering of this one.
+  void SetPipelineDepth(uint32_t depth);
+  // In mailbox mode frames are queued to DisplayCommitThread and a frame
+  // not committed yet is replaced by the next one, however many frames
+  // are queued within one vblank. Needs a pipeline depth of 2, which
+  // PhysicalDisplay sets up before.
+  void SetMailboxMode(bool enable);
+  // Returns the number of frames queued for the display and how many of
+  // them have been replaced before reaching it.
+  void GetFrameCoalescingStats(uint32_t* presented, uint32_t* coalesced);
+  // Sets memory, in bytes, offscreen surfaces kept around to reuse the
+  // composition of planes may use, see CompositionCache.
+  void SetCompositionCacheBudget(uint64_t budget);
+  // Returns how often a plane needing to be rendered from scratch could
+  // reuse a cached composition instead.
+  void GetCompositionCacheStats(uint32_t* hits, uint32_t* misses);
+  // Sets memory, in bytes, offscreen surfaces of the display may use
+  // before surfaces not on screen anymore are released.
+  void SetOffScreenSurfaceBudget(uint64_t budget);
   void SetVideoScalingMode(uint32_t mode);
   void SetVideoColor(HWCColorControl color, float value);
   void GetVideoColor(HWCColorControl color, float* value, float* start,
@@ -92,6 +126,30 @@ class DisplayQueue {
 
   void VSyncControl(bool enabled);
 
+  // Returns predicted time of the next vblank in CLOCK_MONOTONIC
+  // nanoseconds.
+  bool GetNextVblankTime(int64_t* timestamp);
+
+  // Sets time at which the frame passed to the next QueueUpdate call should
+  // be shown. The frame is held and committed as late as possible for
+  // the vblank closest to timestamp. -1 shows the frame right away.
+  void SetTargetPresentTime(int64_t timestamp);
+
+  // Tunes the safety margins learned from measured frame and commit
+  // durations, see MarginEstimator.
+  void SetPresentMarginTuning(uint32_t deviation_factor, uint32_t slack_us);
+
+  // Tunes when the display is considered idle and composited into a
+  // single plane, see IdlePolicy::SetHysteresis.
+  void SetIdleHysteresis(uint32_t min_idle_frames, uint32_t max_idle_frames,
+                         uint32_t exit_frames);
+
+  // Records time elapsed since start, in CLOCK_MONOTONIC nanoseconds,
+  // for stage. Can be called from any thread.
+  void AddStageTiming(HWCFrameStage stage, int64_t start);
+  bool GetFrameStageTiming(HWCFrameStage stage, HWCStageTiming* timing);
+  void GetDrawCallStats(uint64_t* frames, uint64_t* draw_calls);
+
   void HandleIdleCase();
 
   void DisplayConfigurationChanged();
@@ -162,6 +220,8 @@ class DisplayQueue {
   void DumpCurrentDisplayPlaneList(DisplayPlaneStateList& composition);
 
  private:
+  friend class DisplayCommitThread;
+
   enum QueueState {
     kNeedsColorCorrection = 1 << 0,  // Needs Color correction.
     kConfigurationChanged = 1 << 1,  // Layers need to be re-validated.
@@ -207,10 +267,30 @@ class DisplayQueue {
     bool has_cursor_layer_ = false;
     SpinLock idle_lock_;
     int state_ = kPrepareComposition;
-    uint32_t revalidate_frames_counter_ = 0;
     size_t total_planes_ = 1;
   };
 
+  // Frame handed over to commit_thread_. Bookkeeping for the frame is done
+  // when it is queued, as if it had been committed already.
+  struct QueuedFrame {
+    // Planes still being scanned out while the frame is queued. Empty if
+    // these are previous_plane_state_.
+    DisplayPlaneStateList on_screen_planes_;
+    bool queued_ = false;
+    bool render_layers_ = false;
+    // Time at which the frame should be shown or -1.
+    int64_t target_time_ = -1;
+    // Set by commit thread once frame has been committed.
+    bool committed_ = false;
+    // Set if the frame before was dropped. Surfaces are aged as if every
+    // queued frame reached the display, the next frame doesn't age them
+    // again. Outside of mailbox mode we don't drop two frames in a row.
+    bool replaces_dropped_ = false;
+    // Point of release_timeline_ the release fences handed out for the
+    // frame signal at, 0 if they are the commit fence.
+    uint32_t release_point_ = 0;
+  };
+
   struct ScopedStateTracker {
     void ForceSurfaceRelease() {
       forced_ = true;
@@ -262,8 +342,6 @@ class DisplayQueue {
       } else {
         tracker_.state_ = 0;
       }
-
-      tracker_.revalidate_frames_counter_ = 0;
     }
 
     bool IgnoreUpdate() const {
@@ -278,24 +356,26 @@ class DisplayQueue {
       tracker_.idle_lock_.lock();
       // Reset idle frame count. We want that idle frames
       // are continuous to detect idle mode scenario.
+      uint32_t idle_frames = tracker_.idle_frames_;
       tracker_.idle_frames_ = 0;
 
+      IdlePolicy& policy = queue_->idle_policy_;
       tracker_.state_ &= ~FrameStateTracker::kPrepareComposition;
       if (tracker_.state_ & FrameStateTracker::kRenderIdleDisplay) {
+        // This frame was requested by us, don't let it count as an update.
         tracker_.state_ &= ~FrameStateTracker::kRenderIdleDisplay;
         tracker_.state_ |= FrameStateTracker::kTrackingFrames;
-        tracker_.revalidate_frames_counter_ = 0;
+        policy.EnteredIdleMode();
       } else if (tracker_.state_ & FrameStateTracker::kTrackingFrames) {
-        if (tracker_.revalidate_frames_counter_ > 3) {
+        policy.OnPresent(idle_frames, true);
+        if (policy.ShouldExitIdleMode()) {
           tracker_.state_ &= ~FrameStateTracker::kTrackingFrames;
           tracker_.state_ |= FrameStateTracker::kRevalidateLayers;
-          tracker_.revalidate_frames_counter_ = 0;
-        } else {
-          tracker_.revalidate_frames_counter_++;
+          policy.ExitedIdleMode();
         }
-      } else if (tracker_.state_ & FrameStateTracker::kRevalidateLayers) {
+      } else {
+        policy.OnPresent(idle_frames, false);
         tracker_.state_ &= ~FrameStateTracker::kRevalidateLayers;
-        tracker_.revalidate_frames_counter_ = 0;
       }
 
       tracker_.total_planes_ = queue_->previous_plane_state_.size();
@@ -347,8 +427,12 @@ class DisplayQueue {
                        int& re_validate_begin,
                        DisplayPlaneStateList& composition);
 
+  // Sets release fences of source_layers, fence is signalled once the
+  // frame has been flipped. In case of rendering_queued, offscreen
+  // rendering of the frame may still be running on the compositor thread.
   void SetReleaseFenceToLayers(int32_t fence,
-                               std::vector<HwcLayer*>& source_layers);
+                               std::vector<HwcLayer*>& source_layers,
+                               bool rendering_queued);
 
   void SetMediaEffectsState(bool apply_effects,
                             const std::vector<OverlayLayer>& layers,
@@ -362,18 +446,66 @@ class DisplayQueue {
 
   void HandleCommitFailure(DisplayPlaneStateList& current_composition_planes);
 
+  // Commit stage of pipelined mode. Waits for the previous frame to be
+  // flipped while the current one is being rendered and than for the
+  // rendering to finish. Returns false if rendering failed.
+  bool WaitForPipelinedCommit(bool render_layers);
+
+  // Called by commit_thread_ to wait for the queued frame to be rendered
+  // and the previous one to be flipped.
+  bool WaitForQueuedFrame();
+
+  // Called by commit_thread_ to get the time at which the queued frame
+  // should be committed or -1 if it should be committed right away.
+  int64_t GetQueuedFrameCommitTime();
+
+  // Called by commit_thread_ to commit the queued frame.
+  void CommitQueuedFrame(bool rendered);
+
+  // Called by commit_thread_ once it is done with the queued frame. Waits
+  // for the committed frame to be flipped and signals the release fences
+  // handed out for it.
+  void SignalQueuedFrameRelease();
+
+  // Signals release fences of a dropped frame which haven't been taken
+  // over by a frame queued after it.
+  void SignalDroppedFrameRelease();
+
+  // Waits for commit_thread_ to be done with the queued frame or drops it
+  // in case drop is true and the frame is still waiting for its vblank.
+  // Needs to be called before changing any state used by the queued
+  // frame. Returns false if the frame didn't reach the display.
+  bool RetireQueuedFrame(bool drop);
+
+  // Returns time at which work taking margin needs to start to make the
+  // vblank closest to target, or the next vblank if target is -1. Returns
+  // -1 if vblank time can't be predicted.
+  int64_t GetLatchTime(int64_t target, MarginEstimator& margin);
+
+  // Holds the client thread till validation and composition of a frame
+  // to be shown at target need to start.
+  void WaitForLatchTime(int64_t target);
+
   void InitializeOverlayLayers(std::vector<HwcLayer*>& source_layers,
                                bool handle_constraints,
                                std::vector<OverlayLayer>& layers,
                                bool& has_video_layer, bool& has_cursor_layer,
-                               int& re_validate_begin, bool& idle_frame);
+                               int& re_validate_begin, int& dirty_begin,
+                               bool& idle_frame);
 
+  // Layers from re_validate_begin onwards are assigned to planes again.
+  // Layers below it are kept on their planes, dirty_begin is the first of
+  // these with changes which need its plane to be re-tested.
   bool AssignAndCommitPlanes(std::vector<OverlayLayer>& layers,
                              std::vector<HwcLayer*>* source_layers,
                              bool validate_layers, int re_validate_begin,
-                             bool setMediaEffect, int32_t* retire_fence,
+                             int dirty_begin, bool setMediaEffect,
+                             int32_t* retire_fence,
                              ScopedStateTracker* tracker);
 
+  // Releases per frame storage, keeping it allocated for the next frame.
+  void RecycleFrameStorage();
+
   Compositor compositor_;
   uint32_t gpu_fd_;
   uint32_t brightness_;
@@ -381,14 +513,37 @@ class DisplayQueue {
   HWCColorTransform color_transform_hint_;
   uint32_t contrast_;
   int32_t kms_fence_ = 0;
+  uint32_t pipeline_depth_ = 1;
+  bool mailbox_ = false;
+  uint32_t presented_frames_ = 0;
+  uint32_t coalesced_frames_ = 0;
+  TimingHistogram stage_timings_[static_cast<uint32_t>(
+      HWCFrameStage::kNumFrameStages)];
   struct gamma_colors gamma_;
   struct canvas_color_comps canvas_;
   std::unique_ptr<VblankEventHandler> vblank_handler_;
+  // Signalled by commit_thread_ once queued frames have been flipped, so
+  // that QueueUpdate doesn't need to wait for the commit fence with
+  // explicit sync. Needs to outlive commit_thread_.
+  SyncTimeline release_timeline_;
+  std::unique_ptr<DisplayCommitThread> commit_thread_;
+  QueuedFrame queued_frame_;
+  // Commit fence and release point of the frame last committed by
+  // commit_thread_, only used by it.
+  int32_t release_flip_fence_ = -1;
+  uint32_t release_flip_point_ = 0;
+  // Release point of the last dropped frame. Points of release_timeline_
+  // only move forward, so it's signalled along with the point of the
+  // frame replacing it once that one has been flipped. Till then the
+  // frame before is still on screen.
+  uint32_t dropped_release_point_ = 0;
   std::unique_ptr<DisplayPlaneManager> display_plane_manager_;
   std::unique_ptr<ResourceManager> resource_manager_;
   std::vector<OverlayLayer> in_flight_layers_;
   DisplayPlaneStateList previous_plane_state_;
   FrameStateTracker idle_tracker_;
+  // Protected by idle_tracker_.idle_lock_.
+  IdlePolicy idle_policy_;
   ScalingTracker scaling_tracker_;
   // shared_ptr since we need to use this outside of the thread lock (to
   // actually call the hook) and we don't want the memory freed until we're
@@ -420,6 +575,21 @@ class DisplayQueue {
   // frame.
   std::vector<NativeSurface*> surfaces_not_inuse_;
   std::vector<HwcLayer*>* source_layers_ = NULL;
+  // Per frame storage reused by QueueUpdate and PresentClonedCommit, these
+  // are swapped with in_flight_layers_, previous_plane_state_ and
+  // surfaces_not_inuse_ every frame.
+  FrameArena frame_arena_;
+  std::vector<OverlayLayer> frame_layers_;
+  DisplayPlaneStateList frame_planes_;
+  std::vector<NativeSurface*> frame_surfaces_;
+  int64_t target_present_time_ = -1;
+  // Time needed from QueueUpdate till the frame has been committed, not
+  // counting waits for the previous flip.
+  MarginEstimator frame_margin_;
+  // Total time spent in HWCFrameStage::kFenceWait.
+  std::atomic<int64_t> fence_wait_{0};
+  // Time needed by commit_thread_ to commit a frame.
+  MarginEstimator commit_margin_;
 };
 
 }  // namespace hwcomposer
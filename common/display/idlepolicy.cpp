@@ -0,0 +1,127 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "idlepolicy.h"
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+static const uint32_t kIntervalShift = 4;
+// Weight of a new sample in the moving average.
+static const int32_t kAverageWeight = 8;
+// Display is idle once it missed this many of its usual updates.
+static const uint32_t kIdleFactor = 4;
+static const uint32_t kDefaultMinIdleFrames = 60;
+static const uint32_t kDefaultMaxIdleFrames = 250;
+static const uint32_t kDefaultExitFrames = 5;
+
+IdlePolicy::IdlePolicy()
+    : min_idle_frames_(kDefaultMinIdleFrames),
+      max_idle_frames_(kDefaultMaxIdleFrames),
+      exit_frames_(kDefaultExitFrames) {
+}
+
+void IdlePolicy::OnPresent(uint32_t vblanks, bool in_idle_mode) {
+  if (vblanks > max_idle_frames_)
+    vblanks = max_idle_frames_;
+
+  if (in_idle_mode) {
+    // Updates coming in slower than the idle threshold don't make the
+    // display busy, stay in single plane mode for these.
+    if (vblanks < GetIdleThreshold()) {
+      busy_updates_++;
+    } else {
+      busy_updates_ = 0;
+    }
+  }
+
+  int32_t sample = vblanks << kIntervalShift;
+  if (!has_samples_) {
+    average_interval_ = sample;
+    has_samples_ = true;
+    return;
+  }
+
+  int32_t average = average_interval_;
+  average_interval_ = average + (sample - average) / kAverageWeight;
+}
+
+uint32_t IdlePolicy::GetIdleThreshold() const {
+  if (!has_samples_)
+    return max_idle_frames_;
+
+  uint32_t threshold =
+      ((average_interval_ * kIdleFactor) + (1 << kIntervalShift) - 1) >>
+      kIntervalShift;
+  if (threshold < min_idle_frames_)
+    return min_idle_frames_;
+
+  if (threshold > max_idle_frames_)
+    return max_idle_frames_;
+
+  return threshold;
+}
+
+bool IdlePolicy::ShouldExitIdleMode() const {
+  return busy_updates_ >= exit_frames_;
+}
+
+void IdlePolicy::EnteredIdleMode() {
+  busy_updates_ = 0;
+  enter_count_++;
+  IIDLEPOLICYTRACE(
+      "IdlePolicy: Entered idle mode. Threshold: %d Enter: %d Exit: %d",
+      GetIdleThreshold(), enter_count_, exit_count_);
+}
+
+void IdlePolicy::ExitedIdleMode() {
+  busy_updates_ = 0;
+  exit_count_++;
+  IIDLEPOLICYTRACE(
+      "IdlePolicy: Exited idle mode. Idle vblanks: %llu Enter: %d Exit: %d",
+      (unsigned long long)idle_mode_vblanks_, enter_count_, exit_count_);
+}
+
+void IdlePolicy::AddIdleModeVblank() {
+  idle_mode_vblanks_++;
+}
+
+void IdlePolicy::SetHysteresis(uint32_t min_idle_frames,
+                               uint32_t max_idle_frames, uint32_t exit_frames) {
+  if (min_idle_frames)
+    min_idle_frames_ = min_idle_frames;
+
+  if (max_idle_frames)
+    max_idle_frames_ = max_idle_frames;
+
+  if (exit_frames)
+    exit_frames_ = exit_frames;
+
+  if (min_idle_frames_ > max_idle_frames_)
+    min_idle_frames_ = max_idle_frames_;
+
+  IIDLEPOLICYTRACE("IdlePolicy: Hysteresis min: %d max: %d exit: %d",
+                   min_idle_frames_, max_idle_frames_, exit_frames_);
+}
+
+void IdlePolicy::Reset() {
+  average_interval_ = 0;
+  busy_updates_ = 0;
+  has_samples_ = false;
+}
+
+}  // namespace hwcomposer
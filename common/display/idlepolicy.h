@@ -0,0 +1,96 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_IDLEPOLICY_H_
+#define COMMON_DISPLAY_IDLEPOLICY_H_
+
+#include <stdint.h>
+
+namespace hwcomposer {
+
+// Decides when a display is idle enough to be composited into a single
+// plane and when it is busy again and layers need to be re-validated.
+// Learns the update cadence of the display as a moving average of the
+// number of vblanks between presents. Displays updating at a steady rate
+// are considered idle after a few missed updates, while displays which
+// are updated sporadically need to stay idle for longer. The threshold
+// is kept between min_idle_frames and max_idle_frames.
+//
+// IdlePolicy is not thread safe, DisplayQueue accesses it with
+// idle_lock_ held.
+class IdlePolicy {
+ public:
+  IdlePolicy();
+
+  // Needs to be called on every present with the number of vblanks since
+  // the previous one. in_idle_mode is true if the display is currently
+  // composited into a single plane.
+  void OnPresent(uint32_t vblanks, bool in_idle_mode);
+
+  // Returns number of vblanks without any update after which the display
+  // is considered idle.
+  uint32_t GetIdleThreshold() const;
+
+  // Returns true if display has been updated often enough since entering
+  // idle mode that layers should be re-validated.
+  bool ShouldExitIdleMode() const;
+
+  // Called when the display enters or leaves the single plane mode.
+  void EnteredIdleMode();
+  void ExitedIdleMode();
+
+  // Called on every vblank while in idle mode.
+  void AddIdleModeVblank();
+
+  // min_idle_frames and max_idle_frames clamp the learned idle threshold,
+  // passing the same value for both disables learning. exit_frames is the
+  // number of updates needed to leave idle mode. 0 keeps the current
+  // value.
+  void SetHysteresis(uint32_t min_idle_frames, uint32_t max_idle_frames,
+                     uint32_t exit_frames);
+
+  // Forgets the learned cadence.
+  void Reset();
+
+  uint32_t GetEnterCount() const {
+    return enter_count_;
+  }
+
+  uint32_t GetExitCount() const {
+    return exit_count_;
+  }
+
+  uint64_t GetIdleModeVblanks() const {
+    return idle_mode_vblanks_;
+  }
+
+ private:
+  // Average interval is stored in fixed point with 4 fractional bits.
+  uint32_t average_interval_ = 0;
+  uint32_t min_idle_frames_;
+  uint32_t max_idle_frames_;
+  uint32_t exit_frames_;
+  // Number of updates which came at a busy cadence since entering idle
+  // mode.
+  uint32_t busy_updates_ = 0;
+  uint32_t enter_count_ = 0;
+  uint32_t exit_count_ = 0;
+  uint64_t idle_mode_vblanks_ = 0;
+  bool has_samples_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_IDLEPOLICY_H_
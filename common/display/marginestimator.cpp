@@ -0,0 +1,75 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "marginestimator.h"
+
+namespace hwcomposer {
+
+// Same weights as used for estimating round trip time in TCP, 1/8 for
+// the average and 1/4 for the deviation.
+static const int64_t kAverageWeight = 8;
+static const int64_t kDeviationWeight = 4;
+static const uint32_t kDefaultDeviationFactor = 4;
+static const int64_t kDefaultSlack = 500 * 1000;
+
+MarginEstimator::MarginEstimator(int64_t initial_margin)
+    : initial_margin_(initial_margin),
+      slack_(kDefaultSlack),
+      deviation_factor_(kDefaultDeviationFactor) {
+}
+
+void MarginEstimator::AddSample(int64_t duration) {
+  if (duration < 0)
+    return;
+
+  ScopedSpinLock lock(lock_);
+  if (!has_samples_) {
+    average_ = duration;
+    deviation_ = duration / 2;
+    has_samples_ = true;
+    return;
+  }
+
+  int64_t error = duration - average_;
+  average_ += error / kAverageWeight;
+  if (error < 0)
+    error = -error;
+
+  deviation_ += (error - deviation_) / kDeviationWeight;
+}
+
+int64_t MarginEstimator::GetMargin() {
+  ScopedSpinLock lock(lock_);
+  if (!has_samples_)
+    return initial_margin_;
+
+  return average_ + deviation_factor_ * deviation_ + slack_;
+}
+
+void MarginEstimator::SetTuning(uint32_t deviation_factor, int64_t slack) {
+  ScopedSpinLock lock(lock_);
+  deviation_factor_ = deviation_factor;
+  slack_ = slack;
+}
+
+void MarginEstimator::Reset() {
+  ScopedSpinLock lock(lock_);
+  average_ = 0;
+  deviation_ = 0;
+  has_samples_ = false;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,56 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_MARGINESTIMATOR_H_
+#define COMMON_DISPLAY_MARGINESTIMATOR_H_
+
+#include <stdint.h>
+
+#include <spinlock.h>
+
+namespace hwcomposer {
+
+// Learns how long before a vblank some work needs to be started to finish
+// in time. Keeps running averages of measured durations and their mean
+// deviation, the margin is:
+//   average + deviation_factor * deviation + slack.
+class MarginEstimator {
+ public:
+  // initial_margin is used till the first duration has been measured.
+  explicit MarginEstimator(int64_t initial_margin);
+
+  // Adds a measured duration in nanoseconds.
+  void AddSample(int64_t duration);
+
+  // Returns margin in nanoseconds.
+  int64_t GetMargin();
+
+  void SetTuning(uint32_t deviation_factor, int64_t slack);
+
+  void Reset();
+
+ private:
+  SpinLock lock_;
+  int64_t initial_margin_;
+  int64_t average_ = 0;
+  int64_t deviation_ = 0;
+  int64_t slack_;
+  uint32_t deviation_factor_;
+  bool has_samples_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_MARGINESTIMATOR_H_
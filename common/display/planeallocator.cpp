@@ -0,0 +1,128 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "planeallocator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "hwcutils.h"
+#include "planecostmodel.h"
+
+namespace hwcomposer {
+
+static const uint64_t kInvalidCost = std::numeric_limits<uint64_t>::max();
+// Even groups of static layers are assumed to be blended again once in a
+// while, i.e. when a layer is added or moved.
+static const uint32_t kMinGroupUpdateCount =
+    PlaneAllocator::kUpdateHistory / 4;
+static const uint32_t kMaxPlanes = 64;
+
+PlaneAllocator::PlaneAllocator(const PlaneCostModel* cost_model)
+    : cost_model_(cost_model) {
+}
+
+bool PlaneAllocator::Allocate(const std::vector<LayerInfo>& layers,
+                              uint32_t num_planes,
+                              std::vector<size_t>& group_sizes) {
+  group_sizes.clear();
+  size_t size = layers.size();
+  if (size == 0)
+    return true;
+
+  num_planes = std::min(num_planes, kMaxPlanes);
+  if (num_planes == 0)
+    return false;
+
+  size_t stride = size + 1;
+  costs_.assign(stride * (num_planes + 1), kInvalidCost);
+  last_group_.assign(stride * (num_planes + 1), 0);
+  costs_[0] = 0;
+
+  for (uint32_t plane = 0; plane < num_planes; plane++) {
+    const uint64_t* previous = &costs_[plane * stride];
+    uint64_t* current = &costs_[(plane + 1) * stride];
+    size_t* current_group = &last_group_[(plane + 1) * stride];
+    for (size_t end = 1; end <= size; end++) {
+      // Grow the group [begin, end) downwards, keeping track of the
+      // blending cost and area it covers.
+      uint64_t gpu_cost = 0;
+      uint32_t update_count = kMinGroupUpdateCount;
+      HwcRect<int> frame = layers[end - 1].display_frame_;
+      for (size_t begin = end; begin > 0; begin--) {
+        const LayerInfo& layer = layers[begin - 1];
+        size_t group_size = end - begin + 1;
+        if (group_size > 1) {
+          // Layers needing a plane of their own can't be grouped.
+          if (layer.separate_ || layers[end - 1].separate_ ||
+              layer.video_ != layers[end - 1].video_)
+            break;
+
+          CalculateRect(layer.display_frame_, frame);
+        }
+
+        gpu_cost += layer.gpu_cost_;
+        update_count = std::max(update_count, layer.update_count_);
+        if (previous[begin - 1] == kInvalidCost)
+          continue;
+
+        uint64_t group_cost;
+        if (group_size == 1 && (layer.plane_mask_ & (1ULL << plane))) {
+          group_cost = layer.scanout_cost_;
+        } else {
+          // Layers of a group usually change together, so the group is
+          // blended about as often as its most frequently updated layer.
+          group_cost = cost_model_->GetOffScreenScanoutCost(frame) +
+                       gpu_cost * update_count / kUpdateHistory;
+        }
+
+        uint64_t cost = previous[begin - 1] + group_cost;
+        if (cost < current[end]) {
+          current[end] = cost;
+          current_group[end] = group_size;
+        }
+      }
+    }
+  }
+
+  // Pick the cheapest solution covering all layers, whatever the number
+  // of planes.
+  uint32_t planes = 0;
+  uint64_t best = kInvalidCost;
+  for (uint32_t plane = 1; plane <= num_planes; plane++) {
+    uint64_t cost = costs_[plane * stride + size];
+    if (cost < best) {
+      best = cost;
+      planes = plane;
+    }
+  }
+
+  if (best == kInvalidCost)
+    return false;
+
+  size_t end = size;
+  while (planes > 0) {
+    size_t group_size = last_group_[planes * stride + end];
+    group_sizes.emplace_back(group_size);
+    end -= group_size;
+    planes--;
+  }
+
+  std::reverse(group_sizes.begin(), group_sizes.end());
+  return true;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,85 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PLANEALLOCATOR_H_
+#define COMMON_DISPLAY_PLANEALLOCATOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+
+class PlaneCostModel;
+
+// Splits layers, ordered by z-order, into contiguous groups with one plane
+// per group, so that the total cost is the lowest possible. A group of a
+// single layer is scanned out directly if its plane supports it, larger
+// groups are blended by the GPU into an offscreen surface. Keeping groups
+// contiguous keeps the z-order intact.
+//
+// The allocator only works on the data passed in, so it can be run
+// against made up layers and planes with any format and scaler
+// capabilities.
+class PlaneAllocator {
+ public:
+  // Number of frames update counts are taken over.
+  static const uint32_t kUpdateHistory = 32;
+
+  struct LayerInfo {
+    HwcRect<int> display_frame_;
+    // Cost of scanning out the layer on a plane of its own.
+    uint64_t scanout_cost_ = 0;
+    // Cost of blending the layer with the GPU.
+    uint64_t gpu_cost_ = 0;
+    // Bit i is set if the i-th plane can scan out the layer.
+    uint64_t plane_mask_ = 0;
+    // In how many of the last 32 frames layer content changed. A group
+    // needs to be blended again whenever one of its layers changes, so
+    // frequently updated layers are better off on a plane of their own
+    // while static ones are cheap to group.
+    uint32_t update_count_ = kUpdateHistory;
+    // Layer needs a plane of its own, i.e. protected video or a video
+    // stream picked to be scanned out directly.
+    bool separate_ = false;
+    // Video layers are only grouped with other video layers, so that the
+    // media pipeline doesn't have to blend UI layers.
+    bool video_ = false;
+  };
+
+  explicit PlaneAllocator(const PlaneCostModel* cost_model);
+  PlaneAllocator(const PlaneAllocator& rhs) = delete;
+  PlaneAllocator& operator=(const PlaneAllocator& rhs) = delete;
+
+  // Groups layers using at most num_planes planes, at most 64. Returns
+  // false if there is no valid grouping. Otherwise group_sizes holds the
+  // number of layers of each group, bottom most first.
+  bool Allocate(const std::vector<LayerInfo>& layers, uint32_t num_planes,
+                std::vector<size_t>& group_sizes);
+
+ private:
+  const PlaneCostModel* cost_model_;
+  // Lowest cost for the first i layers using k planes, at
+  // k * (layers + 1) + i, and size of the last group used for it. Kept
+  // around to avoid allocations.
+  std::vector<uint64_t> costs_;
+  std::vector<size_t> last_group_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PLANEALLOCATOR_H_
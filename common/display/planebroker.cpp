@@ -0,0 +1,318 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "planebroker.h"
+
+#include <algorithm>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+// Pipes are tracked in a 32 bit mask per plane.
+static const uint32_t kMaxPipes = 32;
+
+void PlaneBroker::SetCallback(PlaneBrokerCallback* callback) {
+  ScopedSpinLock lock(lock_);
+  callback_ = callback;
+}
+
+void PlaneBroker::AddPlane(uint32_t pipe, uint32_t plane_id, bool pinned) {
+  if (pipe >= kMaxPipes)
+    return;
+
+  std::vector<uint32_t> refresh;
+  lock_.lock();
+  GetPipe(pipe);
+  PlaneInfo* plane = GetPlane(plane_id);
+  if (!plane) {
+    planes_.emplace_back();
+    plane = &planes_.back();
+    plane->id_ = plane_id;
+    plane->pipes_ = 0;
+    plane->home_ = pipe;
+    plane->owner_ = pipe;
+  }
+
+  plane->pipes_ |= 1u << pipe;
+  if (pinned && !plane->pinned_) {
+    plane->pinned_ = true;
+    plane->home_ = pipe;
+    if (plane->owner_ != pipe && plane->next_owner_ != pipe)
+      RequestPlane(*plane, pipe, refresh);
+  }
+
+  IPLANERESERVEDTRACE("PlaneBroker plane %d registered by pipe %d owner %d",
+                      plane_id, pipe, plane->owner_);
+  lock_.unlock();
+  Refresh(refresh);
+}
+
+void PlaneBroker::RemovePlane(uint32_t pipe, uint32_t plane_id) {
+  if (pipe >= kMaxPipes)
+    return;
+
+  ScopedSpinLock lock(lock_);
+  PlaneInfo* plane = GetPlane(plane_id);
+  if (!plane)
+    return;
+
+  plane->pipes_ &= ~(1u << pipe);
+  if (plane->pipes_ == 0) {
+    planes_.erase(planes_.begin() + (plane - planes_.data()));
+    return;
+  }
+
+  if (plane->next_owner_ == pipe)
+    plane->next_owner_ = kNoPipe;
+
+  if (plane->home_ == pipe) {
+    plane->pinned_ = false;
+    for (uint32_t i = 0; i < kMaxPipes; i++) {
+      if (plane->pipes_ & (1u << i)) {
+        plane->home_ = i;
+        break;
+      }
+    }
+  }
+
+  if (plane->owner_ == pipe) {
+    if (plane->next_owner_ == kNoPipe)
+      plane->next_owner_ = plane->home_;
+
+    CompleteHandOff(*plane);
+  }
+}
+
+bool PlaneBroker::IsOwner(uint32_t pipe, uint32_t plane_id) const {
+  ScopedSpinLock lock(lock_);
+  const PlaneInfo* plane = GetPlane(plane_id);
+  if (!plane)
+    return true;
+
+  return plane->owner_ == pipe && plane->next_owner_ == kNoPipe;
+}
+
+uint32_t PlaneBroker::GetGeneration(uint32_t pipe) const {
+  ScopedSpinLock lock(lock_);
+  if (pipe >= pipes_.size())
+    return 0;
+
+  return pipes_.at(pipe).generation_;
+}
+
+void PlaneBroker::BeginFrame(uint32_t pipe, uint32_t demand) {
+  if (pipe >= kMaxPipes)
+    return;
+
+  std::vector<uint32_t> refresh;
+  lock_.lock();
+  PipeInfo& info = GetPipe(pipe);
+  info.demand_ = demand;
+  info.active_ = true;
+  // Planes not on screen can be handed over before pipe picks planes.
+  for (PlaneInfo& plane : planes_) {
+    if (plane.owner_ == pipe && plane.next_owner_ != kNoPipe &&
+        !plane.in_use_)
+      CompleteHandOff(plane);
+  }
+
+  Balance(refresh);
+  info.in_frame_ = true;
+  lock_.unlock();
+  Refresh(refresh);
+}
+
+void PlaneBroker::FrameCommitted(uint32_t pipe,
+                                 const std::vector<uint32_t>& planes) {
+  if (pipe >= kMaxPipes)
+    return;
+
+  std::vector<uint32_t> refresh;
+  lock_.lock();
+  PipeInfo& info = GetPipe(pipe);
+  info.active_ = true;
+  info.in_frame_ = false;
+  for (PlaneInfo& plane : planes_) {
+    if (plane.owner_ != pipe)
+      continue;
+
+    plane.in_use_ =
+        std::find(planes.begin(), planes.end(), plane.id_) != planes.end();
+    // The commit disabled the plane on this pipe.
+    if (plane.next_owner_ != kNoPipe && !plane.in_use_)
+      CompleteHandOff(plane);
+  }
+
+  Balance(refresh);
+  lock_.unlock();
+  Refresh(refresh);
+}
+
+void PlaneBroker::DisablePipe(uint32_t pipe) {
+  if (pipe >= kMaxPipes)
+    return;
+
+  std::vector<uint32_t> refresh;
+  lock_.lock();
+  PipeInfo& info = GetPipe(pipe);
+  info.active_ = false;
+  info.in_frame_ = false;
+  info.demand_ = 0;
+  for (PlaneInfo& plane : planes_) {
+    if (plane.owner_ != pipe)
+      continue;
+
+    plane.in_use_ = false;
+    if (plane.next_owner_ != kNoPipe)
+      CompleteHandOff(plane);
+  }
+
+  Balance(refresh);
+  lock_.unlock();
+  Refresh(refresh);
+}
+
+PlaneBroker::PlaneInfo* PlaneBroker::GetPlane(uint32_t plane_id) {
+  for (PlaneInfo& plane : planes_) {
+    if (plane.id_ == plane_id)
+      return &plane;
+  }
+
+  return NULL;
+}
+
+const PlaneBroker::PlaneInfo* PlaneBroker::GetPlane(uint32_t plane_id) const {
+  for (const PlaneInfo& plane : planes_) {
+    if (plane.id_ == plane_id)
+      return &plane;
+  }
+
+  return NULL;
+}
+
+PlaneBroker::PipeInfo& PlaneBroker::GetPipe(uint32_t pipe) {
+  if (pipe >= pipes_.size())
+    pipes_.resize(pipe + 1);
+
+  return pipes_.at(pipe);
+}
+
+uint32_t PlaneBroker::GetPlaneCount(uint32_t pipe) const {
+  uint32_t count = 0;
+  for (const PlaneInfo& plane : planes_) {
+    if (plane.pinned_)
+      continue;
+
+    if (plane.next_owner_ == pipe ||
+        (plane.owner_ == pipe && plane.next_owner_ == kNoPipe))
+      count++;
+  }
+
+  return count;
+}
+
+bool PlaneBroker::CanLend(uint32_t pipe) const {
+  const PipeInfo& info = pipes_.at(pipe);
+  if (!info.active_)
+    return true;
+
+  return GetPlaneCount(pipe) > info.demand_;
+}
+
+void PlaneBroker::RequestPlane(PlaneInfo& plane, uint32_t pipe,
+                               std::vector<uint32_t>& refresh) {
+  IPLANERESERVEDTRACE("PlaneBroker handing plane %d from pipe %d to pipe %d",
+                      plane.id_, plane.owner_, pipe);
+  plane.next_owner_ = pipe;
+  PipeInfo& owner = GetPipe(plane.owner_);
+  owner.generation_++;
+  if (!owner.active_ || (!plane.in_use_ && !owner.in_frame_)) {
+    CompleteHandOff(plane);
+    return;
+  }
+
+  // Owner needs to commit a frame without the plane first.
+  if (std::find(refresh.begin(), refresh.end(), plane.owner_) ==
+      refresh.end())
+    refresh.emplace_back(plane.owner_);
+}
+
+void PlaneBroker::CompleteHandOff(PlaneInfo& plane) {
+  IPLANERESERVEDTRACE("PlaneBroker plane %d moved from pipe %d to pipe %d",
+                      plane.id_, plane.owner_, plane.next_owner_);
+  GetPipe(plane.owner_).generation_++;
+  plane.owner_ = plane.next_owner_;
+  plane.next_owner_ = kNoPipe;
+  plane.in_use_ = false;
+  GetPipe(plane.owner_).generation_++;
+}
+
+void PlaneBroker::Balance(std::vector<uint32_t>& refresh) {
+  uint32_t pipes = pipes_.size();
+  for (uint32_t pipe = 0; pipe < pipes; pipe++) {
+    const PipeInfo& info = pipes_.at(pipe);
+    if (!info.active_)
+      continue;
+
+    uint32_t count = GetPlaneCount(pipe);
+    if (count >= info.demand_)
+      continue;
+
+    // Take back planes lent to other pipes first, then borrow spare
+    // planes of idle pipes.
+    for (PlaneInfo& plane : planes_) {
+      if (count >= info.demand_)
+        break;
+
+      if (plane.home_ == pipe && plane.owner_ != pipe &&
+          plane.next_owner_ == kNoPipe) {
+        RequestPlane(plane, pipe, refresh);
+        count++;
+      }
+    }
+
+    for (PlaneInfo& plane : planes_) {
+      if (count >= info.demand_)
+        break;
+
+      if (plane.pinned_ || !(plane.pipes_ & (1u << pipe)) ||
+          plane.owner_ == pipe || plane.next_owner_ != kNoPipe ||
+          !CanLend(plane.owner_))
+        continue;
+
+      RequestPlane(plane, pipe, refresh);
+      count++;
+    }
+  }
+}
+
+void PlaneBroker::Refresh(const std::vector<uint32_t>& refresh) {
+  if (refresh.empty())
+    return;
+
+  lock_.lock();
+  PlaneBrokerCallback* callback = callback_;
+  lock_.unlock();
+  if (!callback)
+    return;
+
+  for (uint32_t pipe : refresh) {
+    callback->Callback(pipe);
+  }
+}
+
+}  // namespace hwcomposer
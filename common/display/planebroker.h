@@ -0,0 +1,141 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PLANEBROKER_H_
+#define COMMON_DISPLAY_PLANEBROKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <spinlock.h>
+
+namespace hwcomposer {
+
+class PlaneBrokerCallback {
+ public:
+  virtual ~PlaneBrokerCallback() {
+  }
+
+  // Asks pipe to compose a new frame, so that it gives up planes which
+  // have been handed to another pipe.
+  virtual void Callback(uint32_t pipe) = 0;
+};
+
+// Shares planes which can be used with more than one pipe between the
+// displays using them. Every plane has one owner at a time, which is
+// the only pipe allowed to use it. Idle displays and displays showing a
+// single layer lend their spare planes to displays having more layers
+// than planes, and take them back once they need them again.
+//
+// Handing a plane over is transactional: the new owner only gets it
+// once a commit of the current owner without the plane succeeded, i.e.
+// the plane has been disabled on the old pipe. Planes which aren't used
+// by the owner, or whose owner has been disabled, are handed over right
+// away.
+//
+// The broker only deals with plane ids and pipes, displays keep track of
+// their planes themselves, see DisplayPlaneManager.
+class PlaneBroker {
+ public:
+  PlaneBroker() = default;
+  PlaneBroker(const PlaneBroker& rhs) = delete;
+  PlaneBroker& operator=(const PlaneBroker& rhs) = delete;
+
+  void SetCallback(PlaneBrokerCallback* callback);
+
+  // Registers plane_id as usable with pipe. The first pipe registering a
+  // plane owns it. A pinned plane, i.e. the primary plane of pipe, is
+  // always owned by pipe and never lent.
+  void AddPlane(uint32_t pipe, uint32_t plane_id, bool pinned);
+
+  // Plane can't be used with pipe anymore. Planes owned by pipe are
+  // handed to another pipe using them, if any.
+  void RemovePlane(uint32_t pipe, uint32_t plane_id);
+
+  // Returns true in case pipe may use plane_id with its next frame.
+  // Planes which haven't been registered belong to everyone.
+  bool IsOwner(uint32_t pipe, uint32_t plane_id) const;
+
+  // Returns a counter which changes whenever the planes owned by pipe
+  // change.
+  uint32_t GetGeneration(uint32_t pipe) const;
+
+  // To be called before pipe validates a frame. demand is the number of
+  // planes, besides pinned ones, pipe could make use of. Planes pipe has
+  // to give up and which are not on screen are handed over right away.
+  void BeginFrame(uint32_t pipe, uint32_t demand);
+
+  // To be called once pipe committed a frame using planes. Hands over
+  // planes pipe has given up and balances planes between pipes.
+  void FrameCommitted(uint32_t pipe, const std::vector<uint32_t>& planes);
+
+  // Pipe has been disabled, all of its planes are off.
+  void DisablePipe(uint32_t pipe);
+
+ private:
+  static const uint32_t kNoPipe = ~0u;
+
+  struct PlaneInfo {
+    uint32_t id_;
+    // Bit i is set if pipe i registered the plane.
+    uint32_t pipes_;
+    // Pipe which registered the plane first, it always gets it back.
+    uint32_t home_;
+    uint32_t owner_;
+    // Pipe the plane is being handed to.
+    uint32_t next_owner_ = kNoPipe;
+    // Plane is on screen with the last commit of its owner.
+    bool in_use_ = false;
+    bool pinned_ = false;
+  };
+
+  struct PipeInfo {
+    uint32_t demand_ = 0;
+    uint32_t generation_ = 0;
+    bool active_ = false;
+    // Pipe validated a frame which hasn't been committed yet, it might
+    // use any of its planes.
+    bool in_frame_ = false;
+  };
+
+  PlaneInfo* GetPlane(uint32_t plane_id);
+  const PlaneInfo* GetPlane(uint32_t plane_id) const;
+  PipeInfo& GetPipe(uint32_t pipe);
+
+  // Number of planes, besides pinned ones, pipe owns or is about to get.
+  uint32_t GetPlaneCount(uint32_t pipe) const;
+  // Returns true if pipe can give up a plane to a busy pipe.
+  bool CanLend(uint32_t pipe) const;
+
+  // Starts handing plane to pipe. Adds the current owner to refresh in
+  // case it needs to commit a frame first.
+  void RequestPlane(PlaneInfo& plane, uint32_t pipe,
+                    std::vector<uint32_t>& refresh);
+  void CompleteHandOff(PlaneInfo& plane);
+  // Finds planes for pipes having more layers than planes.
+  void Balance(std::vector<uint32_t>& refresh);
+  void Refresh(const std::vector<uint32_t>& refresh);
+
+  std::vector<PlaneInfo> planes_;
+  std::vector<PipeInfo> pipes_;
+  PlaneBrokerCallback* callback_ = NULL;
+  mutable SpinLock lock_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PLANEBROKER_H_
@@ -0,0 +1,158 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "planecostmodel.h"
+
+#include <drm_fourcc.h>
+
+#include <algorithm>
+
+#include "hwcutils.h"
+#include "overlaybuffer.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+// Weights per byte. Display engine fetches are cheapest, GPU accesses go
+// through the 3D pipeline and cost about twice as much.
+static const uint64_t kScanoutWeight = 1;
+static const uint64_t kGpuReadWeight = 2;
+static const uint64_t kGpuWriteWeight = 2;
+// Fixed cost of enabling a plane, equal to fetching a 128x128 ARGB
+// buffer.
+static const uint64_t kPlaneCost = 128 * 128 * 4;
+// Fixed cost of using a plane scaler, there are only two per pipe.
+static const uint64_t kScalerCost = 4 * kPlaneCost;
+// Offscreen surfaces are always 32 bits per pixel.
+static const uint64_t kOffScreenBytesPerPixel = 4;
+
+static uint64_t GetArea(const HwcRect<int>& rect) {
+  if (rect.empty())
+    return 0;
+
+  return static_cast<uint64_t>(rect.right - rect.left) *
+         static_cast<uint64_t>(rect.bottom - rect.top);
+}
+
+static uint64_t GetSourceBytes(const OverlayLayer& layer) {
+  uint64_t area = static_cast<uint64_t>(layer.GetSourceCropWidth()) *
+                  layer.GetSourceCropHeight();
+  OverlayBuffer* buffer = layer.GetBuffer();
+  uint32_t bpp = buffer ? GetBitsPerPixelForFormat(buffer->GetFormat()) : 32;
+  return area * bpp / 8;
+}
+
+static bool HasAlphaChannel(uint32_t format) {
+  switch (format) {
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_ARGB2101010:
+    case DRM_FORMAT_ABGR2101010:
+    case DRM_FORMAT_RGBA1010102:
+    case DRM_FORMAT_BGRA1010102:
+    case DRM_FORMAT_ARGB1555:
+    case DRM_FORMAT_ABGR1555:
+    case DRM_FORMAT_RGBA5551:
+    case DRM_FORMAT_BGRA5551:
+    case DRM_FORMAT_ARGB4444:
+    case DRM_FORMAT_ABGR4444:
+    case DRM_FORMAT_RGBA4444:
+    case DRM_FORMAT_BGRA4444:
+    case DRM_FORMAT_AYUV:
+      return true;
+    default:
+      break;
+  }
+
+  return false;
+}
+
+static bool IsOpaque(const OverlayLayer& layer) {
+  if (layer.GetBlending() == HWCBlending::kBlendingNone)
+    return true;
+
+  if (layer.GetAlpha() != 0xff)
+    return false;
+
+  OverlayBuffer* buffer = layer.GetBuffer();
+  return buffer && !HasAlphaChannel(buffer->GetFormat());
+}
+
+static bool IsScaled(const OverlayLayer& layer) {
+  uint32_t transform = layer.GetTransform();
+  bool rotated = transform & (kTransform90 | kTransform270);
+  uint32_t width = rotated ? layer.GetDisplayFrameHeight()
+                           : layer.GetDisplayFrameWidth();
+  uint32_t height = rotated ? layer.GetDisplayFrameWidth()
+                            : layer.GetDisplayFrameHeight();
+  return layer.GetSourceCropWidth() != width ||
+         layer.GetSourceCropHeight() != height;
+}
+
+uint64_t PlaneCostModel::GetScanoutCost(const OverlayLayer& layer) const {
+  // Display engine fetches the whole source crop, also when downscaling.
+  uint64_t cost = GetSourceBytes(layer) * kScanoutWeight + kPlaneCost;
+  if (IsScaled(layer))
+    cost += kScalerCost;
+
+  return cost;
+}
+
+uint64_t PlaneCostModel::GetGpuCompositionCost(
+    const OverlayLayer& layer) const {
+  uint64_t written =
+      GetArea(layer.GetDisplayFrame()) * kOffScreenBytesPerPixel;
+  uint64_t cost = written * kGpuWriteWeight;
+  // Solid colors don't need to be sampled.
+  if (!layer.IsSolidColor())
+    cost += GetSourceBytes(layer) * kGpuReadWeight;
+
+  // Blending reads the destination too.
+  if (!IsOpaque(layer))
+    cost += written * kGpuReadWeight;
+
+  return cost;
+}
+
+uint64_t PlaneCostModel::GetExpansionCost(
+    const HwcRect<int>& plane_frame, const HwcRect<int>& layer_frame) const {
+  HwcRect<int> expanded = plane_frame;
+  expanded.left = std::min(plane_frame.left, layer_frame.left);
+  expanded.top = std::min(plane_frame.top, layer_frame.top);
+  expanded.right = std::max(plane_frame.right, layer_frame.right);
+  expanded.bottom = std::max(plane_frame.bottom, layer_frame.bottom);
+
+  uint64_t added = (GetArea(expanded) - GetArea(plane_frame)) *
+                   kOffScreenBytesPerPixel;
+  return added * (kGpuWriteWeight + kScanoutWeight);
+}
+
+uint64_t PlaneCostModel::GetOffScreenScanoutCost(
+    const HwcRect<int>& frame) const {
+  return GetArea(frame) * kOffScreenBytesPerPixel * kScanoutWeight +
+         kPlaneCost;
+}
+
+bool PlaneCostModel::PreferGpuComposition(const HwcRect<int>& plane_frame,
+                                          const OverlayLayer& layer) const {
+  uint64_t gpu_cost = GetGpuCompositionCost(layer) +
+                      GetExpansionCost(plane_frame, layer.GetDisplayFrame());
+  return gpu_cost < GetScanoutCost(layer);
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,62 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PLANECOSTMODEL_H_
+#define COMMON_DISPLAY_PLANECOSTMODEL_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+
+struct OverlayLayer;
+
+// Estimates what it costs to show a layer on a plane of its own and to
+// blend it into an offscreen surface with the GPU. Costs are bytes of
+// memory traffic, weighted by how expensive the access is, plus fixed
+// costs for using a plane and its scaler. Plane costs cover power and the
+// chance that a later layer doesn't get a plane anymore.
+class PlaneCostModel {
+ public:
+  PlaneCostModel() = default;
+  PlaneCostModel(const PlaneCostModel& rhs) = delete;
+  PlaneCostModel& operator=(const PlaneCostModel& rhs) = delete;
+
+  // Cost of scanning out layer on a plane of its own.
+  uint64_t GetScanoutCost(const OverlayLayer& layer) const;
+
+  // Cost of blending layer into an offscreen surface with the GPU.
+  uint64_t GetGpuCompositionCost(const OverlayLayer& layer) const;
+
+  // Extra cost of growing an offscreen surface covering plane_frame
+  // to include layer_frame. Pixels added need to be cleared and scanned
+  // out.
+  uint64_t GetExpansionCost(const HwcRect<int>& plane_frame,
+                            const HwcRect<int>& layer_frame) const;
+
+  // Cost of scanning out an offscreen surface covering frame on a plane
+  // of its own.
+  uint64_t GetOffScreenScanoutCost(const HwcRect<int>& frame) const;
+
+  // Returns true if blending layer into the offscreen surface covering
+  // plane_frame is cheaper than scanning it out on a plane of its own.
+  bool PreferGpuComposition(const HwcRect<int>& plane_frame,
+                            const OverlayLayer& layer) const;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PLANECOSTMODEL_H_
@@ -0,0 +1,131 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "planevalidationcache.h"
+
+#include "displayplane.h"
+#include "hwctrace.h"
+#include "overlaybuffer.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+static inline void HashCombine(uint64_t &hash, uint64_t value) {
+  // 64 bit FNV-1a prime with an extra mix so that small integers
+  // (plane id's, z-order etc) spread over the whole key.
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  hash *= 0x100000001b3ULL;
+}
+
+template <typename T>
+static inline void HashRect(uint64_t &hash, const HwcRect<T> &rect) {
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.left)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.top)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.right)));
+  HashCombine(hash, static_cast<uint64_t>(static_cast<int64_t>(rect.bottom)));
+}
+
+PlaneValidationCache::PlaneValidationCache(size_t max_entries)
+    : max_entries_(max_entries) {
+}
+
+uint64_t PlaneValidationCache::GetSignature(
+    const DisplayPlaneStateList &composition) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  HashCombine(hash, composition.size());
+  for (const DisplayPlaneState &plane : composition) {
+    HashCombine(hash, plane.GetDisplayPlane()->id());
+    HashCombine(hash, plane.Scanout());
+    HashCombine(hash, plane.IsUsingPlaneScalar());
+    HashCombine(hash, static_cast<uint64_t>(plane.GetRotationType()));
+    HashCombine(hash, plane.GetDownScalingFactor());
+    HashRect(hash, plane.GetDisplayFrame());
+    HashRect(hash, plane.GetRotatedDisplayFrame());
+
+    const OverlayLayer *layer = plane.GetOverlayLayer();
+    if (!layer) {
+      HashCombine(hash, 0);
+      continue;
+    }
+
+    HashCombine(hash, layer->GetZorder());
+    HashCombine(hash, layer->GetAlpha());
+    HashCombine(hash, static_cast<uint64_t>(layer->GetBlending()));
+    HashCombine(hash, layer->GetMergedTransform());
+    HashCombine(hash, layer->GetPlaneTransform());
+    HashCombine(hash, layer->IsVideoLayer());
+    HashCombine(hash, layer->IsSolidColor());
+    HashRect(hash, layer->GetSourceCrop());
+    HashRect(hash, layer->GetDisplayFrame());
+
+    OverlayBuffer *buffer = layer->GetBuffer();
+    if (buffer) {
+      HashCombine(hash, buffer->GetFormat());
+      HashCombine(hash, buffer->GetTilingMode());
+      HashCombine(hash, buffer->GetWidth());
+      HashCombine(hash, buffer->GetHeight());
+    }
+  }
+
+  return hash;
+}
+
+bool PlaneValidationCache::Lookup(uint64_t signature, bool *passed) {
+  auto it = lookup_.find(signature);
+  if (it == lookup_.end()) {
+    misses_++;
+    IPLANECACHETRACE("PlaneValidationCache miss %llx hits: %u misses: %u",
+                     (unsigned long long)signature, hits_, misses_);
+    return false;
+  }
+
+  // Move entry to front as most recently used.
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *passed = it->second->passed_;
+  hits_++;
+  IPLANECACHETRACE("PlaneValidationCache hit %llx hits: %u misses: %u",
+                   (unsigned long long)signature, hits_, misses_);
+  return true;
+}
+
+void PlaneValidationCache::Insert(uint64_t signature, bool passed) {
+  auto it = lookup_.find(signature);
+  if (it != lookup_.end()) {
+    it->second->passed_ = passed;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+
+  if (entries_.size() >= max_entries_) {
+    lookup_.erase(entries_.back().signature_);
+    entries_.pop_back();
+  }
+
+  Entry entry;
+  entry.signature_ = signature;
+  entry.passed_ = passed;
+  entries_.push_front(entry);
+  lookup_[signature] = entries_.begin();
+}
+
+void PlaneValidationCache::Reset() {
+  IPLANECACHETRACE("PlaneValidationCache reset, %zu entries dropped",
+                   entries_.size());
+  EntryList().swap(entries_);
+  lookup_.clear();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,85 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PLANEVALIDATIONCACHE_H_
+#define COMMON_DISPLAY_PLANEVALIDATIONCACHE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+
+#include "displayplanestate.h"
+
+namespace hwcomposer {
+
+// LRU cache of test commit results. Entries are keyed by a signature of
+// the plane state list being tested, i.e. which plane every layer is
+// mapped to and all layer attributes which can influence the result of
+// a DRM_MODE_ATOMIC_TEST_ONLY commit (format, tiling, size, transform,
+// alpha and z-order). UI's usually cycle between a small set of layer
+// configurations, which lets us skip the test ioctl for all of them
+// once they have been validated.
+class PlaneValidationCache {
+ public:
+  explicit PlaneValidationCache(size_t max_entries = kDefaultMaxEntries);
+
+  // Returns signature of composition.
+  static uint64_t GetSignature(const DisplayPlaneStateList &composition);
+
+  // Returns true if result for signature has been cached. In that case
+  // passed is set to the cached result of the test commit.
+  bool Lookup(uint64_t signature, bool *passed);
+
+  // Stores result of a test commit for signature, evicting the least
+  // recently used entry if needed.
+  void Insert(uint64_t signature, bool passed);
+
+  // Drops all cached results. Needs to be called whenever plane
+  // configuration of the pipe changes or a commit unexpectedly fails.
+  void Reset();
+
+  uint32_t GetHits() const {
+    return hits_;
+  }
+
+  uint32_t GetMisses() const {
+    return misses_;
+  }
+
+  size_t GetSize() const {
+    return entries_.size();
+  }
+
+ private:
+  static const size_t kDefaultMaxEntries = 32;
+
+  struct Entry {
+    uint64_t signature_;
+    bool passed_;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  EntryList entries_;
+  std::unordered_map<uint64_t, EntryList::iterator> lookup_;
+  size_t max_entries_;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PLANEVALIDATIONCACHE_H_
@@ -0,0 +1,128 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "planevalidationstrategy.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "hwctrace.h"
+#include "planevalidationcache.h"
+
+namespace hwcomposer {
+
+PlaneValidationStrategy::PlaneValidationStrategy(
+    DisplayPlaneHandler *plane_handler, PlaneValidationCache *cache)
+    : plane_handler_(plane_handler), cache_(cache) {
+}
+
+PlaneValidationStrategy::~PlaneValidationStrategy() {
+}
+
+bool PlaneValidationStrategy::TestCommit(
+    const DisplayPlaneStateList &composition) const {
+  if (!cache_)
+    return plane_handler_->TestCommit(composition);
+
+  uint64_t signature = PlaneValidationCache::GetSignature(composition);
+  bool passed = false;
+  if (cache_->Lookup(signature, &passed))
+    return passed;
+
+  passed = plane_handler_->TestCommit(composition);
+  cache_->Insert(signature, passed);
+  return passed;
+}
+
+bool PlaneValidationStrategy::TestCommitPrefix(
+    DisplayPlaneStateList &composition, size_t count) {
+  if (count >= composition.size())
+    return TestCommit(composition);
+
+  // Temporarily move out planes after count, DisplayPlaneState is
+  // cheap to move as all its state is shared.
+  DisplayPlaneStateList tail;
+  tail.reserve(composition.size() - count);
+  std::move(composition.begin() + count, composition.end(),
+            std::back_inserter(tail));
+  composition.erase(composition.begin() + count, composition.end());
+
+  bool passed = TestCommit(composition);
+
+  std::move(tail.begin(), tail.end(), std::back_inserter(composition));
+  return passed;
+}
+
+IncrementalPlaneValidationStrategy::IncrementalPlaneValidationStrategy(
+    DisplayPlaneHandler *plane_handler, PlaneValidationCache *cache)
+    : PlaneValidationStrategy(plane_handler, cache) {
+}
+
+bool IncrementalPlaneValidationStrategy::ValidatePlane(
+    const DisplayPlaneStateList &composition) {
+  return TestCommit(composition);
+}
+
+int IncrementalPlaneValidationStrategy::FindFailingPlane(
+    DisplayPlaneStateList &composition, size_t begin) {
+  HWC_UNUSED(composition);
+  HWC_UNUSED(begin);
+  // Every plane has already been validated when it was added.
+  return -1;
+}
+
+BatchedPlaneValidationStrategy::BatchedPlaneValidationStrategy(
+    DisplayPlaneHandler *plane_handler, PlaneValidationCache *cache)
+    : PlaneValidationStrategy(plane_handler, cache) {
+}
+
+bool BatchedPlaneValidationStrategy::ValidatePlane(
+    const DisplayPlaneStateList &composition) {
+  HWC_UNUSED(composition);
+  // Defer the check till all planes have been assigned.
+  return true;
+}
+
+int BatchedPlaneValidationStrategy::FindFailingPlane(
+    DisplayPlaneStateList &composition, size_t begin) {
+  size_t total = composition.size();
+  if (begin >= total)
+    return -1;
+
+  if (TestCommit(composition))
+    return -1;
+
+  // Planes [0, begin) pass, so the first failing plane is in
+  // [begin, total). Bisect for the shortest failing prefix, keeping the
+  // prefix of good planes passing and the one of bad planes failing. The
+  // last plane of the shortest failing prefix is the culprit.
+  size_t good = begin;
+  size_t bad = total;
+  while (bad - good > 1) {
+    size_t mid = good + (bad - good) / 2;
+    if (TestCommitPrefix(composition, mid)) {
+      good = mid;
+    } else {
+      bad = mid;
+    }
+  }
+
+  ISURFACETRACE("Batched validation failed, plane at index %zu can't be used",
+                bad - 1);
+  return static_cast<int>(bad - 1);
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,105 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PLANEVALIDATIONSTRATEGY_H_
+#define COMMON_DISPLAY_PLANEVALIDATIONSTRATEGY_H_
+
+#include <stdint.h>
+
+#include "displayplanehandler.h"
+#include "displayplanestate.h"
+
+namespace hwcomposer {
+
+class PlaneValidationCache;
+
+// Decides when the layer to plane mapping built by DisplayPlaneManager is
+// checked against the kernel. The strategy only talks to
+// DisplayPlaneHandler, so it can be exercised with a mock handler.
+class PlaneValidationStrategy {
+ public:
+  // cache is optional and can be NULL.
+  PlaneValidationStrategy(DisplayPlaneHandler *plane_handler,
+                          PlaneValidationCache *cache);
+  virtual ~PlaneValidationStrategy();
+
+  // Test commits composition, using a cached result for the same
+  // layer to plane mapping if available.
+  bool TestCommit(const DisplayPlaneStateList &composition) const;
+
+  // Called once the last plane in composition has been assigned a layer
+  // which passed all static checks (format, buffer etc). Returns false if
+  // the layer needs to fall back to GPU composition right away.
+  virtual bool ValidatePlane(const DisplayPlaneStateList &composition) = 0;
+
+  // Returns true in case planes are only validated by FindFailingPlane,
+  // i.e. test commits before that may fail because of any plane.
+  virtual bool DefersValidation() const = 0;
+
+  // Called after all layers have been mapped to planes. Planes before
+  // begin are known to work. Returns index of the first plane in
+  // composition which makes the commit fail or -1 if composition can be
+  // committed as is. Caller is expected to move the returned plane to GPU
+  // composition and call this again with begin set to index, so that the
+  // moved plane is checked again.
+  virtual int FindFailingPlane(DisplayPlaneStateList &composition,
+                               size_t begin) = 0;
+
+ protected:
+  // Test commits first count planes of composition.
+  bool TestCommitPrefix(DisplayPlaneStateList &composition, size_t count);
+
+  DisplayPlaneHandler *plane_handler_;
+  PlaneValidationCache *cache_;
+};
+
+// Test commits the partial composition every time a plane is added. This
+// needs as many test commits as planes in use.
+class IncrementalPlaneValidationStrategy : public PlaneValidationStrategy {
+ public:
+  IncrementalPlaneValidationStrategy(DisplayPlaneHandler *plane_handler,
+                                     PlaneValidationCache *cache);
+
+  bool ValidatePlane(const DisplayPlaneStateList &composition) override;
+
+  bool DefersValidation() const override {
+    return false;
+  }
+
+  int FindFailingPlane(DisplayPlaneStateList &composition,
+                       size_t begin) override;
+};
+
+// Assumes every plane can scan out its layer and test commits the whole
+// composition once. Only in case this fails, bisects over the planes to
+// find the first one which can't be scanned out.
+class BatchedPlaneValidationStrategy : public PlaneValidationStrategy {
+ public:
+  BatchedPlaneValidationStrategy(DisplayPlaneHandler *plane_handler,
+                                 PlaneValidationCache *cache);
+
+  bool ValidatePlane(const DisplayPlaneStateList &composition) override;
+
+  bool DefersValidation() const override {
+    return true;
+  }
+
+  int FindFailingPlane(DisplayPlaneStateList &composition,
+                       size_t begin) override;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PLANEVALIDATIONSTRATEGY_H_
@@ -0,0 +1,210 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "surfacepool.h"
+
+#include <algorithm>
+
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "nativesurface.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+bool SurfacePool::Key::operator<(const Key &rhs) const {
+  if (format_ != rhs.format_)
+    return format_ < rhs.format_;
+
+  if (modifier_ != rhs.modifier_)
+    return modifier_ < rhs.modifier_;
+
+  if (video_ != rhs.video_)
+    return video_ < rhs.video_;
+
+  if (width_ != rhs.width_)
+    return width_ < rhs.width_;
+
+  return height_ < rhs.height_;
+}
+
+void SurfacePool::SetDisplaySize(uint32_t width, uint32_t height) {
+  width_ = width;
+  height_ = height;
+  if (!budget_set_)
+    budget_ =
+        static_cast<uint64_t>(kDefaultBudgetSurfaces) * width * height * 4;
+}
+
+void SurfacePool::SetBudget(uint64_t budget) {
+  budget_ = budget;
+  budget_set_ = true;
+}
+
+void SurfacePool::GetAllocationSize(uint32_t width, uint32_t height,
+                                    uint32_t *alloc_width,
+                                    uint32_t *alloc_height) const {
+  *alloc_width = GetSizeClass(width, width_);
+  *alloc_height = GetSizeClass(height, height_);
+}
+
+bool SurfacePool::IsOversized(uint32_t surface_width, uint32_t surface_height,
+                              uint32_t width, uint32_t height) const {
+  uint32_t alloc_width = 0;
+  uint32_t alloc_height = 0;
+  GetAllocationSize(width, height, &alloc_width, &alloc_height);
+  return surface_width >= 2 * alloc_width && surface_height >= 2 * alloc_height;
+}
+
+NativeSurface *SurfacePool::GetFreeSurface(uint32_t format, uint64_t modifier,
+                                           bool video, uint32_t width,
+                                           uint32_t height) {
+  Key key;
+  key.format_ = format;
+  key.modifier_ = modifier;
+  key.video_ = video;
+  key.width_ = width;
+  key.height_ = 0;
+
+  Entry *match = NULL;
+  uint64_t match_area = 0;
+  for (auto it = surfaces_.lower_bound(key); it != surfaces_.end(); ++it) {
+    const Key &current = it->first;
+    if (current.format_ != format || current.modifier_ != modifier ||
+        current.video_ != video)
+      break;
+
+    if (current.height_ < height ||
+        IsOversized(current.width_, current.height_, width, height))
+      continue;
+
+    uint64_t area = static_cast<uint64_t>(current.width_) * current.height_;
+    if (match && area >= match_area)
+      continue;
+
+    for (Entry &entry : it->second) {
+      NativeSurface *surface = entry.surface_.get();
+      if (surface->GetSurfaceAge() != -1 || !surface->GetLayer()->GetBuffer())
+        continue;
+
+      match = &entry;
+      match_area = area;
+      break;
+    }
+  }
+
+  if (!match)
+    return NULL;
+
+  match->last_used_ = ++use_count_;
+  return match->surface_.get();
+}
+
+void SurfacePool::AddSurface(NativeSurface *surface, uint32_t format,
+                             bool video) {
+  Key key;
+  key.format_ = format;
+  key.modifier_ = surface->GetModifier();
+  key.video_ = video;
+  key.width_ = surface->GetWidth();
+  key.height_ = surface->GetHeight();
+
+  surfaces_[key].emplace_back();
+  Entry &entry = surfaces_[key].back();
+  entry.surface_.reset(surface);
+  entry.size_ = static_cast<uint64_t>(key.width_) * key.height_ *
+                GetBitsPerPixelForFormat(format) / 8;
+  entry.last_used_ = ++use_count_;
+  size_ += entry.size_;
+  count_++;
+#ifdef SURFACE_RECYCLE_TRACING
+  ISURFACERECYCLETRACE("Add %dx%d surface, pool holds %zu surfaces, %llu bytes",
+                       key.width_, key.height_, count_,
+                       (unsigned long long)size_);
+#endif
+}
+
+void SurfacePool::ReleaseFreeSurfaces(bool forced) {
+  if (!forced && size_ <= budget_)
+    return;
+
+  std::vector<std::pair<uint64_t, uint64_t>> free_surfaces;
+  for (const auto &bucket : surfaces_) {
+    for (const Entry &entry : bucket.second) {
+      if (!entry.surface_->IsOnScreen())
+        free_surfaces.emplace_back(entry.last_used_, entry.size_);
+    }
+  }
+
+  if (free_surfaces.empty())
+    return;
+
+  // Find the most recently used surface which needs to be released.
+  std::sort(free_surfaces.begin(), free_surfaces.end());
+  uint64_t size = size_;
+  uint64_t last_used = 0;
+  for (const auto &free_surface : free_surfaces) {
+    if (!forced && size <= budget_)
+      break;
+
+    last_used = free_surface.first;
+    size -= free_surface.second;
+  }
+
+  auto it = surfaces_.begin();
+  while (it != surfaces_.end()) {
+    std::vector<Entry> &entries = it->second;
+    auto entry = entries.begin();
+    while (entry != entries.end()) {
+      if (!entry->surface_->IsOnScreen() && entry->last_used_ <= last_used) {
+        size_ -= entry->size_;
+        count_--;
+        entry = entries.erase(entry);
+      } else {
+        entry++;
+      }
+    }
+
+    if (entries.empty()) {
+      it = surfaces_.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+#ifdef SURFACE_RECYCLE_TRACING
+  ISURFACERECYCLETRACE(
+      "ReleaseFreeSurfaces forced: %d, pool holds %zu surfaces, %llu bytes",
+      forced, count_, (unsigned long long)size_);
+#endif
+}
+
+void SurfacePool::Clear() {
+  SurfaceMap().swap(surfaces_);
+  size_ = 0;
+  count_ = 0;
+}
+
+uint32_t SurfacePool::GetSizeClass(uint32_t size, uint32_t max_size) {
+  uint32_t step = max_size / 4;
+  if (step == 0 || size >= max_size)
+    return std::max(size, max_size);
+
+  uint32_t size_class = ((size + step - 1) / step) * step;
+  return std::min(std::max(size_class, step), max_size);
+}
+
+}  // namespace hwcomposer
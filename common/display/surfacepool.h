@@ -0,0 +1,130 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_SURFACEPOOL_H_
+#define COMMON_DISPLAY_SURFACEPOOL_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace hwcomposer {
+
+class NativeSurface;
+
+// Owns the offscreen surfaces of a display, indexed by format, modifier
+// and size class. Surfaces only need to cover the display frame of the
+// plane they are used for, as compositions are rendered at display
+// coordinates. Sizes are rounded up to a quarter of the display size in
+// each direction, so that planes of similar size share surfaces.
+//
+// Surfaces not on screen anymore are kept around to be reused as long as
+// all surfaces fit in the memory budget, least recently used ones are
+// released first.
+class SurfacePool {
+ public:
+  SurfacePool() = default;
+  SurfacePool(const SurfacePool& rhs) = delete;
+  SurfacePool& operator=(const SurfacePool& rhs) = delete;
+
+  // Size classes are derived from the display size. Unless a budget has
+  // been set explicitly, it's adjusted to the display size as well.
+  void SetDisplaySize(uint32_t width, uint32_t height);
+
+  // Sets memory, in bytes, all surfaces of the display may use before
+  // surfaces which are not on screen are released. 0 releases all of
+  // them, as soon as ReleaseFreeSurfaces is called.
+  void SetBudget(uint64_t budget);
+
+  // Returns size a surface needs to be allocated with to cover width x
+  // height.
+  void GetAllocationSize(uint32_t width, uint32_t height,
+                         uint32_t* alloc_width, uint32_t* alloc_height) const;
+
+  // Returns true in case a surface of surface_width x surface_height
+  // is too large to be used for width x height, i.e. it's at least twice
+  // the allocation size in both directions.
+  bool IsOversized(uint32_t surface_width, uint32_t surface_height,
+                   uint32_t width, uint32_t height) const;
+
+  // Returns the smallest surface which can be recycled, has format and
+  // modifier and covers width x height without being oversized. NULL in
+  // case there is none.
+  NativeSurface* GetFreeSurface(uint32_t format, uint64_t modifier, bool video,
+                                uint32_t width, uint32_t height);
+
+  // Takes ownership of surface, which has been allocated with format.
+  void AddSurface(NativeSurface* surface, uint32_t format, bool video);
+
+  // Releases surfaces which are not on screen, least recently used first,
+  // till all surfaces fit in the budget. In case forced is true, all of
+  // them are released.
+  void ReleaseFreeSurfaces(bool forced);
+
+  // Releases all surfaces.
+  void Clear();
+
+  bool IsEmpty() const {
+    return count_ == 0;
+  }
+
+  size_t GetSurfaceCount() const {
+    return count_;
+  }
+
+  // Returns memory, in bytes, used by all surfaces.
+  uint64_t GetSize() const {
+    return size_;
+  }
+
+ private:
+  // Budget is set to this many full screen ARGB surfaces by default.
+  static const uint32_t kDefaultBudgetSurfaces = 6;
+
+  struct Key {
+    uint32_t format_;
+    uint64_t modifier_;
+    bool video_;
+    uint32_t width_;
+    uint32_t height_;
+
+    bool operator<(const Key& rhs) const;
+  };
+
+  struct Entry {
+    std::unique_ptr<NativeSurface> surface_;
+    uint64_t size_;
+    uint64_t last_used_;
+  };
+
+  typedef std::map<Key, std::vector<Entry>> SurfaceMap;
+
+  static uint32_t GetSizeClass(uint32_t size, uint32_t max_size);
+
+  SurfaceMap surfaces_;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  uint64_t budget_ = 0;
+  uint64_t size_ = 0;
+  uint64_t use_count_ = 0;
+  size_t count_ = 0;
+  bool budget_set_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_SURFACEPOOL_H_
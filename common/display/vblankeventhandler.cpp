@@ -29,6 +29,7 @@ static const int64_t kOneSecondNs = 1 * 1000 * 1000 * 1000;
 VblankEventHandler::VblankEventHandler(DisplayQueue* queue)
     : HWCThread(-8, "VblankEventHandler"),
       display_(0),
+      vperiod_(0),
       enabled_(false),
       fd_(-1),
       last_timestamp_(-1),
@@ -125,6 +126,28 @@ void VblankEventHandler::HandlePageFlipEvent(unsigned int sec,
   spin_lock_.unlock();
 }
 
+int64_t VblankEventHandler::GetNextVblankTime(int64_t now) {
+  ScopedSpinLock lock(spin_lock_);
+  if (previous_timestamp_ < 0 || vperiod_ <= 0 || vperiod_ > kOneSecondNs)
+    return -1;
+
+  int64_t next = previous_timestamp_ + vperiod_;
+  if (next <= now)
+    next += ((now - next) / vperiod_ + 1) * vperiod_;
+
+  return next;
+}
+
+int64_t VblankEventHandler::GetClosestVblankTime(int64_t target) {
+  spin_lock_.lock();
+  int64_t vperiod = vperiod_;
+  spin_lock_.unlock();
+  if (vperiod <= 0 || vperiod > kOneSecondNs)
+    return -1;
+
+  return GetNextVblankTime(target - vperiod / 2);
+}
+
 void VblankEventHandler::HandleWait() {
 }
 
@@ -50,6 +50,14 @@ class VblankEventHandler : public HWCThread {
 
   int VSyncControl(bool enabled);
 
+  // Returns predicted time of the first vblank after now, both in
+  // CLOCK_MONOTONIC nanoseconds. Returns -1 if no vblank has been seen yet.
+  int64_t GetNextVblankTime(int64_t now);
+
+  // Returns predicted time of the vblank closest to target. Returns -1 if
+  // no vblank has been seen yet.
+  int64_t GetClosestVblankTime(int64_t target);
+
  protected:
   void HandleRoutine() override;
   void HandleWait() override;
@@ -15,344 +15,180 @@
 */
 
 #include "disjoint_layers.h"
-#include <assert.h>
+
 #include <stdint.h>
+
 #include <algorithm>
-#include <iostream>
-#include <list>
-#include <map>
-#include <set>
-#include <utility>
 #include <vector>
+
 #include "hwctrace.h"
-#include "hwcutils.h"
 
 namespace hwcomposer {
 
-enum EventType { START, END };
-
-struct YPOI {
-  EventType type;
-  uint64_t y;
-  uint64_t rect_id;
+// Left or right edge of a rect when sweeping in x, top or bottom edge
+// when sweeping in y. Crossing an edge toggles the rect's id.
+struct Edge {
+  int pos;
+  uint64_t id;
 
-  bool operator<(const YPOI &rhs) const {
-    if (y == rhs.y)
-      return rect_id < rhs.rect_id;
-    else
-      return (y < rhs.y);
+  bool operator<(const Edge &rhs) const {
+    return pos < rhs.pos;
   }
 };
 
-// Any region will have start X and set of Y coordinates.
-struct Region {
-  uint64_t sx;
-  std::set<YPOI> y_points;
-  RectIDs rect_ids;
-};
-
-// POI is the point of interest while traversing through x coordinates
-struct POI {
-  EventType type;
-  uint64_t rect_id;
-  uint64_t x;
-  uint64_t top_y;
-  uint64_t bot_y;
-
-  bool operator<(const POI &rhs) const {
-    return (x <= rhs.x);
-  }
-};
-
-// This function will take active region and right x
-// For an active region there will be set of YPOI
-// It will traverse through each y_poi and given out
-// rectangle with rect_ids active at that time.
-void GenerateOutLayers(Region *reg, uint64_t x,
-                       const HwcRect<int> &damage_region,
-                       std::vector<RectSet<int>> *out) {
-  Rect<int> out_rect;
-  out_rect.left = std::max(damage_region.left, static_cast<int>(reg->sx));
-  out_rect.right = std::min(damage_region.right, static_cast<int>(x));
-  RectIDs rect_ids;
-
-  for (std::set<YPOI>::iterator y_poi_it = reg->y_points.begin();
-       y_poi_it != reg->y_points.end(); y_poi_it++) {
-    const YPOI &y_poi = *y_poi_it;
-    // No need to check for start or end event
-    // as rect_ids is empty
-    if (rect_ids.isEmpty()) {
-      out_rect.top = std::max(damage_region.top, static_cast<int>(y_poi.y));
-      rect_ids.add(y_poi.rect_id);
-    } else {
-      if (out_rect.top == static_cast<int>(y_poi.y)) {
-        if (y_poi.type == START) {
-          rect_ids.add(y_poi.rect_id);
-        } else {
-          rect_ids.subtract(y_poi.rect_id);
-        }
-        continue;
-      }
-      out_rect.bottom = y_poi.y;
-      if (AnalyseOverlap(damage_region, out_rect) == kOutside)
-        continue;
-
-      out->emplace_back(RectSet<int>(rect_ids, out_rect));
-      out_rect.top = std::max(damage_region.top, static_cast<int>(y_poi.y));
-      if (y_poi.type == START) {
-        rect_ids.add(y_poi.rect_id);
-      } else {
-        rect_ids.subtract(y_poi.rect_id);
-      }
-    }
+// Clips the rects to the damage region and marks the ones which are
+// still non-empty in valid. Coordinates are kept in separate arrays
+// without branches in the loop, so that it compiles to vector min/max
+// and compares.
+static void ClipRects(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region, int *left, int *top,
+                      int *right, int *bottom, uint8_t *valid) {
+  size_t size = in.size();
+  for (size_t i = 0; i < size; i++) {
+    left[i] = in[i].left;
+    top[i] = in[i].top;
+    right[i] = in[i].right;
+    bottom[i] = in[i].bottom;
   }
-}
 
-// This function will remove y coordinates corresponding to given rect_id
-void RemoveYpois(Region *reg, uint64_t rect_id) {
-  std::set<YPOI>::iterator top_it = reg->y_points.begin();
-  while (top_it != reg->y_points.end()) {
-    if ((*top_it).rect_id == rect_id) {
-      reg->y_points.erase(top_it++);
-    } else {
-      top_it++;
-    }
+  int damage_left = damage_region.left;
+  int damage_top = damage_region.top;
+  int damage_right = damage_region.right;
+  int damage_bottom = damage_region.bottom;
+  for (size_t i = 0; i < size; i++) {
+    left[i] = std::max(left[i], damage_left);
+    top[i] = std::max(top[i], damage_top);
+    right[i] = std::min(right[i], damage_right);
+    bottom[i] = std::min(bottom[i], damage_bottom);
+    valid[i] = (left[i] < right[i]) & (top[i] < bottom[i]);
   }
 }
 
-bool compare_region(const Region *first, const Region *second) {
-  uint64_t first_min_y = (*(first->y_points.begin())).y;
-  uint64_t second_min_y = (*(second->y_points.begin())).y;
-  return (first_min_y < second_min_y);
-}
-
-void get_draw_regions(const std::vector<Rect<int>> &in,
-                      const HwcRect<int> &damage_region,
-                      std::vector<RectSet<int>> *out) {
-  if (in.size() > RectIDs::max_elements) {
+template <typename TIds>
+static void GetDrawRegions(const std::vector<Rect<int>> &in,
+                           const HwcRect<int> &damage_region,
+                           std::vector<RectSet<int, TIds>> *out) {
+  const size_t max_elements = TIds::max_elements;
+  if (in.size() > max_elements) {
     return;
   }
 
-  // Set of all point of interests from input rectangles.
-  std::set<POI> pois;
-  std::list<Region *> imp_reg;
-  std::list<Region> active_regions;
-
-  // This loop will add all point of interests into pois.
-  for (uint64_t i = 0; i < in.size(); i++) {
-    const Rect<int> &rect = in[i];
-
-    // Filter out empty or invalid rects.
-    if (rect.left >= rect.right || rect.top >= rect.bottom)
+  int left[max_elements];
+  int top[max_elements];
+  int right[max_elements];
+  int bottom[max_elements];
+  uint8_t valid[max_elements];
+  ClipRects(in, damage_region, left, top, right, bottom, valid);
+
+  std::vector<Edge> x_edges;
+  x_edges.reserve(in.size() * 2);
+  for (size_t i = 0; i < in.size(); i++) {
+    if (!valid[i])
       continue;
 
-    if (AnalyseOverlap(damage_region, rect) == kOutside)
-      continue;
-
-    POI poi;
-    poi.rect_id = i;
-    poi.x = std::max(damage_region.left, rect.left);
-    poi.top_y = std::max(damage_region.top, rect.top);
-    poi.bot_y = std::min(damage_region.bottom, rect.bottom);
-    poi.type = START;
-    pois.insert(poi);
-
-    poi.type = END;
-    poi.x = std::min(damage_region.right, rect.right);
-    pois.insert(poi);
+    x_edges.emplace_back(Edge{left[i], i});
+    x_edges.emplace_back(Edge{right[i], i});
   }
 
-  for (std::set<POI>::iterator it = pois.begin(); it != pois.end(); ++it) {
-    const POI &poi = *it;
-    // First rectangle has to be inserted into active region
-    // This condition will be true if existing all active
-    // regions are already copied to out.
-    // If current poi is of type END there are no active regions,
-    // then this poi might already covered in previous pass
-    if (active_regions.size() == 0 && poi.type == START) {
-      Region reg;
-      reg.sx = poi.x;
-      YPOI y_poi;
-
-      y_poi.rect_id = poi.rect_id;
-      y_poi.type = START;
-      y_poi.y = poi.top_y;
-      reg.y_points.insert(y_poi);
-
-      y_poi.type = END;
-      y_poi.y = poi.bot_y;
-      reg.y_points.insert(y_poi);
+  if (x_edges.empty())
+    return;
 
-      RectIDs rectIds;
-      rectIds.add(poi.rect_id);
-      reg.rect_ids = rectIds;
-      active_regions.push_back(reg);
-      continue;
+  std::sort(x_edges.begin(), x_edges.end());
+
+  // Sweep from left to right. y_edges holds the sorted top and bottom
+  // edges of the rects covering the current slab, i.e. the area till the
+  // next x edge, and is updated as rects start and end. Every slab is cut
+  // into bands at these edges. Bands matching a band of the previous slab
+  // in y range and rect ids are extended to the right, instead of being
+  // emitted as a separate region.
+  std::vector<Edge> y_edges;
+  std::vector<RectSet<int, TIds>> open;
+  std::vector<RectSet<int, TIds>> bands;
+  y_edges.reserve(in.size() * 2);
+  TIds slab_ids;
+  size_t edge = 0;
+  while (edge < x_edges.size()) {
+    int x1 = x_edges[edge].pos;
+    TIds toggled;
+    for (; edge < x_edges.size() && x_edges[edge].pos == x1; edge++)
+      toggled.toggle(x_edges[edge].id);
+
+    TIds removed = slab_ids & toggled;
+    TIds added = toggled ^ removed;
+    slab_ids = slab_ids ^ toggled;
+    if (!removed.isEmpty()) {
+      y_edges.erase(std::remove_if(y_edges.begin(), y_edges.end(),
+                                   [&removed](const Edge &y_edge) {
+                                     return removed.test(y_edge.id);
+                                   }),
+                    y_edges.end());
     }
 
-    // If active_regions in not empty, Check if current
-    // poi y points fall in range of any existing
-    // active_regions.
-    // If yes, get that active region and do further processing
-    // If No, create a new region and insert into active regions
-    // If it is start event then there is possibility that multiple
-    // active_regions get impacted.
-    // If it is end event then one or none active_regions will get
-    // impacted.
-    bool found = false;
-    imp_reg.clear();
-    std::list<Region>::iterator it_reg = active_regions.begin();
-    while (it_reg != active_regions.end()) {
-      Region &cur_reg = *it_reg;
-      uint64_t min_y = (*(cur_reg.y_points.begin())).y;
-      uint64_t max_y = (*(cur_reg.y_points.rbegin())).y;
-      // If bottom y is less than minimum y in region or top y is greater than
-      // max y in region, then this region is not impacted by this rect
-      if (poi.bot_y <= min_y || poi.top_y >= max_y) {
-        it_reg++;
-        continue;
-      } else {
-        found = true;
-        // Found atleast one affected active region. If it is start event,
-        // add rect_id to cur_reg.rect_ids, also top_y and bot_y to
-        // cur_reg.y_points. if it is end event, remove rect_id from
-        // cur_reg.rect_ids and also top_y and bot_y from cur_reg.y_points.
-        // Also, if it is end event, check cur_reg.rect_ids is non empty,
-        // if it is empty remove region from active_regions.
-        // If it is start or end event, check next poi.x and see if it is same
-        // and
-        // those y coordinates fall in this region and it is END event, if yes
-        // 1) remove that rect_id and y coordinates as well
-        // 2)contine to check next poi.x until you find mismatch x.
-        if (poi.x == cur_reg.sx) {
-          if (poi.type == START) {
-            cur_reg.rect_ids.add(poi.rect_id);
-            imp_reg.push_back(&cur_reg);
-          }
+    for (size_t i = added.next(0); i < max_elements; i = added.next(i + 1)) {
+      Edge top_edge{top[i], i};
+      Edge bottom_edge{bottom[i], i};
+      y_edges.insert(
+          std::upper_bound(y_edges.begin(), y_edges.end(), top_edge),
+          top_edge);
+      y_edges.insert(
+          std::upper_bound(y_edges.begin(), y_edges.end(), bottom_edge),
+          bottom_edge);
+    }
 
-          it_reg++;
+    bands.clear();
+    if (!slab_ids.isEmpty() && edge < x_edges.size()) {
+      int x2 = x_edges[edge].pos;
+      TIds ids;
+      size_t y_edge = 0;
+      while (y_edge < y_edges.size()) {
+        int y1 = y_edges[y_edge].pos;
+        for (; y_edge < y_edges.size() && y_edges[y_edge].pos == y1; y_edge++)
+          ids.toggle(y_edges[y_edge].id);
+
+        if (ids.isEmpty() || y_edge == y_edges.size())
           continue;
-        }
-        if (poi.type == START) {
-          GenerateOutLayers(&cur_reg, poi.x, damage_region, out);
-          cur_reg.sx = poi.x;
-          cur_reg.rect_ids.add(poi.rect_id);
-          imp_reg.push_back(&cur_reg);
-          std::set<POI>::iterator next_poi_it = it;
-          next_poi_it++;
-          for (; next_poi_it != pois.end(); next_poi_it++) {
-            const POI &next_poi = *next_poi_it;
-            if (next_poi.x != poi.x) {
-              break;
-            } else {
-              if (next_poi.bot_y <= min_y || next_poi.top_y >= max_y ||
-                  next_poi.type == START) {
-                continue;
-              }
-              cur_reg.rect_ids.subtract(next_poi.rect_id);
-              RemoveYpois(&cur_reg, next_poi.rect_id);
-            }
-          }
-          it_reg++;
-        } else {
-          GenerateOutLayers(&cur_reg, poi.x, damage_region, out);
-          RemoveYpois(&cur_reg, poi.rect_id);
-          cur_reg.sx = poi.x;
-          cur_reg.rect_ids.subtract(poi.rect_id);
 
-          std::set<POI>::iterator next_poi_it = it;
-          next_poi_it++;
-          for (; next_poi_it != pois.end(); next_poi_it++) {
-            const POI &next_poi = *next_poi_it;
-            if (next_poi.x != poi.x) {
-              break;
-            } else {
-              if (next_poi.bot_y <= min_y || next_poi.top_y >= max_y ||
-                  next_poi.type == START) {
-                continue;
-              }
-              cur_reg.rect_ids.subtract(next_poi.rect_id);
-              RemoveYpois(&cur_reg, next_poi.rect_id);
-            }
-          }
-          if (cur_reg.rect_ids.isEmpty()) {
-            active_regions.erase(it_reg++);
-          } else {
-            it_reg++;
-          }
-        }
+        bands.emplace_back(ids, Rect<int>(x1, y1, x2, y_edges[y_edge].pos));
       }
     }
-    // If no affected active region found, add new active region
-    if (!found && poi.type == START) {
-      Region reg;
-      reg.sx = poi.x;
-      YPOI y_poi;
-
-      y_poi.rect_id = poi.rect_id;
-      y_poi.type = START;
-      y_poi.y = poi.top_y;
-      reg.y_points.insert(y_poi);
 
-      y_poi.type = END;
-      y_poi.y = poi.bot_y;
-      reg.y_points.insert(y_poi);
-
-      RectIDs rectIds;
-      rectIds.add(poi.rect_id);
-      reg.rect_ids = rectIds;
-      active_regions.push_back(reg);
-    } else {
-      if (imp_reg.size() > 1 && poi.type == START) {
-        imp_reg.sort(compare_region);
-        uint64_t cur_y = 0;
-        for (std::list<Region *>::iterator cur_imp_reg_it = imp_reg.begin();
-             cur_imp_reg_it != imp_reg.end(); cur_imp_reg_it++) {
-          Region &cur_imp_reg = *(*cur_imp_reg_it);
-          YPOI y_poi;
-          y_poi.rect_id = poi.rect_id;
-          y_poi.type = START;
-
-          if (cur_y == 0) {
-            y_poi.y = poi.top_y;
-          } else {
-            y_poi.y = cur_y;
-          }
-          // This is to split vertical
-          // line into all impacted
-          // regions.
-          cur_imp_reg.y_points.insert(y_poi);
-          // Take bottom of current region as start of next impacted region
-          cur_y = (*(cur_imp_reg.y_points.rbegin())).y;
-          std::list<Region *>::iterator next_imp_reg_it = cur_imp_reg_it;
-          next_imp_reg_it++;
-          if (next_imp_reg_it == imp_reg.end()) {
-            // If there is an another
-            // region which is impacted, no
-            // need to add anything.
-            // if there is no other active region left,
-            // take bottom y and push into this active region
-            y_poi.y = poi.bot_y;
-          } else {
-            y_poi.y = cur_y;
-          }
-          y_poi.type = END;
-          cur_imp_reg.y_points.insert(y_poi);
+    // Both open and bands are sorted by top, so matching bands are found
+    // with a single merge pass.
+    size_t current = 0;
+    for (RectSet<int, TIds> &region : open) {
+      while (current < bands.size() &&
+             bands[current].rect.top < region.rect.top)
+        current++;
+
+      if (current < bands.size()) {
+        RectSet<int, TIds> &band = bands[current];
+        if (band.rect.left == region.rect.right &&
+            band.rect.bottom == region.rect.bottom &&
+            band.rect.top == region.rect.top && band.id_set == region.id_set) {
+          band.rect.left = region.rect.left;
+          continue;
         }
-      } else if (imp_reg.size() == 1 && poi.type == START) {
-        // Only one region got impacted add y coordinated to that region
-        std::list<Region *>::iterator cur_imp_reg_it = imp_reg.begin();
-        YPOI y_poi;
-        y_poi.rect_id = poi.rect_id;
-        y_poi.type = START;
-        y_poi.y = poi.top_y;
-        (*cur_imp_reg_it)->y_points.insert(y_poi);
-        y_poi.type = END;
-        y_poi.y = poi.bot_y;
-        (*cur_imp_reg_it)->y_points.insert(y_poi);
       }
+
+      out->emplace_back(region);
     }
+
+    open.swap(bands);
   }
+
+  out->insert(out->end(), open.begin(), open.end());
+}
+
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region,
+                      std::vector<RectSet<int>> *out) {
+  GetDrawRegions(in, damage_region, out);
+}
+
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region,
+                      std::vector<RectSet<int, WideRectIDs>> *out) {
+  GetDrawRegions(in, damage_region, out);
 }
 
 }  // namespace hwcomposer
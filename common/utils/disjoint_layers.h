@@ -17,6 +17,7 @@
 #ifndef COMMON_UTILS_DISJOINT_LAYERS_H_
 #define COMMON_UTILS_DISJOINT_LAYERS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <hwcrect.h>
@@ -28,14 +29,125 @@
 namespace hwcomposer {
 
 // Some of the structs are adopted from drm_hwcomposer
-struct RectIDs {
+
+// Set of ids of up to kElements rects, kept in kElements / 64 words.
+// BasicRectIDs<64>, i.e. RectIDs, is specialized to a single word, which
+// is what almost all compositions need.
+template <size_t kElements>
+struct BasicRectIDs {
  public:
   typedef uint64_t TId;
 
-  RectIDs() : bitset(0) {
+  static_assert(kElements % 64 == 0, "kElements must be a multiple of 64");
+
+  BasicRectIDs() : words() {
   }
 
-  explicit RectIDs(TId id) : bitset(0) {
+  explicit BasicRectIDs(TId id) : words() {
+    add(id);
+  }
+
+  void add(TId id) {
+    words[id / 64] |= ((uint64_t)1) << (id % 64);
+  }
+
+  void subtract(TId id) {
+    words[id / 64] &= ~(((uint64_t)1) << (id % 64));
+  }
+
+  void toggle(TId id) {
+    words[id / 64] ^= ((uint64_t)1) << (id % 64);
+  }
+
+  bool test(TId id) const {
+    return (words[id / 64] >> (id % 64)) & 1;
+  }
+
+  bool isEmpty() const {
+    for (size_t i = 0; i < kWords; i++) {
+      if (words[i])
+        return false;
+    }
+
+    return true;
+  }
+
+  // Returns the first id >= id in the set, max_elements if there is none.
+  TId next(TId id) const {
+    for (size_t i = id / 64; i < kWords; i++) {
+      uint64_t bits = words[i];
+      if (i == id / 64)
+        bits &= ~(uint64_t)0 << (id % 64);
+
+      if (bits)
+        return i * 64 + __builtin_ctzll(bits);
+    }
+
+    return max_elements;
+  }
+
+  bool operator==(const BasicRectIDs &rhs) const {
+    for (size_t i = 0; i < kWords; i++) {
+      if (words[i] != rhs.words[i])
+        return false;
+    }
+
+    return true;
+  }
+
+  bool operator<(const BasicRectIDs &rhs) const {
+    for (size_t i = kWords; i-- > 0;) {
+      if (words[i] != rhs.words[i])
+        return words[i] < rhs.words[i];
+    }
+
+    return false;
+  }
+
+  BasicRectIDs operator|(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
+    for (size_t i = 0; i < kWords; i++)
+      ret.words[i] = words[i] | rhs.words[i];
+    return ret;
+  }
+
+  BasicRectIDs operator&(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
+    for (size_t i = 0; i < kWords; i++)
+      ret.words[i] = words[i] & rhs.words[i];
+    return ret;
+  }
+
+  BasicRectIDs operator^(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
+    for (size_t i = 0; i < kWords; i++)
+      ret.words[i] = words[i] ^ rhs.words[i];
+    return ret;
+  }
+
+  BasicRectIDs operator|(TId id) const {
+    BasicRectIDs ret(*this);
+    ret.add(id);
+    return ret;
+  }
+
+  static const int max_elements = kElements;
+
+ private:
+  static const size_t kWords = kElements / 64;
+
+  uint64_t words[kWords];
+};
+
+template <>
+struct BasicRectIDs<64> {
+ public:
+  typedef uint64_t TId;
+
+  BasicRectIDs() : bitset(0) {
+  }
+
+  explicit BasicRectIDs(TId id) : bitset(0) {
     add(id);
   }
 
@@ -47,30 +159,55 @@ struct RectIDs {
     bitset &= ~(((uint64_t)1) << id);
   }
 
+  void toggle(TId id) {
+    bitset ^= ((uint64_t)1) << id;
+  }
+
+  bool test(TId id) const {
+    return (bitset >> id) & 1;
+  }
+
   bool isEmpty() const {
     return bitset == 0;
   }
 
+  TId next(TId id) const {
+    uint64_t bits = id < 64 ? bitset & (~(uint64_t)0 << id) : 0;
+    return bits ? __builtin_ctzll(bits) : max_elements;
+  }
+
   uint64_t getBits() const {
     return bitset;
   }
 
-  bool operator==(const RectIDs &rhs) const {
+  bool operator==(const BasicRectIDs &rhs) const {
     return bitset == rhs.bitset;
   }
 
-  bool operator<(const RectIDs &rhs) const {
+  bool operator<(const BasicRectIDs &rhs) const {
     return bitset < rhs.bitset;
   }
 
-  RectIDs operator|(const RectIDs &rhs) const {
-    RectIDs ret;
+  BasicRectIDs operator|(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
     ret.bitset = bitset | rhs.bitset;
     return ret;
   }
 
-  RectIDs operator|(TId id) const {
-    RectIDs ret;
+  BasicRectIDs operator&(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
+    ret.bitset = bitset & rhs.bitset;
+    return ret;
+  }
+
+  BasicRectIDs operator^(const BasicRectIDs &rhs) const {
+    BasicRectIDs ret;
+    ret.bitset = bitset ^ rhs.bitset;
+    return ret;
+  }
+
+  BasicRectIDs operator|(TId id) const {
+    BasicRectIDs ret;
     ret.bitset = bitset;
     ret.add(id);
     return ret;
@@ -82,22 +219,33 @@ struct RectIDs {
   uint64_t bitset;
 };
 
-template <typename TNum>
+typedef BasicRectIDs<64> RectIDs;
+// Used by compositions with more than 64 rects.
+typedef BasicRectIDs<256> WideRectIDs;
+
+template <typename TNum, typename TIds = RectIDs>
 struct RectSet {
-  RectIDs id_set;
+  TIds id_set;
   Rect<TNum> rect;
 
-  RectSet(const RectIDs &i, const Rect<TNum> &r) : id_set(i), rect(r) {
+  RectSet(const TIds &i, const Rect<TNum> &r) : id_set(i), rect(r) {
   }
 
-  bool operator==(const RectSet<TNum> &rhs) const {
+  bool operator==(const RectSet<TNum, TIds> &rhs) const {
     return (id_set == rhs.id_set) && (rect == rhs.rect);
   }
 };
 
+// Splits the parts of rects in in, which are inside damage_region, into
+// disjoint regions. Every region has the ids, i.e. indices in in, of the
+// rects covering it. Nothing is returned in case in has more rects than
+// the id set can hold.
 void get_draw_regions(const std::vector<Rect<int>> &in,
                       const HwcRect<int> &damage_region,
                       std::vector<RectSet<int>> *out);
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region,
+                      std::vector<RectSet<int, WideRectIDs>> *out);
 }  // namespace hwcomposer
 
 #endif  // COMMON_UTILS_DISJOINT_LAYERS_H_
@@ -0,0 +1,111 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_FRAMEARENA_H_
+#define COMMON_UTILS_FRAMEARENA_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+// Keeps track of per frame storage which is reused from frame to frame.
+// Containers are recycled instead of being destroyed, i.e. their elements
+// are destroyed but the capacity is retained so that a frame with the
+// same layer setup as the one before doesn't need any heap allocations.
+//
+// In debug builds the arena counts frames in which a recycled container
+// holds storage it didn't hold when recycled within the two frames
+// before, i.e. it had to reallocate. Containers are double buffered and
+// swapped with each other, so they are matched by their storage and not
+// by the container itself. Once the layer setup is steady this count
+// should stay constant. Allocations made by the elements themselves are
+// not tracked.
+class FrameArena {
+ public:
+  FrameArena() = default;
+  FrameArena(const FrameArena& rhs) = delete;
+  FrameArena& operator=(const FrameArena& rhs) = delete;
+
+  // Destroys all elements of storage, keeping its capacity. Needs to be
+  // called for every recycled container before EndFrame.
+  template <typename T>
+  void Recycle(std::vector<T>& storage) {
+#ifndef NDEBUG
+    Track(storage.data(), storage.capacity() * sizeof(T));
+#endif
+    storage.clear();
+  }
+
+  // Marks all storage of the current frame as recycled.
+  void EndFrame() {
+#ifndef NDEBUG
+    if (grew_) {
+      growths_++;
+      IFRAMEARENATRACE("FrameArena: Storage grew, %u growths.", growths_);
+    }
+
+    grew_ = false;
+    recycled_[2].swap(recycled_[1]);
+    recycled_[1].swap(recycled_[0]);
+    recycled_[0].clear();
+#endif
+  }
+
+  // Returns number of frames in which recycled storage had to grow.
+  // Always 0 in release builds.
+  uint32_t GetGrowthCount() const {
+    return growths_;
+  }
+
+ private:
+#ifndef NDEBUG
+  struct Storage {
+    const void* data_;
+    size_t size_;
+  };
+
+  void Track(const void* data, size_t size) {
+    if (!data)
+      return;
+
+    bool known = false;
+    for (const std::vector<Storage>& frame : recycled_) {
+      for (const Storage& storage : frame) {
+        if (storage.data_ == data && storage.size_ >= size)
+          known = true;
+      }
+    }
+
+    if (!known)
+      grew_ = true;
+
+    recycled_[0].push_back({data, size});
+  }
+
+  // Storage recycled in the current frame and the two frames before.
+  std::vector<Storage> recycled_[3];
+  bool grew_ = false;
+#endif
+  uint32_t growths_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_FRAMEARENA_H_
@@ -46,6 +46,9 @@ extern "C" {
 // #define RECT_DAMAGE_TRACING 1
 // #define PLANE_RESERVED_TRACING 1
 // #define SURFACE_RECYCLE_TRACING 1
+// #define PLANE_VALIDATION_CACHE_TRACING 1
+// #define IDLE_POLICY_TRACING 1
+// #define FRAME_ARENA_TRACING 1
 
 // Function call tracing
 #ifdef FUNCTION_CALL_TRACING
@@ -139,6 +142,30 @@ class TraceFunc {
 #define ISURFACERECYCLETRACE(fmt, ...) ((void)0)
 #endif
 
+#ifdef PLANE_VALIDATION_CACHE_TRACING
+#define IPLANECACHETRACE ITRACE
+#else
+#define IPLANECACHETRACE(fmt, ...) ((void)0)
+#endif
+
+#ifdef IDLE_POLICY_TRACING
+#define IIDLEPOLICYTRACE ITRACE
+#else
+#define IIDLEPOLICYTRACE(fmt, ...) ((void)0)
+#endif
+
+#ifdef VIDEO_PLANE_TRACING
+#define IVIDEOPLANETRACE ITRACE
+#else
+#define IVIDEOPLANETRACE(fmt, ...) ((void)0)
+#endif
+
+#ifdef FRAME_ARENA_TRACING
+#define IFRAMEARENATRACE ITRACE
+#else
+#define IFRAMEARENATRACE(fmt, ...) ((void)0)
+#endif
+
 #ifdef RESOURCE_CACHE_TRACING
 #define ICACHETRACE ITRACE
 #else
@@ -17,6 +17,7 @@
 #include "hwcutils.h"
 
 #include <poll.h>
+#include <time.h>
 
 #include "hwctrace.h"
 
@@ -37,6 +38,12 @@ int HWCPoll(int fd, int timeout) {
   return ret;
 }
 
+int64_t GetMonotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 bool IsLayerAlphaBlendingCommitted(OverlayLayer* layer) {
   uint64_t alpha = 0xFF;
 
@@ -156,6 +163,50 @@ uint32_t GetTotalPlanesForFormat(uint32_t format) {
   return 1;
 }
 
+uint32_t GetBitsPerPixelForFormat(uint32_t format) {
+  switch (format) {
+    case DRM_FORMAT_C8:
+    case DRM_FORMAT_R8:
+    case DRM_FORMAT_RGB332:
+    case DRM_FORMAT_BGR233:
+      return 8;
+    case DRM_FORMAT_NV12:
+    case DRM_FORMAT_NV21:
+    case DRM_FORMAT_NV12_Y_TILED_INTEL:
+    case DRM_FORMAT_YVU420:
+    case DRM_FORMAT_YUV420:
+    case DRM_FORMAT_YVU420_ANDROID:
+      return 12;
+    case DRM_FORMAT_RGB565:
+    case DRM_FORMAT_BGR565:
+    case DRM_FORMAT_XRGB1555:
+    case DRM_FORMAT_XBGR1555:
+    case DRM_FORMAT_ARGB1555:
+    case DRM_FORMAT_ABGR1555:
+    case DRM_FORMAT_XRGB4444:
+    case DRM_FORMAT_ARGB4444:
+    case DRM_FORMAT_GR88:
+    case DRM_FORMAT_RG88:
+    case DRM_FORMAT_R16:
+    case DRM_FORMAT_NV16:
+    case DRM_FORMAT_YUV422:
+    case DRM_FORMAT_UYVY:
+    case DRM_FORMAT_YUYV:
+    case DRM_FORMAT_YVYU:
+    case DRM_FORMAT_VYUY:
+      return 16;
+    case DRM_FORMAT_RGB888:
+    case DRM_FORMAT_BGR888:
+    case DRM_FORMAT_P010:
+    case DRM_FORMAT_YUV444:
+      return 24;
+    default:
+      break;
+  }
+
+  return 32;
+}
+
 bool IsEdidFilting() {
   const char* key = ALL_EDID_FLAG_PROPERTY;
   char* value = new char[20];
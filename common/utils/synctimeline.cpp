@@ -0,0 +1,100 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "synctimeline.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "hwctrace.h"
+
+// sw_sync interface, it's not part of the exported kernel headers.
+struct sw_sync_create_fence_data {
+  uint32_t value;
+  char name[32];
+  int32_t fence;
+};
+
+#define SW_SYNC_IOC_MAGIC 'W'
+#define SW_SYNC_IOC_CREATE_FENCE \
+  _IOWR(SW_SYNC_IOC_MAGIC, 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC _IOW(SW_SYNC_IOC_MAGIC, 1, uint32_t)
+
+namespace hwcomposer {
+
+static const char* kSwSyncPaths[] = {"/dev/sw_sync",
+                                     "/sys/kernel/debug/sync/sw_sync"};
+
+SyncTimeline::~SyncTimeline() {
+  if (fd_ >= 0)
+    close(fd_);
+
+  fd_ = -1;
+}
+
+bool SyncTimeline::Initialize() {
+  if (fd_ >= 0)
+    return true;
+
+  for (const char* path : kSwSyncPaths) {
+    fd_ = open(path, O_RDWR | O_CLOEXEC);
+    if (fd_ >= 0)
+      return true;
+  }
+
+  ITRACE("sw_sync timeline not available: %s", PRINTERROR());
+  return false;
+}
+
+int32_t SyncTimeline::CreateFence(uint32_t* point) {
+  if (fd_ < 0)
+    return -1;
+
+  struct sw_sync_create_fence_data data;
+  memset(&data, 0, sizeof(data));
+  data.value = next_point_ + 1;
+  strncpy(data.name, "iahwc_release", sizeof(data.name) - 1);
+  if (ioctl(fd_, SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+    ETRACE("Failed to create sw_sync fence: %s", PRINTERROR());
+    return -1;
+  }
+
+  next_point_ = data.value;
+  *point = data.value;
+  return data.fence;
+}
+
+bool SyncTimeline::Signal(uint32_t point) {
+  if (fd_ < 0)
+    return false;
+
+  // Points only move forward, fences up to signalled_point_ are done.
+  uint32_t count = point - signalled_point_;
+  if (static_cast<int32_t>(count) <= 0)
+    return true;
+
+  if (ioctl(fd_, SW_SYNC_IOC_INC, &count) < 0) {
+    ETRACE("Failed to advance sw_sync timeline: %s", PRINTERROR());
+    return false;
+  }
+
+  signalled_point_ = point;
+  return true;
+}
+
+}  // namespace hwcomposer
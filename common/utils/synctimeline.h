@@ -0,0 +1,60 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_SYNCTIMELINE_H_
+#define COMMON_UTILS_SYNCTIMELINE_H_
+
+#include <stdint.h>
+
+namespace hwcomposer {
+
+// This class wraps a sw_sync timeline, which allows to hand out fences
+// before the event they stand for has a fence of its own. Fences are
+// created on the next point of the timeline and signalled once the
+// timeline has been advanced to it. Closing the timeline signals all
+// fences which are still pending.
+class SyncTimeline {
+ public:
+  SyncTimeline() = default;
+  ~SyncTimeline();
+
+  // Opens the timeline. Returns false in case sw_sync is not available,
+  // the instance can't be used then.
+  bool Initialize();
+
+  bool IsValid() const {
+    return fd_ >= 0;
+  }
+
+  // Returns a fence for the next point of the timeline, which is stored
+  // in point, or -1 in case of failure.
+  int32_t CreateFence(uint32_t* point);
+
+  // Advances the timeline to point, signalling all fences up to it.
+  // Can be called from a different thread than CreateFence.
+  bool Signal(uint32_t point);
+
+ private:
+  int fd_ = -1;
+  // Last point fences have been created for.
+  uint32_t next_point_ = 0;
+  // Point the timeline has been advanced to.
+  uint32_t signalled_point_ = 0;
+};
+
+}  // namespace hwcomposer
+
+#endif  // COMMON_UTILS_SYNCTIMELINE_H_
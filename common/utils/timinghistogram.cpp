@@ -0,0 +1,96 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "timinghistogram.h"
+
+namespace hwcomposer {
+
+static uint32_t GetPercentile(const uint32_t* buckets, uint32_t num_buckets,
+                              uint64_t total, uint32_t percentile,
+                              uint32_t max_us) {
+  // Rank of the sample in the sorted list, rounded up.
+  uint64_t rank = (total * percentile + 99) / 100;
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < num_buckets; i++) {
+    seen += buckets[i];
+    if (seen < rank)
+      continue;
+
+    uint32_t upper = i == 0 ? 0 : static_cast<uint32_t>((1ULL << i) - 1);
+    return upper < max_us ? upper : max_us;
+  }
+
+  return max_us;
+}
+
+TimingHistogram::TimingHistogram() {
+  Reset();
+}
+
+void TimingHistogram::AddSample(int64_t duration) {
+  if (duration < 0)
+    return;
+
+  uint64_t us = duration / 1000;
+  uint32_t bucket = 0;
+  if (us > 0)
+    bucket = 64 - __builtin_clzll(us);
+
+  if (bucket >= kNumBuckets)
+    bucket = kNumBuckets - 1;
+
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  uint32_t sample = us > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us);
+  uint32_t max = max_us_.load(std::memory_order_relaxed);
+  while (sample > max &&
+         !max_us_.compare_exchange_weak(max, sample,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+void TimingHistogram::GetTiming(HWCStageTiming* timing) const {
+  // Samples added meanwhile might only be partially visible, which is
+  // fine for statistics.
+  uint32_t buckets[kNumBuckets];
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += buckets[i];
+  }
+
+  uint32_t max_us = max_us_.load(std::memory_order_relaxed);
+  timing->count_ = total;
+  timing->max_us_ = max_us;
+  if (total == 0) {
+    timing->p50_us_ = 0;
+    timing->p99_us_ = 0;
+    return;
+  }
+
+  timing->p50_us_ = GetPercentile(buckets, kNumBuckets, total, 50, max_us);
+  timing->p99_us_ = GetPercentile(buckets, kNumBuckets, total, 99, max_us);
+}
+
+void TimingHistogram::Reset() {
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+
+  max_us_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace hwcomposer
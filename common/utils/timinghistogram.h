@@ -0,0 +1,54 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_TIMINGHISTOGRAM_H_
+#define COMMON_UTILS_TIMINGHISTOGRAM_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+
+// Histogram of durations with power of two buckets in microseconds.
+// Bucket 0 counts durations below 1us, bucket i durations in
+// [2^(i-1), 2^i) us. Samples can be added from any thread without
+// locking, percentiles are reported as the upper bound of the bucket
+// they fall into and are therefore accurate to a factor of 2.
+class TimingHistogram {
+ public:
+  TimingHistogram();
+  TimingHistogram(const TimingHistogram& rhs) = delete;
+  TimingHistogram& operator=(const TimingHistogram& rhs) = delete;
+
+  // Adds a duration in nanoseconds.
+  void AddSample(int64_t duration);
+
+  void GetTiming(HWCStageTiming* timing) const;
+
+  void Reset();
+
+ private:
+  static const uint32_t kNumBuckets = 32;
+
+  std::atomic<uint32_t> buckets_[kNumBuckets];
+  std::atomic<uint32_t> max_us_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_TIMINGHISTOGRAM_H_
@@ -89,6 +89,16 @@ String8 HwcService::GetHwcVersion() {
 }
 
 status_t HwcService::SetOption(String8 option, String8 value) {
+  if (option == "idle.hysteresis") {
+    // Format is min_idle_frames,max_idle_frames,exit_frames.
+    uint32_t min_idle_frames, max_idle_frames, exit_frames;
+    if (sscanf(value.string(), "%u,%u,%u", &min_idle_frames, &max_idle_frames,
+               &exit_frames) != 3)
+      return BAD_VALUE;
+
+    mpHwc->SetIdleHysteresis(min_idle_frames, max_idle_frames, exit_frames);
+  }
+
   return OK;
 }
 
@@ -20,6 +20,7 @@
 #include "utils_android.h"
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <android/log.h>
 #include <cutils/properties.h>
@@ -39,6 +40,11 @@
 
 namespace android {
 
+// Per layer metadata, the value is one byte holding an
+// hwcomposer::HWCCompositionQuality.
+static const char kCompositionQualityKey[] =
+    "com.intel.iahwc.composition_quality";
+
 class IAVsyncCallback : public hwcomposer::VsyncCallback {
  public:
   IAVsyncCallback(hwc2_callback_data_t data, hwc2_function_pointer_t hook)
@@ -224,6 +230,16 @@ HWC2::Error IAHWC2::Init() {
       external_display_id = HWC_DISPLAY_VIRTUAL + 1;
   }
 
+  // Format is min_idle_frames,max_idle_frames,exit_frames.
+  property_get("board.hwc.idle.hysteresis", value, "");
+  uint32_t min_idle_frames, max_idle_frames, exit_frames;
+  if (sscanf(value, "%u,%u,%u", &min_idle_frames, &max_idle_frames,
+             &exit_frames) == 3) {
+    ALOGI("HWC Idle Hysteresis min: %u max: %u exit: %u", min_idle_frames,
+          max_idle_frames, exit_frames);
+    SetIdleHysteresis(min_idle_frames, max_idle_frames, exit_frames);
+  }
+
   // Start the hwc service
   hwcService_.Start(*this);
 
@@ -321,6 +337,24 @@ uint32_t IAHWC2::GetMaxVirtualDisplayCount() {
   return 10;
 }
 
+void IAHWC2::GetLayerGenericMetadataKey(uint32_t key_index,
+                                        uint32_t *out_key_length,
+                                        char *out_key, bool *out_mandatory) {
+  supported(__func__);
+  if (key_index > 0) {
+    *out_key_length = 0;
+    return;
+  }
+
+  uint32_t length = strlen(kCompositionQualityKey);
+  if (out_key)
+    memcpy(out_key, kCompositionQualityKey, length);
+
+  *out_key_length = length;
+  // Layers are composed at full resolution without it.
+  *out_mandatory = false;
+}
+
 HWC2::Error IAHWC2::RegisterCallback(int32_t descriptor,
                                      hwc2_callback_data_t data,
                                      hwc2_function_pointer_t function) {
@@ -1457,6 +1491,35 @@ HWC2::Error IAHWC2::Hwc2Layer::SetLayerPerFrameMetadataBlobs(
   return HWC2::Error::None;
 }
 
+HWC2::Error IAHWC2::Hwc2Layer::SetLayerGenericMetadata(
+    uint32_t key_length, const char *key, bool /*mandatory*/,
+    uint32_t value_length, const uint8_t *value) {
+  supported(__func__);
+  if (key_length != strlen(kCompositionQualityKey) ||
+      strncmp(key, kCompositionQualityKey, key_length))
+    return HWC2::Error::Unsupported;
+
+  // Empty value resets the layer to the default.
+  if (value_length == 0) {
+    hwc_layer_.SetCompositionQuality(hwcomposer::HWCCompositionQuality::kFull);
+    return HWC2::Error::None;
+  }
+
+  if (value_length != 1)
+    return HWC2::Error::BadParameter;
+
+  switch (value[0]) {
+    case static_cast<uint8_t>(hwcomposer::HWCCompositionQuality::kFull):
+    case static_cast<uint8_t>(hwcomposer::HWCCompositionQuality::kHalf):
+    case static_cast<uint8_t>(hwcomposer::HWCCompositionQuality::kQuarter):
+      hwc_layer_.SetCompositionQuality(
+          static_cast<hwcomposer::HWCCompositionQuality>(value[0]));
+      return HWC2::Error::None;
+    default:
+      return HWC2::Error::BadParameter;
+  }
+}
+
 // static
 int IAHWC2::HookDevClose(hw_device_t * /*dev*/) {
   unsupported(__func__);
@@ -1494,6 +1557,11 @@ hwc2_function_pointer_t IAHWC2::HookDevGetFunction(struct hwc2_device * /*dev*/,
       return ToHook<HWC2_PFN_GET_MAX_VIRTUAL_DISPLAY_COUNT>(
           DeviceHook<uint32_t, decltype(&IAHWC2::GetMaxVirtualDisplayCount),
                      &IAHWC2::GetMaxVirtualDisplayCount>);
+    case HWC2::FunctionDescriptor::GetLayerGenericMetadataKey:
+      return ToHook<HWC2_PFN_GET_LAYER_GENERIC_METADATA_KEY>(
+          DeviceHook<void, decltype(&IAHWC2::GetLayerGenericMetadataKey),
+                     &IAHWC2::GetLayerGenericMetadataKey, uint32_t,
+                     uint32_t *, char *, bool *>);
     case HWC2::FunctionDescriptor::RegisterCallback:
       return ToHook<HWC2_PFN_REGISTER_CALLBACK>(
           DeviceHook<int32_t, decltype(&IAHWC2::RegisterCallback),
@@ -1738,6 +1806,11 @@ hwc2_function_pointer_t IAHWC2::HookDevGetFunction(struct hwc2_device * /*dev*/,
           LayerHook<decltype(&Hwc2Layer::SetLayerPerFrameMetadataBlobs),
                     &Hwc2Layer::SetLayerPerFrameMetadataBlobs, uint32_t,
                     const int32_t *, const uint32_t *, const uint8_t *>);
+    case HWC2::FunctionDescriptor::SetLayerGenericMetadata:
+      return ToHook<HWC2_PFN_SET_LAYER_GENERIC_METADATA>(
+          LayerHook<decltype(&Hwc2Layer::SetLayerGenericMetadata),
+                    &Hwc2Layer::SetLayerGenericMetadata, uint32_t,
+                    const char *, bool, uint32_t, const uint8_t *>);
     case HWC2::FunctionDescriptor::Invalid:
     default:
       return NULL;
@@ -1810,6 +1883,16 @@ void IAHWC2::DisableHDCPSessionForAllDisplays() {
   device_.DisableHDCPSessionForAllDisplays();
 }
 
+void IAHWC2::SetIdleHysteresis(uint32_t min_idle_frames,
+                               uint32_t max_idle_frames, uint32_t exit_frames) {
+  const std::vector<NativeDisplay *> &displays = device_.GetAllDisplays();
+  size_t size = displays.size();
+  for (size_t i = 0; i < size; ++i) {
+    displays.at(i)->SetIdleHysteresis(min_idle_frames, max_idle_frames,
+                                      exit_frames);
+  }
+}
+
 #ifdef ENABLE_PANORAMA
 void IAHWC2::TriggerPanorama(uint32_t hotplug_simulation) {
   device_.TriggerPanorama(hotplug_simulation);
@@ -60,6 +60,9 @@ class IAHWC2 : public hwc2_device_t {
   void DisableHDCPSessionForDisplay(uint32_t connector);
 
   void DisableHDCPSessionForAllDisplays();
+
+  void SetIdleHysteresis(uint32_t min_idle_frames, uint32_t max_idle_frames,
+                         uint32_t exit_frames);
 #ifdef ENABLE_PANORAMA
   void TriggerPanorama(uint32_t hotplug_simulation);
   void ShutdownPanorama(uint32_t hotplug_simulation);
@@ -150,6 +153,9 @@ class IAHWC2 : public hwc2_device_t {
                                               const int32_t *keys,
                                               const uint32_t *sizes,
                                               const uint8_t *metadata);
+    HWC2::Error SetLayerGenericMetadata(uint32_t key_length, const char *key,
+                                        bool mandatory, uint32_t value_length,
+                                        const uint8_t *value);
 
    private:
     // sf_type_ stores the initial type given to us by surfaceflinger,
@@ -424,6 +430,8 @@ class IAHWC2 : public hwc2_device_t {
   HWC2::Error DestroyVirtualDisplay(hwc2_display_t display);
   void Dump(uint32_t *size, char *buffer);
   uint32_t GetMaxVirtualDisplayCount();
+  void GetLayerGenericMetadataKey(uint32_t key_index, uint32_t *out_key_length,
+                                  char *out_key, bool *out_mandatory);
   HWC2::Error RegisterCallback(int32_t descriptor, hwc2_callback_data_t data,
                                hwc2_function_pointer_t function);
 
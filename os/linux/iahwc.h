@@ -105,6 +105,9 @@ enum iahwc_function_descriptors {
   IAHWC_FUNC_LAYER_SET_SURFACE_DAMAGE,
   IAHWC_FUNC_LAYER_SET_PLANE_ALPHA,
   IAHWC_FUNC_LAYER_SET_INDEX,
+  IAHWC_FUNC_DISPLAY_SET_IDLE_HYSTERESIS,
+  IAHWC_FUNC_DISPLAY_GET_FRAME_STAGE_TIMING,
+  IAHWC_FUNC_LAYER_SET_COMPOSITION_QUALITY,
 };
 
 enum iahwc_callback_descriptor {
@@ -119,6 +122,14 @@ enum iahwc_layer_usage {
   IAHWC_LAYER_USAGE_NORMAL,
 };
 
+// Resolution content of a layer may be composed at by the GPU, see
+// hwcomposer::HWCCompositionQuality.
+enum iahwc_layer_composition_quality {
+  IAHWC_COMPOSITION_QUALITY_FULL,
+  IAHWC_COMPOSITION_QUALITY_HALF,
+  IAHWC_COMPOSITION_QUALITY_QUARTER,
+};
+
 enum iahwc_layer_transform {
   IAHWC_TRANSFORM_FLIP_H,
   IAHWC_TRANSFORM_FLIP_V,
@@ -141,6 +152,22 @@ typedef struct iahwc_region {
   iahwc_rect_t const* rects;
 } iahwc_region_t;
 
+enum iahwc_frame_stage {
+  IAHWC_FRAME_STAGE_INITIALIZE_LAYERS,
+  IAHWC_FRAME_STAGE_VALIDATE_LAYERS,
+  IAHWC_FRAME_STAGE_COMPOSITOR_DRAW,
+  IAHWC_FRAME_STAGE_FENCE_WAIT,
+  IAHWC_FRAME_STAGE_ATOMIC_COMMIT,
+  IAHWC_FRAME_STAGE_COUNT
+};
+
+typedef struct iahwc_stage_timing {
+  uint64_t count;
+  uint32_t p50_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+} iahwc_stage_timing_t;
+
 typedef int (*IAHWC_PFN_GET_NUM_DISPLAYS)(iahwc_device_t*, int* num_displays);
 typedef int (*IAHWC_PFN_REGISTER_CALLBACK)(iahwc_device_t*, int descriptor,
                                            iahwc_display_t display_handle,
@@ -180,6 +207,12 @@ typedef int (*IAHWC_PFN_DISABLE_OVERLAY_USAGE)(iahwc_device_t*,
                                                iahwc_display_t display_handle);
 typedef int (*IAHWC_PFN_ENABLE_OVERLAY_USAGE)(iahwc_device_t*,
                                               iahwc_display_t display_handle);
+typedef int (*IAHWC_PFN_DISPLAY_SET_IDLE_HYSTERESIS)(
+    iahwc_device_t*, iahwc_display_t display_handle, uint32_t min_idle_frames,
+    uint32_t max_idle_frames, uint32_t exit_frames);
+typedef int (*IAHWC_PFN_DISPLAY_GET_FRAME_STAGE_TIMING)(
+    iahwc_device_t*, iahwc_display_t display_handle, uint32_t stage,
+    iahwc_stage_timing_t* timing);
 typedef int (*IAHWC_PFN_CREATE_LAYER)(iahwc_device_t*,
                                       iahwc_display_t display_handle,
                                       iahwc_layer_t* layer_handle);
@@ -224,6 +257,9 @@ typedef int (*IAHWC_PFN_LAYER_SET_INDEX)(iahwc_device_t*,
                                          iahwc_display_t display_handle,
                                          iahwc_layer_t layer_handle,
                                          uint32_t layer_index);
+typedef int (*IAHWC_PFN_LAYER_SET_COMPOSITION_QUALITY)(
+    iahwc_device_t*, iahwc_display_t display_handle, iahwc_layer_t layer_handle,
+    int32_t quality);
 typedef int (*IAHWC_PFN_VSYNC)(iahwc_callback_data_t data,
                                iahwc_display_t display, int64_t timestamp);
 typedef int (*IAHWC_PFN_PIXEL_UPLOADER)(iahwc_callback_data_t data,
@@ -184,6 +184,16 @@ iahwc_function_ptr_t IAHWC::HookGetFunctionPtr(iahwc_device_t* /* device */,
       return ToHook<IAHWC_PFN_ENABLE_OVERLAY_USAGE>(
           DisplayHook<decltype(&IAHWCDisplay::EnableOverlayUsage),
                       &IAHWCDisplay::EnableOverlayUsage>);
+    case IAHWC_FUNC_DISPLAY_SET_IDLE_HYSTERESIS:
+      return ToHook<IAHWC_PFN_DISPLAY_SET_IDLE_HYSTERESIS>(
+          DisplayHook<decltype(&IAHWCDisplay::SetIdleHysteresis),
+                      &IAHWCDisplay::SetIdleHysteresis, uint32_t, uint32_t,
+                      uint32_t>);
+    case IAHWC_FUNC_DISPLAY_GET_FRAME_STAGE_TIMING:
+      return ToHook<IAHWC_PFN_DISPLAY_GET_FRAME_STAGE_TIMING>(
+          DisplayHook<decltype(&IAHWCDisplay::GetFrameStageTiming),
+                      &IAHWCDisplay::GetFrameStageTiming, uint32_t,
+                      iahwc_stage_timing_t*>);
     case IAHWC_FUNC_CREATE_LAYER:
       return ToHook<IAHWC_PFN_CREATE_LAYER>(
           DisplayHook<decltype(&IAHWCDisplay::CreateLayer),
@@ -231,6 +241,10 @@ iahwc_function_ptr_t IAHWC::HookGetFunctionPtr(iahwc_device_t* /* device */,
       return ToHook<IAHWC_PFN_LAYER_SET_INDEX>(
           LayerHook<decltype(&IAHWCLayer::SetLayerIndex),
                     &IAHWCLayer::SetLayerIndex, uint32_t>);
+    case IAHWC_FUNC_LAYER_SET_COMPOSITION_QUALITY:
+      return ToHook<IAHWC_PFN_LAYER_SET_COMPOSITION_QUALITY>(
+          LayerHook<decltype(&IAHWCLayer::SetLayerCompositionQuality),
+                    &IAHWCLayer::SetLayerCompositionQuality, int32_t>);
     case IAHWC_FUNC_INVALID:
     default:
       return NULL;
@@ -406,6 +420,31 @@ int IAHWC::IAHWCDisplay::EnableOverlayUsage() {
   return 0;
 }
 
+int IAHWC::IAHWCDisplay::SetIdleHysteresis(uint32_t min_idle_frames,
+                                           uint32_t max_idle_frames,
+                                           uint32_t exit_frames) {
+  native_display_->SetIdleHysteresis(min_idle_frames, max_idle_frames,
+                                     exit_frames);
+  return 0;
+}
+
+int IAHWC::IAHWCDisplay::GetFrameStageTiming(uint32_t stage,
+                                             iahwc_stage_timing_t* timing) {
+  if (stage >= IAHWC_FRAME_STAGE_COUNT)
+    return IAHWC_ERROR_BAD_PARAMETER;
+
+  hwcomposer::HWCStageTiming stage_timing;
+  if (!native_display_->GetFrameStageTiming(
+          static_cast<hwcomposer::HWCFrameStage>(stage), &stage_timing))
+    return IAHWC_ERROR_UNSUPPORTED;
+
+  timing->count = stage_timing.count_;
+  timing->p50_us = stage_timing.p50_us_;
+  timing->p99_us = stage_timing.p99_us_;
+  timing->max_us = stage_timing.max_us_;
+  return IAHWC_ERROR_NONE;
+}
+
 void IAHWC::IAHWCDisplay::Synchronize() {
   raw_data_uploader_->Synchronize();
 }
@@ -673,6 +712,28 @@ int IAHWC::IAHWCLayer::SetLayerIndex(uint32_t layer_index) {
   return IAHWC_ERROR_NONE;
 }
 
+int IAHWC::IAHWCLayer::SetLayerCompositionQuality(int32_t quality) {
+  switch (quality) {
+    case IAHWC_COMPOSITION_QUALITY_FULL:
+      iahwc_layer_.SetCompositionQuality(
+          hwcomposer::HWCCompositionQuality::kFull);
+      break;
+    case IAHWC_COMPOSITION_QUALITY_HALF:
+      iahwc_layer_.SetCompositionQuality(
+          hwcomposer::HWCCompositionQuality::kHalf);
+      break;
+    case IAHWC_COMPOSITION_QUALITY_QUARTER:
+      iahwc_layer_.SetCompositionQuality(
+          hwcomposer::HWCCompositionQuality::kQuarter);
+      break;
+    default:
+      ETRACE("Unknown composition quality %d", quality);
+      return IAHWC_ERROR_BAD_PARAMETER;
+  }
+
+  return IAHWC_ERROR_NONE;
+}
+
 hwcomposer::HwcLayer* IAHWC::IAHWCLayer::GetLayer() {
   return &iahwc_layer_;
 }
@@ -54,6 +54,7 @@ class IAHWC : public iahwc_device {
     int SetLayerSurfaceDamage(iahwc_region_t region);
     int SetLayerPlaneAlpha(float alpha);
     int SetLayerIndex(uint32_t layer_index);
+    int SetLayerCompositionQuality(int32_t quality);
     uint32_t GetLayerIndex() {
       return layer_index_;
     }
@@ -105,6 +106,11 @@ class IAHWC : public iahwc_device {
 
     int EnableOverlayUsage();
 
+    int SetIdleHysteresis(uint32_t min_idle_frames, uint32_t max_idle_frames,
+                          uint32_t exit_frames);
+
+    int GetFrameStageTiming(uint32_t stage, iahwc_stage_timing_t* timing);
+
     void Synchronize() override;
 
     int RegisterHotPlugCallback(iahwc_callback_data_t data,
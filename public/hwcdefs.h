@@ -51,6 +51,17 @@ enum HWCContentType {
   kCONTENT_TYPE1,  // Can support only HDCP 2.2 and higher specification.
 };
 
+// Resolution the content of a layer may be composed at by the GPU, before
+// being upscaled by the display plane. Only layers whose content doesn't
+// suffer from being scaled, i.e. video backdrops or blurred backgrounds,
+// should allow a reduced resolution.
+enum class HWCCompositionQuality : int32_t {
+  kFull = 0,     // Compose at full resolution, i.e. text and UI.
+  kHalf = 1,     // Compose at half of the resolution in both directions.
+  kQuarter = 2,  // Compose at a quarter of the resolution in both
+                 // directions.
+};
+
 enum HWCTransform : uint32_t {
   kIdentity = 0,
   kReflectX = 1 << 0,
@@ -147,6 +158,24 @@ enum class HWCDisplayCapability : uint32_t {
   kDisplayCapabilityDoze = 2
 };
 
+// Stages of a frame timed by every display, see
+// NativeDisplay::GetFrameStageTiming.
+enum class HWCFrameStage : uint32_t {
+  kInitializeLayers = 0,  // Importing client layers.
+  kValidateLayers = 1,    // Assigning layers to planes.
+  kCompositorDraw = 2,    // Setting up and submitting GPU composition.
+  kFenceWait = 3,         // Waiting for rendering or the previous flip.
+  kAtomicCommit = 4,      // drmModeAtomicCommit.
+  kNumFrameStages = 5
+};
+
+struct HWCStageTiming {
+  uint64_t count_ = 0;  // Number of samples.
+  uint32_t p50_us_ = 0;
+  uint32_t p99_us_ = 0;
+  uint32_t max_us_ = 0;
+};
+
 struct EnumClassHash {
   template <typename T>
   std::size_t operator()(T t) const {
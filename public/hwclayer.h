@@ -120,6 +120,14 @@ struct HwcLayer {
     return state_ & kLayerContentChanged;
   }
 
+  /**
+   * API for querying in how many of the last 32 Present
+   * calls, including the one being prepared, content of
+   * this layer has changed. Layers updated every frame,
+   * i.e. video or games, report 32 and static ones 0.
+   */
+  uint32_t GetUpdateCount() const;
+
   /**
    * API for setting visible region for this layer. The
    * new visible region will take into effect in next Present
@@ -243,6 +251,23 @@ struct HwcLayer {
     return solid_color_;
   }
 
+  /**
+   * API for setting the resolution content of this layer may be composed
+   * at, in case it needs to be blended with other layers by the GPU.
+   * Defaults to HWCCompositionQuality::kFull.
+   */
+  void SetCompositionQuality(HWCCompositionQuality quality) {
+    composition_quality_ = quality;
+  }
+
+  /**
+   * API for getting the resolution content of this layer may be composed
+   * at.
+   */
+  HWCCompositionQuality GetCompositionQuality() const {
+    return composition_quality_;
+  }
+
   bool HasZorderChanged() const {
     return state_ & kZorderChanged;
   }
@@ -332,6 +357,7 @@ struct HwcLayer {
   HwcRect<int> visible_rect_;
   HwcRect<int> current_rendering_damage_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
+  HWCCompositionQuality composition_quality_ = HWCCompositionQuality::kFull;
   HWCNativeHandle sf_handle_ = 0;
   int32_t release_fd_ = -1;
   int32_t acquire_fence_ = -1;
@@ -342,6 +368,8 @@ struct HwcLayer {
   int z_order_ = -1;
   int state_ = kVisible | kVisibleRegionChanged | kZorderChanged;
   int layer_cache_ = kLayerAttributesChanged | kDisplayFrameRectChanged;
+  // Bit i is set if content changed i + 1 Present calls ago.
+  uint32_t update_history_ = 0;
   bool is_cursor_layer_ = false;
   bool is_video_layer_ = false;
   uint32_t solid_color_ = 0xff;
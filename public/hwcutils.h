@@ -43,6 +43,14 @@ int HWCPoll(int fd, int timeout);
 
 bool IsLayerAlphaBlendingCommitted(OverlayLayer* layer);
 
+/**
+ * Current time of CLOCK_MONOTONIC, which is also used for vblank
+ * timestamps.
+ *
+ * @return time in nanoseconds
+ */
+int64_t GetMonotonicTime();
+
 /**
  * Reset the bounds of a rectangle to enclose all rectangles in a region
  *
@@ -90,6 +98,15 @@ bool IsSupportedMediaFormat(uint32_t format);
  */
 uint32_t GetTotalPlanesForFormat(uint32_t format);
 
+/**
+ * Check how many bits per pixel are fetched for a given pixel format
+ *
+ * @param format fourcc based pixel format (see drm_fourcc.h)
+ * @return Average number of bits per pixel over all planes, 32 for
+ *         unknown formats
+ */
+uint32_t GetBitsPerPixelForFormat(uint32_t format);
+
 /**
  * Check if need to send all EDID, or only preferred and perf
  */
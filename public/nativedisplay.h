@@ -144,6 +144,54 @@ class NativeDisplay {
                        PixelUploaderCallback *call_back = NULL,
                        bool handle_constraints = false) = 0;
 
+  /**
+   * API for showing content on screen at a given time. Same as Present,
+   * except that the frame is shown at the vblank closest to
+   * target_timestamp. The frame is held and committed at the latest moment
+   * which still makes that vblank, based on measured validation,
+   * composition and commit durations. Displays which can't schedule
+   * presentation show the frame right away.
+   * @param target_timestamp in nanoseconds, using CLOCK_MONOTONIC like
+   *        vsync callbacks.
+   */
+  virtual bool PresentAt(std::vector<HwcLayer *> &source_layers,
+                         int32_t *retire_fence, int64_t /*target_timestamp*/,
+                         PixelUploaderCallback *call_back = NULL,
+                         bool handle_constraints = false) {
+    return Present(source_layers, retire_fence, call_back, handle_constraints);
+  }
+
+  /**
+   * API to get predicted time of the next vblank.
+   * @param timestamp set to time in nanoseconds, using CLOCK_MONOTONIC like
+   *        vsync callbacks.
+   * @return false if vblank time can't be predicted, i.e. display is off.
+   */
+  virtual bool GetNextVblankTime(int64_t * /*timestamp*/) {
+    return false;
+  }
+
+  /**
+   * API to tune the safety margin used by PresentAt and pipelined
+   * presentation. Margin is average of measured durations plus
+   * deviation_factor times their mean deviation plus slack_us.
+   */
+  virtual void SetPresentMarginTuning(uint32_t /*deviation_factor*/,
+                                      uint32_t /*slack_us*/) {
+  }
+
+  /**
+   * API to tune when the display is considered idle and all layers are
+   * composited into a single plane. The idle threshold is learned from
+   * the update rate of the display and kept between min_idle_frames and
+   * max_idle_frames vblanks. exit_frames is the number of updates after
+   * which planes are used again. Passing 0 keeps the current value.
+   */
+  virtual void SetIdleHysteresis(uint32_t /*min_idle_frames*/,
+                                 uint32_t /*max_idle_frames*/,
+                                 uint32_t /*exit_frames*/) {
+  }
+
   virtual int RegisterVsyncCallback(std::shared_ptr<VsyncCallback> callback,
                                     uint32_t display_id) = 0;
 
@@ -323,6 +371,92 @@ class NativeDisplay {
   virtual void SetDisableExplicitSync(bool /*explicit_sync_enabled*/) {
   }
 
+  /**
+   * API to enable pipelined presentation. depth is the maximum number of
+   * frames in flight. With 1 (default), Present returns once the frame has
+   * been flipped. With 2, frames are committed by a per display thread
+   * as late as possible before the next vblank and composition of the next
+   * frame overlaps with the flip. Present returns as soon as the frame has
+   * been queued. With explicit sync, the fences returned are signalled
+   * once the frame has been flipped, which needs sw_sync support; without
+   * it Present returns once the frame has been committed. A frame still
+   * waiting for its vblank is replaced by the next one. In case the
+   * thread can't be started, and for cloned displays, Present waits for
+   * the frame to be rendered and commits it itself, so composition of the
+   * next frame doesn't overlap with rendering of this one.
+   */
+  virtual void SetPipelineDepth(uint32_t /*depth*/) {
+  }
+
+  /**
+   * API to enable mailbox presentation, which implies a pipeline depth of
+   * 2. A frame which has not been committed yet is replaced by the next
+   * one, so a client presenting faster than the refresh rate only gets the
+   * latest frame within a vblank interval shown. With explicit sync, the
+   * release fences handed out for a replaced frame are signalled once the
+   * frame replacing it has been flipped.
+   */
+  virtual void SetMailboxMode(bool /*enable*/) {
+  }
+
+  /**
+   * API to query how many frames have been queued for the display and how
+   * many of them have been replaced by a later frame before reaching it.
+   * Returns false if not supported.
+   */
+  virtual bool GetFrameCoalescingStats(uint32_t* /*presented*/,
+                                       uint32_t* /*coalesced*/) {
+    return false;
+  }
+
+  /**
+   * API to set how much memory, in bytes, offscreen surfaces kept around
+   * to reuse the composition of layers which didn't change may use. 0
+   * disables the composition cache.
+   */
+  virtual void SetCompositionCacheBudget(uint64_t /*budget*/) {
+  }
+
+  /**
+   * API to query how often a plane needing GPU composition from scratch
+   * could reuse a cached composition instead (hits) and how often it had
+   * to be rendered (misses). Returns false if not supported.
+   */
+  virtual bool GetCompositionCacheStats(uint32_t* /*hits*/,
+                                        uint32_t* /*misses*/) {
+    return false;
+  }
+
+  /**
+   * API to set how much memory, in bytes, offscreen surfaces used for GPU
+   * composition may use. Surfaces which are not on screen anymore are kept
+   * around to be reused till this is exceeded, least recently used ones
+   * are released first. Defaults to six full screen surfaces.
+   */
+  virtual void SetOffScreenSurfaceBudget(uint64_t /*budget*/) {
+  }
+
+  /**
+   * API to query how long a stage of the frames presented so far took.
+   * Durations are collected in histograms with power of two buckets, so
+   * percentiles are accurate to a factor of 2. Returns false if not
+   * supported.
+   */
+  virtual bool GetFrameStageTiming(HWCFrameStage /*stage*/,
+                                   HWCStageTiming* /*timing*/) {
+    return false;
+  }
+
+  /**
+   * API to query how many frames have been composed by the GPU so far and
+   * how many draw calls were issued for them. Returns false if not
+   * supported.
+   */
+  virtual bool GetDrawCallStats(uint64_t* /*frames*/,
+                                uint64_t* /*draw_calls*/) {
+    return false;
+  }
+
   /**
    * API to connect the display. Note that this doesn't necessarily
    * mean display is turned on. Implementation is free to reset any display
@@ -273,6 +273,36 @@ class HotPlugEventCallback : public hwcomposer::DisplayHotPlugEventCallback {
     }
   }
 
+  void DumpFrameTimings() {
+    static const char *stage_names[] = {"InitializeLayers", "ValidateLayers",
+                                        "CompositorDraw", "FenceWait",
+                                        "AtomicCommit"};
+    hwcomposer::ScopedSpinLock lock(spin_lock_);
+    PopulateConnectedDisplays();
+
+    for (size_t i = 0; i < connected_displays_.size(); i++) {
+      printf("\nDisplay %zu stage timings (us)\n", i);
+      printf("%-18s%10s%10s%10s%10s\n", "Stage", "Count", "p50", "p99",
+             "Max");
+      for (uint32_t stage = 0; stage < ARRAY_SIZE(stage_names); stage++) {
+        hwcomposer::HWCStageTiming timing;
+        if (!connected_displays_.at(i)->GetFrameStageTiming(
+                static_cast<hwcomposer::HWCFrameStage>(stage), &timing))
+          break;
+
+        printf("%-18s%10llu%10u%10u%10u\n", stage_names[stage],
+               (unsigned long long)timing.count_, timing.p50_us_,
+               timing.p99_us_, timing.max_us_);
+      }
+
+      uint64_t frames = 0;
+      uint64_t draw_calls = 0;
+      if (connected_displays_.at(i)->GetDrawCallStats(&frames, &draw_calls))
+        printf("GPU composed frames: %llu draw calls: %llu\n",
+               (unsigned long long)frames, (unsigned long long)draw_calls);
+    }
+  }
+
   void SetGamma(float red, float green, float blue) {
     hwcomposer::ScopedSpinLock lock(spin_lock_);
     PopulateConnectedDisplays();
@@ -620,6 +650,9 @@ static void fill_hwclayer(hwcomposer::HwcLayer *pHwcLayer,
   pHwcLayer->SetDisplayFrame(hwcomposer::HwcRect<int>(
       pParameter->frame_x, pParameter->frame_y, pParameter->frame_width,
       pParameter->frame_height), 0, 0);
+  pHwcLayer->SetCompositionQuality(
+      static_cast<hwcomposer::HWCCompositionQuality>(
+          pParameter->composition_quality));
   pHwcLayer->SetNativeHandle(pRenderer->GetNativeBoHandle());
 }
 
@@ -958,6 +991,8 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  callback->DumpFrameTimings();
+
   callback->SetBroadcastRGB("Automatic");
   callback->SetGamma(1, 1, 1);
   callback->SetBrightness(0x80, 0x80, 0x80);
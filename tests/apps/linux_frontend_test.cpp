@@ -168,6 +168,7 @@ struct iahwc_backend {
   IAHWC_PFN_DISPLAY_SET_CONFIG iahwc_set_display_config;
   IAHWC_PFN_DISPLAY_GET_CONFIG iahwc_get_display_config;
   IAHWC_PFN_PRESENT_DISPLAY iahwc_present_display;
+  IAHWC_PFN_DISPLAY_GET_FRAME_STAGE_TIMING iahwc_get_frame_stage_timing;
   IAHWC_PFN_CREATE_LAYER iahwc_create_layer;
   IAHWC_PFN_LAYER_SET_BO iahwc_layer_set_bo;
   IAHWC_PFN_LAYER_SET_ACQUIRE_FENCE iahwc_layer_set_acquire_fence;
@@ -535,6 +536,25 @@ static void init_frames(int32_t width, int32_t height) {
   }
 }
 
+static void dump_frame_timings(iahwc_device_t *iahwc_device) {
+  static const char *stage_names[IAHWC_FRAME_STAGE_COUNT] = {
+      "InitializeLayers", "ValidateLayers", "CompositorDraw", "FenceWait",
+      "AtomicCommit"};
+
+  printf("\nStage timings (us)\n");
+  printf("%-18s%10s%10s%10s%10s\n", "Stage", "Count", "p50", "p99", "Max");
+  for (uint32_t stage = 0; stage < IAHWC_FRAME_STAGE_COUNT; stage++) {
+    iahwc_stage_timing_t timing;
+    if (backend->iahwc_get_frame_stage_timing(iahwc_device, 0, stage,
+                                              &timing) != IAHWC_ERROR_NONE)
+      break;
+
+    printf("%-18s%10llu%10u%10u%10u\n", stage_names[stage],
+           (unsigned long long)timing.count, timing.p50_us, timing.p99_us,
+           timing.max_us);
+  }
+}
+
 static void print_help(void) {
   printf(
       "usage: testjsonlayers [-h|--help] [-f|--frames <frames>] [-j|--json "
@@ -704,6 +724,9 @@ int main(int argc, char *argv[]) {
   backend->iahwc_register_callback =
       (IAHWC_PFN_REGISTER_CALLBACK)iahwc_device->getFunctionPtr(
           iahwc_device, IAHWC_FUNC_REGISTER_CALLBACK);
+  backend->iahwc_get_frame_stage_timing =
+      (IAHWC_PFN_DISPLAY_GET_FRAME_STAGE_TIMING)iahwc_device->getFunctionPtr(
+          iahwc_device, IAHWC_FUNC_DISPLAY_GET_FRAME_STAGE_TIMING);
 
   parse_args(argc, argv);
 
@@ -794,6 +817,7 @@ int main(int argc, char *argv[]) {
     frame_total++;
   }
 
+  dump_frame_timings(iahwc_device);
   reset_vt();
   return 0;
 }
@@ -53,6 +53,9 @@ bool parseParametersJson(const char* json_path, TEST_PARAMETERS* parameters) {
           } else if (strcmp(layer_key, "transform") == 0) {
             layer_parameter.transform =
                 (LAYER_TRANSFORM)json_object_get_int(layer_value);
+          } else if (strcmp(layer_key, "composition_quality") == 0) {
+            layer_parameter.composition_quality =
+                json_object_get_int(layer_value);
           } else if (strcmp(layer_key, "resource_path") == 0) {
             layer_parameter.resource_path =
                 std::string(json_object_get_string(layer_value));
@@ -225,6 +225,8 @@ typedef struct {
   uint32_t frame_y;
   uint32_t frame_width;
   uint32_t frame_height;
+  // See hwcomposer::HWCCompositionQuality.
+  uint32_t composition_quality = 0;
 } LAYER_PARAMETER;
 
 typedef std::vector<LAYER_PARAMETER> LAYER_PARAMETERS;
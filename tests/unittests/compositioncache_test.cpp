@@ -0,0 +1,249 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <drm_fourcc.h>
+
+#include <memory>
+#include <vector>
+
+#include "compositioncache.h"
+#include "displayplanemanager.h"
+#include "fakebuffer.h"
+#include "fakeplanes.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const uint32_t kWidth = 1920;
+static const uint32_t kHeight = 1080;
+static const uint32_t kFormat = DRM_FORMAT_ABGR8888;
+// Memory used by the three surfaces of a plane.
+static const uint64_t kPlaneSize = 3ULL * kWidth * kHeight * 4;
+
+// Full screen plane blending one layer, i.e. for GPU rotation.
+class Scene {
+ public:
+  Scene() : handler_(1, 2), manager_(&handler_, NULL), plane_(1) {
+  }
+
+  // Returns layers of a frame showing buffer.
+  std::vector<OverlayLayer> MakeFrame(
+      const std::shared_ptr<OverlayBuffer>& buffer) {
+    std::vector<OverlayLayer> layers(1);
+    layers[0].SetDisplayFrame(HwcRect<int>(0, 0, kWidth, kHeight));
+    layers[0].SetSourceCrop(HwcRect<float>(0, 0, kWidth, kHeight));
+    layers[0].SetBuffer(buffer, -1);
+    return layers;
+  }
+
+  // Returns a plane composing layers to surfaces of format, which are
+  // marked as shown in case on_screen is true. Planes get all three
+  // surfaces upfront, there is no resource manager to allocate them.
+  DisplayPlaneState MakePlane(std::vector<OverlayLayer>& layers,
+                              uint32_t format = kFormat,
+                              bool on_screen = true) {
+    DisplayPlaneState plane(&plane_, &layers[0], &manager_);
+    for (size_t i = 0; i < 3; i++) {
+      surfaces_.emplace_back(new FakeSurface(kWidth, kHeight, format));
+      plane.SetOffScreenTarget(surfaces_.back().get());
+    }
+
+    plane.ForceGPURendering();
+    if (on_screen) {
+      for (NativeSurface* surface : plane.GetSurfaces())
+        surface->SetSurfaceAge(0);
+    }
+
+    return plane;
+  }
+
+  FakePlaneHandler handler_;
+  DisplayPlaneManager manager_;
+  FakePlane plane_;
+  std::vector<std::unique_ptr<FakeSurface>> surfaces_;
+};
+
+static std::shared_ptr<OverlayBuffer> MakeBuffer() {
+  return std::make_shared<FakeBuffer>(kWidth, kHeight, kFormat);
+}
+
+static void TestHit() {
+  Scene scene;
+  std::vector<OverlayLayer> layers = scene.MakeFrame(MakeBuffer());
+  CompositionCache cache;
+  std::vector<NativeSurface*> evicted;
+  DisplayPlaneState retired = scene.MakePlane(layers);
+  std::vector<NativeSurface*> cached = retired.GetSurfaces();
+  EXPECT_TRUE(cache.Insert(retired, layers, evicted));
+  EXPECT_TRUE(evicted.empty());
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+
+  // Retiring the same plane again within a frame doesn't add an entry.
+  EXPECT_TRUE(cache.Insert(retired, layers, evicted));
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+
+  // A later frame showing the same layers takes the surfaces over.
+  std::vector<OverlayLayer> next =
+      scene.MakeFrame(layers[0].GetSharedBuffer());
+  DisplayPlaneState plane = scene.MakePlane(next);
+  std::vector<NativeSurface*> surfaces;
+  EXPECT_TRUE(cache.Lookup(plane, next, surfaces));
+  EXPECT_TRUE(surfaces == cached);
+  EXPECT_EQ(1u, cache.GetHits());
+  EXPECT_EQ(0u, cache.GetSize());
+
+  // Entries are handed out once.
+  surfaces.clear();
+  EXPECT_FALSE(cache.Lookup(plane, next, surfaces));
+  EXPECT_TRUE(surfaces.empty());
+  EXPECT_EQ(1u, cache.GetMisses());
+}
+
+static void TestMiss() {
+  Scene scene;
+  std::vector<OverlayLayer> layers = scene.MakeFrame(MakeBuffer());
+  CompositionCache cache;
+  std::vector<NativeSurface*> evicted;
+  EXPECT_TRUE(cache.Insert(scene.MakePlane(layers), layers, evicted));
+
+  // Different content.
+  std::vector<OverlayLayer> other = scene.MakeFrame(MakeBuffer());
+  std::vector<NativeSurface*> surfaces;
+  EXPECT_FALSE(cache.Lookup(scene.MakePlane(other), other, surfaces));
+
+  // Different position.
+  std::vector<OverlayLayer> moved =
+      scene.MakeFrame(layers[0].GetSharedBuffer());
+  moved[0].SetDisplayFrame(HwcRect<int>(0, 0, kWidth / 2, kHeight / 2));
+  EXPECT_FALSE(cache.Lookup(scene.MakePlane(moved), moved, surfaces));
+
+  // Same composition, but target surfaces of a different format.
+  EXPECT_FALSE(cache.Lookup(scene.MakePlane(layers, DRM_FORMAT_RGB565),
+                            layers, surfaces));
+  EXPECT_TRUE(surfaces.empty());
+  EXPECT_EQ(0u, cache.GetHits());
+  EXPECT_EQ(3u, cache.GetMisses());
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+
+  // Surfaces which haven't been shown yet aren't cached.
+  std::vector<OverlayLayer> pending = scene.MakeFrame(MakeBuffer());
+  EXPECT_FALSE(cache.Insert(scene.MakePlane(pending, kFormat, false),
+                            pending, evicted));
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+}
+
+static void TestEviction() {
+  Scene scene;
+  CompositionCache cache(2 * kPlaneSize);
+  std::vector<NativeSurface*> evicted;
+  std::vector<std::vector<OverlayLayer>> frames;
+  std::vector<std::vector<NativeSurface*>> cached;
+  for (int i = 0; i < 3; i++)
+    frames.emplace_back(scene.MakeFrame(MakeBuffer()));
+
+  for (std::vector<OverlayLayer>& layers : frames) {
+    DisplayPlaneState plane = scene.MakePlane(layers);
+    cached.emplace_back(plane.GetSurfaces());
+    EXPECT_TRUE(cache.Insert(plane, layers, evicted));
+  }
+
+  // Oldest entry doesn't fit in the budget anymore.
+  EXPECT_TRUE(evicted == cached[0]);
+  EXPECT_EQ(2 * kPlaneSize, cache.GetSize());
+  std::vector<NativeSurface*> surfaces;
+  EXPECT_FALSE(cache.Lookup(scene.MakePlane(frames[0]), frames[0], surfaces));
+
+  // Shrinking the budget drops least recently used entries first.
+  evicted.clear();
+  cache.SetBudget(kPlaneSize, evicted);
+  EXPECT_TRUE(evicted == cached[1]);
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+
+  // Compositions bigger than the budget aren't cached.
+  evicted.clear();
+  cache.SetBudget(kPlaneSize - 1, evicted);
+  EXPECT_TRUE(evicted == cached[2]);
+  EXPECT_EQ(0u, cache.GetSize());
+  EXPECT_FALSE(cache.Insert(scene.MakePlane(frames[2]), frames[2], evicted));
+
+  evicted.clear();
+  cache.SetBudget(0, evicted);
+  EXPECT_TRUE(evicted.empty());
+  EXPECT_FALSE(cache.Insert(scene.MakePlane(frames[2]), frames[2], evicted));
+}
+
+static void TestInvalidate() {
+  Scene scene;
+  CompositionCache cache;
+  std::vector<NativeSurface*> evicted;
+  std::vector<OverlayLayer> layers = scene.MakeFrame(MakeBuffer());
+  DisplayPlaneState plane = scene.MakePlane(layers);
+  std::vector<NativeSurface*> cached = plane.GetSurfaces();
+  EXPECT_TRUE(cache.Insert(plane, layers, evicted));
+
+  // Updates of other buffers don't matter.
+  std::vector<OverlayLayer> other = scene.MakeFrame(MakeBuffer());
+  EXPECT_TRUE(other[0].HasLayerContentChanged());
+  cache.Invalidate(other, evicted);
+  EXPECT_TRUE(evicted.empty());
+  EXPECT_EQ(kPlaneSize, cache.GetSize());
+
+  // Damage of a cached buffer drops the entry.
+  std::vector<OverlayLayer> damaged =
+      scene.MakeFrame(layers[0].GetSharedBuffer());
+  cache.Invalidate(damaged, evicted);
+  EXPECT_TRUE(evicted == cached);
+  EXPECT_EQ(0u, cache.GetSize());
+
+  // So does releasing a cached buffer.
+  std::vector<OverlayLayer> released = scene.MakeFrame(MakeBuffer());
+  plane = scene.MakePlane(released);
+  cached = plane.GetSurfaces();
+  EXPECT_TRUE(cache.Insert(plane, released, evicted));
+  released.clear();
+  evicted.clear();
+  cache.Invalidate(other, evicted);
+  EXPECT_TRUE(evicted == cached);
+  EXPECT_EQ(0u, cache.GetSize());
+}
+
+static void TestReset() {
+  Scene scene;
+  CompositionCache cache;
+  std::vector<NativeSurface*> evicted;
+  std::vector<OverlayLayer> first = scene.MakeFrame(MakeBuffer());
+  std::vector<OverlayLayer> second = scene.MakeFrame(MakeBuffer());
+  EXPECT_TRUE(cache.Insert(scene.MakePlane(first), first, evicted));
+  EXPECT_TRUE(cache.Insert(scene.MakePlane(second), second, evicted));
+  cache.Reset(evicted);
+  EXPECT_EQ(6u, evicted.size());
+  EXPECT_EQ(0u, cache.GetSize());
+
+  EXPECT_TRUE(cache.Insert(scene.MakePlane(first), first, evicted));
+  cache.Clear();
+  EXPECT_EQ(0u, cache.GetSize());
+  std::vector<NativeSurface*> surfaces;
+  EXPECT_FALSE(cache.Lookup(scene.MakePlane(first), first, surfaces));
+}
+
+int main() {
+  RUN_TEST(TestHit);
+  RUN_TEST(TestMiss);
+  RUN_TEST(TestEviction);
+  RUN_TEST(TestInvalidate);
+  RUN_TEST(TestReset);
+  return UNITTEST_RESULT();
+}
@@ -0,0 +1,276 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "compositorservice.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+// Long enough for a worker to pick up queued tasks, tests fail instead of
+// hanging in case it doesn't.
+static const std::chrono::seconds kTimeout(5);
+// Time given to a worker to do something it shouldn't.
+static const std::chrono::milliseconds kGrace(50);
+
+// Client counting the tasks queued with and handled by the service, like
+// CompositorThread does with its requests. Handling blocks while the
+// client is held, so that tests can queue tasks while it's running.
+class FakeClient : public CompositorServiceClient {
+ public:
+  void HandleTasks(CompositorRenderers& /*renderers*/) override {
+    std::unique_lock<std::mutex> lock(lock_);
+    if (running_)
+      overlapped_ = true;
+
+    running_ = true;
+    started_++;
+    changed_.notify_all();
+    changed_.wait(lock, [this] { return !held_; });
+    handled_tasks_ += queued_tasks_;
+    queued_tasks_ = 0;
+    handled_++;
+    running_ = false;
+    changed_.notify_all();
+  }
+
+  // Adds a task and hands it over to service, see CompositorThread::Kick.
+  void Kick(CompositorService& service) {
+    lock_.lock();
+    queued_tasks_++;
+    total_tasks_++;
+    lock_.unlock();
+    service.Queue(this);
+  }
+
+  void Hold() {
+    std::lock_guard<std::mutex> lock(lock_);
+    held_ = true;
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> lock(lock_);
+    held_ = false;
+    changed_.notify_all();
+  }
+
+  // Waits for tasks to be handled count times, or to be started in case
+  // of started. Returns false on timeout.
+  bool WaitFor(uint32_t count, bool started = false) {
+    std::unique_lock<std::mutex> lock(lock_);
+    return changed_.wait_for(lock, kTimeout, [this, count, started] {
+      return (started ? started_ : handled_) >= count;
+    });
+  }
+
+  uint32_t GetHandled() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return handled_;
+  }
+
+  // Returns true in case every task queued has been handled.
+  bool AllTasksHandled() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return queued_tasks_ == 0 && handled_tasks_ == total_tasks_;
+  }
+
+  // Returns true in case two workers handled the client at the same time.
+  bool Overlapped() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return overlapped_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable changed_;
+  uint32_t started_ = 0;
+  uint32_t handled_ = 0;
+  uint32_t queued_tasks_ = 0;
+  uint32_t handled_tasks_ = 0;
+  uint32_t total_tasks_ = 0;
+  bool held_ = false;
+  bool running_ = false;
+  bool overlapped_ = false;
+};
+
+static void TestQueue() {
+  CompositorService& service = CompositorService::getInstance();
+  FakeClient client;
+  EXPECT_TRUE(service.AddClient(&client));
+  // Adding a client twice doesn't do anything.
+  EXPECT_TRUE(service.AddClient(&client));
+  client.Kick(service);
+  EXPECT_TRUE(client.WaitFor(1));
+  service.RemoveClient(&client);
+  EXPECT_EQ(1u, client.GetHandled());
+  EXPECT_TRUE(client.AllTasksHandled());
+
+  // Tasks of removed clients are dropped.
+  client.Kick(service);
+  std::this_thread::sleep_for(kGrace);
+  EXPECT_EQ(1u, client.GetHandled());
+}
+
+static void TestQueueWhileRunning() {
+  CompositorService& service = CompositorService::getInstance();
+  FakeClient client;
+  EXPECT_TRUE(service.AddClient(&client));
+  client.Hold();
+  client.Kick(service);
+  EXPECT_TRUE(client.WaitFor(1, true));
+
+  // Tasks queued while running are handled in one go afterwards, by one
+  // worker at a time.
+  client.Kick(service);
+  client.Kick(service);
+  std::this_thread::sleep_for(kGrace);
+  EXPECT_EQ(0u, client.GetHandled());
+  client.Release();
+  EXPECT_TRUE(client.WaitFor(2));
+  service.RemoveClient(&client);
+  EXPECT_EQ(2u, client.GetHandled());
+  EXPECT_TRUE(client.AllTasksHandled());
+  EXPECT_FALSE(client.Overlapped());
+}
+
+static void TestRemoveWaitsForQueuedTasks() {
+  CompositorService& service = CompositorService::getInstance();
+  FakeClient client;
+  EXPECT_TRUE(service.AddClient(&client));
+  client.Hold();
+  client.Kick(service);
+  EXPECT_TRUE(client.WaitFor(1, true));
+  client.Kick(service);
+
+  std::atomic<bool> removed(false);
+  std::thread remover([&service, &client, &removed] {
+    service.RemoveClient(&client);
+    removed = true;
+  });
+
+  std::this_thread::sleep_for(kGrace);
+  EXPECT_FALSE(removed);
+  client.Release();
+  remover.join();
+  EXPECT_EQ(2u, client.GetHandled());
+  EXPECT_TRUE(client.AllTasksHandled());
+}
+
+static void TestBusyClientDoesNotBlockOthers() {
+  CompositorService& service = CompositorService::getInstance();
+  std::vector<std::unique_ptr<FakeClient>> clients;
+  for (int i = 0; i < 3; i++) {
+    clients.emplace_back(new FakeClient());
+    EXPECT_TRUE(service.AddClient(clients.back().get()));
+  }
+
+  // Whichever worker is home of the busy client, the other one handles
+  // the remaining clients.
+  FakeClient& busy = *clients[0];
+  busy.Hold();
+  busy.Kick(service);
+  EXPECT_TRUE(busy.WaitFor(1, true));
+  for (int round = 1; round <= 3; round++) {
+    for (size_t i = 1; i < clients.size(); i++) {
+      clients[i]->Kick(service);
+      EXPECT_TRUE(clients[i]->WaitFor(round));
+    }
+  }
+
+  busy.Release();
+  for (std::unique_ptr<FakeClient>& client : clients) {
+    service.RemoveClient(client.get());
+    EXPECT_TRUE(client->AllTasksHandled());
+  }
+}
+
+static void TestReleaseBeforeExit() {
+  // CompositorThread::ExitThread queues a release of its resources and
+  // removes itself right away. The release has to be handled first, also
+  // in case a draw is still running.
+  CompositorService& service = CompositorService::getInstance();
+  for (int i = 0; i < 100; i++) {
+    FakeClient client;
+    EXPECT_TRUE(service.AddClient(&client));
+    bool drawing = i % 2;
+    if (drawing) {
+      client.Hold();
+      client.Kick(service);
+      EXPECT_TRUE(client.WaitFor(1, true));
+      client.Release();
+    }
+
+    client.Kick(service);
+    service.RemoveClient(&client);
+    EXPECT_TRUE(client.AllTasksHandled());
+    EXPECT_TRUE(client.GetHandled() >= 1u);
+  }
+}
+
+static void TestConcurrentClients() {
+  // Displays queue tasks, are added and removed from their own threads.
+  CompositorService& service = CompositorService::getInstance();
+  const int kClients = 4;
+  const int kRuns = 20;
+  const int kKicks = 50;
+  std::vector<std::unique_ptr<FakeClient>> clients;
+  for (int i = 0; i < kClients * kRuns; i++)
+    clients.emplace_back(new FakeClient());
+
+  std::vector<std::thread> displays;
+  for (int i = 0; i < kClients; i++) {
+    displays.emplace_back([&service, &clients, i, kRuns, kKicks] {
+      for (int run = 0; run < kRuns; run++) {
+        FakeClient* client = clients[i * kRuns + run].get();
+        service.AddClient(client);
+        for (int kick = 0; kick < kKicks; kick++) {
+          client->Kick(service);
+          if (kick % 8 == 0)
+            std::this_thread::yield();
+        }
+
+        service.RemoveClient(client);
+      }
+    });
+  }
+
+  for (std::thread& display : displays)
+    display.join();
+
+  for (std::unique_ptr<FakeClient>& client : clients) {
+    EXPECT_TRUE(client->AllTasksHandled());
+    EXPECT_FALSE(client->Overlapped());
+  }
+}
+
+int main() {
+  RUN_TEST(TestQueue);
+  RUN_TEST(TestQueueWhileRunning);
+  RUN_TEST(TestRemoveWaitsForQueuedTasks);
+  RUN_TEST(TestBusyClientDoesNotBlockOthers);
+  RUN_TEST(TestReleaseBeforeExit);
+  RUN_TEST(TestConcurrentClients);
+  return UNITTEST_RESULT();
+}
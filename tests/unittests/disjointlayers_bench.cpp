@@ -0,0 +1,122 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures get_draw_regions on random stacks of 1080p layers. Compares the
+// previous implementation with the current one on up to 64 layers, and
+// the narrow (RectIDs) with the wide (WideRectIDs) id sets. Build with
+// "make -C tests disjointlayers_bench", optionally pass the number of
+// iterations per stack.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "disjoint_layers.h"
+#include "legacydisjointlayers.h"
+
+using namespace hwcomposer;
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+static const size_t kStacks = 50;
+
+// Returns stacks of count layers, from full screen to small widgets.
+static std::vector<std::vector<Rect<int>>> MakeStacks(size_t count) {
+  std::mt19937 rng(count);
+  std::uniform_int_distribution<int> x(0, kWidth - 1);
+  std::uniform_int_distribution<int> y(0, kHeight - 1);
+  std::vector<std::vector<Rect<int>>> stacks(kStacks);
+  for (std::vector<Rect<int>>& stack : stacks) {
+    for (size_t i = 0; i < count; i++) {
+      int left = x(rng);
+      int top = y(rng);
+      std::uniform_int_distribution<int> width(1, kWidth - left);
+      std::uniform_int_distribution<int> height(1, kHeight - top);
+      stack.emplace_back(left, top, left + width(rng), top + height(rng));
+    }
+  }
+
+  return stacks;
+}
+
+// Returns average time in microseconds get_draw_regions took for stacks,
+// and the average number of regions in regions.
+template <typename TRegions>
+static double Measure(const std::vector<std::vector<Rect<int>>>& stacks,
+                      int iterations,
+                      void (*get_regions)(const std::vector<Rect<int>>&,
+                                          const HwcRect<int>&, TRegions*),
+                      double* regions) {
+  HwcRect<int> screen(0, 0, kWidth, kHeight);
+  TRegions out;
+  size_t total_regions = 0;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (const std::vector<Rect<int>>& stack : stacks) {
+    for (int i = 0; i < iterations; i++) {
+      out.clear();
+      get_regions(stack, screen, &out);
+    }
+
+    total_regions += out.size();
+  }
+
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  *regions = (double)total_regions / stacks.size();
+  return elapsed.count() / (stacks.size() * iterations);
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::max(atoi(argv[1]), 1) : 20;
+  void (*legacy_regions)(const std::vector<Rect<int>>&, const HwcRect<int>&,
+                         std::vector<RectSet<int>>*) =
+      legacy::get_draw_regions;
+  void (*narrow_regions)(const std::vector<Rect<int>>&, const HwcRect<int>&,
+                         std::vector<RectSet<int>>*) = get_draw_regions;
+  void (*wide_regions)(const std::vector<Rect<int>>&, const HwcRect<int>&,
+                       std::vector<RectSet<int, WideRectIDs>>*) =
+      get_draw_regions;
+
+  printf("%6s %22s %22s %22s\n", "layers", "legacy us (regions)",
+         "narrow us (regions)", "wide us (regions)");
+  for (size_t count = 2; count <= WideRectIDs::max_elements; count *= 2) {
+    std::vector<std::vector<Rect<int>>> stacks = MakeStacks(count);
+    double wide_count;
+    double wide_us = Measure(stacks, iterations, wide_regions, &wide_count);
+    if (count > RectIDs::max_elements) {
+      printf("%6zu %22s %22s %12.1f (%7.0f)\n", count, "-", "-", wide_us,
+             wide_count);
+      continue;
+    }
+
+    double legacy_count;
+    double narrow_count;
+    double legacy_us =
+        Measure(stacks, iterations, legacy_regions, &legacy_count);
+    double narrow_us =
+        Measure(stacks, iterations, narrow_regions, &narrow_count);
+    printf("%6zu %12.1f (%7.0f) %12.1f (%7.0f) %12.1f (%7.0f)\n", count,
+           legacy_us, legacy_count, narrow_us, narrow_count, wide_us,
+           wide_count);
+  }
+
+  return 0;
+}
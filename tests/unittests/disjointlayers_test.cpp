@@ -0,0 +1,272 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "disjoint_layers.h"
+#include "legacydisjointlayers.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+static const size_t kStacks = 200;
+
+// Returns count random rects on the screen. In case of shared_edges, edges
+// are mostly snapped to a coarse grid, so that rects share edges like
+// windows and toasts do.
+static std::vector<Rect<int>> MakeStack(std::mt19937 &rng, size_t count,
+                                        bool shared_edges = true) {
+  std::uniform_int_distribution<int> x(0, kWidth);
+  std::uniform_int_distribution<int> y(0, kHeight);
+  std::uniform_int_distribution<int> snap(0, 3);
+  std::vector<Rect<int>> rects;
+  for (size_t i = 0; i < count; i++) {
+    int x1 = x(rng);
+    int x2 = x(rng);
+    int y1 = y(rng);
+    int y2 = y(rng);
+    if (shared_edges && snap(rng)) {
+      x1 &= ~127;
+      x2 &= ~127;
+      y1 &= ~127;
+      y2 &= ~127;
+    }
+
+    rects.emplace_back(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2),
+                       std::max(y1, y2));
+  }
+
+  return rects;
+}
+
+// Grid made of all edges of a stack of rects and of the damage region. Any
+// correct split of the stack into disjoint regions consists of whole cells.
+class Grid {
+ public:
+  Grid(const std::vector<Rect<int>> &in, const HwcRect<int> &damage) {
+    for (const Rect<int> &rect : in) {
+      xs_.emplace_back(rect.left);
+      xs_.emplace_back(rect.right);
+      ys_.emplace_back(rect.top);
+      ys_.emplace_back(rect.bottom);
+    }
+
+    xs_.emplace_back(damage.left);
+    xs_.emplace_back(damage.right);
+    ys_.emplace_back(damage.top);
+    ys_.emplace_back(damage.bottom);
+    std::sort(xs_.begin(), xs_.end());
+    xs_.erase(std::unique(xs_.begin(), xs_.end()), xs_.end());
+    std::sort(ys_.begin(), ys_.end());
+    ys_.erase(std::unique(ys_.begin(), ys_.end()), ys_.end());
+  }
+
+  // Returns ids of the rects covering every cell inside damage.
+  template <typename TIds>
+  std::vector<TIds> Expected(const std::vector<Rect<int>> &in,
+                             const HwcRect<int> &damage) const {
+    std::vector<TIds> cells(xs_.size() * ys_.size());
+    for (size_t i = 0; i < in.size(); i++) {
+      Rect<int> rect(std::max(in[i].left, damage.left),
+                     std::max(in[i].top, damage.top),
+                     std::min(in[i].right, damage.right),
+                     std::min(in[i].bottom, damage.bottom));
+      if (rect.left >= rect.right || rect.top >= rect.bottom)
+        continue;
+
+      size_t x1, y1, x2, y2;
+      Cells(rect, &x1, &y1, &x2, &y2);
+      for (size_t y = y1; y < y2; y++) {
+        for (size_t x = x1; x < x2; x++)
+          cells[y * xs_.size() + x].add(i);
+      }
+    }
+
+    return cells;
+  }
+
+  // Returns ids of the regions covering every cell in cells. Returns false
+  // in case regions overlap or don't line up with the grid.
+  template <typename TIds>
+  bool Paint(const std::vector<RectSet<int, TIds>> &regions,
+             std::vector<TIds> *cells) const {
+    cells->assign(xs_.size() * ys_.size(), TIds());
+    for (const RectSet<int, TIds> &region : regions) {
+      size_t x1, y1, x2, y2;
+      if (!Cells(region.rect, &x1, &y1, &x2, &y2) || region.id_set.isEmpty())
+        return false;
+
+      for (size_t y = y1; y < y2; y++) {
+        for (size_t x = x1; x < x2; x++) {
+          TIds &cell = (*cells)[y * xs_.size() + x];
+          if (!cell.isEmpty())
+            return false;
+
+          cell = region.id_set;
+        }
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  bool Cells(const Rect<int> &rect, size_t *x1, size_t *y1, size_t *x2,
+             size_t *y2) const {
+    *x1 = std::lower_bound(xs_.begin(), xs_.end(), rect.left) - xs_.begin();
+    *x2 = std::lower_bound(xs_.begin(), xs_.end(), rect.right) - xs_.begin();
+    *y1 = std::lower_bound(ys_.begin(), ys_.end(), rect.top) - ys_.begin();
+    *y2 = std::lower_bound(ys_.begin(), ys_.end(), rect.bottom) - ys_.begin();
+    return *x2 < xs_.size() && xs_[*x1] == rect.left &&
+           xs_[*x2] == rect.right && *y2 < ys_.size() &&
+           ys_[*y1] == rect.top && ys_[*y2] == rect.bottom;
+  }
+
+  std::vector<int> xs_;
+  std::vector<int> ys_;
+};
+
+template <typename TIds>
+static bool IsSplitCorrectly(const std::vector<Rect<int>> &in,
+                             const HwcRect<int> &damage,
+                             const std::vector<RectSet<int, TIds>> &regions) {
+  Grid grid(in, damage);
+  std::vector<TIds> cells;
+  return grid.Paint(regions, &cells) &&
+         cells == grid.Expected<TIds>(in, damage);
+}
+
+// Returns the full screen or a random part of it.
+static HwcRect<int> MakeDamage(std::mt19937 &rng) {
+  std::vector<Rect<int>> damage = MakeStack(rng, 1);
+  if (rng() % 2 || damage[0].left == damage[0].right ||
+      damage[0].top == damage[0].bottom)
+    return HwcRect<int>(0, 0, kWidth, kHeight);
+
+  return damage[0];
+}
+
+static void TestLayout() {
+  std::vector<RectSet<int>> out;
+  HwcRect<int> screen(0, 0, kWidth, kHeight);
+  std::vector<Rect<int>> in;
+  in.emplace_back(0, 0, kWidth, kHeight);
+  in.emplace_back(100, 100, 200, 200);
+  get_draw_regions(in, screen, &out);
+  // Columns left and right of the small rect, and the parts above, on and
+  // below it.
+  EXPECT_EQ(5u, out.size());
+  EXPECT_TRUE(IsSplitCorrectly(in, screen, out));
+
+  // Equal rects make a single region.
+  in[0] = in[1];
+  out.clear();
+  get_draw_regions(in, screen, &out);
+  EXPECT_EQ(1u, out.size());
+  EXPECT_TRUE(out[0].id_set == (RectIDs(0) | 1));
+
+  // Empty rects and parts outside damage are dropped.
+  in[0] = Rect<int>(300, 300, 300, 400);
+  out.clear();
+  get_draw_regions(in, HwcRect<int>(150, 0, kWidth, kHeight), &out);
+  EXPECT_EQ(1u, out.size());
+  EXPECT_TRUE(out[0] == RectSet<int>(RectIDs(1), Rect<int>(150, 100, 200,
+                                                            200)));
+}
+
+static void TestMatchesLegacy() {
+  // The previous implementation emits overlapping regions for some stacks
+  // with shared edges, so it's only compared on stacks without.
+  std::mt19937 rng(1);
+  for (size_t i = 0; i < kStacks; i++) {
+    std::vector<Rect<int>> in = MakeStack(rng, 2 + i % 63, false);
+    HwcRect<int> damage = MakeDamage(rng);
+    std::vector<RectSet<int>> out;
+    std::vector<RectSet<int>> legacy_out;
+    get_draw_regions(in, damage, &out);
+    legacy::get_draw_regions(in, damage, &legacy_out);
+    Grid grid(in, damage);
+    std::vector<RectIDs> cells;
+    std::vector<RectIDs> legacy_cells;
+    EXPECT_TRUE(grid.Paint(out, &cells));
+    EXPECT_TRUE(grid.Paint(legacy_out, &legacy_cells));
+    EXPECT_TRUE(cells == legacy_cells);
+    // Neighbouring bands with the same rects are merged.
+    EXPECT_TRUE(out.size() <= legacy_out.size());
+  }
+}
+
+static void TestSharedEdges() {
+  std::mt19937 rng(4);
+  for (size_t i = 0; i < kStacks; i++) {
+    std::vector<Rect<int>> in = MakeStack(rng, 2 + i % 63);
+    HwcRect<int> damage = MakeDamage(rng);
+    std::vector<RectSet<int>> out;
+    get_draw_regions(in, damage, &out);
+    EXPECT_TRUE(IsSplitCorrectly(in, damage, out));
+  }
+}
+
+static void TestWideMatchesNarrow() {
+  std::mt19937 rng(2);
+  for (size_t i = 0; i < kStacks; i++) {
+    std::vector<Rect<int>> in = MakeStack(rng, 1 + i % 64);
+    HwcRect<int> damage = MakeDamage(rng);
+    std::vector<RectSet<int>> out;
+    std::vector<RectSet<int, WideRectIDs>> wide_out;
+    get_draw_regions(in, damage, &out);
+    get_draw_regions(in, damage, &wide_out);
+    EXPECT_EQ(out.size(), wide_out.size());
+    for (size_t j = 0; j < out.size() && j < wide_out.size(); j++) {
+      EXPECT_TRUE(out[j].rect == wide_out[j].rect);
+      for (size_t id = 0; id < in.size(); id++)
+        EXPECT_EQ(out[j].id_set.test(id), wide_out[j].id_set.test(id));
+    }
+  }
+}
+
+static void TestMoreThan64Rects() {
+  std::mt19937 rng(3);
+  for (size_t i = 0; i < kStacks / 4; i++) {
+    std::vector<Rect<int>> in = MakeStack(rng, 65 + i * 191 / (kStacks / 4));
+    HwcRect<int> damage = MakeDamage(rng);
+    std::vector<RectSet<int, WideRectIDs>> out;
+    get_draw_regions(in, damage, &out);
+    EXPECT_TRUE(IsSplitCorrectly(in, damage, out));
+  }
+
+  // Too many rects for the id sets.
+  HwcRect<int> screen(0, 0, kWidth, kHeight);
+  std::vector<RectSet<int>> out;
+  get_draw_regions(MakeStack(rng, 65), screen, &out);
+  EXPECT_TRUE(out.empty());
+  std::vector<RectSet<int, WideRectIDs>> wide_out;
+  get_draw_regions(MakeStack(rng, 257), screen, &wide_out);
+  EXPECT_TRUE(wide_out.empty());
+}
+
+int main() {
+  RUN_TEST(TestLayout);
+  RUN_TEST(TestMatchesLegacy);
+  RUN_TEST(TestSharedEdges);
+  RUN_TEST(TestWideMatchesNarrow);
+  RUN_TEST(TestMoreThan64Rects);
+  return UNITTEST_RESULT();
+}
@@ -0,0 +1,146 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_UNITTESTS_FAKEBUFFER_H_
+#define TESTS_UNITTESTS_FAKEBUFFER_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "nativesurface.h"
+#include "overlaybuffer.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+// Buffer which isn't backed by any memory, only its size and format are
+// known.
+class FakeBuffer : public OverlayBuffer {
+ public:
+  FakeBuffer(uint32_t width, uint32_t height, uint32_t format)
+      : width_(width), height_(height), format_(format) {
+  }
+
+  void InitializeFromNativeHandle(
+      HWCNativeHandle /*handle*/,
+      ResourceManager* /*buffer_manager*/) override {
+  }
+
+  uint32_t GetDataSpace() const override {
+    return dataspace_;
+  }
+
+  uint32_t GetWidth() const override {
+    return width_;
+  }
+
+  uint32_t GetHeight() const override {
+    return height_;
+  }
+
+  uint32_t GetFormat() const override {
+    return format_;
+  }
+
+  HWCLayerType GetUsage() const override {
+    return kLayerNormal;
+  }
+
+  uint32_t GetFb(bool* /*isNewCreated*/) override {
+    return 0;
+  }
+
+  uint32_t GetPrimeFD() const override {
+    return 0;
+  }
+
+  const uint32_t* GetPitches() const override {
+    return pitches_;
+  }
+
+  const uint32_t* GetOffsets() const override {
+    return offsets_;
+  }
+
+  uint32_t GetTilingMode() const override {
+    return 0;
+  }
+
+  void SetDataSpace(uint32_t dataspace) override {
+    dataspace_ = dataspace;
+  }
+
+  bool GetInterlace() override {
+    return false;
+  }
+
+  void SetInterlace(bool /*isInterlaced*/) override {
+  }
+
+  const ResourceHandle& GetGpuResource(GpuDisplay /*egl_display*/,
+                                       bool /*external_import*/) override {
+    return resource_;
+  }
+
+  const ResourceHandle& GetGpuResource() override {
+    return resource_;
+  }
+
+  const MediaResourceHandle& GetMediaResource(MediaDisplay /*display*/,
+                                              uint32_t /*width*/,
+                                              uint32_t /*height*/) override {
+    return media_resource_;
+  }
+
+  bool CreateFrameBufferWithModifier(uint64_t /*modifier*/) override {
+    return false;
+  }
+
+  HWCNativeHandle GetOriginalHandle() const override {
+    return handle_;
+  }
+
+  void SetOriginalHandle(HWCNativeHandle handle) override {
+    handle_ = handle;
+  }
+
+  void Dump() override {
+  }
+
+ private:
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t format_;
+  uint32_t dataspace_ = 0;
+  uint32_t pitches_[4] = {0, 0, 0, 0};
+  uint32_t offsets_[4] = {0, 0, 0, 0};
+  ResourceHandle resource_;
+  MediaResourceHandle media_resource_;
+  HWCNativeHandle handle_ = 0;
+};
+
+// Offscreen surface using a FakeBuffer.
+class FakeSurface : public NativeSurface {
+ public:
+  FakeSurface(uint32_t width, uint32_t height, uint32_t format)
+      : NativeSurface(width, height) {
+    layer_.SetBuffer(std::make_shared<FakeBuffer>(width, height, format), -1);
+  }
+};
+
+}  // namespace hwcomposer
+#endif  // TESTS_UNITTESTS_FAKEBUFFER_H_
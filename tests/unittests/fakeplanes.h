@@ -0,0 +1,171 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_UNITTESTS_FAKEPLANES_H_
+#define TESTS_UNITTESTS_FAKEPLANES_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "displayplane.h"
+#include "displayplanehandler.h"
+#include "displayplanestate.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+// Plane which can scan out any layer, unless limited to some formats or
+// to layers which don't need scaling.
+class FakePlane : public DisplayPlane {
+ public:
+  explicit FakePlane(uint32_t id) : id_(id) {
+  }
+
+  uint32_t id() const override {
+    return id_;
+  }
+
+  bool ValidateLayer(const OverlayLayer* layer) override {
+    if (scaling_)
+      return true;
+
+    return layer->GetSourceCropWidth() == layer->GetDisplayFrameWidth() &&
+           layer->GetSourceCropHeight() == layer->GetDisplayFrameHeight();
+  }
+
+  bool IsSupportedFormat(uint32_t format) override {
+    return formats_.empty() ||
+           std::find(formats_.begin(), formats_.end(), format) !=
+               formats_.end();
+  }
+
+  // Formats the plane can scan out, any if empty.
+  void SetFormats(const std::vector<uint32_t>& formats) {
+    formats_ = formats;
+  }
+
+  void SetScaling(bool scaling) {
+    scaling_ = scaling;
+  }
+
+  bool IsSupportedTransform(uint32_t /*transform*/) const override {
+    return true;
+  }
+
+  uint32_t GetPreferredVideoFormat() const override {
+    return 0;
+  }
+
+  uint32_t GetPreferredFormat() const override {
+    return 0;
+  }
+
+  uint64_t GetPreferredFormatModifier() const override {
+    return 0;
+  }
+
+  void BlackListPreferredFormatModifier() override {
+  }
+
+  void PreferredFormatModifierValidated() override {
+  }
+
+  void SetInUse(bool in_use) override {
+    in_use_ = in_use;
+  }
+
+  bool InUse() const override {
+    return in_use_;
+  }
+
+  bool IsUniversal() override {
+    return true;
+  }
+
+  void Dump() const override {
+  }
+
+ private:
+  uint32_t id_;
+  bool in_use_ = false;
+  bool scaling_ = true;
+  std::vector<uint32_t> formats_;
+};
+
+// Handler of planes with ids first_id to first_id + count - 1, or with
+// the given ids. Test commits fail in case a plane marked as failing
+// scans out a layer.
+class FakePlaneHandler : public DisplayPlaneHandler {
+ public:
+  FakePlaneHandler(uint32_t first_id, uint32_t count,
+                   PlaneBroker* broker = NULL)
+      : broker_(broker) {
+    for (uint32_t i = 0; i < count; i++)
+      ids_.emplace_back(first_id + i);
+  }
+
+  FakePlaneHandler(const std::vector<uint32_t>& ids, PlaneBroker* broker)
+      : ids_(ids), broker_(broker) {
+  }
+
+  bool PopulatePlanes(
+      std::vector<std::unique_ptr<DisplayPlane>>& overlay_planes) override {
+    for (uint32_t id : ids_)
+      overlay_planes.emplace_back(new FakePlane(id));
+
+    return true;
+  }
+
+  bool TestCommit(const DisplayPlaneStateList& composition) const override {
+    test_commits_++;
+    for (const DisplayPlaneState& plane : composition) {
+      uint32_t id = plane.GetDisplayPlane()->id();
+      if (plane.Scanout() &&
+          std::find(failing_.begin(), failing_.end(), id) != failing_.end())
+        return false;
+    }
+
+    return true;
+  }
+
+  PlaneBroker* GetPlaneBroker() const override {
+    return broker_;
+  }
+
+  void SetFailing(const std::vector<uint32_t>& failing) {
+    failing_ = failing;
+  }
+
+  uint32_t GetTestCommits() const {
+    return test_commits_;
+  }
+
+  void ResetTestCommits() {
+    test_commits_ = 0;
+  }
+
+ private:
+  std::vector<uint32_t> ids_;
+  PlaneBroker* broker_;
+  std::vector<uint32_t> failing_;
+  mutable uint32_t test_commits_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // TESTS_UNITTESTS_FAKEPLANES_H_
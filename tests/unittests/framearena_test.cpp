@@ -0,0 +1,172 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Growths are only counted in debug builds.
+#undef NDEBUG
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "framearena.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+// Storage is recycled up to two frames after it has been allocated.
+static const uint32_t kWarmUpFrames = 4;
+static const uint32_t kFrames = 100;
+
+struct Layer {
+  int32_t frame_[4];
+  uint32_t z_order_;
+};
+
+// Per frame storage handled like DisplayQueue does: layers of a frame are
+// swapped into in_flight_layers_ once committed, and the storage of the
+// frame before is recycled.
+class Queue {
+ public:
+  void QueueUpdate(uint32_t layers, uint32_t planes) {
+    for (uint32_t i = 0; i < layers; i++)
+      frame_layers_.push_back(Layer{{0, 0, 1920, 1080}, i});
+
+    for (uint32_t i = 0; i < planes; i++)
+      frame_planes_.emplace_back(i);
+
+    in_flight_layers_.swap(frame_layers_);
+    previous_planes_.swap(frame_planes_);
+    arena_.Recycle(frame_layers_);
+    arena_.Recycle(frame_planes_);
+    arena_.EndFrame();
+  }
+
+  FrameArena arena_;
+
+ private:
+  std::vector<Layer> frame_layers_;
+  std::vector<Layer> in_flight_layers_;
+  std::vector<uint32_t> frame_planes_;
+  std::vector<uint32_t> previous_planes_;
+};
+
+// Per frame storage handled like Compositor::Draw does: storage of the
+// previous frame is recycled first, states are then handed over to the
+// compositor thread which swaps the ones it's done with back.
+class Compositor {
+ public:
+  void Draw(uint32_t regions) {
+    arena_.Recycle(draw_state_);
+    arena_.EndFrame();
+    for (uint32_t i = 0; i < regions; i++)
+      draw_state_.emplace_back(i);
+
+    thread_state_.swap(draw_state_);
+  }
+
+  FrameArena arena_;
+
+ private:
+  std::vector<uint32_t> draw_state_;
+  std::vector<uint32_t> thread_state_;
+};
+
+static void TestSteadyFramesDontGrow() {
+  Queue queue;
+  for (uint32_t i = 0; i < kWarmUpFrames; i++)
+    queue.QueueUpdate(8, 4);
+
+  uint32_t growths = queue.arena_.GetGrowthCount();
+  EXPECT_TRUE(growths > 0);
+  for (uint32_t i = 0; i < kFrames; i++)
+    queue.QueueUpdate(8, 4);
+
+  EXPECT_EQ(growths, queue.arena_.GetGrowthCount());
+
+  // Fewer layers fit into storage of the frames before.
+  for (uint32_t i = 0; i < kFrames; i++)
+    queue.QueueUpdate(i % 8, i % 4);
+
+  EXPECT_EQ(growths, queue.arena_.GetGrowthCount());
+
+  Compositor compositor;
+  for (uint32_t i = 0; i < kWarmUpFrames; i++)
+    compositor.Draw(16);
+
+  growths = compositor.arena_.GetGrowthCount();
+  for (uint32_t i = 0; i < kFrames; i++)
+    compositor.Draw(16 - i % 16);
+
+  EXPECT_EQ(growths, compositor.arena_.GetGrowthCount());
+}
+
+static void TestMoreLayersGrow() {
+  Queue queue;
+  for (uint32_t i = 0; i < kWarmUpFrames; i++)
+    queue.QueueUpdate(8, 4);
+
+  // Both buffers of the double buffered storage need to grow.
+  uint32_t growths = queue.arena_.GetGrowthCount();
+  for (uint32_t i = 0; i < kWarmUpFrames; i++)
+    queue.QueueUpdate(64, 4);
+
+  EXPECT_EQ(growths + 2, queue.arena_.GetGrowthCount());
+  growths = queue.arena_.GetGrowthCount();
+  for (uint32_t i = 0; i < kFrames; i++)
+    queue.QueueUpdate(64, 4);
+
+  EXPECT_EQ(growths, queue.arena_.GetGrowthCount());
+}
+
+static void TestGrowthOfSwappedStorage() {
+  // One buffer of a swapped pair growing while still being smaller than
+  // the other one is a growth too.
+  FrameArena arena;
+  std::vector<uint32_t> storage(1000);
+  std::vector<uint32_t> in_flight(10);
+  for (uint32_t i = 0; i < kWarmUpFrames; i++) {
+    storage.swap(in_flight);
+    arena.Recycle(storage);
+    arena.EndFrame();
+  }
+
+  uint32_t growths = arena.GetGrowthCount();
+  for (uint32_t i = 0; i < kFrames; i++) {
+    storage.resize(10);
+    storage.swap(in_flight);
+    arena.Recycle(storage);
+    arena.EndFrame();
+  }
+
+  EXPECT_EQ(growths, arena.GetGrowthCount());
+  std::vector<uint32_t>& small =
+      storage.capacity() < in_flight.capacity() ? storage : in_flight;
+  small.resize(500);
+  for (uint32_t i = 0; i < 2; i++) {
+    storage.swap(in_flight);
+    arena.Recycle(storage);
+    arena.EndFrame();
+  }
+
+  EXPECT_EQ(growths + 1, arena.GetGrowthCount());
+}
+
+int main() {
+  RUN_TEST(TestSteadyFramesDontGrow);
+  RUN_TEST(TestMoreLayersGrow);
+  RUN_TEST(TestGrowthOfSwappedStorage);
+  return UNITTEST_RESULT();
+}
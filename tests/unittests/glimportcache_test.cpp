@@ -0,0 +1,119 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <hwcmeta.h>
+
+#include "glimportcache.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+// Files stand in for dma-bufs, imports are only identified by them.
+class Buffer {
+ public:
+  explicit Buffer(uint32_t gem_handle) : file_(tmpfile()) {
+    meta_.width_ = 64;
+    meta_.height_ = 64;
+    meta_.num_planes_ = 1;
+    meta_.pitches_[0] = 256;
+    meta_.offsets_[0] = 0;
+    meta_.gem_handles_[0] = gem_handle;
+    meta_.prime_fds_[0] = file_ ? fileno(file_) : -1;
+    meta_.fb_modifiers_[0] = 0;
+    meta_.fb_modifiers_[1] = 0;
+  }
+
+  ~Buffer() {
+    if (file_)
+      fclose(file_);
+  }
+
+  HwcMeta meta_;
+
+ private:
+  FILE* file_;
+};
+
+static EGLImageKHR GetImage(uintptr_t id) {
+  return reinterpret_cast<EGLImageKHR>(id);
+}
+
+static void TestImportsAreShared() {
+  Buffer buffer(1);
+  EXPECT_TRUE(GLImportCache::Add(buffer.meta_, 0, GetImage(1), 10));
+  EXPECT_FALSE(GLImportCache::Add(buffer.meta_, 0, GetImage(2), 20));
+
+  // Another import of the buffer, e.g. on a cloned display, has another
+  // fd for the same dma-buf.
+  Buffer clone(1);
+  clone.meta_.prime_fds_[0] = dup(buffer.meta_.prime_fds_[0]);
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  GLuint texture = 0;
+  EXPECT_TRUE(GLImportCache::Acquire(clone.meta_, 0, &image, &texture));
+  EXPECT_TRUE(image == GetImage(1));
+  EXPECT_EQ(10u, texture);
+
+  // Imports of other formats or layouts aren't the same.
+  EXPECT_FALSE(GLImportCache::Acquire(clone.meta_, 1, &image, &texture));
+  clone.meta_.pitches_[0] = 512;
+  EXPECT_FALSE(GLImportCache::Acquire(clone.meta_, 0, &image, &texture));
+  close(clone.meta_.prime_fds_[0]);
+
+  EXPECT_FALSE(GLImportCache::Release(GetImage(1)));
+  EXPECT_TRUE(GLImportCache::Release(GetImage(1)));
+}
+
+static void TestReusedGemHandles() {
+  // GEM handles are closed once a display purges a buffer, so its handle
+  // number can show up with another buffer while the import is in use.
+  Buffer buffer(5);
+  Buffer reused(5);
+  EXPECT_TRUE(GLImportCache::Add(buffer.meta_, 0, GetImage(1), 10));
+
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  GLuint texture = 0;
+  EXPECT_FALSE(GLImportCache::Acquire(reused.meta_, 0, &image, &texture));
+  EXPECT_TRUE(GLImportCache::Add(reused.meta_, 0, GetImage(2), 20));
+  EXPECT_TRUE(GLImportCache::Acquire(buffer.meta_, 0, &image, &texture));
+  EXPECT_TRUE(image == GetImage(1));
+
+  EXPECT_FALSE(GLImportCache::Release(GetImage(1)));
+  EXPECT_TRUE(GLImportCache::Release(GetImage(1)));
+  EXPECT_TRUE(GLImportCache::Release(GetImage(2)));
+}
+
+static void TestUnknownBuffers() {
+  // Buffers whose dma-bufs can't be identified are never shared.
+  Buffer buffer(1);
+  buffer.meta_.prime_fds_[0] = -1;
+  EXPECT_FALSE(GLImportCache::Add(buffer.meta_, 0, GetImage(1), 10));
+
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  GLuint texture = 0;
+  EXPECT_FALSE(GLImportCache::Acquire(buffer.meta_, 0, &image, &texture));
+  EXPECT_TRUE(GLImportCache::Release(GetImage(1)));
+}
+
+int main() {
+  RUN_TEST(TestImportsAreShared);
+  RUN_TEST(TestReusedGemHandles);
+  RUN_TEST(TestUnknownBuffers);
+  return UNITTEST_RESULT();
+}
@@ -0,0 +1,196 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <stdint.h>
+
+#include "idlepolicy.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+// Drives policy like DisplayQueue does, see HandleIdleCase and
+// ScopedIdleStateTracker.
+class Display {
+ public:
+  explicit Display(IdlePolicy& policy) : policy_(policy) {
+  }
+
+  void Vblanks(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (idle_)
+        policy_.AddIdleModeVblank();
+
+      uint32_t threshold = policy_.GetIdleThreshold();
+      if (idle_frames_ > threshold)
+        continue;
+
+      idle_frames_++;
+      if (idle_frames_ > threshold && !idle_)
+        refresh_requested_ = true;
+    }
+  }
+
+  // Presents a frame, the one composing the display into a single plane
+  // in case a refresh has been requested.
+  void Present() {
+    uint32_t idle_frames = idle_frames_;
+    idle_frames_ = 0;
+    if (refresh_requested_) {
+      refresh_requested_ = false;
+      idle_ = true;
+      policy_.EnteredIdleMode();
+    } else if (idle_) {
+      policy_.OnPresent(idle_frames, true);
+      if (policy_.ShouldExitIdleMode()) {
+        idle_ = false;
+        policy_.ExitedIdleMode();
+      }
+    } else {
+      policy_.OnPresent(idle_frames, false);
+    }
+  }
+
+  // Presents count frames, every interval vblanks.
+  void Update(uint32_t count, uint32_t interval) {
+    for (uint32_t i = 0; i < count; i++) {
+      Vblanks(interval);
+      Present();
+    }
+  }
+
+  bool IsIdle() const {
+    return idle_;
+  }
+
+  bool RefreshRequested() const {
+    return refresh_requested_;
+  }
+
+ private:
+  IdlePolicy& policy_;
+  uint32_t idle_frames_ = 0;
+  bool idle_ = false;
+  bool refresh_requested_ = false;
+};
+
+static void TestThresholdWithoutSamples() {
+  IdlePolicy policy;
+  EXPECT_EQ(250u, policy.GetIdleThreshold());
+  policy.SetHysteresis(4, 100, 0);
+  EXPECT_EQ(100u, policy.GetIdleThreshold());
+}
+
+static void TestLearnsCadence() {
+  // Missing four of the usual updates makes the display idle.
+  IdlePolicy steady;
+  steady.SetHysteresis(4, 250, 3);
+  Display(steady).Update(30, 5);
+  EXPECT_EQ(20u, steady.GetIdleThreshold());
+
+  IdlePolicy sporadic;
+  sporadic.SetHysteresis(4, 250, 3);
+  Display(sporadic).Update(30, 40);
+  EXPECT_EQ(160u, sporadic.GetIdleThreshold());
+
+  // Cadence moves with a moving average, so a steady display slowing
+  // down gets a longer threshold over time.
+  Display display(steady);
+  display.Update(4, 40);
+  uint32_t threshold = steady.GetIdleThreshold();
+  EXPECT_TRUE(threshold > 20u && threshold < 160u);
+  display.Update(60, 40);
+  threshold = steady.GetIdleThreshold();
+  EXPECT_TRUE(threshold >= 158u && threshold <= 160u);
+}
+
+static void TestThresholdIsClamped() {
+  IdlePolicy policy;
+  Display display(policy);
+  display.Update(30, 1);
+  EXPECT_EQ(60u, policy.GetIdleThreshold());
+  display.Update(60, 100);
+  EXPECT_EQ(250u, policy.GetIdleThreshold());
+
+  // Same minimum and maximum disable learning.
+  policy.SetHysteresis(30, 30, 0);
+  EXPECT_EQ(30u, policy.GetIdleThreshold());
+  display.Update(60, 1);
+  EXPECT_EQ(30u, policy.GetIdleThreshold());
+
+  // Minimum is kept below maximum.
+  policy.SetHysteresis(300, 0, 0);
+  EXPECT_EQ(30u, policy.GetIdleThreshold());
+}
+
+static void TestEnterAndExitIdleMode() {
+  IdlePolicy policy;
+  policy.SetHysteresis(4, 250, 3);
+  Display display(policy);
+  display.Update(30, 5);
+  EXPECT_EQ(20u, policy.GetIdleThreshold());
+
+  // Not idle before the threshold has been crossed.
+  display.Vblanks(20);
+  EXPECT_FALSE(display.RefreshRequested());
+  display.Vblanks(1);
+  EXPECT_TRUE(display.RefreshRequested());
+  display.Present();
+  EXPECT_TRUE(display.IsIdle());
+  EXPECT_EQ(1u, policy.GetEnterCount());
+  EXPECT_EQ(0u, policy.GetExitCount());
+
+  // Updates coming slower than the threshold keep the display idle.
+  display.Update(2, 30);
+  EXPECT_TRUE(display.IsIdle());
+  EXPECT_EQ(0u, policy.GetExitCount());
+  EXPECT_EQ(60u, policy.GetIdleModeVblanks());
+
+  // As do less than exit_frames busy updates in a row.
+  display.Update(2, 1);
+  display.Update(1, 40);
+  EXPECT_TRUE(display.IsIdle());
+
+  display.Update(3, 1);
+  EXPECT_FALSE(display.IsIdle());
+  EXPECT_EQ(1u, policy.GetEnterCount());
+  EXPECT_EQ(1u, policy.GetExitCount());
+  EXPECT_EQ(105u, policy.GetIdleModeVblanks());
+
+  // Idle vblanks are only counted in idle mode.
+  display.Update(10, 5);
+  EXPECT_EQ(105u, policy.GetIdleModeVblanks());
+}
+
+static void TestReset() {
+  IdlePolicy policy;
+  policy.SetHysteresis(4, 250, 3);
+  Display(policy).Update(30, 5);
+  EXPECT_EQ(20u, policy.GetIdleThreshold());
+  policy.Reset();
+  EXPECT_EQ(250u, policy.GetIdleThreshold());
+  // The first sample after a reset is taken as is.
+  Display(policy).Update(1, 10);
+  EXPECT_EQ(40u, policy.GetIdleThreshold());
+}
+
+int main() {
+  RUN_TEST(TestThresholdWithoutSamples);
+  RUN_TEST(TestLearnsCadence);
+  RUN_TEST(TestThresholdIsClamped);
+  RUN_TEST(TestEnterAndExitIdleMode);
+  RUN_TEST(TestReset);
+  return UNITTEST_RESULT();
+}
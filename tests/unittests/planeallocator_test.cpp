@@ -0,0 +1,252 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <memory>
+#include <vector>
+
+#include "fakeplanes.h"
+#include "overlaylayer.h"
+#include "planeallocator.h"
+#include "planecostmodel.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const uint64_t kScanoutCost = 100;
+static const uint64_t kGpuCost = 1000;
+static const uint32_t kFormatA = 1;
+static const uint32_t kFormatB = 2;
+
+static PlaneAllocator::LayerInfo MakeLayer(uint64_t plane_mask) {
+  PlaneAllocator::LayerInfo info;
+  info.display_frame_ = HwcRect<int>(0, 0, 1920, 1080);
+  info.scanout_cost_ = kScanoutCost;
+  info.gpu_cost_ = kGpuCost;
+  info.plane_mask_ = plane_mask;
+  return info;
+}
+
+// Returns mask of planes which can scan out a layer of format, scaled or
+// not, like DisplayPlaneManager does with the planes of a display.
+static uint64_t GetPlaneMask(
+    const std::vector<std::unique_ptr<FakePlane>>& planes, uint32_t format,
+    bool scaled) {
+  OverlayLayer layer;
+  layer.SetDisplayFrame(HwcRect<int>(0, 0, 1920, 1080));
+  if (scaled)
+    layer.SetSourceCrop(HwcRect<float>(0, 0, 960, 540));
+  else
+    layer.SetSourceCrop(HwcRect<float>(0, 0, 1920, 1080));
+
+  uint64_t mask = 0;
+  for (size_t i = 0; i < planes.size(); i++) {
+    if (planes[i]->IsSupportedFormat(format) &&
+        planes[i]->ValidateLayer(&layer))
+      mask |= 1ULL << i;
+  }
+
+  return mask;
+}
+
+static std::vector<size_t> Groups(size_t first, size_t second) {
+  std::vector<size_t> groups;
+  groups.emplace_back(first);
+  if (second)
+    groups.emplace_back(second);
+
+  return groups;
+}
+
+static void TestOneLayerPerPlane() {
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(3, MakeLayer(0xf));
+  std::vector<size_t> group_sizes;
+  EXPECT_TRUE(allocator.Allocate(layers, 4, group_sizes));
+  EXPECT_TRUE(group_sizes == std::vector<size_t>(3, 1));
+}
+
+static void TestMoreLayersThanPlanes() {
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(7, MakeLayer(0x7));
+  std::vector<size_t> group_sizes;
+  EXPECT_TRUE(allocator.Allocate(layers, 3, group_sizes));
+  EXPECT_TRUE(group_sizes.size() <= 3);
+  size_t total = 0;
+  for (size_t size : group_sizes) {
+    EXPECT_TRUE(size > 0);
+    total += size;
+  }
+
+  EXPECT_EQ(layers.size(), total);
+  EXPECT_FALSE(allocator.Allocate(layers, 0, group_sizes));
+}
+
+static void TestFrequentlyUpdatedLayerGetsOwnPlane() {
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(3, MakeLayer(0x3));
+  std::vector<size_t> group_sizes;
+
+  // Static layers are blended together, the updated one is scanned out.
+  layers[0].update_count_ = 0;
+  layers[1].update_count_ = 0;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(2, 1));
+
+  layers[0].update_count_ = PlaneAllocator::kUpdateHistory;
+  layers[2].update_count_ = 0;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(1, 2));
+}
+
+static void TestSeparateLayersAreNotGrouped() {
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(4, MakeLayer(0x3));
+  std::vector<size_t> group_sizes;
+  layers[0].separate_ = true;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(1, 3));
+
+  // Layers on either side can't share its plane and there are only two.
+  layers[0].separate_ = false;
+  layers[1].separate_ = true;
+  EXPECT_FALSE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(allocator.Allocate(layers, 3, group_sizes));
+  EXPECT_TRUE(group_sizes.size() == 3 && group_sizes[1] == 1);
+}
+
+static void TestVideoIsNotGroupedWithUi() {
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(4, MakeLayer(0x3));
+  std::vector<size_t> group_sizes;
+  layers[2].video_ = true;
+  layers[3].video_ = true;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(2, 2));
+
+  layers[3].video_ = false;
+  EXPECT_FALSE(allocator.Allocate(layers, 2, group_sizes));
+}
+
+static void TestPickedStreamsAreNotGrouped() {
+  // Two streams scanned out directly and two blended by the media
+  // pipeline. Grouping the static streams would be cheapest, but picked
+  // ones need a plane each.
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers(4, MakeLayer(0xf));
+  std::vector<size_t> group_sizes;
+  for (PlaneAllocator::LayerInfo& layer : layers) {
+    layer.video_ = true;
+    layer.update_count_ = 0;
+  }
+
+  layers[0].separate_ = true;
+  layers[3].separate_ = true;
+  for (size_t num_planes = 3; num_planes <= 4; num_planes++) {
+    EXPECT_TRUE(allocator.Allocate(layers, num_planes, group_sizes));
+    size_t first = 0;
+    for (size_t size : group_sizes) {
+      for (size_t i = first; i < first + size; i++) {
+        if (layers[i].separate_)
+          EXPECT_EQ(1u, size);
+      }
+
+      first += size;
+    }
+
+    EXPECT_EQ(layers.size(), first);
+  }
+
+  // Picked streams and the ones between them need three planes.
+  EXPECT_FALSE(allocator.Allocate(layers, 2, group_sizes));
+
+  // Adjacent picked streams aren't grouped either.
+  layers[0].separate_ = false;
+  layers[3].separate_ = false;
+  layers[1].separate_ = true;
+  layers[2].separate_ = true;
+  EXPECT_FALSE(allocator.Allocate(layers, 3, group_sizes));
+  EXPECT_TRUE(allocator.Allocate(layers, 4, group_sizes));
+  EXPECT_TRUE(group_sizes == std::vector<size_t>(4, 1));
+}
+
+static void TestScalerCapabilities() {
+  // Bottom and top layers need scaling, only one of two planes has a
+  // scaler. The scaled layer which can be put on it is scanned out, the
+  // other one is grouped.
+  std::vector<std::unique_ptr<FakePlane>> planes;
+  planes.emplace_back(new FakePlane(1));
+  planes.emplace_back(new FakePlane(2));
+  planes[1]->SetScaling(false);
+
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers;
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatA, true)));
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatA, false)));
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatA, true)));
+  EXPECT_EQ(0x1u, layers[0].plane_mask_);
+  EXPECT_EQ(0x3u, layers[1].plane_mask_);
+
+  std::vector<size_t> group_sizes;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(1, 2));
+
+  planes[0]->SetScaling(false);
+  planes[1]->SetScaling(true);
+  layers[0].plane_mask_ = GetPlaneMask(planes, kFormatA, true);
+  layers[2].plane_mask_ = GetPlaneMask(planes, kFormatA, true);
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(2, 1));
+}
+
+static void TestFormatCapabilities() {
+  std::vector<std::unique_ptr<FakePlane>> planes;
+  planes.emplace_back(new FakePlane(1));
+  planes.emplace_back(new FakePlane(2));
+  planes[0]->SetFormats(std::vector<uint32_t>(1, kFormatA));
+
+  PlaneCostModel cost_model;
+  PlaneAllocator allocator(&cost_model);
+  std::vector<PlaneAllocator::LayerInfo> layers;
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatB, false)));
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatA, false)));
+  layers.emplace_back(MakeLayer(GetPlaneMask(planes, kFormatB, false)));
+  EXPECT_EQ(0x2u, layers[0].plane_mask_);
+
+  // Bottom layer can't be scanned out by the bottom plane, top one can
+  // use the top plane.
+  std::vector<size_t> group_sizes;
+  EXPECT_TRUE(allocator.Allocate(layers, 2, group_sizes));
+  EXPECT_TRUE(group_sizes == Groups(2, 1));
+}
+
+int main() {
+  RUN_TEST(TestOneLayerPerPlane);
+  RUN_TEST(TestMoreLayersThanPlanes);
+  RUN_TEST(TestFrequentlyUpdatedLayerGetsOwnPlane);
+  RUN_TEST(TestSeparateLayersAreNotGrouped);
+  RUN_TEST(TestVideoIsNotGroupedWithUi);
+  RUN_TEST(TestPickedStreamsAreNotGrouped);
+  RUN_TEST(TestScalerCapabilities);
+  RUN_TEST(TestFormatCapabilities);
+  return UNITTEST_RESULT();
+}
@@ -0,0 +1,255 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <drm_fourcc.h>
+
+#include <memory>
+#include <vector>
+
+#include "displayplanemanager.h"
+#include "fakebuffer.h"
+#include "fakeplanes.h"
+#include "planebroker.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const uint32_t kPipeA = 0;
+static const uint32_t kPipeB = 1;
+static const uint32_t kSize = 1024;
+
+// Records displays asked to compose a new frame.
+class RefreshRecorder : public PlaneBrokerCallback {
+ public:
+  void Callback(uint32_t pipe) override {
+    pipes_.emplace_back(pipe);
+  }
+
+  std::vector<uint32_t> pipes_;
+};
+
+static std::vector<uint32_t> Ids(uint32_t primary) {
+  std::vector<uint32_t> ids;
+  ids.emplace_back(primary);
+  ids.emplace_back(3);
+  ids.emplace_back(4);
+  return ids;
+}
+
+// Two displays with primary planes 1 and 2, sharing overlay planes 3 and
+// 4 which belong to display A.
+class Displays {
+ public:
+  Displays()
+      : handler_a_(Ids(1), &broker_),
+        handler_b_(Ids(2), &broker_),
+        manager_a_(&handler_a_, NULL),
+        manager_b_(&handler_b_, NULL) {
+    broker_.SetCallback(&recorder_);
+    layers_.resize(4);
+    for (OverlayLayer& layer : layers_) {
+      layer.SetDisplayFrame(HwcRect<int>(0, 0, kSize, kSize));
+      layer.SetSourceCrop(HwcRect<float>(0, 0, kSize, kSize));
+    }
+
+    manager_a_.Initialize(kPipeA, kSize, kSize);
+    manager_b_.Initialize(kPipeB, kSize, kSize);
+  }
+
+  // Adds a plane showing count layers to composition, blended by the GPU
+  // if there is more than one.
+  void AddPlane(DisplayPlaneManager& manager, size_t count,
+                DisplayPlaneStateList& composition) {
+    planes_.emplace_back(new FakePlane(planes_.size() + 10));
+    composition.emplace_back(planes_.back().get(), &layers_[0], &manager);
+    if (count < 2)
+      return;
+
+    DisplayPlaneState& plane = composition.back();
+    for (size_t i = 0; i < 3; i++) {
+      surfaces_.emplace_back(
+          new FakeSurface(kSize, kSize, DRM_FORMAT_XRGB8888));
+      plane.SetOffScreenTarget(surfaces_.back().get());
+    }
+
+    for (size_t i = 1; i < count; i++)
+      plane.AddLayer(&layers_[i]);
+  }
+
+  bool Owns(uint32_t pipe, uint32_t plane_id) const {
+    return broker_.IsOwner(pipe, plane_id);
+  }
+
+  PlaneBroker broker_;
+  RefreshRecorder recorder_;
+  FakePlaneHandler handler_a_;
+  FakePlaneHandler handler_b_;
+  DisplayPlaneManager manager_a_;
+  DisplayPlaneManager manager_b_;
+  std::vector<OverlayLayer> layers_;
+  std::vector<std::unique_ptr<FakePlane>> planes_;
+  std::vector<std::unique_ptr<FakeSurface>> surfaces_;
+};
+
+static std::vector<uint32_t> Planes(uint32_t first, uint32_t second = 0,
+                                    uint32_t third = 0) {
+  std::vector<uint32_t> planes(1, first);
+  if (second)
+    planes.emplace_back(second);
+  if (third)
+    planes.emplace_back(third);
+
+  return planes;
+}
+
+// Display A shows one layer, B had to blend three layers on its primary
+// plane and claims A's spare planes. A picks up the change with its next
+// frame.
+static void ClaimSparePlanes(Displays& d) {
+  DisplayPlaneStateList idle;
+  d.AddPlane(d.manager_a_, 1, idle);
+  EXPECT_FALSE(d.manager_a_.SyncSharedPlanes(idle, false));
+  d.broker_.FrameCommitted(kPipeA, Planes(1));
+
+  DisplayPlaneStateList busy;
+  d.AddPlane(d.manager_b_, 3, busy);
+  EXPECT_TRUE(d.manager_b_.SyncSharedPlanes(busy, false));
+  d.broker_.FrameCommitted(kPipeB, Planes(2, 3, 4));
+
+  EXPECT_TRUE(d.manager_a_.SyncSharedPlanes(idle, false));
+  d.broker_.FrameCommitted(kPipeA, Planes(1));
+}
+
+static void TestClaim() {
+  Displays d;
+  EXPECT_EQ(3u, d.manager_a_.GetTotalOverlays());
+  EXPECT_EQ(1u, d.manager_b_.GetTotalOverlays());
+  EXPECT_TRUE(d.Owns(kPipeA, 3));
+  EXPECT_FALSE(d.Owns(kPipeB, 3));
+
+  ClaimSparePlanes(d);
+  // Planes weren't on screen, no refresh of A needed.
+  EXPECT_TRUE(d.recorder_.pipes_.empty());
+  EXPECT_TRUE(d.Owns(kPipeB, 3));
+  EXPECT_TRUE(d.Owns(kPipeB, 4));
+  EXPECT_FALSE(d.Owns(kPipeA, 3));
+  EXPECT_EQ(3u, d.manager_b_.GetTotalOverlays());
+  EXPECT_EQ(1u, d.manager_a_.GetTotalOverlays());
+
+  // Nothing changes as long as demand is met.
+  DisplayPlaneStateList idle;
+  d.AddPlane(d.manager_a_, 1, idle);
+  EXPECT_FALSE(d.manager_a_.SyncSharedPlanes(idle, false));
+}
+
+static void TestNoClaimWhenLayersFit() {
+  Displays d;
+  DisplayPlaneStateList idle;
+  d.AddPlane(d.manager_a_, 1, idle);
+  EXPECT_FALSE(d.manager_a_.SyncSharedPlanes(idle, false));
+  d.broker_.FrameCommitted(kPipeA, Planes(1));
+
+  // One layer, or several with overlays disabled, don't need more planes.
+  DisplayPlaneStateList single;
+  d.AddPlane(d.manager_b_, 1, single);
+  EXPECT_FALSE(d.manager_b_.SyncSharedPlanes(single, false));
+  DisplayPlaneStateList blended;
+  d.AddPlane(d.manager_b_, 3, blended);
+  EXPECT_FALSE(d.manager_b_.SyncSharedPlanes(blended, true));
+  EXPECT_TRUE(d.Owns(kPipeA, 3));
+  EXPECT_TRUE(d.Owns(kPipeA, 4));
+
+  // A blends two of its three layers by choice, with a plane to spare.
+  // It keeps the two planes it uses and lends the other one.
+  DisplayPlaneStateList spare;
+  d.AddPlane(d.manager_a_, 2, spare);
+  d.AddPlane(d.manager_a_, 1, spare);
+  EXPECT_FALSE(d.manager_a_.SyncSharedPlanes(spare, false));
+  d.broker_.FrameCommitted(kPipeA, Planes(1, 4));
+  EXPECT_TRUE(d.manager_b_.SyncSharedPlanes(blended, false));
+  EXPECT_TRUE(d.Owns(kPipeB, 3));
+  EXPECT_TRUE(d.Owns(kPipeA, 4));
+  EXPECT_TRUE(d.recorder_.pipes_.empty());
+}
+
+static void TestTakeBack() {
+  Displays d;
+  ClaimSparePlanes(d);
+
+  // A ran out of planes, its planes are on screen on B.
+  DisplayPlaneStateList busy;
+  d.AddPlane(d.manager_a_, 3, busy);
+  EXPECT_FALSE(d.manager_a_.SyncSharedPlanes(busy, false));
+  EXPECT_TRUE(d.recorder_.pipes_ == std::vector<uint32_t>(1, kPipeB));
+  // B may not use them anymore, A doesn't get them before B turned them
+  // off.
+  EXPECT_FALSE(d.Owns(kPipeB, 3));
+  EXPECT_FALSE(d.Owns(kPipeA, 3));
+  d.broker_.FrameCommitted(kPipeA, Planes(1));
+
+  // B composes a frame without them.
+  DisplayPlaneStateList blended;
+  d.AddPlane(d.manager_b_, 3, blended);
+  EXPECT_TRUE(d.manager_b_.SyncSharedPlanes(blended, false));
+  EXPECT_EQ(1u, d.manager_b_.GetTotalOverlays());
+  d.broker_.FrameCommitted(kPipeB, Planes(2));
+  EXPECT_TRUE(d.Owns(kPipeA, 3));
+  EXPECT_TRUE(d.Owns(kPipeA, 4));
+  EXPECT_TRUE(d.manager_a_.SyncSharedPlanes(busy, false));
+  EXPECT_EQ(3u, d.manager_a_.GetTotalOverlays());
+  d.broker_.FrameCommitted(kPipeA, Planes(1, 3, 4));
+
+  // B picks up the hand-off. It keeps asking for planes, but A doesn't
+  // have any to spare.
+  EXPECT_TRUE(d.manager_b_.SyncSharedPlanes(blended, false));
+  EXPECT_FALSE(d.manager_b_.SyncSharedPlanes(blended, false));
+  EXPECT_TRUE(d.Owns(kPipeA, 3));
+  EXPECT_EQ(1u, d.recorder_.pipes_.size());
+}
+
+static void TestRelease() {
+  Displays d;
+  ClaimSparePlanes(d);
+
+  // Planes of a disabled display are handed over right away.
+  d.broker_.DisablePipe(kPipeB);
+  DisplayPlaneStateList busy;
+  d.AddPlane(d.manager_a_, 3, busy);
+  EXPECT_TRUE(d.manager_a_.SyncSharedPlanes(busy, false));
+  EXPECT_TRUE(d.recorder_.pipes_.empty());
+  EXPECT_TRUE(d.Owns(kPipeA, 3));
+  EXPECT_TRUE(d.Owns(kPipeA, 4));
+  EXPECT_EQ(3u, d.manager_a_.GetTotalOverlays());
+
+  // So are planes of a display which doesn't use them anymore.
+  Displays e;
+  ClaimSparePlanes(e);
+  e.broker_.FrameCommitted(kPipeB, Planes(2));
+  DisplayPlaneStateList blended;
+  e.AddPlane(e.manager_a_, 3, blended);
+  EXPECT_TRUE(e.manager_a_.SyncSharedPlanes(blended, false));
+  EXPECT_TRUE(e.recorder_.pipes_.empty());
+  EXPECT_TRUE(e.Owns(kPipeA, 3));
+  EXPECT_TRUE(e.Owns(kPipeA, 4));
+}
+
+int main() {
+  RUN_TEST(TestClaim);
+  RUN_TEST(TestNoClaimWhenLayersFit);
+  RUN_TEST(TestTakeBack);
+  RUN_TEST(TestRelease);
+  return UNITTEST_RESULT();
+}
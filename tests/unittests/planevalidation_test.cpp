@@ -0,0 +1,206 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <memory>
+#include <vector>
+
+#include "displayplanemanager.h"
+#include "fakeplanes.h"
+#include "planevalidationcache.h"
+#include "planevalidationstrategy.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const uint32_t kPlanes = 7;
+
+// Maps one layer to each of kPlanes planes.
+class Composition {
+ public:
+  Composition() : handler_(1, kPlanes), manager_(&handler_, NULL) {
+    layers_.resize(kPlanes);
+    for (uint32_t i = 0; i < kPlanes; i++) {
+      planes_.emplace_back(new FakePlane(i + 1));
+      int offset = static_cast<int>(i) * 10;
+      layers_[i].SetDisplayFrame(
+          HwcRect<int>(offset, offset, offset + 100, offset + 100));
+      layers_[i].SetSourceCrop(HwcRect<float>(0, 0, 100, 100));
+    }
+
+    for (uint32_t i = 0; i < kPlanes; i++)
+      composition_.emplace_back(planes_[i].get(), &layers_[i], &manager_);
+  }
+
+  FakePlaneHandler handler_;
+  DisplayPlaneManager manager_;
+  std::vector<std::unique_ptr<FakePlane>> planes_;
+  std::vector<OverlayLayer> layers_;
+  DisplayPlaneStateList composition_;
+};
+
+static uint32_t Log2Ceil(uint32_t value) {
+  uint32_t log = 0;
+  while ((1u << log) < value)
+    log++;
+
+  return log;
+}
+
+static void TestAllPlanesPass() {
+  Composition c;
+  BatchedPlaneValidationStrategy strategy(&c.handler_, NULL);
+  EXPECT_TRUE(strategy.DefersValidation());
+  EXPECT_TRUE(strategy.ValidatePlane(c.composition_));
+  EXPECT_EQ(-1, strategy.FindFailingPlane(c.composition_, 0));
+  EXPECT_EQ(1u, c.handler_.GetTestCommits());
+}
+
+static void TestBisectFindsFailingPlane() {
+  for (uint32_t failing = 0; failing < kPlanes; failing++) {
+    Composition c;
+    c.handler_.SetFailing(std::vector<uint32_t>(1, failing + 1));
+    BatchedPlaneValidationStrategy strategy(&c.handler_, NULL);
+    EXPECT_EQ(static_cast<int>(failing),
+              strategy.FindFailingPlane(c.composition_, 0));
+    // One commit of all planes, then bisection.
+    EXPECT_TRUE(c.handler_.GetTestCommits() <= 1 + Log2Ceil(kPlanes));
+
+    // Prefix commits must leave composition as it was.
+    EXPECT_EQ(kPlanes, c.composition_.size());
+    for (uint32_t i = 0; i < kPlanes; i++)
+      EXPECT_EQ(i + 1, c.composition_[i].GetDisplayPlane()->id());
+  }
+}
+
+static void TestBisectStartsAtBegin() {
+  // Planes before begin are known to work, the failing plane is searched
+  // in [begin, end) only.
+  Composition c;
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 6));
+  BatchedPlaneValidationStrategy strategy(&c.handler_, NULL);
+  EXPECT_EQ(5, strategy.FindFailingPlane(c.composition_, 3));
+  EXPECT_TRUE(c.handler_.GetTestCommits() <= 1 + Log2Ceil(kPlanes - 3));
+  EXPECT_EQ(-1, strategy.FindFailingPlane(c.composition_, kPlanes));
+}
+
+static void TestMultipleFailingPlanes() {
+  Composition c;
+  std::vector<uint32_t> failing;
+  failing.emplace_back(3);
+  failing.emplace_back(6);
+  c.handler_.SetFailing(failing);
+  BatchedPlaneValidationStrategy strategy(&c.handler_, NULL);
+  int index = strategy.FindFailingPlane(c.composition_, 0);
+  EXPECT_EQ(2, index);
+
+  // Caller moves the failing plane to GPU composition and checks again
+  // starting with it.
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 6));
+  index = strategy.FindFailingPlane(c.composition_, index);
+  EXPECT_EQ(5, index);
+
+  c.handler_.SetFailing(std::vector<uint32_t>());
+  EXPECT_EQ(-1, strategy.FindFailingPlane(c.composition_, index));
+}
+
+static void TestMovedPlaneStillFails() {
+  // A plane which fails also when composed offscreen is found again, so
+  // that the caller can give up on planning plane by plane.
+  Composition c;
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 4));
+  BatchedPlaneValidationStrategy strategy(&c.handler_, NULL);
+  int index = strategy.FindFailingPlane(c.composition_, 0);
+  EXPECT_EQ(3, index);
+  EXPECT_EQ(index, strategy.FindFailingPlane(c.composition_, index));
+}
+
+static void TestIncrementalValidatesEveryPlane() {
+  Composition c;
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 2));
+  IncrementalPlaneValidationStrategy strategy(&c.handler_, NULL);
+  EXPECT_FALSE(strategy.DefersValidation());
+  EXPECT_FALSE(strategy.ValidatePlane(c.composition_));
+  EXPECT_EQ(1u, c.handler_.GetTestCommits());
+  EXPECT_EQ(-1, strategy.FindFailingPlane(c.composition_, 0));
+}
+
+static void TestCachedTestCommits() {
+  Composition c;
+  PlaneValidationCache cache;
+  BatchedPlaneValidationStrategy strategy(&c.handler_, &cache);
+  EXPECT_TRUE(strategy.TestCommit(c.composition_));
+  EXPECT_TRUE(strategy.TestCommit(c.composition_));
+  EXPECT_EQ(1u, c.handler_.GetTestCommits());
+  EXPECT_EQ(1u, cache.GetHits());
+  EXPECT_EQ(1u, cache.GetMisses());
+
+  // A different mapping is a miss.
+  DisplayPlaneStateList shorter;
+  shorter.emplace_back(c.planes_[0].get(), &c.layers_[0], &c.manager_);
+  EXPECT_TRUE(strategy.TestCommit(shorter));
+  EXPECT_EQ(2u, c.handler_.GetTestCommits());
+
+  // Failed results are cached as well.
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 4));
+  cache.Reset();
+  EXPECT_FALSE(strategy.TestCommit(c.composition_));
+  EXPECT_FALSE(strategy.TestCommit(c.composition_));
+  EXPECT_EQ(3u, c.handler_.GetTestCommits());
+}
+
+static void TestCachedBisection() {
+  // Bisecting the same composition again is served from the cache.
+  Composition c;
+  c.handler_.SetFailing(std::vector<uint32_t>(1, 5));
+  PlaneValidationCache cache;
+  BatchedPlaneValidationStrategy strategy(&c.handler_, &cache);
+  EXPECT_EQ(4, strategy.FindFailingPlane(c.composition_, 0));
+  uint32_t commits = c.handler_.GetTestCommits();
+  EXPECT_EQ(4, strategy.FindFailingPlane(c.composition_, 0));
+  EXPECT_EQ(commits, c.handler_.GetTestCommits());
+}
+
+static void TestCacheEviction() {
+  PlaneValidationCache cache(2);
+  bool passed = false;
+  cache.Insert(1, true);
+  cache.Insert(2, false);
+  EXPECT_TRUE(cache.Lookup(1, &passed));
+  EXPECT_TRUE(passed);
+  // 2 is the least recently used entry now.
+  cache.Insert(3, true);
+  EXPECT_EQ(2u, cache.GetSize());
+  EXPECT_FALSE(cache.Lookup(2, &passed));
+  EXPECT_TRUE(cache.Lookup(1, &passed));
+  EXPECT_TRUE(cache.Lookup(3, &passed));
+
+  cache.Reset();
+  EXPECT_EQ(0u, cache.GetSize());
+  EXPECT_FALSE(cache.Lookup(1, &passed));
+}
+
+int main() {
+  RUN_TEST(TestAllPlanesPass);
+  RUN_TEST(TestBisectFindsFailingPlane);
+  RUN_TEST(TestBisectStartsAtBegin);
+  RUN_TEST(TestMultipleFailingPlanes);
+  RUN_TEST(TestMovedPlaneStillFails);
+  RUN_TEST(TestIncrementalValidatesEveryPlane);
+  RUN_TEST(TestCachedTestCommits);
+  RUN_TEST(TestCachedBisection);
+  RUN_TEST(TestCacheEviction);
+  return UNITTEST_RESULT();
+}
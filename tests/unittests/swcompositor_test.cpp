@@ -0,0 +1,343 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Composes planes with Compositor::Draw and the SW renderer, i.e. the
+// path DisplayQueue takes, and checks the pixels written to the plane's
+// surface. Only built with the SW compositor.
+
+#include <drm_fourcc.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <nativebufferhandler.h>
+
+#include "compositor.h"
+#include "displayplanemanager.h"
+#include "fakebuffer.h"
+#include "fakeplanes.h"
+#include "hwclayer.h"
+#include "resourcemanager.h"
+#include "swsurface.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+static const uint32_t kFormat = DRM_FORMAT_ABGR8888;
+
+// Maps buffers to the memory MemoryBuffer keeps. Buffers are never
+// created or imported.
+class MemoryBufferHandler : public NativeBufferHandler {
+ public:
+  bool CreateBuffer(uint32_t /*w*/, uint32_t /*h*/, int /*format*/,
+                    HWCNativeHandle* /*handle*/, uint32_t /*layer_type*/,
+                    bool* /*modifier_used*/, int64_t /*modifier*/,
+                    bool /*raw_pixel_buffer*/) const override {
+    return false;
+  }
+
+  bool ReleaseBuffer(HWCNativeHandle /*handle*/) const override {
+    return true;
+  }
+
+  void DestroyHandle(HWCNativeHandle /*handle*/) const override {
+  }
+
+  bool ImportBuffer(HWCNativeHandle /*handle*/) const override {
+    return false;
+  }
+
+  void CopyHandle(HWCNativeHandle /*source*/,
+                  HWCNativeHandle* /*target*/) const override {
+  }
+
+  uint32_t GetTotalPlanes(HWCNativeHandle /*handle*/) const override {
+    return 1;
+  }
+
+  void* Map(HWCNativeHandle handle, uint32_t /*x*/, uint32_t /*y*/,
+            uint32_t /*width*/, uint32_t /*height*/, uint32_t* stride,
+            void** /*map_data*/, size_t /*plane*/) const override {
+    *stride = handle->meta_data_.pitches_[0];
+    return handle->pixel_memory_;
+  }
+
+  int32_t UnMap(HWCNativeHandle /*handle*/,
+                void* /*map_data*/) const override {
+    return 0;
+  }
+
+  uint32_t GetFd() const override {
+    return 0;
+  }
+
+  bool GetInterlace(HWCNativeHandle /*handle*/) const override {
+    return false;
+  }
+};
+
+// ABGR8888 buffer in memory, pixels are r, g, b, a bytes.
+class MemoryBuffer : public FakeBuffer {
+ public:
+  MemoryBuffer(uint32_t width, uint32_t height,
+               const NativeBufferHandler* handler)
+      : FakeBuffer(width, height, kFormat),
+        width_(width),
+        pixels_(width * height * 4) {
+    handle_.meta_data_.width_ = width;
+    handle_.meta_data_.height_ = height;
+    handle_.meta_data_.format_ = kFormat;
+    handle_.meta_data_.pitches_[0] = width * 4;
+    handle_.meta_data_.num_planes_ = 1;
+    handle_.pixel_memory_ = pixels_.data();
+    resource_.handle_ = &handle_;
+    resource_.handler_ = handler;
+  }
+
+  const ResourceHandle& GetGpuResource(GpuDisplay /*egl_display*/,
+                                       bool /*external_import*/) override {
+    return resource_;
+  }
+
+  const ResourceHandle& GetGpuResource() override {
+    return resource_;
+  }
+
+  uint8_t* GetPixel(uint32_t x, uint32_t y) {
+    return &pixels_[(y * width_ + x) * 4];
+  }
+
+  void Fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    for (size_t i = 0; i < pixels_.size(); i += 4) {
+      pixels_[i] = r;
+      pixels_[i + 1] = g;
+      pixels_[i + 2] = b;
+      pixels_[i + 3] = a;
+    }
+  }
+
+ private:
+  uint32_t width_;
+  std::vector<uint8_t> pixels_;
+  gbm_handle handle_;
+  ResourceHandle resource_;
+};
+
+// Offscreen surface rendered to memory.
+class MemorySurface : public SWSurface {
+ public:
+  explicit MemorySurface(const std::shared_ptr<MemoryBuffer>& buffer)
+      : SWSurface(buffer->GetWidth(), buffer->GetHeight()) {
+    layer_.SetBuffer(buffer, -1);
+  }
+};
+
+// Returns true in case pixel is r, g, b, a. Allows for rounding.
+static bool PixelIs(const uint8_t* pixel, int r, int g, int b, int a) {
+  const int expected[4] = {r, g, b, a};
+  for (int i = 0; i < 4; i++) {
+    if (pixel[i] < expected[i] - 1 || pixel[i] > expected[i] + 1)
+      return false;
+  }
+
+  return true;
+}
+
+// Display of width x height, whose layers are composed into a single
+// plane. The plane gets all three surfaces upfront, the one added last is
+// drawn to.
+class Scene {
+ public:
+  Scene(uint32_t width, uint32_t height)
+      : width_(width),
+        height_(height),
+        plane_handler_(1, 1),
+        plane_manager_(&plane_handler_, NULL),
+        plane_(1),
+        resource_manager_(&buffer_handler_) {
+    for (size_t i = 0; i < 3; i++) {
+      target_ = std::make_shared<MemoryBuffer>(width, height,
+                                               &buffer_handler_);
+      surfaces_.emplace_back(new MemorySurface(target_));
+    }
+
+    compositor_.Init(&resource_manager_, 0);
+    compositor_.BeginFrame(false);
+  }
+
+  ~Scene() {
+    compositor_.Reset();
+  }
+
+  // Adds a layer showing source, which is shown at frame with transform.
+  // Layers are set up like solid color layers and get the buffer later,
+  // there is no resource manager which could import it.
+  void AddLayer(const std::shared_ptr<MemoryBuffer>& source,
+                const HwcRect<int>& frame, uint32_t transform,
+                HWCBlending blending, uint8_t alpha) {
+    HwcLayer hwc_layer;
+    hwc_layer.SetLayerCompositionType(Composition_SolidColor);
+    hwc_layer.SetTransform(transform);
+    hwc_layer.SetAlpha(alpha);
+    hwc_layer.SetBlending(blending);
+    hwc_layer.SetDisplayFrame(frame, 0, 0);
+    layers_.emplace_back();
+    OverlayLayer& layer = layers_.back();
+    layer.InitializeFromHwcLayer(&hwc_layer, NULL, NULL, layers_.size() - 1,
+                                 layers_.size() - 1, height_, width_,
+                                 kIdentity, false);
+    layer.SetBuffer(source, -1);
+    layer.SetSourceCrop(
+        HwcRect<float>(0, 0, source->GetWidth(), source->GetHeight()));
+  }
+
+  void AddSolidColor(const HwcRect<int>& frame, uint32_t color,
+                     uint8_t alpha) {
+    HwcLayer hwc_layer;
+    hwc_layer.SetLayerCompositionType(Composition_SolidColor);
+    hwc_layer.SetSolidColor(color);
+    hwc_layer.SetAlpha(alpha);
+    hwc_layer.SetBlending(HWCBlending::kBlendingPremult);
+    hwc_layer.SetDisplayFrame(frame, 0, 0);
+    layers_.emplace_back();
+    layers_.back().InitializeFromHwcLayer(&hwc_layer, NULL, NULL,
+                                          layers_.size() - 1,
+                                          layers_.size() - 1, height_,
+                                          width_, kIdentity, false);
+  }
+
+  // Composes all layers into surface_ like DisplayQueue would.
+  bool Draw() {
+    DisplayPlaneStateList planes;
+    planes.emplace_back(&plane_, &layers_[0], &plane_manager_);
+    DisplayPlaneState& plane = planes.back();
+    for (std::unique_ptr<MemorySurface>& surface : surfaces_)
+      plane.SetOffScreenTarget(surface.get());
+
+    for (size_t i = 1; i < layers_.size(); i++)
+      plane.AddLayer(&layers_[i]);
+
+    plane.ForceGPURendering();
+    return compositor_.Draw(planes, layers_);
+  }
+
+  uint8_t* GetPixel(uint32_t x, uint32_t y) {
+    return target_->GetPixel(x, y);
+  }
+
+ private:
+  uint32_t width_;
+  uint32_t height_;
+  FakePlaneHandler plane_handler_;
+  DisplayPlaneManager plane_manager_;
+  FakePlane plane_;
+  MemoryBufferHandler buffer_handler_;
+  ResourceManager resource_manager_;
+  std::shared_ptr<MemoryBuffer> target_;
+  std::vector<std::unique_ptr<MemorySurface>> surfaces_;
+  Compositor compositor_;
+  std::vector<OverlayLayer> layers_;
+};
+
+static void TestBlendSolidColor() {
+  // Half transparent red dialog on top of a green layer. Tall enough for
+  // regions of different widths to be split in bands drawn by several
+  // threads.
+  const uint32_t kWidth = 64;
+  const uint32_t kHeight = 160;
+  MemoryBufferHandler handler;
+  std::shared_ptr<MemoryBuffer> green =
+      std::make_shared<MemoryBuffer>(kWidth, kHeight, &handler);
+  green->Fill(0, 255, 0, 255);
+
+  Scene scene(kWidth, kHeight);
+  scene.AddLayer(green, HwcRect<int>(0, 0, kWidth, kHeight), kIdentity,
+                 HWCBlending::kBlendingNone, 255);
+  scene.AddSolidColor(HwcRect<int>(16, 40, 48, 120), 0xff0000ff, 128);
+  EXPECT_TRUE(scene.Draw());
+  for (uint32_t y = 0; y < kHeight; y++) {
+    for (uint32_t x = 0; x < kWidth; x++) {
+      bool dialog = x >= 16 && x < 48 && y >= 40 && y < 120;
+      if (dialog)
+        EXPECT_TRUE(PixelIs(scene.GetPixel(x, y), 128, 127, 0, 255));
+      else
+        EXPECT_TRUE(PixelIs(scene.GetPixel(x, y), 0, 255, 0, 255));
+    }
+  }
+}
+
+static void TestBlendCoverage() {
+  // Coverage layers are premultiplied by their pixels' alpha, on top of
+  // that layer alpha applies.
+  const uint32_t kSize = 16;
+  MemoryBufferHandler handler;
+  std::shared_ptr<MemoryBuffer> blue =
+      std::make_shared<MemoryBuffer>(kSize, kSize, &handler);
+  blue->Fill(0, 0, 255, 255);
+  std::shared_ptr<MemoryBuffer> red =
+      std::make_shared<MemoryBuffer>(kSize, kSize, &handler);
+  red->Fill(255, 0, 0, 128);
+
+  Scene scene(kSize, kSize);
+  scene.AddLayer(blue, HwcRect<int>(0, 0, kSize, kSize), kIdentity,
+                 HWCBlending::kBlendingNone, 255);
+  scene.AddLayer(red, HwcRect<int>(0, 0, kSize, kSize), kIdentity,
+                 HWCBlending::kBlendingCoverage, 128);
+  EXPECT_TRUE(scene.Draw());
+  // Red covers a quarter of blue.
+  EXPECT_TRUE(PixelIs(scene.GetPixel(0, 0), 64, 0, 191, 255));
+  EXPECT_TRUE(PixelIs(scene.GetPixel(kSize - 1, kSize - 1), 64, 0, 191, 255));
+}
+
+static void TestRotatedLayer() {
+  // Layer of 8x4 pixels, rotated by 90 degrees clockwise into a 4x8
+  // display. Red and green of a pixel are its position times 32.
+  const uint32_t kWidth = 8;
+  const uint32_t kHeight = 4;
+  MemoryBufferHandler handler;
+  std::shared_ptr<MemoryBuffer> source =
+      std::make_shared<MemoryBuffer>(kWidth, kHeight, &handler);
+  for (uint32_t y = 0; y < kHeight; y++) {
+    for (uint32_t x = 0; x < kWidth; x++) {
+      uint8_t* pixel = source->GetPixel(x, y);
+      pixel[0] = x * 32;
+      pixel[1] = y * 32;
+      pixel[3] = 255;
+    }
+  }
+
+  Scene scene(kHeight, kWidth);
+  scene.AddLayer(source, HwcRect<int>(0, 0, kHeight, kWidth), kTransform90,
+                 HWCBlending::kBlendingNone, 255);
+  EXPECT_TRUE(scene.Draw());
+  // Top left of the layer ends up at the top right of the display.
+  for (uint32_t y = 0; y < kWidth; y++) {
+    for (uint32_t x = 0; x < kHeight; x++) {
+      uint32_t source_x = y;
+      uint32_t source_y = kHeight - 1 - x;
+      EXPECT_TRUE(PixelIs(scene.GetPixel(x, y), source_x * 32,
+                          source_y * 32, 0, 255));
+    }
+  }
+}
+
+int main() {
+  RUN_TEST(TestBlendSolidColor);
+  RUN_TEST(TestBlendCoverage);
+  RUN_TEST(TestRotatedLayer);
+  return UNITTEST_RESULT();
+}
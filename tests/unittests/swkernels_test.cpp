@@ -0,0 +1,325 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <drm_fourcc.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "swkernels.h"
+#include "unittest.h"
+
+using namespace hwcomposer;
+
+// Kernels round differently depending on the instruction set, compare
+// floats and bytes with some slack.
+static const float kSlack = 1.0f / 255.0f;
+
+static bool Near(float expected, float actual) {
+  return fabsf(expected - actual) <= kSlack;
+}
+
+static bool NearByte(int expected, uint8_t actual) {
+  return expected - 1 <= actual && actual <= expected + 1;
+}
+
+// Returns true in case pixel is r, g, b, a.
+static bool PixelIs(const float* pixel, float r, float g, float b, float a) {
+  return Near(r, pixel[0]) && Near(g, pixel[1]) && Near(b, pixel[2]) &&
+         Near(a, pixel[3]);
+}
+
+// 4x4 ABGR8888 texture, i.e. r, g, b, a in memory. Red and green of a
+// texel are its x and y times 64, so that tests can tell where a sample
+// comes from.
+class Texture {
+ public:
+  Texture() : pixels_(kSize * kSize * 4) {
+    for (uint32_t y = 0; y < kSize; y++) {
+      for (uint32_t x = 0; x < kSize; x++) {
+        uint8_t* texel = &pixels_[(y * kSize + x) * 4];
+        texel[0] = x * 64;
+        texel[1] = y * 64;
+        texel[2] = 0;
+        texel[3] = 255;
+      }
+    }
+  }
+
+  SWSource GetSource() const {
+    SWSource source = SWSource();
+    source.pixels_ = pixels_.data();
+    source.stride_ = kSize * 4;
+    source.width_ = kSize;
+    source.height_ = kSize;
+    source.format_ = DRM_FORMAT_ABGR8888;
+    source.premult_ = true;
+    return source;
+  }
+
+  static const uint32_t kSize = 4;
+
+ private:
+  std::vector<uint8_t> pixels_;
+};
+
+// Returns a source of a single texel with bytes in memory order.
+static SWSource MakeTexel(const uint8_t* bytes, uint32_t format,
+                          bool premult) {
+  SWSource source = SWSource();
+  source.pixels_ = bytes;
+  source.stride_ = 4;
+  source.width_ = 1;
+  source.height_ = 1;
+  source.format_ = format;
+  source.premult_ = premult;
+  return source;
+}
+
+static SWSpan MakeSpan(float x, float y, float dx, float dy) {
+  SWSpan span;
+  span.x_ = x;
+  span.y_ = y;
+  span.dx_ = dx;
+  span.dy_ = dy;
+  return span;
+}
+
+// Returns true in case pixel i of row was sampled from texel x, y.
+static bool SampledFrom(const std::vector<float>& row, size_t i, uint32_t x,
+                        uint32_t y) {
+  return PixelIs(&row[i * 4], x * 64 / 255.0f, y * 64 / 255.0f, 0.0f, 1.0f);
+}
+
+static void TestFormats() {
+  EXPECT_TRUE(SWIsFormatSupported(DRM_FORMAT_ABGR8888));
+  EXPECT_TRUE(SWIsFormatSupported(DRM_FORMAT_XBGR8888));
+  EXPECT_TRUE(SWIsFormatSupported(DRM_FORMAT_ARGB8888));
+  EXPECT_TRUE(SWIsFormatSupported(DRM_FORMAT_XRGB8888));
+  EXPECT_FALSE(SWIsFormatSupported(DRM_FORMAT_NV12));
+
+  const uint8_t bytes[4] = {255, 128, 0, 64};
+  const SWSpan span = MakeSpan(0.0f, 0.0f, 1.0f, 0.0f);
+  float pixel[4];
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_ABGR8888, true), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 1.0f, 128 / 255.0f, 0.0f, 64 / 255.0f));
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_ARGB8888, true), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 0.0f, 128 / 255.0f, 1.0f, 64 / 255.0f));
+  // Alpha of X formats is ignored.
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_XBGR8888, true), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 1.0f, 128 / 255.0f, 0.0f, 1.0f));
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_XRGB8888, false), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 0.0f, 128 / 255.0f, 1.0f, 1.0f));
+}
+
+static void TestPremultAndCoverageSources() {
+  // Half transparent red, blended below an empty row and on top of
+  // opaque blue.
+  const uint8_t bytes[4] = {255, 0, 0, 128};
+  const SWSpan span = MakeSpan(0.0f, 0.0f, 1.0f, 0.0f);
+  const float blue[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  float half = 128 / 255.0f;
+  float pixel[4];
+
+  // Premultiplied texels are taken as is, i.e. red is added to what's
+  // below.
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_ABGR8888, true), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 1.0f, 0.0f, 0.0f, half));
+  float row[4];
+  SWInitRow(row, 1);
+  SWBlendRow(row, pixel, 1, 1.0f);
+  SWBlendRow(row, blue, 1, 1.0f);
+  EXPECT_TRUE(PixelIs(row, 1.0f, 0.0f, 1.0f - half, 0.0f));
+
+  // Coverage texels are premultiplied by their alpha.
+  SWFetchRow(MakeTexel(bytes, DRM_FORMAT_ABGR8888, false), span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, half, 0.0f, 0.0f, half));
+  SWInitRow(row, 1);
+  SWBlendRow(row, pixel, 1, 1.0f);
+  SWBlendRow(row, blue, 1, 1.0f);
+  EXPECT_TRUE(PixelIs(row, half, 0.0f, 1.0f - half, 0.0f));
+
+  // Same for solid colors, which have no pixels.
+  SWSource color = SWSource();
+  color.color_[0] = 1.0f;
+  color.color_[3] = 0.5f;
+  color.premult_ = false;
+  SWFetchRow(color, span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 0.5f, 0.0f, 0.0f, 0.5f));
+  color.premult_ = true;
+  SWFetchRow(color, span, 1, pixel);
+  EXPECT_TRUE(PixelIs(pixel, 1.0f, 0.0f, 0.0f, 0.5f));
+}
+
+static void TestBlendLayerAlpha() {
+  // Odd number of pixels, so that both the vectorized loop and the one
+  // handling the rest run.
+  const uint32_t kCount = 5;
+  std::vector<float> red(kCount * 4, 0.0f);
+  std::vector<float> blue(kCount * 4, 0.0f);
+  for (uint32_t i = 0; i < kCount; i++) {
+    red[i * 4] = red[i * 4 + 3] = 1.0f;
+    blue[i * 4 + 2] = blue[i * 4 + 3] = 1.0f;
+  }
+
+  std::vector<float> row(kCount * 4);
+  SWInitRow(row.data(), kCount);
+  for (uint32_t i = 0; i < kCount; i++)
+    EXPECT_TRUE(PixelIs(&row[i * 4], 0.0f, 0.0f, 0.0f, 1.0f));
+
+  // Layer alpha scales the source and what it covers.
+  SWBlendRow(row.data(), red.data(), kCount, 0.25f);
+  EXPECT_FALSE(SWIsRowCovered(row.data(), kCount));
+  SWBlendRow(row.data(), blue.data(), kCount, 0.5f);
+  EXPECT_FALSE(SWIsRowCovered(row.data(), kCount));
+  for (uint32_t i = 0; i < kCount; i++)
+    EXPECT_TRUE(PixelIs(&row[i * 4], 0.25f, 0.0f, 0.375f, 0.375f));
+
+  SWBlendRow(row.data(), blue.data(), kCount, 1.0f);
+  EXPECT_TRUE(SWIsRowCovered(row.data(), kCount));
+  for (uint32_t i = 0; i < kCount; i++)
+    EXPECT_TRUE(PixelIs(&row[i * 4], 0.25f, 0.0f, 0.75f, 0.0f));
+
+  // Layers below a covered row don't contribute anymore.
+  SWBlendRow(row.data(), red.data(), kCount, 1.0f);
+  for (uint32_t i = 0; i < kCount; i++)
+    EXPECT_TRUE(PixelIs(&row[i * 4], 0.25f, 0.0f, 0.75f, 0.0f));
+
+  // Transparent layers don't change anything.
+  SWInitRow(row.data(), kCount);
+  SWBlendRow(row.data(), red.data(), kCount, 0.0f);
+  for (uint32_t i = 0; i < kCount; i++)
+    EXPECT_TRUE(PixelIs(&row[i * 4], 0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+static void TestRotationAndFlips() {
+  // Spans SWRenderer uses for rows of rotated and flipped layers. Pixels
+  // map to texel centers, so samples are copied without filtering.
+  Texture texture;
+  const uint32_t kMax = Texture::kSize - 1;
+  SWSource source = texture.GetSource();
+  std::vector<float> row(Texture::kSize * 4);
+  for (uint32_t y = 0; y < Texture::kSize; y++) {
+    // Identity.
+    SWFetchRow(source, MakeSpan(0.0f, y, 1.0f, 0.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, i, y));
+
+    // Horizontal flip.
+    SWFetchRow(source, MakeSpan(kMax, y, -1.0f, 0.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, kMax - i, y));
+
+    // Vertical flip.
+    SWFetchRow(source, MakeSpan(0.0f, kMax - y, 1.0f, 0.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, i, kMax - y));
+
+    // 180 degrees.
+    SWFetchRow(source, MakeSpan(kMax, kMax - y, -1.0f, 0.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, kMax - i, kMax - y));
+
+    // 90 degrees, rows of the display are columns of the texture.
+    SWFetchRow(source, MakeSpan(y, kMax, 0.0f, -1.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, y, kMax - i));
+
+    // 270 degrees.
+    SWFetchRow(source, MakeSpan(kMax - y, 0.0f, 0.0f, 1.0f), Texture::kSize,
+               row.data());
+    for (uint32_t i = 0; i < Texture::kSize; i++)
+      EXPECT_TRUE(SampledFrom(row, i, kMax - y, i));
+  }
+}
+
+static void TestBilinearSampling() {
+  Texture texture;
+  SWSource source = texture.GetSource();
+  const uint32_t kCount = 7;
+  std::vector<float> row(kCount * 4);
+
+  // Sample positions off texel centers by less than 1/256 are copied.
+  SWFetchRow(source, MakeSpan(1.002f, 0.998f, 1.0f, 0.0f), 3, row.data());
+  for (uint32_t i = 0; i < 3; i++)
+    EXPECT_TRUE(SampledFrom(row, i, i + 1, 1));
+
+  // Half a texel off centers is filtered. Samples beyond the edges are
+  // clamped to the edge texels.
+  SWFetchRow(source, MakeSpan(-0.5f, 1.5f, 1.0f, 0.0f), 5, row.data());
+  EXPECT_TRUE(PixelIs(&row[0], 0.0f, 96 / 255.0f, 0.0f, 1.0f));
+  for (uint32_t i = 1; i < 4; i++) {
+    float red = (i - 0.5f) * 64 / 255.0f;
+    EXPECT_TRUE(PixelIs(&row[i * 4], red, 96 / 255.0f, 0.0f, 1.0f));
+  }
+  EXPECT_TRUE(PixelIs(&row[16], 192 / 255.0f, 96 / 255.0f, 0.0f, 1.0f));
+
+  // Upscaling interpolates between texels, vertically too.
+  SWFetchRow(source, MakeSpan(0.0f, 0.0f, 0.5f, 0.25f), kCount, row.data());
+  for (uint32_t i = 0; i < kCount; i++) {
+    float red = i * 0.5f * 64 / 255.0f;
+    float green = i * 0.25f * 64 / 255.0f;
+    EXPECT_TRUE(PixelIs(&row[i * 4], red, green, 0.0f, 1.0f));
+  }
+
+  // Downscaling by two at texel centers takes every other texel.
+  SWFetchRow(source, MakeSpan(0.0f, 2.0f, 2.0f, 0.0f), 2, row.data());
+  EXPECT_TRUE(SampledFrom(row, 0, 0, 2));
+  EXPECT_TRUE(SampledFrom(row, 1, 2, 2));
+}
+
+static void TestStoreRow() {
+  // Premultiplied colors with the coverage left for layers below.
+  const float row[8] = {0.5f, 0.25f, 0.0f, 0.5f, 1.0f, 0.0f, 1.0f, 0.0f};
+  uint8_t dst[8];
+  SWStoreRow(row, 2, DRM_FORMAT_ABGR8888, dst);
+  EXPECT_TRUE(NearByte(128, dst[0]) && NearByte(64, dst[1]) &&
+              NearByte(0, dst[2]) && NearByte(128, dst[3]));
+  EXPECT_TRUE(NearByte(255, dst[4]) && NearByte(0, dst[5]) &&
+              NearByte(255, dst[6]) && NearByte(255, dst[7]));
+
+  SWStoreRow(row, 2, DRM_FORMAT_XRGB8888, dst);
+  EXPECT_TRUE(NearByte(0, dst[0]) && NearByte(64, dst[1]) &&
+              NearByte(128, dst[2]) && NearByte(128, dst[3]));
+
+  // Unsupported formats aren't written to.
+  uint8_t untouched[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  SWStoreRow(row, 2, DRM_FORMAT_NV12, untouched);
+  for (uint8_t i = 0; i < 8; i++)
+    EXPECT_EQ(i + 1, untouched[i]);
+
+  // Stored pixels read back the same.
+  float pixels[8];
+  SWFetchRow(MakeTexel(dst, DRM_FORMAT_ARGB8888, true),
+             MakeSpan(0.0f, 0.0f, 1.0f, 0.0f), 1, pixels);
+  EXPECT_TRUE(PixelIs(pixels, 0.5f, 0.25f, 0.0f, 0.5f));
+}
+
+int main() {
+  RUN_TEST(TestFormats);
+  RUN_TEST(TestPremultAndCoverageSources);
+  RUN_TEST(TestBlendLayerAlpha);
+  RUN_TEST(TestRotationAndFlips);
+  RUN_TEST(TestBilinearSampling);
+  RUN_TEST(TestStoreRow);
+  return UNITTEST_RESULT();
+}
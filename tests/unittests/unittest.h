@@ -0,0 +1,50 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_UNITTESTS_UNITTEST_H_
+#define TESTS_UNITTESTS_UNITTEST_H_
+
+#include <stdio.h>
+
+// Minimal checks for the unit tests run by "make check". Every test is a
+// program of its own, which returns non zero in case any check failed.
+
+static int unittest_failures = 0;
+
+#define EXPECT_TRUE(cond)                                         \
+  do {                                                            \
+    if (!(cond)) {                                                \
+      fprintf(stderr, "%s:%d: Expected %s\n", __FILE__, __LINE__, \
+              #cond);                                             \
+      unittest_failures++;                                        \
+    }                                                             \
+  } while (0)
+
+#define EXPECT_FALSE(cond) EXPECT_TRUE(!(cond))
+#define EXPECT_EQ(expected, actual) EXPECT_TRUE((expected) == (actual))
+
+#define RUN_TEST(test)                      \
+  do {                                      \
+    int failures = unittest_failures;       \
+    test();                                 \
+    printf("%s %s\n",                       \
+           failures == unittest_failures ? "[ PASS ]" : "[ FAIL ]", \
+           #test);                          \
+  } while (0)
+
+#define UNITTEST_RESULT() (unittest_failures == 0 ? 0 : 1)
+
+#endif  // TESTS_UNITTESTS_UNITTEST_H_
@@ -111,9 +111,19 @@ LOCAL_CPPFLAGS += \
 LOCAL_C_INCLUDES += \
         $(LOCAL_PATH)/../common/compositor/vk \
         $(LOCAL_PATH)/../../mesa/include
+else ifeq ($(strip $(BOARD_USES_SW_COMPOSITOR)), true)
+LOCAL_CPPFLAGS += \
+        -DUSE_SW
+
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/../common/compositor/sw
 else
 LOCAL_CPPFLAGS += \
         -DUSE_GL
+
+ifeq ($(strip $(HWC_SHARED_COMPOSITOR)), true)
+LOCAL_CPPFLAGS += -DENABLE_SHARED_COMPOSITOR
+endif
 endif
 
 LOCAL_C_INCLUDES += \
@@ -20,6 +20,7 @@
 #include "displayplanestate.h"
 namespace hwcomposer {
 
+class PlaneBroker;
 struct OverlayLayer;
 
 struct OverlayPlane {
@@ -40,6 +41,14 @@ class DisplayPlaneHandler {
       std::vector<std::unique_ptr<DisplayPlane>>& overlay_planes) = 0;
 
   virtual bool TestCommit(const DisplayPlaneStateList& composition) const = 0;
+
+  /**
+   * API for querying the broker sharing planes with other
+   * displays. Returns NULL in case planes are not shared.
+   */
+  virtual PlaneBroker* GetPlaneBroker() const {
+    return NULL;
+  }
 };
 
 }  // namespace hwcomposer
@@ -29,6 +29,10 @@
 #include "hwcutils.h"
 #include "resourcemanager.h"
 
+#ifdef ENABLE_SHARED_COMPOSITOR
+#include "glimportcache.h"
+#endif
+
 #ifndef DISABLE_VA
 #include <va/va_drmcommon.h>
 #include "vautils.h"
@@ -122,6 +126,18 @@ const ResourceHandle& DrmBuffer::GetGpuResource(GpuDisplay egl_display,
   }
 
 #if USE_GL
+#ifdef ENABLE_SHARED_COMPOSITOR
+  // Imports are set up once by the compositor creating them, as other
+  // compositors may be using them meanwhile.
+  if (image_.texture_ && image_.image_ != EGL_NO_IMAGE_KHR)
+    return image_;
+
+  if (image_.image_ == 0 && external_import &&
+      GLImportCache::Acquire(image_.handle_->meta_data_, format_,
+                             &image_.image_, &image_.texture_))
+    return image_;
+#endif
+
   if (image_.image_ == 0) {
     EGLImageKHR image = EGL_NO_IMAGE_KHR;
     uint32_t total_planes = METADATA(num_planes_);
@@ -263,9 +279,20 @@ const ResourceHandle& DrmBuffer::GetGpuResource(GpuDisplay egl_display,
 
   glBindTexture(target, 0);
 
+#ifdef ENABLE_SHARED_COMPOSITOR
+  // Framebuffers aren't shared between contexts, surfaces are drawn with
+  // the one of the renderer drawing them instead, see GLSurface.
+  if (external_import && image_.image_ != EGL_NO_IMAGE_KHR) {
+    // Other compositors might pick up the import right away.
+    glFlush();
+    GLImportCache::Add(image_.handle_->meta_data_, format_, image_.image_,
+                       image_.texture_);
+  }
+#else
   if (!external_import && image_.fb_ == 0) {
     glGenFramebuffers(1, &image_.fb_);
   }
+#endif
 #elif USE_VK
   if (image_.image_ == VK_NULL_HANDLE) {
     VkDevice dev = egl_display;
@@ -302,6 +329,8 @@ const ResourceHandle& DrmBuffer::GetGpuResource(GpuDisplay egl_display,
       ETRACE("vkCreateDmaBufImageINTEL failed\n");
     }
   }
+#elif USE_SW
+  image_.handler_ = resource_manager_->GetNativeBufferHandler();
 #endif
   return image_;
 }
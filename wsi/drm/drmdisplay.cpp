@@ -719,11 +719,15 @@ bool DrmDisplay::Commit(
   }
 
 #ifdef ENABLE_DOUBLE_BUFFERING
+  // In pipelined mode DisplayQueue waits for the flip before the next
+  // commit, so that it overlaps with composition of the next frame.
   int32_t fence = *commit_fence;
-  if (fence > 0) {
+  if (fence > 0 && pipeline_depth_ == 1) {
+    int64_t wait_start = GetMonotonicTime();
     HWCPoll(fence, -1);
     close(fence);
     *commit_fence = 0;
+    display_queue_->AddStageTiming(HWCFrameStage::kFenceWait, wait_start);
   }
 #endif
   if (first_commit_) {
@@ -792,18 +796,31 @@ bool DrmDisplay::CommitFrame(
 
 #ifndef ENABLE_DOUBLE_BUFFERING
   if (previous_fence > 0) {
+    int64_t wait_start = GetMonotonicTime();
     HWCPoll(previous_fence, -1);
     close(previous_fence);
     *previous_fence_released = true;
+    display_queue_->AddStageTiming(HWCFrameStage::kFenceWait, wait_start);
   }
 #endif
 
+  int64_t commit_start = GetMonotonicTime();
   int ret = drmModeAtomicCommit(gpu_fd_, pset, flags, NULL);
+  display_queue_->AddStageTiming(HWCFrameStage::kAtomicCommit, commit_start);
   if (ret) {
     ETRACE("Failed to commit pset ret=%s\n", PRINTERROR());
     return false;
   }
 
+  // Planes given up by this display have been disabled with this commit
+  // and can be handed to other displays now.
+  std::vector<uint32_t> planes;
+  planes.reserve(comp_planes.size());
+  for (const DisplayPlaneState &comp_plane : comp_planes) {
+    planes.emplace_back(comp_plane.GetDisplayPlane()->id());
+  }
+
+  manager_->GetPlaneBroker()->FrameCommitted(pipe_, planes);
   return true;
 }
 
@@ -1225,6 +1242,7 @@ void DrmDisplay::Disable(const DisplayPlaneStateList &composition_planes) {
 
   drmModeConnectorSetProperty(gpu_fd_, connector_, dpms_prop_,
                               DRM_MODE_DPMS_OFF);
+  manager_->GetPlaneBroker()->DisablePipe(pipe_);
 }
 
 void DrmDisplay::ReleaseUnreservedPlanes(
@@ -1337,6 +1355,10 @@ bool DrmDisplay::TestCommit(const DisplayPlaneStateList &composition) const {
   return true;
 }
 
+PlaneBroker *DrmDisplay::GetPlaneBroker() const {
+  return manager_->GetPlaneBroker();
+}
+
 std::unique_ptr<DrmPlane> DrmDisplay::CreatePlane(uint32_t plane_id,
                                                   uint32_t possible_crtcs) {
   return std::unique_ptr<DrmPlane>(new DrmPlane(plane_id, possible_crtcs));
@@ -110,6 +110,8 @@ class DrmDisplay : public PhysicalDisplay {
   bool PopulatePlanes(
       std::vector<std::unique_ptr<DisplayPlane>> &overlay_planes) override;
 
+  PlaneBroker *GetPlaneBroker() const override;
+
   void NotifyClientsOfDisplayChangeStatus() override;
 
   void ForceRefresh();
@@ -40,6 +40,7 @@ namespace hwcomposer {
 
 DrmDisplayManager::DrmDisplayManager() : HWCThread(-8, "DisplayManager") {
   CTRACE();
+  plane_broker_.SetCallback(this);
 }
 
 DrmDisplayManager::~DrmDisplayManager() {
@@ -696,6 +697,16 @@ void DrmDisplayManager::RemoveUnreservedPlanes() {
   }
 }
 
+void DrmDisplayManager::Callback(uint32_t pipe) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    if (static_cast<uint32_t>(displays_.at(i)->GetDisplayPipe()) == pipe) {
+      displays_.at(i)->ForceRefresh();
+      break;
+    }
+  }
+}
+
 FrameBufferManager *DrmDisplayManager::GetFrameBufferManager() {
   return frame_buffer_manager_.get();
 }
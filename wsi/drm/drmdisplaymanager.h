@@ -44,7 +44,9 @@ namespace hwcomposer {
 
 class NativeDisplay;
 
-class DrmDisplayManager : public HWCThread, public DisplayManager {
+class DrmDisplayManager : public HWCThread,
+                          public DisplayManager,
+                          public PlaneBrokerCallback {
  public:
   DrmDisplayManager();
   ~DrmDisplayManager() override;
@@ -103,6 +105,16 @@ class DrmDisplayManager : public HWCThread, public DisplayManager {
 
   FrameBufferManager *GetFrameBufferManager() override;
 
+  // Planes which can be used with more than one pipe are shared between
+  // displays.
+  PlaneBroker *GetPlaneBroker() {
+    return &plane_broker_;
+  }
+
+  // Refreshes the display using pipe, so it gives up planes handed to
+  // another display.
+  void Callback(uint32_t pipe) override;
+
  protected:
   void HandleWait() override;
   void HandleRoutine() override;
@@ -113,6 +125,7 @@ class DrmDisplayManager : public HWCThread, public DisplayManager {
   std::map<uint32_t, std::unique_ptr<NativeDisplay>> virtual_displays_;
   std::unique_ptr<FrameBufferManager> frame_buffer_manager_;
   std::vector<std::unique_ptr<DrmDisplay>> displays_;
+  PlaneBroker plane_broker_;
   std::shared_ptr<DisplayHotPlugEventCallback> callback_ = NULL;
   std::unique_ptr<NativeBufferHandler> buffer_handler_;
   GpuDevice &device_ = GpuDevice::getInstance();
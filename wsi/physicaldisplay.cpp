@@ -447,6 +447,86 @@ void PhysicalDisplay::SetDisableExplicitSync(bool disable_explicit_sync) {
   display_queue_->SetDisableExplicitSync(disable_explicit_sync);
 }
 
+void PhysicalDisplay::SetPipelineDepth(uint32_t depth) {
+  // DrmDisplay only waits for the flip itself with a depth of 1, the
+  // queue needs to use the same depth.
+  if (depth == 0 || depth > kMaxPipelineDepth) {
+    uint32_t supported = depth == 0 ? 1 : kMaxPipelineDepth;
+    WTRACE("Pipeline depth %d not supported, using %d.", depth, supported);
+    depth = supported;
+  }
+
+  display_queue_->SetPipelineDepth(depth);
+  pipeline_depth_ = depth;
+}
+
+void PhysicalDisplay::SetMailboxMode(bool enable) {
+  // Goes through SetPipelineDepth, so that DrmDisplay leaves waiting for
+  // the flip to the queue as well.
+  if (enable && pipeline_depth_ < kMaxPipelineDepth)
+    SetPipelineDepth(kMaxPipelineDepth);
+
+  display_queue_->SetMailboxMode(enable);
+}
+
+bool PhysicalDisplay::GetFrameCoalescingStats(uint32_t *presented,
+                                              uint32_t *coalesced) {
+  display_queue_->GetFrameCoalescingStats(presented, coalesced);
+  return true;
+}
+
+bool PhysicalDisplay::GetFrameStageTiming(HWCFrameStage stage,
+                                          HWCStageTiming *timing) {
+  return display_queue_->GetFrameStageTiming(stage, timing);
+}
+
+bool PhysicalDisplay::GetDrawCallStats(uint64_t *frames,
+                                       uint64_t *draw_calls) {
+  display_queue_->GetDrawCallStats(frames, draw_calls);
+  return true;
+}
+
+void PhysicalDisplay::SetCompositionCacheBudget(uint64_t budget) {
+  display_queue_->SetCompositionCacheBudget(budget);
+}
+
+bool PhysicalDisplay::GetCompositionCacheStats(uint32_t *hits,
+                                               uint32_t *misses) {
+  display_queue_->GetCompositionCacheStats(hits, misses);
+  return true;
+}
+
+void PhysicalDisplay::SetOffScreenSurfaceBudget(uint64_t budget) {
+  display_queue_->SetOffScreenSurfaceBudget(budget);
+}
+
+bool PhysicalDisplay::PresentAt(std::vector<HwcLayer *> &source_layers,
+                                int32_t *retire_fence, int64_t target_timestamp,
+                                PixelUploaderCallback *call_back,
+                                bool handle_constraints) {
+  display_queue_->SetTargetPresentTime(target_timestamp);
+  bool success =
+      Present(source_layers, retire_fence, call_back, handle_constraints);
+  display_queue_->SetTargetPresentTime(-1);
+  return success;
+}
+
+bool PhysicalDisplay::GetNextVblankTime(int64_t *timestamp) {
+  return display_queue_->GetNextVblankTime(timestamp);
+}
+
+void PhysicalDisplay::SetPresentMarginTuning(uint32_t deviation_factor,
+                                             uint32_t slack_us) {
+  display_queue_->SetPresentMarginTuning(deviation_factor, slack_us);
+}
+
+void PhysicalDisplay::SetIdleHysteresis(uint32_t min_idle_frames,
+                                        uint32_t max_idle_frames,
+                                        uint32_t exit_frames) {
+  display_queue_->SetIdleHysteresis(min_idle_frames, max_idle_frames,
+                                    exit_frames);
+}
+
 void PhysicalDisplay::SetVideoScalingMode(uint32_t mode) {
   display_queue_->SetVideoScalingMode(mode);
 }
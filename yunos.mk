@@ -45,16 +45,29 @@ LOCAL_SRC_FILES := os/alios/hwf_alioshal.cpp \
     common/core/resourcemanager.cpp \
     common/core/framebuffermanager.cpp \
     common/utils/hwcutils.cpp \
+    common/utils/timinghistogram.cpp \
     common/utils/hwcthread.cpp \
     common/utils/hwcevent.cpp \
+    common/utils/synctimeline.cpp \
     common/utils/fdhandler.cpp \
     common/utils/disjoint_layers.cpp \
     common/display/virtualdisplay.cpp \
+    common/display/compositioncache.cpp \
+    common/display/displaycommitthread.cpp \
     common/display/displayqueue.cpp \
     common/display/displayplanestate.cpp \
+    common/display/idlepolicy.cpp \
+    common/display/marginestimator.cpp \
+    common/display/planeallocator.cpp \
+    common/display/planebroker.cpp \
+    common/display/planecostmodel.cpp \
+    common/display/planevalidationcache.cpp \
+    common/display/planevalidationstrategy.cpp \
+    common/display/surfacepool.cpp \
     common/display/displayplanemanager.cpp \
     common/display/vblankeventhandler.cpp \
     common/compositor/compositor.cpp \
+    common/compositor/compositorservice.cpp \
     common/compositor/compositorthread.cpp \
     common/compositor/nativesurface.cpp \
     common/compositor/factory.cpp \
@@ -65,6 +78,8 @@ LOCAL_SRC_FILES := os/alios/hwf_alioshal.cpp \
     common/compositor/gl/egloffscreencontext.cpp \
     common/compositor/gl/nativeglresource.cpp \
     common/compositor/gl/glprogram.cpp \
+    common/compositor/gl/glprogramcache.cpp \
+    common/compositor/gl/glimportcache.cpp \
     common/compositor/va/varenderer.cpp \
     common/compositor/va/vautils.cpp \
     wsi/drm/drmdisplaymanager.cpp \